@@ -60,6 +60,7 @@ CLANG_DIAG_ON(unknown-pragmas)
 
 #include "Engine/BlockingBackgroundRender.h"
 #include "Engine/CLArgs.h"
+#include "Engine/CombinedRender.h"
 #include "Engine/CreateNodeArgs.h"
 #include "Engine/FileDownloader.h"
 #include "Engine/GroupOutput.h"
@@ -140,6 +141,9 @@ struct RenderQueueItem
     QString sequenceName;
     QString savePath;
     ProcessHandlerPtr process;
+
+    // If set, the writer renders together with the other writers of this group, which are started at the same time
+    CombinedRenderPtr combinedRender;
 };
 
 struct AppInstancePrivate
@@ -204,6 +208,17 @@ public:
     void getSequenceNameFromWriter(const OutputEffectInstance* writer, QString* sequenceName);
 
     void startRenderingFullSequence(bool blocking, const RenderQueueItem& writerWork);
+
+    /**
+     * @brief Groups the given renders with a CombinedRender if their writers share nodes
+     **/
+    void combineRenders(std::list<RenderQueueItem>* items);
+
+    /**
+     * @brief Removes from the render queue the renders of the given group and appends them to the given list.
+     * Must be called with renderQueueMutex locked.
+     **/
+    void takeQueuedRendersOfGroup(const CombinedRenderPtr& combinedRender, std::list<RenderQueueItem>* items);
 };
 
 AppInstance::AppInstance(int appID)
@@ -1809,6 +1824,10 @@ AppInstance::startWritersRendering(bool doBlockingRender,
         return;
     }
 
+    if ( !renderInSeparateProcess && (itemsToQueue.size() > 1) && appPTR->getCurrentSettings()->isCombinedWritersRenderEnabled() ) {
+        _imp->combineRenders(&itemsToQueue);
+    }
+
     if (appPTR->isBackground() || doBlockingRender) {
         //blocking call, we don't want this function to return pre-maturely, in which case it would kill the app
         QtConcurrent::blockingMap( itemsToQueue, boost::bind(&AppInstancePrivate::startRenderingFullSequence, _imp.get(), true, _1) );
@@ -1822,13 +1841,18 @@ AppInstance::startWritersRendering(bool doBlockingRender,
                 return;
             } else {
                 std::list<RenderQueueItem>::const_iterator it = itemsToQueue.begin();
-                const RenderQueueItem& firstWork = *it;
+                std::list<RenderQueueItem> worksToStart;
+                worksToStart.push_back(*it);
                 ++it;
                 for (; it != itemsToQueue.end(); ++it) {
                     _imp->renderQueue.push_back(*it);
                 }
+                // The writers rendering together with the first one must start with it
+                _imp->takeQueuedRendersOfGroup(worksToStart.front().combinedRender, &worksToStart);
                 k.unlock();
-                _imp->startRenderingFullSequence(false, firstWork);
+                for (it = worksToStart.begin(); it != worksToStart.end(); ++it) {
+                    _imp->startRenderingFullSequence(false, *it);
+                }
             }
         } else {
             for (std::list<RenderQueueItem>::const_iterator it = itemsToQueue.begin(); it != itemsToQueue.end(); ++it) {
@@ -1901,10 +1925,58 @@ AppInstancePrivate::validateRenderOptions(const AppInstance::RenderWork& w,
     return true;
 }
 
+void
+AppInstancePrivate::combineRenders(std::list<RenderQueueItem>* items)
+{
+    std::list<CombinedRender::WriterRange> writers;
+
+    for (std::list<RenderQueueItem>::const_iterator it = items->begin(); it != items->end(); ++it) {
+        // A writer rendering several frame ranges renders them one after the other: it cannot render with the other writers
+        for (std::list<CombinedRender::WriterRange>::const_iterator it2 = writers.begin(); it2 != writers.end(); ++it2) {
+            if (it2->writer == it->work.writer) {
+                return;
+            }
+        }
+        CombinedRender::WriterRange w;
+        w.writer = it->work.writer;
+        w.firstFrame = it->work.firstFrame;
+        w.lastFrame = it->work.lastFrame;
+        w.frameStep = it->work.frameStep;
+        writers.push_back(w);
+    }
+
+    CombinedRenderPtr combinedRender = boost::make_shared<CombinedRender>(writers);
+    if (combinedRender->getNSharedNodes() == 0) {
+        return;
+    }
+    for (std::list<RenderQueueItem>::iterator it = items->begin(); it != items->end(); ++it) {
+        it->combinedRender = combinedRender;
+    }
+}
+
+void
+AppInstancePrivate::takeQueuedRendersOfGroup(const CombinedRenderPtr& combinedRender,
+                                             std::list<RenderQueueItem>* items)
+{
+    if (!combinedRender) {
+        return;
+    }
+    for (std::list<RenderQueueItem>::iterator it = renderQueue.begin(); it != renderQueue.end();) {
+        if (it->combinedRender == combinedRender) {
+            items->push_back(*it);
+            it = renderQueue.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 void
 AppInstancePrivate::startRenderingFullSequence(bool blocking,
                                                const RenderQueueItem& w)
 {
+    w.work.writer->setCombinedRender(w.combinedRender);
+
     if (blocking) {
         BlockingBackgroundRender backgroundRender(w.work.writer);
         backgroundRender.blockingRender(w.work.useRenderStats, w.work.firstFrame, w.work.lastFrame, w.work.frameStep); //< doesn't return before rendering is finished
@@ -1956,7 +2028,7 @@ AppInstance::removeRenderFromQueue(OutputEffectInstance* writer)
 void
 AppInstance::startNextQueuedRender(OutputEffectInstance* finishedWriter)
 {
-    RenderQueueItem nextWork;
+    std::list<RenderQueueItem> nextWorks;
 
     // Do not make the process die under the mutex otherwise we may deadlock
     ProcessHandlerPtr processDying;
@@ -1969,16 +2041,20 @@ AppInstance::startNextQueuedRender(OutputEffectInstance* finishedWriter)
                 break;
             }
         }
-        if ( !_imp->renderQueue.empty() ) {
-            nextWork = _imp->renderQueue.front();
+        // Wait for all the writers of a combined render to finish before starting the next render
+        if ( !_imp->renderQueue.empty() && ( _imp->activeRenders.empty() || !_imp->activeRenders.front().combinedRender ) ) {
+            nextWorks.push_back( _imp->renderQueue.front() );
             _imp->renderQueue.pop_front();
+            _imp->takeQueuedRendersOfGroup(nextWorks.front().combinedRender, &nextWorks);
         } else {
             return;
         }
     }
     processDying.reset();
 
-    _imp->startRenderingFullSequence(false, nextWork);
+    for (std::list<RenderQueueItem>::const_iterator it = nextWorks.begin(); it != nextWorks.end(); ++it) {
+        _imp->startRenderingFullSequence(false, *it);
+    }
 }
 
 void
@@ -48,6 +48,7 @@
 
 #include <clocale>
 #include <csignal>
+#include <algorithm>
 #include <cstddef>
 #include <cassert>
 #include <stdexcept>
@@ -116,7 +117,8 @@
 #include "Engine/JoinViewsNode.h"
 #include "Engine/LibraryBinary.h"
 #include "Engine/Log.h"
-#include "Engine/MemoryInfo.h" // getSystemTotalRAM, printAsRAM
+#include "Engine/MemoryGovernor.h"
+#include "Engine/MemoryInfo.h" // printAsRAM
 #include "Engine/Node.h"
 #include "Engine/OfxImageEffectInstance.h"
 #include "Engine/OfxEffectInstance.h"
@@ -126,6 +128,7 @@
 #include "Engine/ProcessHandler.h" // ProcessInputChannel
 #include "Engine/Project.h"
 #include "Engine/PrecompNode.h"
+#include "Engine/RamBufferPool.h"
 #include "Engine/ReadNode.h"
 #include "Engine/RotoPaint.h"
 #include "Engine/RotoSmear.h"
@@ -594,6 +597,11 @@ AppManager::~AppManager()
     ///Caches may have launched some threads to delete images, wait for them to be done
     QThreadPool::globalInstance()->waitForDone();
 
+    ///The governor evicts from the caches: stop it before them
+    if (_imp->memoryGovernor) {
+        _imp->memoryGovernor->quitThread();
+    }
+
     ///Kill caches now because decreaseNCacheFilesOpened can be called
     _imp->_nodeCache->waitForDeleterThread();
     _imp->_diskCache->waitForDeleterThread();
@@ -1068,7 +1076,7 @@ bool
 AppManager::loadInternalAfterInitGui(const CLArgs& cl)
 {
     try {
-        size_t maxCacheRAM = _imp->_settings->getRamMaximumPercent() * getSystemTotalRAM();
+        size_t maxCacheRAM = _imp->_settings->getRamMaximumPercent() * MemoryGovernor::getTotalRAM();
         U64 viewerCacheSize = _imp->_settings->getMaximumViewerDiskCacheSize();
         U64 maxDiskCacheNode = _imp->_settings->getMaximumDiskCacheNodeSize();
 
@@ -1076,9 +1084,14 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
         _imp->_diskCache = boost::make_shared<Cache<Image> >("DiskCache", NATRON_CACHE_VERSION, maxDiskCacheNode, 0.);
         _imp->_viewerCache = boost::make_shared<Cache<FrameEntry> >("ViewerCache", NATRON_CACHE_VERSION, viewerCacheSize, 0.);
         _imp->setViewerCacheTileSize();
+        setApplicationsCachesFileMappingFlags( _imp->_settings->getDiskCacheFileMappingFlags() );
     } catch (std::logic_error&) {
         // ignore
     }
+    if (_imp->_nodeCache && _imp->_viewerCache) {
+        _imp->memoryGovernor.reset( new MemoryGovernor() );
+        _imp->memoryGovernor->start();
+    }
 
     int oldCacheVersion = 0;
     {
@@ -1407,6 +1420,7 @@ AppManager::clearAllCaches()
 
     clearDiskCache();
     clearNodeCache();
+    RamBufferPool::purge();
 
 
     ///for each app instance clear all its nodes cache
@@ -1493,7 +1507,7 @@ AppManager::writeToOutputPipe(const QString & longMessage,
 void
 AppManager::setApplicationsCachesMaximumMemoryPercent(double p)
 {
-    size_t maxCacheRAM = p * getSystemTotalRAM_conditionnally();
+    size_t maxCacheRAM = p * MemoryGovernor::getTotalRAM();
 
     _imp->_nodeCache->setMaximumCacheSize(maxCacheRAM);
     _imp->_nodeCache->setMaximumInMemorySize(1);
@@ -1511,6 +1525,14 @@ AppManager::setApplicationsCachesMaximumDiskSpace(unsigned long long size)
     _imp->_diskCache->setMaximumCacheSize(size);
 }
 
+void
+AppManager::setApplicationsCachesFileMappingFlags(int flags)
+{
+    _imp->_nodeCache->setFileMappingFlags(flags);
+    _imp->_diskCache->setFileMappingFlags(flags);
+    _imp->_viewerCache->setFileMappingFlags(flags);
+}
+
 void
 AppManager::loadAllPlugins()
 {
@@ -2505,6 +2527,24 @@ AppManager::removeAllCacheEntriesForHolder(const CacheEntryHolder* holder,
     _imp->_viewerCache->removeAllEntriesForHolderPublic(holder, blocking);
 }
 
+void
+AppManager::setCachePolicyForHolder(const CacheEntryHolder* holder,
+                                    std::size_t budget,
+                                    CachePriorityEnum priority)
+{
+    _imp->_nodeCache->setHolderPolicy(holder, budget, priority);
+    _imp->_diskCache->setHolderPolicy(holder, budget, priority);
+    _imp->_viewerCache->setHolderPolicy(holder, budget, priority);
+}
+
+void
+AppManager::removeCachePolicyForHolder(const CacheEntryHolder* holder)
+{
+    _imp->_nodeCache->removeHolderPolicy(holder);
+    _imp->_diskCache->removeHolderPolicy(holder);
+    _imp->_viewerCache->removeHolderPolicy(holder);
+}
+
 const QString &
 AppManager::getApplicationBinaryPath() const
 {
@@ -2570,6 +2610,12 @@ AppManager::getTextureOrCreate(const FrameKey & key,
     return _imp->_viewerCache->getOrCreate(key, params, locker, returnValue);
 }
 
+void
+AppManager::prefetchTexture(const FrameKey & key) const
+{
+    _imp->_viewerCache->prefetch(key);
+}
+
 bool
 AppManager::isAggressiveCachingEnabled() const
 {
@@ -2579,7 +2625,7 @@ AppManager::isAggressiveCachingEnabled() const
 U64
 AppManager::getCachesTotalMemorySize() const
 {
-    return  _imp->_nodeCache->getMemoryCacheSize();
+    return  _imp->_nodeCache->getMemoryCacheSize() + RamBufferPool::getIdleBytes();
 }
 
 U64
@@ -2889,10 +2935,42 @@ AppManager::isNodeCacheAlmostFull() const
 void
 AppManager::checkCacheFreeMemoryIsGoodEnough()
 {
+    ///Idle blocks kept by the image buffer pool count toward the budget of the node cache, which holds the images.
+    ///They hold no data, so they are released before any entry gets evicted.
+    {
+        std::size_t nodeCacheSize = _imp->_nodeCache->getMemoryCacheSize();
+        std::size_t nodeMaxCacheSize = _imp->_nodeCache->getMaximumMemorySize();
+        RamBufferPool::trim(nodeMaxCacheSize > nodeCacheSize ? nodeMaxCacheSize - nodeCacheSize : 0);
+    }
+
+    ///The memory governor samples the system in the background and publishes how much the caches may hold:
+    ///the allocation path only compares against it. Eviction is left to the governor unless the caches grew
+    ///well beyond the budget since the last sample.
+    if (_imp->memoryGovernor) {
+        std::size_t budget = _imp->memoryGovernor->getMemoryBudget();
+        std::size_t cachesSize = getCachesInMemorySize();
+        if (cachesSize > budget) {
+#ifdef NATRON_DEBUG_CACHE
+            qDebug() << "Caches are above the memory budget:" << printAsRAM(cachesSize) << ">" << printAsRAM(budget);
+#endif
+            if ( (double)(cachesSize - budget) > (double)budget * NATRON_MEMORY_GOVERNOR_HARD_LIMIT_MARGIN ) {
+                releaseCachesMemory(cachesSize - budget);
+            }
+            _imp->memoryGovernor->requestUpdate();
+        }
+
+        return;
+    }
+
     ///Before allocating the memory check that there's enough space to fit in memory
-    size_t systemRAMToKeepFree = getSystemTotalRAM() * appPTR->getCurrentSettings()->getUnreachableRamPercent();
+    size_t systemRAMToKeepFree = MemoryGovernor::getTotalRAM() * appPTR->getCurrentSettings()->getUnreachableRamPercent();
     size_t totalFreeRAM = getAmountFreePhysicalRAM();
 
+    if ( (totalFreeRAM <= systemRAMToKeepFree) && (RamBufferPool::getIdleBytes() > 0) ) {
+        RamBufferPool::purge();
+        totalFreeRAM = getAmountFreePhysicalRAM();
+    }
+
     while (totalFreeRAM <= systemRAMToKeepFree) {
 #ifdef NATRON_DEBUG_CACHE
         qDebug() << "Total system free RAM is below the threshold:" << printAsRAM(totalFreeRAM)
@@ -2907,6 +2985,47 @@ AppManager::checkCacheFreeMemoryIsGoodEnough()
     }
 }
 
+std::size_t
+AppManager::getCachesInMemorySize() const
+{
+    return _imp->_nodeCache->getMemoryCacheSize() + _imp->_viewerCache->getMemoryCacheSize() + RamBufferPool::getIdleBytes();
+}
+
+void
+AppManager::releaseCachesMemory(std::size_t bytesToFree)
+{
+    ///Idle buffers hold no data: they go first
+    std::size_t idleBytes = RamBufferPool::getIdleBytes();
+
+    if (idleBytes > 0) {
+        RamBufferPool::trim(idleBytes > bytesToFree ? idleBytes - bytesToFree : 0);
+        std::size_t released = idleBytes - std::min( idleBytes, RamBufferPool::getIdleBytes() );
+        if (released >= bytesToFree) {
+            return;
+        }
+        bytesToFree -= released;
+    }
+
+    ///Share the rest between the caches in proportion of their size, so that neither of them gets emptied first
+    std::size_t nodeCacheSize = _imp->_nodeCache->getMemoryCacheSize();
+    std::size_t viewerCacheSize = _imp->_viewerCache->getMemoryCacheSize();
+    if (nodeCacheSize + viewerCacheSize == 0) {
+        return;
+    }
+    std::size_t nodeCacheShare = (std::size_t)( (double)bytesToFree * nodeCacheSize / (nodeCacheSize + viewerCacheSize) );
+    std::size_t viewerCacheShare = bytesToFree - nodeCacheShare;
+    std::size_t freed = _imp->_nodeCache->evictLRUInMemoryEntries(nodeCacheShare);
+    freed += _imp->_viewerCache->evictLRUInMemoryEntries(viewerCacheShare);
+
+    ///Entries in use cannot be evicted: take what is missing from whichever cache can still give
+    if (freed < bytesToFree) {
+        freed += _imp->_nodeCache->evictLRUInMemoryEntries(bytesToFree - freed);
+    }
+    if (freed < bytesToFree) {
+        _imp->_viewerCache->evictLRUInMemoryEntries(bytesToFree - freed);
+    }
+}
+
 void
 AppManager::onOCIOConfigPathChanged(const std::string& path)
 {
@@ -3778,6 +3897,12 @@ AppManager::getGPUContextPool() const
     return _imp->renderingContextPool.get();
 }
 
+FilePrefetcher*
+AppManager::getFilePrefetcher() const
+{
+    return _imp->filePrefetcher.get();
+}
+
 void
 AppManager::refreshOpenGLRenderingFlagOnAllInstances()
 {
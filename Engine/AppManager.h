@@ -219,6 +219,11 @@ public:
                             FrameEntryLocker* locker,
                             FrameEntryPtr* returnValue) const;
 
+    /**
+     * @brief Starts reading in the background the texture matching the key if it is only in the disk portion of the viewer cache
+     **/
+    void prefetchTexture(const FrameKey & key) const;
+
 
     U64 getCachesTotalMemorySize() const;
     U64 getCachesTotalDiskSize() const;
@@ -230,6 +235,11 @@ public:
 
     void setApplicationsCachesMaximumDiskSpace(unsigned long long size);
 
+    /**
+     * @brief Sets the hints used to map the files of the disk caches, a combination of MemoryFile::MappingFlagsEnum
+     **/
+    void setApplicationsCachesFileMappingFlags(int flags);
+
     void removeFromNodeCache(const ImagePtr & image);
     void removeFromViewerCache(const FrameEntryPtr & texture);
 
@@ -245,6 +255,16 @@ public:
 
     void removeAllCacheEntriesForHolder(const CacheEntryHolder* holder, bool blocking);
 
+    /**
+     * @brief Sets the RAM budget in bytes (0 for no limit) and the priority of the entries of the given holder in all caches.
+     **/
+    void setCachePolicyForHolder(const CacheEntryHolder* holder, std::size_t budget, CachePriorityEnum priority);
+
+    /**
+     * @brief Forgets the budget and priority of the given holder in all caches, to be called when it is destroyed.
+     **/
+    void removeCachePolicyForHolder(const CacheEntryHolder* holder);
+
     SettingsPtr getCurrentSettings() const WARN_UNUSED_RETURN;
     const KnobFactory & getKnobFactory() const WARN_UNUSED_RETURN;
 
@@ -354,6 +374,18 @@ public:
      **/
     void checkCacheFreeMemoryIsGoodEnough();
 
+    /**
+     * @brief Returns the number of bytes held in RAM by the node cache, the viewer cache and the idle image buffers.
+     **/
+    std::size_t getCachesInMemorySize() const;
+
+    /**
+     * @brief Releases at least the given number of bytes from the caches held in RAM, if possible: idle image buffers
+     * are released first, then least recently used entries are evicted from the node cache and the viewer cache in
+     * proportion of their size. Called by the memory governor when the caches are over budget.
+     **/
+    void releaseCachesMemory(std::size_t bytesToFree);
+
     void onCheckerboardSettingsChanged() { Q_EMIT checkerboardSettingsChanged(); }
 
     void onOCIOConfigPathChanged(const std::string& path);
@@ -501,6 +533,11 @@ public:
     const OfxHost* getOFXHost() const;
     GPUContextPool* getGPUContextPool() const;
 
+    /**
+     * @brief Returns the object used to warm up the page cache with files that are about to be read.
+     **/
+    FilePrefetcher* getFilePrefetcher() const;
+
 
     /**
      * @brief Return the concatenation of all search paths of Natron, i.e:
@@ -63,6 +63,8 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/CacheSerialization.h"
 #include "Engine/CLArgs.h"
 #include "Engine/ExistenceCheckThread.h"
+#include "Engine/FilePrefetcher.h"
+#include "Engine/MemoryGovernor.h"
 #include "Engine/Format.h"
 #include "Engine/FrameEntry.h"
 #include "Engine/Image.h"
@@ -136,6 +138,8 @@ AppManagerPrivate::AppManagerPrivate()
     , hasInitializedOpenGLFunctions(false)
     , openGLFunctionsMutex()
     , renderingContextPool()
+    , filePrefetcher( new FilePrefetcher() )
+    , memoryGovernor()
     , openGLRenderers()
 {
     setMaxCacheFiles();
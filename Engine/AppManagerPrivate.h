@@ -204,6 +204,8 @@ public:
 #endif
 
     boost::scoped_ptr<GPUContextPool> renderingContextPool;
+    boost::scoped_ptr<FilePrefetcher> filePrefetcher;
+    boost::scoped_ptr<MemoryGovernor> memoryGovernor; //< keeps the caches within the memory the process may use
     std::list<OpenGLRendererInfo> openGLRenderers;
     boost::scoped_ptr<QCoreApplication> _qApp;
 
@@ -40,6 +40,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 // /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
 #include <boost/bind.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
 #include <boost/math/special_functions/fpclassify.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
@@ -777,19 +778,17 @@ bezierSegmentEval(bool useGuiCurves,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
     if (nbPointsPerSegment == -1) {
         /*
-         * Approximate the necessary number of line segments, using http://antigrain.com/research/adaptive_bezier/
+         * Approximate the necessary number of line segments from the curvature of the segment: the distance between a cubic
+         * Bezier and the polyline joining n + 1 uniformly spaced points is bounded by 3/4 * max(|p0 - 2p1 + p2|, |p1 - 2p2 + p3|) / n^2.
+         * The points are expressed in pixels at the given mipmap level, so coarser levels use fewer points.
          */
-        double dx1, dy1, dx2, dy2, dx3, dy3;
-        dx1 = p1.x - p0.x;
-        dy1 = p1.y - p0.y;
-        dx2 = p2.x - p1.x;
-        dy2 = p2.y - p1.y;
-        dx3 = p3.x - p2.x;
-        dy3 = p3.y - p2.y;
-        double length = std::sqrt(dx1 * dx1 + dy1 * dy1) +
-                        std::sqrt(dx2 * dx2 + dy2 * dy2) +
-                        std::sqrt(dx3 * dx3 + dy3 * dy3);
-        nbPointsPerSegment = (int)std::max(length * 0.25, 2.);
+        double ddx1 = p0.x - 2. * p1.x + p2.x;
+        double ddy1 = p0.y - 2. * p1.y + p2.y;
+        double ddx2 = p1.x - 2. * p2.x + p3.x;
+        double ddy2 = p1.y - 2. * p2.y + p3.y;
+        double dd = std::sqrt( std::max(ddx1 * ddx1 + ddy1 * ddy1, ddx2 * ddx2 + ddy2 * ddy2) );
+        double nSegments = std::ceil( std::sqrt(0.75 * dd / NATRON_BEZIER_FLATTENING_TOLERANCE) );
+        nbPointsPerSegment = (int)std::min(std::max(nSegments, 1.), 1000.) + 1;
     }
 
     double incr = 1. / (double)(nbPointsPerSegment - 1);
@@ -2531,6 +2530,88 @@ Bezier::getKeyframesCount() const
     }
 }
 
+/**
+ * @brief Returns a hash identifying the polyline computed for the given points: it depends on the position of the points
+ * at the given time and not on the curve they were read from, so that the overlay and the render share the same polylines
+ * when the GUI and internal curves are equal.
+ **/
+static U64
+hashBezierFlattening(bool useGuiCurves,
+                     const BezierCPs& points,
+                     const BezierCPs* featherPoints,
+                     double time,
+                     unsigned int mipMapLevel,
+                     double precision,
+                     bool finished,
+                     bool isOpenBezier,
+                     bool evaluateIfEqual,
+                     const Transform::Matrix3x3& transform)
+{
+    Hash64 hash;
+
+    hash.append(featherPoints != 0);
+    hash.append(mipMapLevel);
+    hash.append(precision);
+    hash.append(finished);
+    hash.append(isOpenBezier);
+    hash.append(evaluateIfEqual);
+    hash.append(transform.a);
+    hash.append(transform.b);
+    hash.append(transform.c);
+    hash.append(transform.d);
+    hash.append(transform.e);
+    hash.append(transform.f);
+    hash.append(transform.g);
+    hash.append(transform.h);
+    hash.append(transform.i);
+    for (int l = 0; l < 2; ++l) {
+        const BezierCPs* cps = l == 0 ? &points : featherPoints;
+        if (!cps) {
+            break;
+        }
+        hash.append( (U64)cps->size() );
+        for (BezierCPs::const_iterator it = cps->begin(); it != cps->end(); ++it) {
+            double x, y, lx, ly, rx, ry;
+            (*it)->getPositionAtTime(useGuiCurves, time, ViewIdx(0), &x, &y);
+            (*it)->getLeftBezierPointAtTime(useGuiCurves, time, ViewIdx(0), &lx, &ly);
+            (*it)->getRightBezierPointAtTime(useGuiCurves, time, ViewIdx(0), &rx, &ry);
+            hash.append(x);
+            hash.append(y);
+            hash.append(lx);
+            hash.append(ly);
+            hash.append(rx);
+            hash.append(ry);
+        }
+    }
+    hash.computeHash();
+
+    return hash.value();
+}
+
+/**
+ * @brief Appends the polyline to the output of evaluateAtTime_DeCasteljau or evaluateFeatherPointsAtTime_DeCasteljau
+ **/
+static void
+appendBezierFlattening(const BezierFlattening& flattening,
+                       std::list<std::list<ParametricPoint> >* points,
+                       std::list<ParametricPoint >* pointsSingleList,
+                       RectD* bbox)
+{
+    if (points) {
+        points->insert( points->end(), flattening.segments.begin(), flattening.segments.end() );
+    } else {
+        for (std::list<std::list<ParametricPoint> >::const_iterator it = flattening.segments.begin(); it != flattening.segments.end(); ++it) {
+            pointsSingleList->insert( pointsSingleList->end(), it->begin(), it->end() );
+        }
+    }
+    if ( bbox && !flattening.segments.empty() ) {
+        bbox->x1 = std::min(bbox->x1, flattening.bbox.x1);
+        bbox->x2 = std::max(bbox->x2, flattening.bbox.x2);
+        bbox->y1 = std::min(bbox->y1, flattening.bbox.y1);
+        bbox->y2 = std::max(bbox->y2, flattening.bbox.y2);
+    }
+}
+
 void
 Bezier::deCastelJau(bool isOpenBezier,
                     bool useGuiCurves,
@@ -2649,13 +2730,28 @@ Bezier::evaluateAtTime_DeCasteljau_internal(bool useGuiCurves,
 
     getTransformAtTime(time, &transform);
     QMutexLocker l(&itemMutex);
-    deCastelJau(isOpenBezier(), useGuiCurves, _imp->points, time, mipMapLevel, _imp->finished,
+    U64 shapeHash = hashBezierFlattening(useGuiCurves, _imp->points, 0, time, mipMapLevel,
+#ifdef ROTO_BEZIER_EVAL_ITERATIVE
+                                         nbPointsPerSegment,
+#else
+                                         errorScale,
+#endif
+                                         _imp->finished, isOpenBezier(), false, transform);
+    BezierFlatteningConstPtr flattening = _imp->getFlattening(shapeHash);
+    if (!flattening) {
+        boost::shared_ptr<BezierFlattening> newFlattening = boost::make_shared<BezierFlattening>();
+        newFlattening->shapeHash = shapeHash;
+        deCastelJau(isOpenBezier(), useGuiCurves, _imp->points, time, mipMapLevel, _imp->finished,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
-                nbPointsPerSegment,
+                    nbPointsPerSegment,
 #else
-                errorScale,
+                    errorScale,
 #endif
-                transform, points, pointsSingleList, bbox);
+                    transform, &newFlattening->segments, 0, &newFlattening->bbox);
+        _imp->insertFlattening(newFlattening);
+        flattening = newFlattening;
+    }
+    appendBezierFlattening(*flattening, points, pointsSingleList, bbox);
 }
 
 void
@@ -2731,6 +2827,22 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal(bool useGuiPoints,
     Transform::Matrix3x3 transform;
     getTransformAtTime(time, &transform);
 
+    U64 shapeHash = hashBezierFlattening(useGuiPoints, _imp->points, &_imp->featherPoints, time, mipMapLevel,
+#ifdef ROTO_BEZIER_EVAL_ITERATIVE
+                                         nbPointsPerSegment,
+#else
+                                         errorScale,
+#endif
+                                         _imp->finished, isOpenBezier(), evaluateIfEqual, transform);
+    BezierFlatteningConstPtr flattening = _imp->getFlattening(shapeHash);
+    if (flattening) {
+        appendBezierFlattening(*flattening, points, pointsSingleList, bbox);
+
+        return;
+    }
+    boost::shared_ptr<BezierFlattening> newFlattening = boost::make_shared<BezierFlattening>();
+    newFlattening->shapeHash = shapeHash;
+
     for (BezierCPs::const_iterator it = _imp->featherPoints.begin(); it != _imp->featherPoints.end();
          ++it) {
         if ( next == _imp->featherPoints.end() ) {
@@ -2745,39 +2857,22 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal(bool useGuiPoints,
         if ( !evaluateIfEqual && bezierSegmenEqual(useGuiPoints, time, ViewIdx(0), **itCp, **nextCp, **it, **next) ) {
             continue;
         }
-        if (points) {
-            std::list<ParametricPoint> segmentPoints;
-            bezierSegmentEval(useGuiPoints, *(*it), *(*next), time, ViewIdx(0),  mipMapLevel,
+        std::list<ParametricPoint> segmentPoints;
+        bezierSegmentEval(useGuiPoints, *(*it), *(*next), time, ViewIdx(0),  mipMapLevel,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
-                              nbPointsPerSegment,
+                          nbPointsPerSegment,
 #else
-                              errorScale,
+                          errorScale,
 #endif
-                              transform, &segmentPoints, bbox);
+                          transform, &segmentPoints, &newFlattening->bbox);
 
-            // If we are a closed bezier or we are not on the last segment, remove the last point so we don't add duplicates
-            if (!isOpenBezier() || next != _imp->featherPoints.end()) {
-                if (!segmentPoints.empty()) {
-                    segmentPoints.pop_back();
-                }
-            }
-            points->push_back(segmentPoints);
-        } else {
-            assert(pointsSingleList);
-            bezierSegmentEval(useGuiPoints, *(*it), *(*next), time, ViewIdx(0),  mipMapLevel,
-#ifdef ROTO_BEZIER_EVAL_ITERATIVE
-                              nbPointsPerSegment,
-#else
-                              errorScale,
-#endif
-                              transform, pointsSingleList, bbox);
-            // If we are a closed bezier or we are not on the last segment, remove the last point so we don't add duplicates
-            if (!isOpenBezier() || next != _imp->featherPoints.end()) {
-                if (!pointsSingleList->empty()) {
-                    pointsSingleList->pop_back();
-                }
+        // If we are a closed bezier or we are not on the last segment, remove the last point so we don't add duplicates
+        if (!isOpenBezier() || next != _imp->featherPoints.end()) {
+            if (!segmentPoints.empty()) {
+                segmentPoints.pop_back();
             }
         }
+        newFlattening->segments.push_back(segmentPoints);
 
         // increment for next iteration
         if ( itCp != _imp->featherPoints.end() ) {
@@ -2791,6 +2886,8 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal(bool useGuiPoints,
         }
     } // for(it)
 
+    _imp->insertFlattening(newFlattening);
+    appendBezierFlattening(*newFlattening, points, pointsSingleList, bbox);
 }
 
 void
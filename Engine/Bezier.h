@@ -51,6 +51,13 @@ CLANG_DIAG_ON(deprecated-declarations)
 
 #define ROTO_BEZIER_EVAL_ITERATIVE
 
+// Maximum distance, in pixels, between a Bezier segment and the polyline approximating it when the number of points
+// of the polyline is computed automatically (nbPointsPerSegment = -1)
+#define NATRON_BEZIER_FLATTENING_TOLERANCE 0.2
+
+// Number of polylines approximating a Bezier kept in memory by each Bezier
+#define NATRON_BEZIER_FLATTENING_CACHE_SIZE 8
+
 NATRON_NAMESPACE_ENTER
 
 
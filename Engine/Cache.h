@@ -33,6 +33,7 @@
 #include <fstream>
 #include <functional>
 #include <list>
+#include <map>
 #include <set>
 #include <cstddef>
 #include <utility>
@@ -72,6 +73,12 @@ GCC_DIAG_ON(deprecated)
 
 #define NATRON_TILE_CACHE_FILE_SIZE_BYTES 2000000000
 
+// Number of least recently used entries among which the cache evicts the one that is the cheapest to recompute relative to its size
+#define NATRON_CACHE_EVICTION_WINDOW 16
+
+// Fraction of the in-memory portion of the cache the entries of pinned holders may occupy before they can be evicted
+#define NATRON_CACHE_MAX_PINNED_FRACTION 0.5
+
 ///When defined, number of opened files, memory size and disk size of the cache are printed whenever there's activity.
 //#define NATRON_DEBUG_CACHE
 
@@ -465,6 +472,71 @@ public:
 
 private:
 
+    struct HolderPolicy
+    {
+        // Maximum number of bytes the entries of the holder may occupy in RAM, or 0 if unlimited
+        std::size_t budget;
+        CachePriorityEnum priority;
+    };
+
+    typedef std::map<std::string, HolderPolicy> HolderPoliciesMap;
+    typedef std::map<std::string, std::size_t> HolderSizesMap;
+
+    /**
+     * @brief The eviction score of an entry, see the evict() function of the LRU hash tables: among the entries it is given,
+     * the ones that took the less time to render relative to their size are evicted first, and the priority of their holder
+     * is respected.
+     * If holderID is set, only the entries of this holder are evicted, regardless of its priority.
+     * If evictPinned is true, the entries of pinned holders are evicted like those of holders with a high priority.
+     **/
+    class EvictionScore
+    {
+        const HolderPoliciesMap& _policies;
+        const std::string* _holderID;
+        bool _evictPinned;
+
+    public:
+
+        EvictionScore(const HolderPoliciesMap& policies,
+                      const std::string* holderID,
+                      bool evictPinned)
+            : _policies(policies)
+            , _holderID(holderID)
+            , _evictPinned(evictPinned)
+        {
+        }
+
+        bool operator()(const EntryTypePtr& entry,
+                        double* score) const
+        {
+            CachePriorityEnum priority = eCachePriorityNormal;
+
+            if (_holderID) {
+                if (entry->getKey().getCacheHolderID() != *_holderID) {
+                    return false;
+                }
+            } else if ( !_policies.empty() ) {
+                typename HolderPoliciesMap::const_iterator found = _policies.find( entry->getKey().getCacheHolderID() );
+                if ( found != _policies.end() ) {
+                    priority = found->second.priority;
+                }
+            }
+            if (priority == eCachePriorityPinned) {
+                if (!_evictPinned) {
+                    return false;
+                }
+                priority = eCachePriorityHigh;
+            }
+            double size = std::max( (double)entry->getElementsCountFromParams(), 1. );
+            *score = entry->getRenderCost() / size;
+            if (priority == eCachePriorityHigh) {
+                // Rendering times per byte are far below 1 second: among the entries given, those of normal priority go first
+                *score += 1.;
+            }
+
+            return true;
+        }
+    };
 
     std::size_t _maximumInMemorySize;     // the maximum size of the in-memory portion of the cache.(in % of the maximum cache size)
     std::size_t _maximumCacheSize;     // maximum size allowed for the cache
@@ -474,7 +546,7 @@ private:
      */
     mutable std::size_t _memoryCacheSize;     // current size of the cache in bytes
     mutable std::size_t _diskCacheSize;
-    mutable QMutex _sizeLock; // protects _memoryCacheSize & _diskCacheSize & _maximumInMemorySize & _maximumCacheSize
+    mutable QMutex _sizeLock; // protects _memoryCacheSize & _diskCacheSize & _maximumInMemorySize & _maximumCacheSize & _holderMemorySizes
     mutable QMutex _lock; //protects _memoryCache & _diskCache
     mutable QMutex _getLock;  //prevents get() and getOrCreate() to be called simultaneously
 
@@ -512,6 +584,15 @@ private:
     // When set these are used for fast search of a free tile
     TileCacheFileWPtr _nextAvailableCacheFile;
     int _nextAvailableCacheFileIndex;
+
+    // Budget and priority of the holders that do not use the defaults, protected by _lock
+    HolderPoliciesMap _holderPolicies;
+
+    // Number of bytes the entries of each holder occupy in RAM, counted like _memoryCacheSize
+    mutable HolderSizesMap _holderMemorySizes;
+
+    // MemoryFile::MappingFlagsEnum hints used to map the files of the entries that are read back from disk, protected by _sizeLock
+    int _fileMappingFlags;
 public:
 
 
@@ -545,6 +626,9 @@ public:
         , _cacheFiles()
         , _nextAvailableCacheFile()
         , _nextAvailableCacheFileIndex(-1)
+        , _holderPolicies()
+        , _holderMemorySizes()
+        , _fileMappingFlags(MemoryFile::eMappingFlagsNone)
     {
         _signalEmitter = boost::make_shared<CacheSignalEmitter>();
     }
@@ -638,7 +722,7 @@ private:
             return TileCacheFilePtr();
         } else {
             TileCacheFilePtr ret = boost::make_shared<TileCacheFile>();
-            ret->file = boost::make_shared<MemoryFile>(filepath, MemoryFile::eFileOpenModeEnumIfExistsKeepElseFail);
+            ret->file = boost::make_shared<MemoryFile>(filepath, MemoryFile::eFileOpenModeEnumIfExistsKeepElseFail, getTileFileMappingFlags());
             std::size_t nTilesPerFile = std::floor( ( (double)NATRON_TILE_CACHE_FILE_SIZE_BYTES ) / _tileByteSize );
             ret->usedTiles.resize(nTilesPerFile, false);
             int index = dataOffset / _tileByteSize;
@@ -711,7 +795,7 @@ private:
             std::stringstream cacheFilePathSs;
             cacheFilePathSs << getCachePath().toStdString() << "/CachePart" << nCacheFiles;
             std::string cacheFilePath = cacheFilePathSs.str();
-            foundAvailableFile->file = boost::make_shared<MemoryFile>(cacheFilePath, MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate);
+            foundAvailableFile->file = boost::make_shared<MemoryFile>(cacheFilePath, MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate, getTileFileMappingFlags());
 
             std::size_t nTilesPerFile = std::floor(((double)NATRON_TILE_CACHE_FILE_SIZE_BYTES) / _tileByteSize);
             std::size_t cacheFileSize = nTilesPerFile * _tileByteSize;
@@ -764,13 +848,26 @@ private:
             } else {
                 // Invalidate this portion of the cache
                 (*foundTileFile)->file->flush(MemoryFile::eFlushTypeInvalidate, (*foundTileFile)->file->data() + dataOffset, _tileByteSize);
+                (*foundTileFile)->file->advise(MemoryFile::eAccessAdviceDontNeed, (*foundTileFile)->file->data() + dataOffset, _tileByteSize);
             }
         } else {
+            // The tile content is not needed anymore: let the system reclaim its pages instead of other tiles
+            (*foundTileFile)->file->advise(MemoryFile::eAccessAdviceDontNeed, (*foundTileFile)->file->data() + dataOffset, _tileByteSize);
             _nextAvailableCacheFile = *foundTileFile;
             _nextAvailableCacheFileIndex = index;
         }
     }
 
+    /**
+     * @brief The tiles of consecutive frames are mostly allocated one after the other, so the system read-ahead is kept.
+     * Populating a whole tile file would read up to NATRON_TILE_CACHE_FILE_SIZE_BYTES at once: the tiles that are needed
+     * next are read in advance with prefetch() instead.
+     **/
+    int getTileFileMappingFlags() const
+    {
+        return getFileMappingFlags() & ~MemoryFile::eMappingFlagsPopulate;
+    }
+
 
     void createInternal(const typename EntryType::key_type & key,
                         const ParamsTypePtr & params,
@@ -891,6 +988,15 @@ private:
             // For a tiled cache, all entries must have the same size
             assert(!_isTiled || (*returnValue)->getSizeInBytesFromParams() == _tileByteSize);
 
+            if (*returnValue && !_isTiled) {
+                // Make room for the new entry in the budget of its holder
+                std::list<EntryTypePtr> entriesToBeDeleted;
+                enforceHolderBudget(key.getCacheHolderID(), (*returnValue)->getElementsCountFromParams(), entriesToBeDeleted);
+                if ( !entriesToBeDeleted.empty() ) {
+                    _deleterThread.appendToQueue(entriesToBeDeleted);
+                }
+            }
+
             if (*returnValue) {
 
                 // If there is a lock, lock it before exposing the entry to other threads
@@ -1221,6 +1327,42 @@ public:
         return ret;
     }
 
+    /**
+     * @brief Removes least recently used entries from the in-memory cache until at least bytesToFree bytes
+     * were released, or nothing is left to evict. The lock is taken only once for the whole batch and the entries
+     * are destroyed by the deleter thread. Returns the number of bytes released.
+     **/
+    std::size_t evictLRUInMemoryEntries(std::size_t bytesToFree) const
+    {
+        std::size_t freed = 0;
+        std::list<EntryTypePtr> entriesToBeDeleted;
+        {
+            QMutexLocker locker(&_lock);
+            while (freed < bytesToFree) {
+                std::size_t memoryCacheSize = getMemoryCacheSize();
+                std::list<EntryTypePtr> deleted;
+                if ( !tryEvictInMemoryEntry(deleted) ) {
+                    break;
+                }
+
+                ///Entries stored on disk were deallocated in place
+                std::size_t newMemoryCacheSize = getMemoryCacheSize();
+                if (newMemoryCacheSize < memoryCacheSize) {
+                    freed += memoryCacheSize - newMemoryCacheSize;
+                }
+                for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
+                    if ( !(*it)->isStoredOnDisk() ) {
+                        freed += (*it)->size();
+                    }
+                    entriesToBeDeleted.push_back(*it);
+                }
+            }
+        }
+        _deleterThread.appendToQueue(entriesToBeDeleted);
+
+        return freed;
+    }
+
     /**
      * @brief Removes the last recently used entry from the disk cache.
      * This is expensive since it takes the lock. Returns false
@@ -1239,7 +1381,8 @@ public:
      * This way the cache can keep track of the real memory footprint.
      **/
     virtual void notifyEntrySizeChanged(std::size_t oldSize,
-                                        std::size_t newSize) const OVERRIDE FINAL
+                                        std::size_t newSize,
+                                        const std::string& holderID) const OVERRIDE FINAL
     {
         ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache
         QMutexLocker k(&_sizeLock);
@@ -1255,6 +1398,7 @@ public:
         } else {
             _memoryCacheSize += diff;
         }
+        addHolderMemorySize(holderID, diff);
 #ifdef NATRON_DEBUG_CACHE
         qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
 #endif
@@ -1265,7 +1409,8 @@ public:
      **/
     virtual void notifyEntryAllocated(double time,
                                       std::size_t size,
-                                      StorageModeEnum storage) const OVERRIDE FINAL
+                                      StorageModeEnum storage,
+                                      const std::string& holderID) const OVERRIDE FINAL
     {
         ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache, hence the
         ///lock should already be taken.
@@ -1277,10 +1422,12 @@ public:
                 _diskCacheSize += size;
             } else {
                 _memoryCacheSize += size;
+                addHolderMemorySize(holderID, (qint64)size);
                 appPTR->increaseNCacheFilesOpened();
             }
         } else {
             _memoryCacheSize += size;
+            addHolderMemorySize(holderID, (qint64)size);
         }
 
         _signalEmitter->emitAddedEntry(time);
@@ -1296,12 +1443,14 @@ public:
      **/
     virtual void notifyEntryDestroyed(double time,
                                       std::size_t size,
-                                      StorageModeEnum storage) const OVERRIDE FINAL
+                                      StorageModeEnum storage,
+                                      const std::string& holderID) const OVERRIDE FINAL
     {
         QMutexLocker k(&_sizeLock);
 
         if (storage == eStorageModeRAM) {
             _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
+            addHolderMemorySize(holderID, -(qint64)size);
 #ifdef NATRON_DEBUG_CACHE
             qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
 #endif
@@ -1330,7 +1479,8 @@ public:
     virtual void notifyEntryStorageChanged(StorageModeEnum oldStorage,
                                            StorageModeEnum newStorage,
                                            double time,
-                                           std::size_t size) const OVERRIDE FINAL
+                                           std::size_t size,
+                                           const std::string& holderID) const OVERRIDE FINAL
     {
         assert(!_isTiled);
 
@@ -1343,6 +1493,7 @@ public:
         assert(newStorage != eStorageModeNone);
         if (oldStorage == eStorageModeRAM) {
             _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
+            addHolderMemorySize(holderID, -(qint64)size);
             _diskCacheSize += size;
 #ifdef NATRON_DEBUG_CACHE
             qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
@@ -1352,6 +1503,7 @@ public:
             appPTR->decreaseNCacheFilesOpened();
         } else if (oldStorage == eStorageModeDisk) {
             _memoryCacheSize += size;
+            addHolderMemorySize(holderID, (qint64)size);
             _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
 #ifdef NATRON_DEBUG_CACHE
             qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
@@ -1362,6 +1514,7 @@ public:
         } else {
             if (newStorage == eStorageModeRAM) {
                 _memoryCacheSize += size;
+                addHolderMemorySize(holderID, (qint64)size);
             } else if (newStorage == eStorageModeDisk) {
                 _diskCacheSize += size;
             }
@@ -1419,6 +1572,98 @@ public:
         _maximumCacheSize = newSize;
     }
 
+    /**
+     * @brief Sets the hints (a combination of MemoryFile::MappingFlagsEnum) given to the system when mapping the files of
+     * the entries read back from disk. Sequential and populate hints also enable prefetch().
+     **/
+    void setFileMappingFlags(int flags)
+    {
+        QMutexLocker k(&_sizeLock);
+
+        _fileMappingFlags = flags;
+    }
+
+    int getFileMappingFlags() const
+    {
+        QMutexLocker k(&_sizeLock);
+
+        return _fileMappingFlags;
+    }
+
+    /**
+     * @brief If an entry matching the key lives only in the disk portion of the cache, asks the system to start reading its
+     * backing file in the background, so that a later get() of this entry does not wait for the disk.
+     * For a tiled cache, the portion of the tile file holding the entry is read in advance instead, wherever the entry is.
+     * This does nothing if the file mapping flags have neither the sequential nor the populate hint.
+     **/
+    void prefetch(const typename EntryType::key_type & key) const
+    {
+        if ( !( getFileMappingFlags() & (MemoryFile::eMappingFlagsSequential | MemoryFile::eMappingFlagsPopulate) ) ) {
+            return;
+        }
+        if (_isTiled) {
+            prefetchTile(key);
+
+            return;
+        }
+        std::list<std::string> filesToPrefetch;
+        {
+            QMutexLocker locker(&_lock);
+            CacheIterator diskCached = _diskCache( key.getHash() );
+            if ( diskCached == _diskCache.end() ) {
+                return;
+            }
+            std::list<EntryTypePtr> & entries = getValueFromIterator(diskCached);
+            for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                if ( (*it)->getKey() == key ) {
+                    filesToPrefetch.push_back( (*it)->getFilePath() );
+                }
+            }
+        }
+        // Do not hold the lock while doing I/O, if the entry was removed in the meantime its file does not exist anymore
+        for (std::list<std::string>::iterator it = filesToPrefetch.begin(); it != filesToPrefetch.end(); ++it) {
+            MemoryFile::prefetch(*it);
+        }
+    }
+
+private:
+
+    void prefetchTile(const typename EntryType::key_type & key) const
+    {
+        // Tiled entries are inserted in the disk portion, their data is in a tile file shared with other entries
+        std::list<std::pair<std::string, std::size_t> > tilesToPrefetch;
+        {
+            QMutexLocker locker(&_lock);
+            CacheIterator found = _diskCache( key.getHash() );
+            if ( found == _diskCache.end() ) {
+                found = _memoryCache( key.getHash() );
+                if ( found == _memoryCache.end() ) {
+                    return;
+                }
+            }
+            std::list<EntryTypePtr> & entries = getValueFromIterator(found);
+            for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                if ( (*it)->getKey() == key ) {
+                    tilesToPrefetch.push_back( std::make_pair( (*it)->getFilePath(), (*it)->getOffsetInFile() ) );
+                }
+            }
+        }
+        if ( tilesToPrefetch.empty() ) {
+            return;
+        }
+        QMutexLocker k(&_tileCacheMutex);
+        for (std::list<std::pair<std::string, std::size_t> >::iterator it = tilesToPrefetch.begin(); it != tilesToPrefetch.end(); ++it) {
+            for (std::set<TileCacheFilePtr>::const_iterator it2 = _cacheFiles.begin(); it2 != _cacheFiles.end(); ++it2) {
+                if ( ( (*it2)->file->path() == it->first ) && ( it->second + _tileByteSize <= (*it2)->file->size() ) ) {
+                    (*it2)->file->advise(MemoryFile::eAccessAdviceWillNeed, (*it2)->file->data() + it->second, _tileByteSize);
+                    break;
+                }
+            }
+        }
+    }
+
+public:
+
     void setMaximumInMemorySize(double percentage)
     {
         QMutexLocker k(&_sizeLock);
@@ -1606,6 +1851,37 @@ public:
         }
     }
 
+    /**
+     * @brief Sets the maximum number of bytes the entries of the given holder may occupy in RAM (0 for no limit) and their
+     * priority in the cache. When the budget is exceeded, the entries of the holder are evicted, even if they are pinned.
+     **/
+    void setHolderPolicy(const CacheEntryHolder* holder,
+                         std::size_t budget,
+                         CachePriorityEnum priority)
+    {
+        std::string holderID = holder->getCacheID();
+        QMutexLocker locker(&_lock);
+
+        if ( !budget && (priority == eCachePriorityNormal) ) {
+            _holderPolicies.erase(holderID);
+        } else {
+            HolderPolicy& policy = _holderPolicies[holderID];
+            policy.budget = budget;
+            policy.priority = priority;
+        }
+    }
+
+    /**
+     * @brief Forgets the policy of the given holder, to be called when it is destroyed.
+     **/
+    void removeHolderPolicy(const CacheEntryHolder* holder)
+    {
+        std::string holderID = holder->getCacheID();
+        QMutexLocker locker(&_lock);
+
+        _holderPolicies.erase(holderID);
+    }
+
 private:
 
     virtual void removeAllEntriesWithDifferentNodeHashForHolderPrivate(const std::string & holderID,
@@ -1712,7 +1988,7 @@ private:
                          back into the memoryCache.*/
                         if (!_isTiled) {
                             try {
-                                (*it)->reOpenFileMapping();
+                                (*it)->reOpenFileMapping( getFileMappingFlags() );
                             } catch (const std::exception & e) {
                                 qDebug() << "Error while reopening cache file: " << e.what();
                                 ret.erase(it);
@@ -1806,15 +2082,25 @@ private:
         }
     }
 
-    bool tryEvictInMemoryEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    /**
+     * @brief Evicts from the in-memory cache the entry with the lowest EvictionScore among the least recently used ones.
+     * If holderID is set, only an entry of this holder may be evicted. If evictedSize is set, it is set to the number of
+     * bytes the entry occupied in RAM.
+     **/
+    bool tryEvictInMemoryEntry(std::list<EntryTypePtr> & entriesToBeDeleted,
+                               const std::string* holderID = 0,
+                               std::size_t* evictedSize = 0) const
     {
         assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _memoryCache.evict();
+        std::pair<hash_type, EntryTypePtr> evicted = _memoryCache.evict(EvictionScore( _holderPolicies, holderID, isPinnedMemoryExceeded() ), NATRON_CACHE_EVICTION_WINDOW);
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         if (!evicted.second) {
             return false;
         }
+        if (evictedSize) {
+            *evictedSize = evicted.second->size();
+        }
 
         // If it is stored on disk, remove it from memory
         // If the cache is tiled, the entry is sharing the same file with other entries so we cannot close the file.
@@ -1880,7 +2166,8 @@ private:
     {
 
         assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _diskCache.evict();
+        // Pinning keeps entries in RAM: on disk they are only kept longer than entries of normal priority
+        std::pair<hash_type, EntryTypePtr> evicted = _diskCache.evict(EvictionScore(_holderPolicies, 0, true), NATRON_CACHE_EVICTION_WINDOW);
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         if (!evicted.second) {
@@ -1894,6 +2181,78 @@ private:
         return true;
     }
 
+    /**
+     * @brief Evicts entries of the given holder from the in-memory cache until an entry of newEntrySize bytes fits in its budget.
+     **/
+    void enforceHolderBudget(const std::string& holderID,
+                             std::size_t newEntrySize,
+                             std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        assert( !_lock.tryLock() );
+        typename HolderPoliciesMap::const_iterator found = _holderPolicies.find(holderID);
+        if ( ( found == _holderPolicies.end() ) || !found->second.budget ) {
+            return;
+        }
+        std::size_t budget = found->second.budget;
+        std::size_t used;
+        {
+            QMutexLocker k(&_sizeLock);
+            typename HolderSizesMap::const_iterator foundSize = _holderMemorySizes.find(holderID);
+            used = foundSize == _holderMemorySizes.end() ? 0 : foundSize->second;
+        }
+        // Evicted entries are deallocated later on by the deleter thread: count them out right away
+        while (used + newEntrySize > budget) {
+            std::size_t evictedSize = 0;
+            if ( !tryEvictInMemoryEntry(entriesToBeDeleted, &holderID, &evictedSize) ) {
+                break;
+            }
+            used = evictedSize > used ? 0 : used - evictedSize;
+        }
+    }
+
+    /**
+     * @brief Adds diff bytes to the RAM occupied by the entries of the given holder. Must be called with _sizeLock taken.
+     **/
+    void addHolderMemorySize(const std::string& holderID,
+                             qint64 diff) const
+    {
+        if (diff >= 0) {
+            _holderMemorySizes[holderID] += diff;
+
+            return;
+        }
+        typename HolderSizesMap::iterator found = _holderMemorySizes.find(holderID);
+        if ( found == _holderMemorySizes.end() ) {
+            return;
+        }
+        if ( (qint64)found->second <= -diff ) {
+            _holderMemorySizes.erase(found);
+        } else {
+            found->second -= (std::size_t)(-diff);
+        }
+    }
+
+    /**
+     * @brief Returns true if the entries of pinned holders occupy more than NATRON_CACHE_MAX_PINNED_FRACTION of the in-memory
+     * portion of the cache, in which case they may be evicted too.
+     **/
+    bool isPinnedMemoryExceeded() const
+    {
+        assert( !_lock.tryLock() );
+        QMutexLocker k(&_sizeLock);
+        std::size_t pinnedSize = 0;
+        for (typename HolderPoliciesMap::const_iterator it = _holderPolicies.begin(); it != _holderPolicies.end(); ++it) {
+            if (it->second.priority != eCachePriorityPinned) {
+                continue;
+            }
+            typename HolderSizesMap::const_iterator foundSize = _holderMemorySizes.find(it->first);
+            if ( foundSize != _holderMemorySizes.end() ) {
+                pinnedSize += foundSize->second;
+            }
+        }
+
+        return pinnedSize > _maximumInMemorySize * NATRON_CACHE_MAX_PINNED_FRACTION;
+    }
 };
 
 NATRON_NAMESPACE_EXIT
@@ -65,6 +65,8 @@
 #include "Engine/CacheEntryHolder.h"
 #include "Engine/MemoryFile.h"
 #include "Engine/NonKeyParams.h"
+#include "Engine/NumaTopology.h"
+#include "Engine/RamBufferPool.h"
 #include "Engine/Texture.h"
 #include "Engine/EngineFwd.h"
 #include "Global/GlobalDefines.h"
@@ -75,17 +77,25 @@ NATRON_NAMESPACE_ENTER
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////BUFFER////////////////////////////////////////////////////
 
+/**
+ * @brief A buffer in RAM whose memory comes from the RamBufferPool, so that the blocks of discarded images
+ * are recycled by the next images of the same size.
+ **/
 template <typename T>
 class RamBuffer
 {
     T* data;
     U64 count;
 
+    // Actual size of the block returned by the pool, in bytes
+    std::size_t allocatedBytes;
+
 public:
 
     RamBuffer()
         : data(0)
         , count(0)
+        , allocatedBytes(0)
     {
     }
 
@@ -103,6 +113,7 @@ public:
     {
         std::swap(data, other.data);
         std::swap(count, other.count);
+        std::swap(allocatedBytes, other.allocatedBytes);
     }
 
     U64 size() const
@@ -116,32 +127,41 @@ public:
             return;
         }
         count = size;
+        std::size_t bytes = size * sizeof(T);
+        int currentNode = NumaTopology::getCurrentNode();
         if (data) {
-            free(data);
+            if ( RamBufferPool::getBlockSize(bytes) == allocatedBytes ) {
+                // The current block has the right size class, the content is discarded anyway.
+                // In NUMA mode, keep it only if its memory is on the node of this thread or not placed yet.
+                if ( !NumaTopology::isEnabled() ) {
+                    return;
+                }
+                int memoryNode = NumaTopology::getMemoryNode(data, allocatedBytes);
+                if ( (memoryNode == -1) || (memoryNode == currentNode) ) {
+                    return;
+                }
+            }
+            RamBufferPool::deallocate(data, allocatedBytes);
             data = 0;
+            allocatedBytes = 0;
         }
-        if (count == 0) {
-            return;
-        }
-        data = (T*)malloc( size * sizeof(T) );
-        if (!data) {
-            throw std::bad_alloc();
-        }
+        data = (T*)RamBufferPool::allocate(bytes, &allocatedBytes, currentNode);
     }
 
     void clear()
     {
         count = 0;
         if (data) {
-            free(data);
+            RamBufferPool::deallocate(data, allocatedBytes);
             data = 0;
+            allocatedBytes = 0;
         }
     }
 
     ~RamBuffer()
     {
         if (data) {
-            free(data);
+            RamBufferPool::deallocate(data, allocatedBytes);
             data = 0;
         }
     }
@@ -186,17 +206,17 @@ public:
      * @brief To be called by a CacheEntry whenever it's size is changed.
      * This way the cache can keep track of the real memory footprint.
      **/
-    virtual void notifyEntrySizeChanged(size_t oldSize, size_t newSize) const = 0;
+    virtual void notifyEntrySizeChanged(size_t oldSize, size_t newSize, const std::string& holderID) const = 0;
 
     /**
      * @brief To be called by a CacheEntry on allocation.
      **/
-    virtual void notifyEntryAllocated(double time, size_t size, StorageModeEnum storage) const = 0;
+    virtual void notifyEntryAllocated(double time, size_t size, StorageModeEnum storage, const std::string& holderID) const = 0;
 
     /**
      * @brief To be called by a CacheEntry on destruction.
      **/
-    virtual void notifyEntryDestroyed(double time, size_t size, StorageModeEnum storage) const = 0;
+    virtual void notifyEntryDestroyed(double time, size_t size, StorageModeEnum storage, const std::string& holderID) const = 0;
 
     /**
      * @brief Called by the Cache deleter thread to wake up sleeping threads that were attempting to create a new image
@@ -213,7 +233,7 @@ public:
      * it is reallocated in the RAM.
      **/
     virtual void notifyEntryStorageChanged(StorageModeEnum oldStorage, StorageModeEnum newStorage,
-                                           double time, size_t size) const = 0;
+                                           double time, size_t size, const std::string& holderID) const = 0;
 
     /**
      * @brief Remove from the cache all entries that matches the holderID and have a different nodeHash than the given one.
@@ -547,11 +567,11 @@ public:
         return _cacheFileDataOffset;
     }
 
-    void reOpenFileMapping() const
+    void reOpenFileMapping(int mappingFlags) const
     {
         assert(!_backingFile && _storageMode == eStorageModeDisk);
         try{
-            _backingFile.reset( new MemoryFile(_path, MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate) );
+            _backingFile.reset( new MemoryFile(_path, MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate, mappingFlags) );
         } catch (const std::exception & e) {
             _backingFile.reset();
             throw std::bad_alloc();
@@ -771,6 +791,7 @@ public:
         , _cache()
         , _entryLock(QReadWriteLock::Recursive)
         , _removeBackingFileBeforeDestruction(false)
+        , _renderCost(0.)
     {
     }
 
@@ -789,6 +810,7 @@ public:
         , _cache(cache)
         , _entryLock(QReadWriteLock::Recursive)
         , _removeBackingFileBeforeDestruction(false)
+        , _renderCost(0.)
     {
     }
 
@@ -850,7 +872,7 @@ public:
         }
 
         if (_cache) {
-            _cache->notifyEntryAllocated( getTime(), size(), storageInfo.mode );
+            _cache->notifyEntryAllocated( getTime(), size(), storageInfo.mode, _key.getCacheHolderID() );
         }
     }
 
@@ -875,9 +897,9 @@ public:
 
         if (_cache) {
             if (_cache->isTileCache()) {
-                _cache->notifyEntryAllocated(getTime(), size, eStorageModeDisk);
+                _cache->notifyEntryAllocated(getTime(), size, eStorageModeDisk, _key.getCacheHolderID());
             } else {
-                _cache->notifyEntryStorageChanged(eStorageModeNone, eStorageModeDisk, getTime(), size);
+                _cache->notifyEntryStorageChanged(eStorageModeNone, eStorageModeDisk, getTime(), size, _key.getCacheHolderID());
             }
         }
     }
@@ -941,18 +963,19 @@ public:
     /** @brief This function is called by the get() function of the Cache when the entry is
      * living only in the disk portion of the cache. No locking is required here because the
      * caller is already preventing other threads to call this function.
+     * mappingFlags is a combination of MemoryFile::MappingFlagsEnum.
      **/
-    void reOpenFileMapping() const
+    void reOpenFileMapping(int mappingFlags) const
     {
         if (_cache && _cache->isTileCache()) {
             return;
         }
         {
             QWriteLocker k(&_entryLock);
-            _data.reOpenFileMapping();
+            _data.reOpenFileMapping(mappingFlags);
         }
         if (_cache) {
-            _cache->notifyEntryStorageChanged( eStorageModeDisk, eStorageModeRAM, getTime(), size() );
+            _cache->notifyEntryStorageChanged( eStorageModeDisk, eStorageModeRAM, getTime(), size(), _key.getCacheHolderID() );
         }
     }
 
@@ -975,18 +998,18 @@ public:
             if (info.mode == eStorageModeDisk) {
                 if (dataAllocated) {
                     if (_cache->isTileCache()) {
-                         _cache->notifyEntryDestroyed(time, sz, eStorageModeDisk);
+                         _cache->notifyEntryDestroyed(time, sz, eStorageModeDisk, _key.getCacheHolderID());
                     } else {
-                        _cache->notifyEntryStorageChanged( eStorageModeRAM, eStorageModeDisk, time, sz );
+                        _cache->notifyEntryStorageChanged( eStorageModeRAM, eStorageModeDisk, time, sz, _key.getCacheHolderID() );
                     }
                 }
             } else if (info.mode == eStorageModeRAM) {
                 if (dataAllocated) {
-                    _cache->notifyEntryDestroyed(time, sz, eStorageModeRAM);
+                    _cache->notifyEntryDestroyed(time, sz, eStorageModeRAM, _key.getCacheHolderID());
                 }
             } else if (info.mode == eStorageModeGLTex) {
                 if (dataAllocated) {
-                    _cache->notifyEntryDestroyed(time, sz, eStorageModeGLTex);
+                    _cache->notifyEntryDestroyed(time, sz, eStorageModeGLTex, _key.getCacheHolderID());
                 }
             }
         }
@@ -1064,10 +1087,10 @@ public:
             _cache->backingFileClosed();
         }
         if (isAlloc) {
-            _cache->notifyEntryDestroyed(getTime(), getElementsCountFromParams(), eStorageModeRAM);
+            _cache->notifyEntryDestroyed(getTime(), getElementsCountFromParams(), eStorageModeRAM, _key.getCacheHolderID());
         } else {
             ///size() will return 0 at this point, we have to recompute it
-            _cache->notifyEntryDestroyed(getTime(), getElementsCountFromParams(), eStorageModeDisk);
+            _cache->notifyEntryDestroyed(getTime(), getElementsCountFromParams(), eStorageModeDisk, _key.getCacheHolderID());
         }
     }
 
@@ -1086,6 +1109,27 @@ public:
         return _key.getTime();
     }
 
+    /**
+     * @brief Adds the given time, in seconds, spent rendering the content of this entry. The cache evicts first the entries
+     * that are cheap to recompute relative to their size.
+     **/
+    void addRenderCost(double seconds)
+    {
+        QWriteLocker k(&_entryLock);
+
+        _renderCost += seconds;
+    }
+
+    /**
+     * @brief Returns the total time in seconds spent rendering the content of this entry, or 0 if it is unknown.
+     **/
+    double getRenderCost() const
+    {
+        QReadLocker k(&_entryLock);
+
+        return _renderCost;
+    }
+
     ParamsTypePtr getParams() const WARN_UNUSED_RETURN
     {
         return _params;
@@ -1143,7 +1187,7 @@ protected:
 
         _data.swap(other._data);
         if (_cache) {
-            _cache->notifyEntrySizeChanged( oldSize, size() );
+            _cache->notifyEntrySizeChanged( oldSize, size(), _key.getCacheHolderID() );
         }
     }
 
@@ -1253,6 +1297,7 @@ protected:
     const CacheAPI* _cache;
     mutable QReadWriteLock _entryLock;
     bool _removeBackingFileBeforeDestruction;
+    double _renderCost; // protected by _entryLock
 };
 
 NATRON_NAMESPACE_EXIT
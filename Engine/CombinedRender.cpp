@@ -0,0 +1,346 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CombinedRender.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#include "Engine/Image.h"
+#include "Engine/Node.h"
+#include "Engine/OutputEffectInstance.h"
+#include "Engine/WriteNode.h"
+
+NATRON_NAMESPACE_ENTER
+
+namespace {
+struct WriterState
+{
+    const OutputEffectInstance* writer;
+    int firstFrame, lastFrame, frameStep;
+
+    // Index in the schedule of the next frame this writer will start
+    std::size_t nextIndex;
+
+    // Frames rendered by this writer
+    std::set<int> doneFrames;
+    bool started;
+    bool finished;
+
+    bool hasFrame(int frame) const
+    {
+        return frame >= firstFrame && frame <= lastFrame && (frame - firstFrame) % frameStep == 0;
+    }
+
+    bool needsFrame(int frame) const
+    {
+        return started && !finished && hasFrame(frame) && doneFrames.find(frame) == doneFrames.end();
+    }
+};
+} // anon namespace
+
+struct CombinedRenderPrivate
+{
+    // All frames rendered by at least one writer, sorted
+    std::vector<int> schedule;
+
+    // Nodes whose output is pinned. Written only in the constructor.
+    std::set<const Node*> sharedNodes;
+
+    // Protects all fields below
+    mutable QMutex lock;
+
+    // Woken up whenever a writer progresses
+    QWaitCondition writerProgressed;
+    std::vector<WriterState> writers;
+    std::map<int, std::list<ImagePtr> > pinnedImages;
+
+    CombinedRenderPrivate()
+        : schedule()
+        , sharedNodes()
+        , lock()
+        , writerProgressed()
+        , writers()
+        , pinnedImages()
+    {
+    }
+
+    std::size_t getFrameIndex(int frame) const
+    {
+        return std::lower_bound(schedule.begin(), schedule.end(), frame) - schedule.begin();
+    }
+
+    WriterState* findWriter(const OutputEffectInstance* writer)
+    {
+        for (std::size_t i = 0; i < writers.size(); ++i) {
+            if (writers[i].writer == writer) {
+                return &writers[i];
+            }
+        }
+
+        return 0;
+    }
+
+    void findSharedNodes();
+
+    void releasePinnedImages();
+};
+
+static void
+addUpstreamNodes(const NodePtr& node,
+                 std::set<const Node*>* visited,
+                 std::map<const Node*, std::set<const Node*> >* consumers)
+{
+    if ( !visited->insert( node.get() ).second ) {
+        return;
+    }
+    int nInputs = node->getNInputs();
+    for (int i = 0; i < nInputs; ++i) {
+        NodePtr input = node->getInput(i);
+        if (input) {
+            (*consumers)[input.get()].insert( node.get() );
+            addUpstreamNodes(input, visited, consumers);
+        }
+    }
+}
+
+void
+CombinedRenderPrivate::findSharedNodes()
+{
+    // For each node, the number of writers it is upstream of
+    std::map<const Node*, int> nWriters;
+    // For each node, the nodes that read its output in the tree of any writer
+    std::map<const Node*, std::set<const Node*> > consumers;
+
+    for (std::size_t i = 0; i < writers.size(); ++i) {
+        // A Write node renders through the writer embedded in it
+        NodePtr root = writers[i].writer->getNode();
+        const WriteNode* isWriteNode = dynamic_cast<const WriteNode*>(writers[i].writer);
+        if (isWriteNode) {
+            NodePtr embeddedWriter = isWriteNode->getEmbeddedWriter();
+            if (embeddedWriter) {
+                root = embeddedWriter;
+            }
+        }
+        std::set<const Node*> visited;
+        addUpstreamNodes(root, &visited, &consumers);
+        for (std::set<const Node*>::const_iterator it = visited.begin(); it != visited.end(); ++it) {
+            ++nWriters[*it];
+        }
+    }
+
+    // Only pin the nodes where the trees split: pinning the nodes upstream of them would not save any render.
+    for (std::map<const Node*, int>::const_iterator it = nWriters.begin(); it != nWriters.end(); ++it) {
+        if (it->second < 2) {
+            continue;
+        }
+        const std::set<const Node*>& nodeConsumers = consumers[it->first];
+        for (std::set<const Node*>::const_iterator it2 = nodeConsumers.begin(); it2 != nodeConsumers.end(); ++it2) {
+            std::map<const Node*, int>::const_iterator found = nWriters.find(*it2);
+            if ( ( found == nWriters.end() ) || (found->second < 2) ) {
+                sharedNodes.insert(it->first);
+                break;
+            }
+        }
+    }
+}
+
+void
+CombinedRenderPrivate::releasePinnedImages()
+{
+    // Called with the lock held
+    for (std::map<int, std::list<ImagePtr> >::iterator it = pinnedImages.begin(); it != pinnedImages.end();) {
+        bool needed = false;
+        for (std::size_t i = 0; i < writers.size(); ++i) {
+            if ( writers[i].needsFrame(it->first) ) {
+                needed = true;
+                break;
+            }
+        }
+        if (needed) {
+            ++it;
+        } else {
+            pinnedImages.erase(it++);
+        }
+    }
+}
+
+CombinedRender::CombinedRender(const std::list<WriterRange>& writers)
+    : _imp( new CombinedRenderPrivate() )
+{
+    std::set<int> frames;
+
+    for (std::list<WriterRange>::const_iterator it = writers.begin(); it != writers.end(); ++it) {
+        assert( !_imp->findWriter(it->writer) );
+        WriterState w;
+        w.writer = it->writer;
+        w.firstFrame = it->firstFrame;
+        w.lastFrame = it->lastFrame;
+        w.frameStep = std::max(1, it->frameStep);
+        w.nextIndex = 0;
+        w.started = false;
+        w.finished = false;
+        _imp->writers.push_back(w);
+        for (int f = w.firstFrame; f <= w.lastFrame; f += w.frameStep) {
+            frames.insert(f);
+        }
+    }
+    _imp->schedule.assign( frames.begin(), frames.end() );
+    for (std::size_t i = 0; i < _imp->writers.size(); ++i) {
+        _imp->writers[i].nextIndex = _imp->getFrameIndex(_imp->writers[i].firstFrame);
+    }
+    _imp->findSharedNodes();
+}
+
+CombinedRender::~CombinedRender()
+{
+}
+
+std::size_t
+CombinedRender::getNSharedNodes() const
+{
+    return _imp->sharedNodes.size();
+}
+
+bool
+CombinedRender::isSharedNode(const Node* node) const
+{
+    return _imp->sharedNodes.find(node) != _imp->sharedNodes.end();
+}
+
+void
+CombinedRender::notifyWriterStarted(const OutputEffectInstance* writer)
+{
+    QMutexLocker k(&_imp->lock);
+    WriterState* w = _imp->findWriter(writer);
+
+    if (w) {
+        w->started = true;
+    }
+}
+
+void
+CombinedRender::notifyWriterFinished(const OutputEffectInstance* writer)
+{
+    QMutexLocker k(&_imp->lock);
+    WriterState* w = _imp->findWriter(writer);
+
+    if (!w) {
+        return;
+    }
+    w->finished = true;
+    _imp->releasePinnedImages();
+    _imp->writerProgressed.wakeAll();
+}
+
+bool
+CombinedRender::waitForFrame(const OutputEffectInstance* writer,
+                             int frame,
+                             int timeoutMs)
+{
+    QMutexLocker k(&_imp->lock);
+    WriterState* w = _imp->findWriter(writer);
+
+    if (!w) {
+        return true;
+    }
+    const std::size_t frameIndex = _imp->getFrameIndex(frame);
+    for (;;) {
+        // Only wait for the writers that still have to start this frame: since every writer starts its frames in order,
+        // the writer that is the furthest behind never waits and the group cannot deadlock.
+        bool mustWait = false;
+        for (std::size_t i = 0; i < _imp->writers.size(); ++i) {
+            const WriterState& other = _imp->writers[i];
+            if ( (&other == w) || !other.started || other.finished || !other.hasFrame(frame) ) {
+                continue;
+            }
+            if (frameIndex >= other.nextIndex + NATRON_COMBINED_RENDER_MAX_FRAMES_AHEAD) {
+                mustWait = true;
+                break;
+            }
+        }
+        if (!mustWait) {
+            break;
+        }
+        if ( !_imp->writerProgressed.wait(&_imp->lock, timeoutMs) ) {
+            return false;
+        }
+    }
+
+    // The next frame of this writer is the one following this frame in its range
+    int nextFrame = frame + w->frameStep;
+    std::size_t nextIndex = nextFrame > w->lastFrame ? _imp->schedule.size() : _imp->getFrameIndex(nextFrame);
+    if (nextIndex > w->nextIndex) {
+        w->nextIndex = nextIndex;
+        _imp->writerProgressed.wakeAll();
+    }
+
+    return true;
+}
+
+void
+CombinedRender::notifyFrameDone(const OutputEffectInstance* writer,
+                                int frame)
+{
+    QMutexLocker k(&_imp->lock);
+    WriterState* w = _imp->findWriter(writer);
+
+    if (!w) {
+        return;
+    }
+    w->doneFrames.insert(frame);
+
+    std::map<int, std::list<ImagePtr> >::iterator found = _imp->pinnedImages.find(frame);
+    if ( found == _imp->pinnedImages.end() ) {
+        return;
+    }
+    for (std::size_t i = 0; i < _imp->writers.size(); ++i) {
+        if ( _imp->writers[i].needsFrame(frame) ) {
+            return;
+        }
+    }
+    _imp->pinnedImages.erase(found);
+}
+
+void
+CombinedRender::pinImage(int frame,
+                         const ImagePtr& image)
+{
+    if (!image) {
+        return;
+    }
+    QMutexLocker k(&_imp->lock);
+    std::list<ImagePtr>& images = _imp->pinnedImages[frame];
+    if ( std::find(images.begin(), images.end(), image) == images.end() ) {
+        images.push_back(image);
+    }
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,133 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_COMBINEDRENDER_H
+#define NATRON_ENGINE_COMBINEDRENDER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <cstddef>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Engine/EngineFwd.h"
+
+// Number of frames of the combined schedule a writer may start ahead of the slowest writer that also renders them.
+// This bounds the number of frames for which the images of the shared nodes are pinned in the cache.
+#define NATRON_COMBINED_RENDER_MAX_FRAMES_AHEAD 4
+
+// Interval, in milliseconds, at which a render thread waiting for the other writers of its group checks whether its render was aborted
+#define NATRON_COMBINED_RENDER_WAIT_TIMEOUT_MS 50
+
+NATRON_NAMESPACE_ENTER
+
+struct CombinedRenderPrivate;
+
+/**
+ * @brief Groups the writers of a render so that the part of the graph they have in common is computed once per frame
+ * instead of once per writer.
+ *
+ * The frame ranges of all writers are merged in a single schedule. The writers still render with their own render engine
+ * and encode their own files, but a writer may not start a frame more than NATRON_COMBINED_RENDER_MAX_FRAMES_AHEAD frames
+ * of the schedule ahead of the other writers that render this frame as well: they all go through the same frames at the
+ * same time.
+ *
+ * The shared nodes are the nodes upstream of at least 2 writers where the trees of the writers split. Their output is
+ * always cached and the first writer that renders it for a frame pins the images, so that they cannot be evicted before all
+ * the other writers have rendered this frame. Writers that reach a frame while another one is still rendering it wait
+ * for the image being rendered instead of rendering it again (see Image::getRestToRender_trimap()).
+ *
+ * This class is MT-safe.
+ **/
+class CombinedRender
+{
+public:
+
+    struct WriterRange
+    {
+        OutputEffectInstance* writer;
+        int firstFrame;
+        int lastFrame;
+        int frameStep;
+    };
+
+    /**
+     * @brief Builds the schedule of the given writers and finds the nodes they share.
+     * The writers must be distinct.
+     **/
+    CombinedRender(const std::list<WriterRange>& writers);
+
+    ~CombinedRender();
+
+    /**
+     * @brief Returns the number of shared nodes. If it is 0, rendering the writers together is pointless.
+     **/
+    std::size_t getNSharedNodes() const;
+
+    /**
+     * @brief Returns true if the output of the given node is used by several writers of the group
+     **/
+    bool isSharedNode(const Node* node) const;
+
+    /**
+     * @brief Called when the render of the given writer starts. Only the writers that are rendering are waited for.
+     **/
+    void notifyWriterStarted(const OutputEffectInstance* writer);
+
+    /**
+     * @brief Called when the render of the given writer is finished or aborted. The writer no longer holds the other ones back
+     * and the images pinned for it are released.
+     **/
+    void notifyWriterFinished(const OutputEffectInstance* writer);
+
+    /**
+     * @brief Blocks the calling render thread until the given writer may start rendering the given frame, or the timeout (in
+     * milliseconds) expires. Returns false on timeout: the caller should check whether its render was aborted and call it again.
+     **/
+    bool waitForFrame(const OutputEffectInstance* writer, int frame, int timeoutMs);
+
+    /**
+     * @brief Called once the given writer has rendered all the views of the given frame (or failed to): the images pinned for
+     * this frame are released once all the writers rendering it are done with it.
+     **/
+    void notifyFrameDone(const OutputEffectInstance* writer, int frame);
+
+    /**
+     * @brief Keeps the given image of a shared node alive, and thus in the cache, until all the writers rendering the given
+     * frame are done with it.
+     **/
+    void pinImage(int frame, const ImagePtr& image);
+
+private:
+
+    boost::scoped_ptr<CombinedRenderPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_COMBINEDRENDER_H
@@ -27,11 +27,24 @@
 
 #include <cassert>
 #include <stdexcept>
+#include <sstream> // stringstream
+
+#include <QtCore/QMutex>
+#include <QtCore/QDateTime>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#endif
 
 #include "Engine/Node.h"
 #include "Engine/Image.h"
 #include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
+#include "Engine/CreateNodeArgs.h"
+#include "Engine/DiskCacheStore.h"
+#include "Engine/Hash64.h"
 #include "Engine/KnobTypes.h"
+#include "Engine/Project.h"
 #include "Engine/TimeLine.h"
 #include "Engine/ViewIdx.h"
 
@@ -43,12 +56,82 @@ struct DiskCacheNodePrivate
     KnobIntWPtr firstFrame;
     KnobIntWPtr lastFrame;
     KnobButtonWPtr preRender;
+    KnobChoiceWPtr compression;
+    KnobIntWPtr diskBudget;
+    KnobButtonWPtr clearStore;
+    KnobStringWPtr storeID;
+
+    // Protects store and storeSavedInProject
+    mutable QMutex storeLock;
+    boost::shared_ptr<DiskCacheStore> store;
+
+    // True if a project file saved by the user refers to the store
+    bool storeSavedInProject;
 
     DiskCacheNodePrivate()
+        : storeLock()
+        , store()
+        , storeSavedInProject(false)
+    {
+    }
+
+    std::string getStorePath() const
+    {
+        std::string path = appPTR->getDiskCacheLocation().toStdString();
+
+        path += "/" NATRON_DISKCACHE_STORE_DIRNAME "/";
+        path += storeID.lock()->getValue();
+
+        return path;
+    }
+
+    U64 getDiskBudget() const
+    {
+        return (U64)diskBudget.lock()->getValue() * 1024ULL * 1024ULL;
+    }
+
+    /**
+     * @brief Returns the store of the node, opening it the first time it is needed or when
+     * the store ID changed, e.g: after loading a project.
+     **/
+    boost::shared_ptr<DiskCacheStore> getStore()
+    {
+        std::string path = getStorePath();
+        QMutexLocker k(&storeLock);
+
+        if ( !store || (store->getPath() != path) ) {
+            store = boost::make_shared<DiskCacheStore>( path, getDiskBudget() );
+        }
+
+        return store;
+    }
+
+    /**
+     * @brief Same as getStore() but does not open the store if it was not opened yet.
+     **/
+    boost::shared_ptr<DiskCacheStore> getStoreIfOpened() const
     {
+        QMutexLocker k(&storeLock);
+
+        return store;
     }
 };
 
+static std::string
+generateStoreID(const DiskCacheNode* node)
+{
+    Hash64 hash;
+
+    hash.append( (U64)QDateTime::currentMSecsSinceEpoch() );
+    hash.append( (U64)reinterpret_cast<std::size_t>(node) );
+    hash.computeHash();
+
+    std::stringstream ss;
+    ss << std::hex << hash.value();
+
+    return ss.str();
+}
+
 DiskCacheNode::DiskCacheNode(NodePtr node)
     : OutputEffectInstance(node)
     , _imp( new DiskCacheNodePrivate() )
@@ -60,6 +143,54 @@ DiskCacheNode::~DiskCacheNode()
 {
 }
 
+void
+DiskCacheNode::onEffectCreated(bool /*mayCreateFileDialog*/,
+                               const CreateNodeArgs& args)
+{
+    ProjectPtr project = getApp()->getProject();
+
+    if ( args.getProperty<NodeSerializationPtr>(kCreateNodeArgsPropNodeSerialization) ) {
+        if ( project->isLoadingProject() ) {
+            QMutexLocker k(&_imp->storeLock);
+            _imp->storeSavedInProject = true;
+        } else {
+            // Copied or duplicated node: do not share the store of the original node
+            _imp->storeID.lock()->setValue( generateStoreID(this) );
+        }
+    }
+    QObject::connect( project.get(), SIGNAL(projectNameChanged(QString,bool)), this, SLOT(onProjectNameChanged(QString,bool)) );
+}
+
+void
+DiskCacheNode::onProjectNameChanged(const QString& /*name*/,
+                                    bool modified)
+{
+    // The project is reported unmodified once it was saved or loaded
+    ProjectPtr project = getApp()->getProject();
+
+    if ( !modified && project->hasProjectBeenSavedByUser() && !project->isProjectClosing() ) {
+        QMutexLocker k(&_imp->storeLock);
+        _imp->storeSavedInProject = true;
+    }
+}
+
+void
+DiskCacheNode::onEffectAboutToBeDestroyed()
+{
+    AppInstancePtr app = getApp();
+    ProjectPtr project = app ? app->getProject() : ProjectPtr();
+    std::string path = _imp->getStorePath();
+    QMutexLocker k(&_imp->storeLock);
+
+    // Keep the frames if a saved project refers to them, they will be found again when it is opened.
+    // Otherwise the node was deleted or its project discarded and nothing will ever use the store again.
+    if ( project && project->isProjectClosing() && _imp->storeSavedInProject ) {
+        return;
+    }
+    _imp->store.reset();
+    DiskCacheStore::removeStore(path);
+}
+
 void
 DiskCacheNode::addAcceptedComponents(int /*inputNb*/,
                                      std::list<ImagePlaneDesc>* comps)
@@ -131,6 +262,53 @@ DiskCacheNode::initializeKnobs()
     preRender->setHintToolTip( tr("Cache the frame range specified by rendering images at zoom-level 100% only.") );
     page->addKnob(preRender);
     _imp->preRender = preRender;
+
+    KnobChoicePtr compression = AppManager::createKnob<KnobChoice>( this, tr("Compression") );
+    compression->setName("compression");
+    compression->setAnimationEnabled(false);
+    {
+        std::vector<ChoiceOption> choices;
+        choices.push_back( ChoiceOption("Uncompressed", "", tr("Frames are stored as 32-bit floating point raw data. Fastest to read but largest on disk.").toStdString() ) );
+        choices.push_back( ChoiceOption("Lossless", "", tr("Frames are stored as 32-bit floating point data compressed without any loss.").toStdString() ) );
+        choices.push_back( ChoiceOption("Half float", "", tr("Frames are stored as 16-bit floating point data. Half the size of uncompressed frames, with a loss of precision.").toStdString() ) );
+        compression->populateChoices(choices);
+    }
+    compression->setEvaluateOnChange(false);
+    compression->setDefaultValue(1);
+    compression->setHintToolTip( tr("How frames are encoded in the frame store of this node. "
+                                    "Changing this only affects frames that are cached afterwards.") );
+    page->addKnob(compression);
+    _imp->compression = compression;
+
+    KnobIntPtr diskBudget = AppManager::createKnob<KnobInt>( this, tr("Disk Budget (MiB)") );
+    diskBudget->setName("diskBudget");
+    diskBudget->setAnimationEnabled(false);
+    diskBudget->disableSlider();
+    diskBudget->setEvaluateOnChange(false);
+    diskBudget->setMinimum(1);
+    diskBudget->setDefaultValue(8192);
+    diskBudget->setAddNewLine(false);
+    diskBudget->setHintToolTip( tr("Maximum amount of disk space used by the frame store of this node. When exceeded, "
+                                   "the least recently used frames are removed.") );
+    page->addKnob(diskBudget);
+    _imp->diskBudget = diskBudget;
+
+    KnobButtonPtr clearStore = AppManager::createKnob<KnobButton>( this, tr("Clear Store") );
+    clearStore->setName("clearStore");
+    clearStore->setEvaluateOnChange(false);
+    clearStore->setHintToolTip( tr("Remove all frames cached by this node from the disk.") );
+    page->addKnob(clearStore);
+    _imp->clearStore = clearStore;
+
+    // Identifies the directory of the frame store. It is saved with the project so that the node finds its frames again.
+    KnobStringPtr storeID = AppManager::createKnob<KnobString>( this, tr("Store ID") );
+    storeID->setName("storeID");
+    storeID->setAnimationEnabled(false);
+    storeID->setEvaluateOnChange(false);
+    storeID->setSecretByDefault(true);
+    storeID->setValue( generateStoreID(this) );
+    page->addKnob(storeID);
+    _imp->storeID = storeID;
 }
 
 bool
@@ -167,6 +345,15 @@ DiskCacheNode::knobChanged(KnobI* k,
         std::list<AppInstance::RenderWork> works;
         works.push_back(w);
         getApp()->startWritersRendering(false, works);
+    } else if (_imp->clearStore.lock().get() == k) {
+        _imp->getStore()->clear();
+        // Results of getFramesNeeded depend on the content of the store
+        clearActionsCache();
+    } else if (_imp->diskBudget.lock().get() == k) {
+        boost::shared_ptr<DiskCacheStore> store = _imp->getStoreIfOpened();
+        if (store) {
+            store->setMaximumSize( _imp->getDiskBudget() );
+        }
     } else {
         ret = false;
     }
@@ -201,6 +388,66 @@ DiskCacheNode::getFrameRange(double *first,
     }
 }
 
+std::string
+DiskCacheNode::getStorePath() const
+{
+    return _imp->getStorePath();
+}
+
+FramesNeededMap
+DiskCacheNode::getFramesNeeded(double time,
+                               ViewIdx view)
+{
+    // If the frame is in the store, do not let the input branch be pre-rendered: on a miss
+    // the source image is fetched on demand by getImage() in render().
+    EffectInstancePtr input = getInput(0);
+
+    if ( input && _imp->getStore()->hasFrameAtAnyLevel(input->getRenderHash(), time, view) ) {
+        return FramesNeededMap();
+    }
+
+    return EffectInstance::getFramesNeeded(time, view);
+}
+
+/**
+ * @brief Reads the portion roi of the frame from the store into output, downscaling a higher resolution
+ * version of the frame if it is not stored at the requested mipmap level.
+ **/
+static bool
+readFrameFromStore(DiskCacheStore& store,
+                   const DiskCacheStoreKey& key,
+                   const RectI& roi,
+                   Image* output)
+{
+    if ( store.readFrame(key, roi, output) ) {
+        return true;
+    }
+    if (key.mipMapLevel == 0) {
+        return false;
+    }
+
+    DiskCacheStoreKey levelKey = key;
+    RectI storedBounds;
+    if ( !store.getBestLevelForFrame(key, key.mipMapLevel - 1, &levelKey.mipMapLevel, &storedBounds) ) {
+        return false;
+    }
+    const unsigned int downscaleLevels = key.mipMapLevel - levelKey.mipMapLevel;
+    RectI roiAtLevel;
+    if ( !roi.upscalePowerOfTwo(downscaleLevels).intersect(storedBounds, &roiAtLevel) ||
+         !output->getBounds().contains( roiAtLevel.downscalePowerOfTwoSmallestEnclosing(downscaleLevels) ) ) {
+        return false;
+    }
+
+    ImagePtr levelImage = boost::make_shared<Image>( output->getComponents(), output->getRoD(), roiAtLevel, levelKey.mipMapLevel, output->getPixelAspectRatio(),
+                                                     eImageBitDepthFloat, output->getPremultiplication(), output->getFieldingOrder() );
+    if ( !store.readFrame(levelKey, roiAtLevel, levelImage.get()) ) {
+        return false;
+    }
+    levelImage->downscaleMipMap( output->getRoD(), roiAtLevel, levelKey.mipMapLevel, key.mipMapLevel, false, output );
+
+    return true;
+}
+
 StatusEnum
 DiskCacheNode::render(const RenderActionArgs& args)
 {
@@ -212,25 +459,48 @@ DiskCacheNode::render(const RenderActionArgs& args)
     }
 
 
-    const std::pair<ImagePlaneDesc, ImagePtr>& output = args.outputPlanes.front();
+    boost::shared_ptr<DiskCacheStore> store = _imp->getStore();
+    const DiskCacheStore::CodecEnum codec = (DiskCacheStore::CodecEnum)_imp->compression.lock()->getValue();
+    bool storeChanged = false;
 
     for (std::list<std::pair<ImagePlaneDesc, ImagePtr> >::const_iterator it = args.outputPlanes.begin(); it != args.outputPlanes.end(); ++it) {
+        DiskCacheStoreKey key;
+        key.inputHash = input->getRenderHash();
+        key.time = args.time;
+        key.view = args.view;
+        key.mipMapLevel = it->second->getMipMapLevel();
+        key.planeID = it->first.getPlaneID() + '.' + it->first.getChannelsLabel();
+
+        if ( readFrameFromStore(*store, key, args.roi, it->second.get()) ) {
+            continue;
+        }
+
         RectI roiPixel;
         ImagePtr srcImg = getImage(0, args.time, args.originalScale, args.view, NULL, &it->first, false /*mapToClipPrefs*/, true /*dontUpscale*/, eStorageModeRAM /*useOpenGL*/, 0 /*textureDepth*/,  &roiPixel);
         if (!srcImg) {
             return eStatusFailed;
         }
-        if ( srcImg->getMipMapLevel() != output.second->getMipMapLevel() ) {
+        const ImagePtr& output = it->second;
+        if ( srcImg->getMipMapLevel() != output->getMipMapLevel() ) {
             throw std::runtime_error("Host gave image with wrong scale");
         }
-        if ( ( srcImg->getComponents() != output.second->getComponents() ) || ( srcImg->getBitDepth() != output.second->getBitDepth() ) ) {
+        if ( ( srcImg->getComponents() != output->getComponents() ) || ( srcImg->getBitDepth() != output->getBitDepth() ) ) {
             srcImg->convertToFormat( args.roi, getApp()->getDefaultColorSpaceForBitDepth( srcImg->getBitDepth() ),
-                                     getApp()->getDefaultColorSpaceForBitDepth( output.second->getBitDepth() ), 3, true, false, output.second.get() );
+                                     getApp()->getDefaultColorSpaceForBitDepth( output->getBitDepth() ), 3, true, false, output.get() );
         } else {
-            output.second->pasteFrom( *srcImg, args.roi, output.second->usesBitMap() && srcImg->usesBitMap() );
+            output->pasteFrom( *srcImg, args.roi, output->usesBitMap() && srcImg->usesBitMap() );
+        }
+
+        if ( !aborted() && store->writeFrame(key, codec, *it->second, args.roi) ) {
+            storeChanged = true;
         }
     }
 
+    if (storeChanged) {
+        // Results of getFramesNeeded depend on the content of the store
+        clearActionsCache();
+    }
+
     return eStatusOK;
 }
 
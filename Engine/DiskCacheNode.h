@@ -87,9 +87,12 @@ public:
 
     virtual std::string getPluginDescription() const OVERRIDE FINAL WARN_UNUSED_RETURN
     {
-        return tr("This node caches all images of the connected input node onto the disk with full 32bit floating point raw data. "
+        return tr("This node caches all images of the connected input node onto the disk. "
                   "When an image is found in the cache, %1 will then not request the input branch to render out that image. "
                   "The DiskCache node only caches full images and does not split up the images in chunks.  "
+                  "Each node owns a dedicated frame store which is not affected by clearing the caches of %1 and is kept across sessions "
+                  "for as long as the input branch is not modified. Frames can be stored uncompressed, losslessly compressed or as "
+                  "half-float, and the least recently used frames are removed when the store exceeds its disk budget. "
                   "The DiskCache node is useful if working with a large and complex node tree: this allows to break the tree into smaller "
                   "branches and cache any branch that you're no longer working on. The cached images are saved by default in the same directory that is used "
                   "for the viewer cache but you can set its location and size in the preferences. A solid state drive disk is recommended for efficiency of this node. "
@@ -143,8 +146,22 @@ public:
 
     virtual bool isHostChannelSelectorSupported(bool* defaultR, bool* defaultG, bool* defaultB, bool* defaultA) const OVERRIDE WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Returns the location of the persistent frame store of this node.
+     **/
+    std::string getStorePath() const;
+
+public Q_SLOTS:
+
+    void onProjectNameChanged(const QString& name, bool modified);
+
 private:
 
+    virtual void onEffectCreated(bool mayCreateFileDialog, const CreateNodeArgs& args) OVERRIDE FINAL;
+    virtual void onEffectAboutToBeDestroyed() OVERRIDE FINAL;
+
+    virtual FramesNeededMap getFramesNeeded(double time, ViewIdx view) OVERRIDE FINAL WARN_UNUSED_RETURN;
+
     virtual bool knobChanged(KnobI* k,
                              ValueChangedReasonEnum reason,
                              ViewSpec view,
@@ -0,0 +1,910 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "DiskCacheStore.h"
+
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstring> // memcpy
+#include <stdexcept>
+#include <sstream> // stringstream
+
+#include <QtCore/QMutex>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QByteArray>
+#include <QtCore/QThread>
+#include <QtCore/QDebug>
+
+#include "Engine/Hash64.h"
+#include "Engine/Image.h"
+#include "Engine/MemoryFile.h"
+
+// Number of rows encoded together. This is the granularity at which a region of interest can be decoded.
+#define NATRON_DISKCACHE_STORE_STRIP_HEIGHT 32
+
+// Bump when the file layout changes: frames with another version are discarded when the store is opened
+#define NATRON_DISKCACHE_STORE_VERSION 1
+
+// zlib compression level used by the lossless codec: favor speed, the byte shuffling does most of the work
+#define NATRON_DISKCACHE_STORE_ZLIB_LEVEL 1
+
+NATRON_NAMESPACE_ENTER
+
+namespace {
+
+// On-disk layout of a frame file:
+// DiskCacheFrameHeader | plane ID (padded to 8 bytes) | nStrips * DiskCacheStripEntry | strips data
+struct DiskCacheFrameHeader
+{
+    char magic[4];
+    U32 version;
+    U32 codec;
+    U32 nComps;
+    int x1, y1, x2, y2;
+    double time;
+    int view;
+    U32 mipMapLevel;
+    U64 inputHash;
+    U32 stripHeight;
+    U32 nStrips;
+    U32 planeIDLength;
+    U32 reserved;
+};
+
+struct DiskCacheStripEntry
+{
+    // Offset in bytes of the strip from the start of the file
+    U64 offset;
+
+    // Number of encoded bytes
+    U64 size;
+};
+
+const char kDiskCacheFrameMagic[4] = { 'N', 'D', 'C', 'F' };
+
+std::size_t
+getPaddedPlaneIDLength(std::size_t length)
+{
+    return (length + 7) & ~( (std::size_t)7 );
+}
+
+std::size_t
+getStripsTableOffset(const DiskCacheFrameHeader& header)
+{
+    return sizeof(DiskCacheFrameHeader) + getPaddedPlaneIDLength(header.planeIDLength);
+}
+
+bool
+isHeaderValid(const DiskCacheFrameHeader& header,
+              std::size_t fileSize)
+{
+    if ( (std::memcmp(header.magic, kDiskCacheFrameMagic, 4) != 0) || (header.version != NATRON_DISKCACHE_STORE_VERSION) ) {
+        return false;
+    }
+    if ( (header.codec > (U32)DiskCacheStore::eCodecHalf) || (header.nComps == 0) || (header.nComps > 4) || (header.stripHeight == 0) ) {
+        return false;
+    }
+    if ( (header.x2 <= header.x1) || (header.y2 <= header.y1) ) {
+        return false;
+    }
+    U32 expectedStrips = ( (U32)(header.y2 - header.y1) + header.stripHeight - 1 ) / header.stripHeight;
+    if (header.nStrips != expectedStrips) {
+        return false;
+    }
+
+    return getStripsTableOffset(header) + header.nStrips * sizeof(DiskCacheStripEntry) <= fileSize;
+}
+
+U16
+floatToHalf(float f)
+{
+    U32 x;
+
+    std::memcpy( &x, &f, sizeof(float) );
+    U32 sign = (x >> 16) & 0x8000;
+    U32 biasedExp = (x >> 23) & 0xff;
+    U32 mant = x & 0x7fffff;
+
+    if (biasedExp == 0xff) {
+        // Inf or NaN
+        return (U16)( sign | 0x7c00 | (mant ? 0x200 : 0) );
+    }
+    int exp = (int)biasedExp - 127 + 15;
+    if (exp >= 0x1f) {
+        // Overflow: clamp to infinity
+        return (U16)(sign | 0x7c00);
+    }
+    if (exp <= 0) {
+        // Denormalized half
+        if (exp < -10) {
+            return (U16)sign;
+        }
+        mant |= 0x800000;
+        U32 shift = (U32)(14 - exp);
+        U32 h = mant >> shift;
+        U32 rem = mant & ( (1u << shift) - 1 );
+        U32 halfway = 1u << (shift - 1);
+        if ( (rem > halfway) || ( (rem == halfway) && (h & 1) ) ) {
+            ++h;
+        }
+
+        return (U16)(sign | h);
+    }
+    U32 h = ( (U32)exp << 10 ) | (mant >> 13);
+    U32 rem = mant & 0x1fff;
+    // Round to nearest even. A carry into the exponent correctly produces the next power of 2 (or infinity)
+    if ( (rem > 0x1000) || ( (rem == 0x1000) && (h & 1) ) ) {
+        ++h;
+    }
+
+    return (U16)(sign | h);
+}
+
+float
+halfToFloatNoTable(U16 h)
+{
+    U32 sign = (U32)(h & 0x8000) << 16;
+    U32 exp = (h >> 10) & 0x1f;
+    U32 mant = h & 0x3ff;
+    U32 x;
+
+    if (exp == 0) {
+        if (mant == 0) {
+            x = sign;
+        } else {
+            // Denormalized half: renormalize it
+            exp = 127 - 15 + 1;
+            while ( !(mant & 0x400) ) {
+                mant <<= 1;
+                --exp;
+            }
+            mant &= 0x3ff;
+            x = sign | (exp << 23) | (mant << 13);
+        }
+    } else if (exp == 0x1f) {
+        x = sign | 0x7f800000 | (mant << 13);
+    } else {
+        x = sign | ( (exp + 127 - 15) << 23 ) | (mant << 13);
+    }
+    float f;
+    std::memcpy( &f, &x, sizeof(float) );
+
+    return f;
+}
+
+class HalfToFloatTable
+{
+public:
+
+    HalfToFloatTable()
+        : values(65536)
+    {
+        for (U32 i = 0; i < 65536; ++i) {
+            values[i] = halfToFloatNoTable( (U16)i );
+        }
+    }
+
+    std::vector<float> values;
+};
+
+// Built before main() since the store may be accessed from several render threads
+const HalfToFloatTable kHalfToFloat;
+
+// Splits the bytes of 32-bit values in 4 planes: floats of neighbouring pixels share their
+// sign/exponent bytes which then compress far better.
+void
+shuffleBytes(const unsigned char* src,
+             std::size_t nValues,
+             unsigned char* dst)
+{
+    for (std::size_t i = 0; i < nValues; ++i) {
+        for (int b = 0; b < 4; ++b) {
+            dst[b * nValues + i] = src[i * 4 + b];
+        }
+    }
+}
+
+struct DiskCacheFrameRecord
+{
+    std::string filePath;
+    RectI bounds;
+    U32 nComps;
+    DiskCacheStore::CodecEnum codec;
+    U64 sizeOnDisk;
+    U64 lastAccess;
+};
+
+typedef std::map<DiskCacheStoreKey, DiskCacheFrameRecord> DiskCacheFrameIndex;
+
+// Frames ordered by their last access, least recently used first
+typedef std::map<U64, DiskCacheStoreKey> DiskCacheLRUIndex;
+} // anon namespace
+
+bool
+DiskCacheStoreKey::operator<(const DiskCacheStoreKey& other) const
+{
+    // The mipmap level is compared last so that all levels of a frame are contiguous in the index
+    if (inputHash != other.inputHash) {
+        return inputHash < other.inputHash;
+    }
+    if (time != other.time) {
+        return time < other.time;
+    }
+    if ( (int)view != (int)other.view ) {
+        return (int)view < (int)other.view;
+    }
+    if (planeID != other.planeID) {
+        return planeID < other.planeID;
+    }
+
+    return mipMapLevel < other.mipMapLevel;
+}
+
+bool
+DiskCacheStoreKey::operator==(const DiskCacheStoreKey& other) const
+{
+    return inputHash == other.inputHash &&
+           time == other.time &&
+           (int)view == (int)other.view &&
+           mipMapLevel == other.mipMapLevel &&
+           planeID == other.planeID;
+}
+
+U64
+DiskCacheStoreKey::getHash() const
+{
+    Hash64 hash;
+
+    hash.append(inputHash);
+    hash.append(time);
+    hash.append( (int)view );
+    hash.append(mipMapLevel);
+    for (std::size_t i = 0; i < planeID.size(); ++i) {
+        hash.append(planeID[i]);
+    }
+    hash.computeHash();
+
+    return hash.value();
+}
+
+struct DiskCacheStorePrivate
+{
+    std::string path;
+
+    // Protects all fields below
+    mutable QMutex lock;
+    DiskCacheFrameIndex frames;
+    DiskCacheLRUIndex lruIndex;
+    U64 maximumSize;
+    U64 totalSize;
+    U64 accessCounter;
+
+    // Used to generate unique temporary file names when several threads write at once
+    U64 tmpFileCounter;
+
+    DiskCacheStorePrivate(const std::string& path,
+                          U64 maximumSize)
+        : path(path)
+        , lock()
+        , frames()
+        , lruIndex()
+        , maximumSize(maximumSize)
+        , totalSize(0)
+        , accessCounter(0)
+        , tmpFileCounter(0)
+    {
+    }
+
+    void buildIndex();
+
+    std::string getFramePath(const DiskCacheStoreKey& key) const
+    {
+        std::stringstream ss;
+
+        ss << path << '/' << std::hex << key.getHash() << "." NATRON_DISKCACHE_STORE_FILE_EXT;
+
+        return ss.str();
+    }
+
+    bool insertFrame_locked(const DiskCacheStoreKey& key,
+                            DiskCacheFrameRecord record)
+    {
+        assert( !lock.tryLock() );
+        record.lastAccess = ++accessCounter;
+        if ( !frames.insert( std::make_pair(key, record) ).second ) {
+            return false;
+        }
+        lruIndex.insert( std::make_pair(record.lastAccess, key) );
+        totalSize += record.sizeOnDisk;
+
+        return true;
+    }
+
+    /**
+     * @brief Marks the frame as the most recently used one
+     **/
+    void touchFrame_locked(DiskCacheFrameIndex::iterator it)
+    {
+        assert( !lock.tryLock() );
+        lruIndex.erase(it->second.lastAccess);
+        it->second.lastAccess = ++accessCounter;
+        lruIndex.insert( std::make_pair(it->second.lastAccess, it->first) );
+    }
+
+    void removeFrame_locked(DiskCacheFrameIndex::iterator it)
+    {
+        assert( !lock.tryLock() );
+        QFile::remove( QString::fromUtf8( it->second.filePath.c_str() ) );
+        totalSize = it->second.sizeOnDisk > totalSize ? 0 : totalSize - it->second.sizeOnDisk;
+        lruIndex.erase(it->second.lastAccess);
+        frames.erase(it);
+    }
+
+    /**
+     * @brief Removes the least recently used frames until the store fits its budget. The frame identified by
+     * keyToKeep is never removed.
+     **/
+    void evictExceedingFrames_locked(const DiskCacheStoreKey* keyToKeep)
+    {
+        assert( !lock.tryLock() );
+        DiskCacheLRUIndex::iterator lru = lruIndex.begin();
+        while ( totalSize > maximumSize && lru != lruIndex.end() ) {
+            if ( keyToKeep && (lru->second == *keyToKeep) ) {
+                ++lru;
+                continue;
+            }
+            DiskCacheFrameIndex::iterator found = frames.find(lru->second);
+            ++lru;
+            assert( found != frames.end() );
+            if ( found != frames.end() ) {
+                removeFrame_locked(found);
+            }
+        }
+    }
+
+    void encodeStrip(DiskCacheStore::CodecEnum codec,
+                     const Image::ReadAccess& acc,
+                     const RectI& stripRect,
+                     int nComps,
+                     std::vector<unsigned char>* out) const;
+
+    bool decodeStrip(DiskCacheStore::CodecEnum codec,
+                     const unsigned char* data,
+                     std::size_t dataSize,
+                     const RectI& stripRect,
+                     const RectI& roi,
+                     int nComps,
+                     Image::WriteAccess& acc) const;
+};
+
+void
+DiskCacheStorePrivate::buildIndex()
+{
+    QDir dir( QString::fromUtf8( path.c_str() ) );
+
+    if ( !dir.exists() ) {
+        dir.mkpath( QString::fromUtf8( path.c_str() ) );
+
+        return;
+    }
+
+    // Remove temporary files left by an interrupted write
+    {
+        QStringList tmpFiles = dir.entryList(QStringList( QString::fromUtf8("*.tmp") ), QDir::Files);
+        Q_FOREACH(const QString &file, tmpFiles) {
+            dir.remove(file);
+        }
+    }
+
+    // Oldest first so that the access counter reflects the last time each frame was written
+    QFileInfoList infos = dir.entryInfoList(QStringList( QString::fromUtf8("*." NATRON_DISKCACHE_STORE_FILE_EXT) ), QDir::Files, QDir::Time | QDir::Reversed);
+    Q_FOREACH(const QFileInfo &info, infos) {
+        QFile file( info.absoluteFilePath() );
+        bool valid = false;
+        if ( file.open(QIODevice::ReadOnly) ) {
+            DiskCacheFrameHeader header;
+            if ( ( file.read( (char*)&header, sizeof(header) ) == (qint64)sizeof(header) ) && isHeaderValid( header, (std::size_t)info.size() ) ) {
+                QByteArray planeID = file.read(header.planeIDLength);
+                if ( planeID.size() == (int)header.planeIDLength ) {
+                    DiskCacheStoreKey key;
+                    key.inputHash = header.inputHash;
+                    key.time = header.time;
+                    key.view = ViewIdx(header.view);
+                    key.mipMapLevel = header.mipMapLevel;
+                    key.planeID = std::string( planeID.constData(), planeID.size() );
+
+                    DiskCacheFrameRecord record;
+                    record.filePath = info.absoluteFilePath().toStdString();
+                    record.bounds = RectI(header.x1, header.y1, header.x2, header.y2);
+                    record.nComps = header.nComps;
+                    record.codec = (DiskCacheStore::CodecEnum)header.codec;
+                    record.sizeOnDisk = (U64)info.size();
+                    valid = insertFrame_locked(key, record);
+                }
+            }
+            file.close();
+        }
+        if (!valid) {
+            QFile::remove( info.absoluteFilePath() );
+        }
+    }
+} // DiskCacheStorePrivate::buildIndex
+
+void
+DiskCacheStorePrivate::encodeStrip(DiskCacheStore::CodecEnum codec,
+                                   const Image::ReadAccess& acc,
+                                   const RectI& stripRect,
+                                   int nComps,
+                                   std::vector<unsigned char>* out) const
+{
+    const std::size_t rowValues = (std::size_t)stripRect.width() * nComps;
+    const std::size_t nValues = rowValues * stripRect.height();
+
+    switch (codec) {
+    case DiskCacheStore::eCodecRaw: {
+        out->resize( nValues * sizeof(float) );
+        unsigned char* dst = &out->front();
+        for (int y = stripRect.y1; y < stripRect.y2; ++y) {
+            const float* src = (const float*)acc.pixelAt(stripRect.x1, y);
+            assert(src);
+            std::memcpy( dst, src, rowValues * sizeof(float) );
+            dst += rowValues * sizeof(float);
+        }
+        break;
+    }
+    case DiskCacheStore::eCodecHalf: {
+        out->resize( nValues * sizeof(U16) );
+        U16* dst = (U16*)&out->front();
+        for (int y = stripRect.y1; y < stripRect.y2; ++y) {
+            const float* src = (const float*)acc.pixelAt(stripRect.x1, y);
+            assert(src);
+            for (std::size_t i = 0; i < rowValues; ++i) {
+                *dst++ = floatToHalf(src[i]);
+            }
+        }
+        break;
+    }
+    case DiskCacheStore::eCodecLossless: {
+        std::vector<unsigned char> rows( nValues * sizeof(float) );
+        unsigned char* dst = &rows.front();
+        for (int y = stripRect.y1; y < stripRect.y2; ++y) {
+            const float* src = (const float*)acc.pixelAt(stripRect.x1, y);
+            assert(src);
+            std::memcpy( dst, src, rowValues * sizeof(float) );
+            dst += rowValues * sizeof(float);
+        }
+        std::vector<unsigned char> shuffled( rows.size() );
+        shuffleBytes(&rows.front(), nValues, &shuffled.front());
+        QByteArray compressed = qCompress(&shuffled.front(), (int)shuffled.size(), NATRON_DISKCACHE_STORE_ZLIB_LEVEL);
+        out->assign( compressed.constData(), compressed.constData() + compressed.size() );
+        break;
+    }
+    }
+} // DiskCacheStorePrivate::encodeStrip
+
+bool
+DiskCacheStorePrivate::decodeStrip(DiskCacheStore::CodecEnum codec,
+                                   const unsigned char* data,
+                                   std::size_t dataSize,
+                                   const RectI& stripRect,
+                                   const RectI& roi,
+                                   int nComps,
+                                   Image::WriteAccess& acc) const
+{
+    RectI rect;
+
+    if ( !stripRect.intersect(roi, &rect) ) {
+        return true;
+    }
+    const std::size_t stripRowValues = (std::size_t)stripRect.width() * nComps;
+    const std::size_t nValues = stripRowValues * stripRect.height();
+    const std::size_t rowValues = (std::size_t)rect.width() * nComps;
+    const std::size_t xOffset = (std::size_t)(rect.x1 - stripRect.x1) * nComps;
+
+    switch (codec) {
+    case DiskCacheStore::eCodecRaw: {
+        // Read straight from the mapped pages into the output image
+        if ( dataSize != nValues * sizeof(float) ) {
+            return false;
+        }
+        const float* src = (const float*)data;
+        for (int y = rect.y1; y < rect.y2; ++y) {
+            float* dst = (float*)acc.pixelAt(rect.x1, y);
+            assert(dst);
+            std::memcpy( dst, src + (y - stripRect.y1) * stripRowValues + xOffset, rowValues * sizeof(float) );
+        }
+        break;
+    }
+    case DiskCacheStore::eCodecHalf: {
+        if ( dataSize != nValues * sizeof(U16) ) {
+            return false;
+        }
+        const U16* src = (const U16*)data;
+        const float* table = &kHalfToFloat.values.front();
+        for (int y = rect.y1; y < rect.y2; ++y) {
+            float* dst = (float*)acc.pixelAt(rect.x1, y);
+            assert(dst);
+            const U16* srcRow = src + (y - stripRect.y1) * stripRowValues + xOffset;
+            for (std::size_t i = 0; i < rowValues; ++i) {
+                dst[i] = table[srcRow[i]];
+            }
+        }
+        break;
+    }
+    case DiskCacheStore::eCodecLossless: {
+        QByteArray shuffled = qUncompress(data, (int)dataSize);
+        if ( shuffled.size() != (int)(nValues * sizeof(float)) ) {
+            return false;
+        }
+        const unsigned char* planes[4];
+        for (int b = 0; b < 4; ++b) {
+            planes[b] = (const unsigned char*)shuffled.constData() + b * nValues;
+        }
+        for (int y = rect.y1; y < rect.y2; ++y) {
+            unsigned char* dst = (unsigned char*)acc.pixelAt(rect.x1, y);
+            assert(dst);
+            std::size_t srcIndex = (y - stripRect.y1) * stripRowValues + xOffset;
+            for (std::size_t i = 0; i < rowValues; ++i, ++srcIndex) {
+                for (int b = 0; b < 4; ++b) {
+                    *dst++ = planes[b][srcIndex];
+                }
+            }
+        }
+        break;
+    }
+    }
+
+    return true;
+} // DiskCacheStorePrivate::decodeStrip
+
+DiskCacheStore::DiskCacheStore(const std::string& directoryPath,
+                               U64 maximumSize)
+    : _imp( new DiskCacheStorePrivate(directoryPath, maximumSize) )
+{
+    QMutexLocker k(&_imp->lock);
+
+    _imp->buildIndex();
+    _imp->evictExceedingFrames_locked(0);
+}
+
+DiskCacheStore::~DiskCacheStore()
+{
+}
+
+const std::string&
+DiskCacheStore::getPath() const
+{
+    return _imp->path;
+}
+
+void
+DiskCacheStore::setMaximumSize(U64 maximumSize)
+{
+    QMutexLocker k(&_imp->lock);
+
+    _imp->maximumSize = maximumSize;
+    _imp->evictExceedingFrames_locked(0);
+}
+
+U64
+DiskCacheStore::getMaximumSize() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return _imp->maximumSize;
+}
+
+U64
+DiskCacheStore::getSize() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return _imp->totalSize;
+}
+
+int
+DiskCacheStore::getNumFrames() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return (int)_imp->frames.size();
+}
+
+bool
+DiskCacheStore::hasFrame(const DiskCacheStoreKey& key,
+                         const RectI& roi) const
+{
+    QMutexLocker k(&_imp->lock);
+    DiskCacheFrameIndex::const_iterator found = _imp->frames.find(key);
+
+    return found != _imp->frames.end() && found->second.bounds.contains(roi);
+}
+
+bool
+DiskCacheStore::hasFrameAtAnyLevel(U64 inputHash,
+                                   double time,
+                                   ViewIdx view) const
+{
+    // The empty plane ID and level 0 sort before any other plane and level of the frame
+    DiskCacheStoreKey key;
+
+    key.inputHash = inputHash;
+    key.time = time;
+    key.view = view;
+
+    QMutexLocker k(&_imp->lock);
+    DiskCacheFrameIndex::const_iterator it = _imp->frames.lower_bound(key);
+    if ( it == _imp->frames.end() ) {
+        return false;
+    }
+    return it->first.inputHash == inputHash && it->first.time == time && (int)it->first.view == (int)view;
+}
+
+bool
+DiskCacheStore::getBestLevelForFrame(const DiskCacheStoreKey& key,
+                                     unsigned int maxLevel,
+                                     unsigned int* level,
+                                     RectI* bounds) const
+{
+    DiskCacheStoreKey levelZero = key;
+
+    levelZero.mipMapLevel = 0;
+
+    QMutexLocker k(&_imp->lock);
+    for (DiskCacheFrameIndex::const_iterator it = _imp->frames.lower_bound(levelZero); it != _imp->frames.end(); ++it) {
+        if ( (it->first.inputHash != key.inputHash) || (it->first.time != key.time) || ( (int)it->first.view != (int)key.view ) ||
+             ( it->first.planeID != key.planeID) || (it->first.mipMapLevel > maxLevel) ) {
+            break;
+        }
+        *level = it->first.mipMapLevel;
+        *bounds = it->second.bounds;
+
+        return true;
+    }
+
+    return false;
+}
+
+bool
+DiskCacheStore::readFrame(const DiskCacheStoreKey& key,
+                          const RectI& roi,
+                          Image* output)
+{
+    assert(output);
+    if ( !output || (output->getBitDepth() != eImageBitDepthFloat) || (output->getStorageMode() == eStorageModeGLTex) ) {
+        return false;
+    }
+
+    DiskCacheFrameRecord record;
+    {
+        QMutexLocker k(&_imp->lock);
+        DiskCacheFrameIndex::iterator found = _imp->frames.find(key);
+        if ( ( found == _imp->frames.end() ) || !found->second.bounds.contains(roi) ) {
+            return false;
+        }
+        _imp->touchFrame_locked(found);
+        record = found->second;
+    }
+
+    if ( ( record.nComps != output->getComponentsCount() ) || !output->getBounds().contains(roi) ) {
+        return false;
+    }
+
+    bool ok = false;
+    try {
+        MemoryFile file(record.filePath, MemoryFile::eFileOpenModeEnumIfExistsKeepElseFail);
+        const unsigned char* data = (const unsigned char*)file.data();
+        const std::size_t fileSize = file.size();
+        DiskCacheFrameHeader header;
+
+        if ( data && (fileSize >= sizeof(header)) ) {
+            std::memcpy( &header, data, sizeof(header) );
+            if ( isHeaderValid(header, fileSize) && (header.inputHash == key.inputHash) && (header.mipMapLevel == key.mipMapLevel) &&
+                 (header.nComps == record.nComps) && (header.codec == (U32)record.codec) ) {
+                const DiskCacheStripEntry* strips = (const DiskCacheStripEntry*)( data + getStripsTableOffset(header) );
+                const RectI frameBounds(header.x1, header.y1, header.x2, header.y2);
+                Image::WriteAccess acc = output->getWriteRights();
+
+                ok = true;
+                for (U32 s = 0; s < header.nStrips && ok; ++s) {
+                    RectI stripRect( frameBounds.x1, frameBounds.y1 + s * header.stripHeight, frameBounds.x2,
+                                     std::min( frameBounds.y2, (int)(frameBounds.y1 + (s + 1) * header.stripHeight) ) );
+                    if ( (stripRect.y2 <= roi.y1) || (stripRect.y1 >= roi.y2) ) {
+                        continue;
+                    }
+                    if ( strips[s].offset + strips[s].size > fileSize ) {
+                        ok = false;
+                        break;
+                    }
+                    ok = _imp->decodeStrip( (DiskCacheStore::CodecEnum)header.codec, data + strips[s].offset, (std::size_t)strips[s].size,
+                                            stripRect, roi, (int)header.nComps, acc );
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        qDebug() << "DiskCacheStore: failed to read" << record.filePath.c_str() << ":" << e.what();
+        ok = false;
+    }
+
+    if (!ok) {
+        // The file is unusable, drop it from the store
+        QMutexLocker k(&_imp->lock);
+        DiskCacheFrameIndex::iterator found = _imp->frames.find(key);
+        if ( ( found != _imp->frames.end() ) && (found->second.filePath == record.filePath) ) {
+            _imp->removeFrame_locked(found);
+        }
+    }
+
+    return ok;
+} // DiskCacheStore::readFrame
+
+bool
+DiskCacheStore::writeFrame(const DiskCacheStoreKey& key,
+                           CodecEnum codec,
+                           const Image& src,
+                           const RectI& bounds)
+{
+    if ( (src.getBitDepth() != eImageBitDepthFloat) || (src.getStorageMode() == eStorageModeGLTex) ) {
+        return false;
+    }
+    RectI frameBounds;
+    if ( !bounds.intersect(src.getBounds(), &frameBounds) ) {
+        return false;
+    }
+
+    const int nComps = (int)src.getComponentsCount();
+    const U32 stripHeight = NATRON_DISKCACHE_STORE_STRIP_HEIGHT;
+    const U32 nStrips = ( (U32)frameBounds.height() + stripHeight - 1 ) / stripHeight;
+
+    // Encode all strips first: their encoded size is needed to lay out the file
+    std::vector<std::vector<unsigned char> > encodedStrips(nStrips);
+    {
+        Image::ReadAccess acc = src.getReadRights();
+        for (U32 s = 0; s < nStrips; ++s) {
+            RectI stripRect( frameBounds.x1, frameBounds.y1 + s * stripHeight, frameBounds.x2,
+                             std::min( frameBounds.y2, (int)(frameBounds.y1 + (s + 1) * stripHeight) ) );
+            _imp->encodeStrip(codec, acc, stripRect, nComps, &encodedStrips[s]);
+        }
+    }
+
+    DiskCacheFrameHeader header;
+    std::memset( &header, 0, sizeof(header) );
+    std::memcpy(header.magic, kDiskCacheFrameMagic, 4);
+    header.version = NATRON_DISKCACHE_STORE_VERSION;
+    header.codec = (U32)codec;
+    header.nComps = (U32)nComps;
+    header.x1 = frameBounds.x1;
+    header.y1 = frameBounds.y1;
+    header.x2 = frameBounds.x2;
+    header.y2 = frameBounds.y2;
+    header.time = key.time;
+    header.view = (int)key.view;
+    header.mipMapLevel = key.mipMapLevel;
+    header.inputHash = key.inputHash;
+    header.stripHeight = stripHeight;
+    header.nStrips = nStrips;
+    header.planeIDLength = (U32)key.planeID.size();
+
+    const std::size_t stripsTableOffset = getStripsTableOffset(header);
+    std::vector<DiskCacheStripEntry> stripsTable(nStrips);
+    std::size_t fileSize = stripsTableOffset + nStrips * sizeof(DiskCacheStripEntry);
+    for (U32 s = 0; s < nStrips; ++s) {
+        stripsTable[s].offset = fileSize;
+        stripsTable[s].size = encodedStrips[s].size();
+        fileSize += encodedStrips[s].size();
+    }
+
+    const std::string framePath = _imp->getFramePath(key);
+    std::string tmpPath;
+    {
+        QMutexLocker k(&_imp->lock);
+        std::stringstream ss;
+        ss << framePath << '.' << ++_imp->tmpFileCounter << ".tmp";
+        tmpPath = ss.str();
+    }
+
+    try {
+        MemoryFile file(tmpPath, fileSize, MemoryFile::eFileOpenModeEnumIfExistsTruncateElseCreate);
+        char* data = file.data();
+        std::memcpy( data, &header, sizeof(header) );
+        if ( !key.planeID.empty() ) {
+            std::memcpy( data + sizeof(header), key.planeID.c_str(), key.planeID.size() );
+        }
+        if (nStrips > 0) {
+            std::memcpy( data + stripsTableOffset, &stripsTable.front(), nStrips * sizeof(DiskCacheStripEntry) );
+        }
+        for (U32 s = 0; s < nStrips; ++s) {
+            if ( !encodedStrips[s].empty() ) {
+                std::memcpy( data + stripsTable[s].offset, &encodedStrips[s].front(), encodedStrips[s].size() );
+            }
+        }
+        // Do not wait for the pages to reach the disk: the page cache is shared with readers of the renamed file
+        file.flush(MemoryFile::eFlushTypeAsync, 0, 0);
+    } catch (const std::exception& e) {
+        qDebug() << "DiskCacheStore: failed to write" << tmpPath.c_str() << ":" << e.what();
+        QFile::remove( QString::fromUtf8( tmpPath.c_str() ) );
+
+        return false;
+    }
+
+    // Publish the frame: the rename is atomic so readers never see a partially written file
+    QMutexLocker k(&_imp->lock);
+    DiskCacheFrameIndex::iterator found = _imp->frames.find(key);
+    if ( found != _imp->frames.end() ) {
+        _imp->removeFrame_locked(found);
+    }
+    QString qFramePath = QString::fromUtf8( framePath.c_str() );
+    QFile::remove(qFramePath);
+    if ( !QFile::rename(QString::fromUtf8( tmpPath.c_str() ), qFramePath) ) {
+        QFile::remove( QString::fromUtf8( tmpPath.c_str() ) );
+
+        return false;
+    }
+
+    DiskCacheFrameRecord record;
+    record.filePath = framePath;
+    record.bounds = frameBounds;
+    record.nComps = (U32)nComps;
+    record.codec = codec;
+    record.sizeOnDisk = fileSize;
+    _imp->insertFrame_locked(key, record);
+
+    _imp->evictExceedingFrames_locked(&key);
+
+    return true;
+} // DiskCacheStore::writeFrame
+
+void
+DiskCacheStore::clear()
+{
+    QMutexLocker k(&_imp->lock);
+
+    while ( !_imp->frames.empty() ) {
+        _imp->removeFrame_locked( _imp->frames.begin() );
+    }
+    _imp->totalSize = 0;
+}
+
+void
+DiskCacheStore::removeStore(const std::string& directoryPath)
+{
+    QDir dir( QString::fromUtf8( directoryPath.c_str() ) );
+
+    if ( !dir.exists() ) {
+        return;
+    }
+    QStringList files = dir.entryList(QStringList() << QString::fromUtf8("*." NATRON_DISKCACHE_STORE_FILE_EXT) << QString::fromUtf8("*.tmp"), QDir::Files);
+    Q_FOREACH(const QString &file, files) {
+        dir.remove(file);
+    }
+    // Only succeeds if nothing else was put in the directory
+    dir.rmdir( dir.absolutePath() );
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,184 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_DISKCACHESTORE_H
+#define NATRON_ENGINE_DISKCACHESTORE_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/RectI.h"
+#include "Engine/ViewIdx.h"
+#include "Engine/EngineFwd.h"
+
+// Name of the directory, relative to the disk cache location, where DiskCache nodes store their frames.
+// It lives next to (and not inside) the directories of the generic caches, so that clearing them leaves it untouched.
+#define NATRON_DISKCACHE_STORE_DIRNAME "DiskCacheNodeStore"
+
+// Extension of a frame file in a DiskCacheStore
+#define NATRON_DISKCACHE_STORE_FILE_EXT "ndcf"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Identifies a frame in a DiskCacheStore. The inputHash is the hash of the node connected to the DiskCache node,
+ * which is saved with the project and thus stable across sessions.
+ **/
+struct DiskCacheStoreKey
+{
+    U64 inputHash;
+    double time;
+    ViewIdx view;
+    unsigned int mipMapLevel;
+    std::string planeID;
+
+    DiskCacheStoreKey()
+        : inputHash(0)
+        , time(0)
+        , view(0)
+        , mipMapLevel(0)
+        , planeID()
+    {
+    }
+
+    bool operator<(const DiskCacheStoreKey& other) const;
+
+    bool operator==(const DiskCacheStoreKey& other) const;
+
+    /**
+     * @brief Returns a hash of all members, used to name the frame file
+     **/
+    U64 getHash() const;
+};
+
+struct DiskCacheStorePrivate;
+
+/**
+ * @brief A persistent on-disk frame store owned by a single DiskCache node.
+ * Each frame is saved in its own file made of a self-describing header, a strip index and the strips of pixels.
+ * Each strip is encoded independently so that a region of interest can be decoded without touching the rest of the frame.
+ * Frames are read through a memory mapping of the file: uncompressed and half-float strips are decoded straight from the
+ * mapped pages into the output image.
+ * The in-memory index is rebuilt from the frame headers when the store is opened, so the store survives restarts and
+ * is not affected by clearing the application caches.
+ * When the total size of the frames exceeds the budget, the least recently used frames are removed, following an index
+ * of the frames ordered by their last access.
+ *
+ * This class is MT-safe.
+ **/
+class DiskCacheStore
+{
+public:
+
+    enum CodecEnum
+    {
+        // 32-bit float, uncompressed
+        eCodecRaw = 0,
+
+        // 32-bit float, byte-shuffled then deflated: lossless
+        eCodecLossless,
+
+        // 16-bit half float, uncompressed: lossy but half the size
+        eCodecHalf
+    };
+
+    /**
+     * @brief Opens the store located in the given directory, creating the directory if needed,
+     * and indexes the frames that it already contains.
+     **/
+    DiskCacheStore(const std::string& directoryPath,
+                   U64 maximumSize);
+
+    ~DiskCacheStore();
+
+    const std::string& getPath() const;
+
+    void setMaximumSize(U64 maximumSize);
+
+    U64 getMaximumSize() const;
+
+    /**
+     * @brief Returns the number of bytes occupied on disk by all frames in the store.
+     **/
+    U64 getSize() const;
+
+    int getNumFrames() const;
+
+    /**
+     * @brief Returns true if the frame identified by the given key was stored and covers the given roi.
+     **/
+    bool hasFrame(const DiskCacheStoreKey& key, const RectI& roi) const;
+
+    /**
+     * @brief Returns true if the frame at the given time/view was stored for any plane at any mipmap level
+     **/
+    bool hasFrameAtAnyLevel(U64 inputHash, double time, ViewIdx view) const;
+
+    /**
+     * @brief Returns the lowest mipmap level, lesser or equal to maxLevel, at which the given frame is stored.
+     * Returns false if the frame is not stored at any of these levels.
+     **/
+    bool getBestLevelForFrame(const DiskCacheStoreKey& key, unsigned int maxLevel, unsigned int* level, RectI* bounds) const;
+
+    /**
+     * @brief Decodes the portion roi of the frame into output. The output image must be a 32-bit float image with the same
+     * number of components as the stored frame and roi must be contained in both the stored frame and the output bounds.
+     * Returns false if the frame is not in the store or could not be read, in which case the output is left untouched
+     * (or partially written if the file was found to be corrupted).
+     **/
+    bool readFrame(const DiskCacheStoreKey& key, const RectI& roi, Image* output);
+
+    /**
+     * @brief Encodes the portion bounds of the 32-bit float image src into the store. Any previous frame with the same key
+     * is replaced. Least recently used frames are then removed until the store fits its budget.
+     **/
+    bool writeFrame(const DiskCacheStoreKey& key, CodecEnum codec, const Image& src, const RectI& bounds);
+
+    /**
+     * @brief Removes all frames of the store from the disk.
+     **/
+    void clear();
+
+    /**
+     * @brief Removes the store located in the given directory and the directory itself. No DiskCacheStore may be opened
+     * on that directory.
+     **/
+    static void removeStore(const std::string& directoryPath);
+
+private:
+
+    boost::scoped_ptr<DiskCacheStorePrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_DISKCACHESTORE_H
@@ -32,6 +32,7 @@
 #include <fstream>
 #include <bitset>
 #include <cassert>
+#include <cmath>
 #include <stdexcept>
 #include <sstream> // stringstream
 
@@ -61,9 +62,11 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/ImageParams.h"
 #include "Engine/KnobFile.h"
 #include "Engine/KnobTypes.h"
+#include "Engine/KnobValuesSnapshot.h"
 #include "Engine/Log.h"
 #include "Engine/MemoryInfo.h" // printAsRAM
 #include "Engine/Node.h"
+#include "Engine/NumaTopology.h"
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/OfxOverlayInteract.h"
 #include "Engine/OfxImageEffectInstance.h"
@@ -1978,6 +1981,46 @@ EffectInstance::tryConcatenateTransforms(double time,
     } // if ((canTransform && getTransformSucceeded) || (canApplyTransform && !inputHoldingTransforms.empty()))
 } // EffectInstance::tryConcatenateTransforms
 
+bool
+EffectInstance::getIntegerTranslation(double time,
+                                      bool draftRender,
+                                      ViewIdx view,
+                                      const RenderScale & scale,
+                                      EffectInstancePtr* inputToTranslate,
+                                      int* translateX,
+                                      int* translateY)
+{
+    if ( !getNode()->getCurrentCanTransform() ) {
+        return false;
+    }
+
+    Transform::Matrix3x3 mat;
+    EffectInstancePtr input;
+    StatusEnum stat = getTransform_public(time, scale, draftRender, view, &input, &mat);
+    if ( (stat != eStatusOK) || !input ) {
+        return false;
+    }
+
+    // The matrix is in pixel coordinates, from the source image to the destination
+    const double eps = 1e-6;
+    if ( (std::fabs(mat.a - 1.) > eps) || (std::fabs(mat.b) > eps) ||
+         (std::fabs(mat.d) > eps) || (std::fabs(mat.e - 1.) > eps) ||
+         (std::fabs(mat.g) > eps) || (std::fabs(mat.h) > eps) || (std::fabs(mat.i - 1.) > eps) ) {
+        return false;
+    }
+    double tx = std::floor(mat.c + 0.5);
+    double ty = std::floor(mat.f + 0.5);
+    if ( (std::fabs(mat.c - tx) > eps) || (std::fabs(mat.f - ty) > eps) ) {
+        return false;
+    }
+
+    *inputToTranslate = input;
+    *translateX = (int)tx;
+    *translateY = (int)ty;
+
+    return true;
+} // EffectInstance::getIntegerTranslation
+
 bool
 EffectInstance::allocateImagePlane(const ImageKey & key,
                                    const RectD & rod,
@@ -2146,6 +2189,8 @@ EffectInstance::Implementation::tiledRenderingFunctor(EffectInstance::Implementa
                                                       const RectToRender & specificData,
                                                       QThread* callingThread)
 {
+    NumaTopology::bindCurrentThread();
+
     ///Make the thread-storage live as long as the render action is called if we're in a newly launched thread in eRenderSafetyFullySafeFrame mode
     QThread* curThread = QThread::currentThread();
 
@@ -2156,6 +2201,9 @@ EffectInstance::Implementation::tiledRenderingFunctor(EffectInstance::Implementa
         appPTR->getAppTLS()->copyTLS(callingThread, curThread);
     }
 
+    // The snapshot of the parameters is not part of the TLS copied above: read the same values as the calling thread
+    bool knobsSnapshotPushed = callingThread != curThread && KnobValuesSnapshot::pushCurrentSnapshot(args.knobsSnapshot);
+
 
     EffectInstance::RenderingFunctorRetEnum ret = tiledRenderingFunctor(specificData,
                                                                         args.renderFullScaleThenDownscale,
@@ -2177,12 +2225,95 @@ EffectInstance::Implementation::tiledRenderingFunctor(EffectInstance::Implementa
                                                                         args.processChannels,
                                                                         args.planes);
 
+    if (knobsSnapshotPushed) {
+        KnobValuesSnapshot::popCurrentSnapshot();
+    }
+
     //Exit of the host frame threading thread
     appPTR->getAppTLS()->cleanupTLSForThread();
 
     return ret;
 }
 
+NumaTileQueue::NumaTileQueue(const std::list<EffectInstance::RectToRender>& rects,
+                             int nNodes)
+    : _lock()
+    , _nodesRects( std::max(1, nNodes) )
+{
+    // Rectangles are sorted by rows: give each node a contiguous band of the image
+    std::size_t nRects = rects.size();
+    std::size_t i = 0;
+
+    for (std::list<EffectInstance::RectToRender>::const_iterator it = rects.begin(); it != rects.end(); ++it, ++i) {
+        _nodesRects[i * _nodesRects.size() / nRects].push_back(*it);
+    }
+}
+
+bool
+NumaTileQueue::pop(int node,
+                   EffectInstance::RectToRender* rect)
+{
+    QMutexLocker k(&_lock);
+
+    if ( (node < 0) || ( node >= (int)_nodesRects.size() ) ) {
+        node = 0;
+    }
+    if ( !_nodesRects[node].empty() ) {
+        *rect = _nodesRects[node].front();
+        _nodesRects[node].pop_front();
+
+        return true;
+    }
+    // Nothing left on our node: help the node that has the most work left, starting from the end of its band
+    // so that we do not compete with its own threads for the same area of the image.
+    std::size_t busiest = 0;
+    for (std::size_t i = 1; i < _nodesRects.size(); ++i) {
+        if ( _nodesRects[i].size() > _nodesRects[busiest].size() ) {
+            busiest = i;
+        }
+    }
+    if ( _nodesRects[busiest].empty() ) {
+        return false;
+    }
+    *rect = _nodesRects[busiest].back();
+    _nodesRects[busiest].pop_back();
+
+    return true;
+}
+
+void
+NumaTileQueue::clear()
+{
+    QMutexLocker k(&_lock);
+
+    for (std::size_t i = 0; i < _nodesRects.size(); ++i) {
+        _nodesRects[i].clear();
+    }
+}
+
+EffectInstance::RenderingFunctorRetEnum
+EffectInstance::Implementation::numaTiledRenderingFunctor(EffectInstance::Implementation::TiledRenderingFunctorArgs & args,
+                                                          NumaTileQueue* queue,
+                                                          int /*workerIndex*/,
+                                                          QThread* callingThread)
+{
+    NumaTopology::bindCurrentThread();
+    int node = NumaTopology::getCurrentNode();
+    RectToRender rect;
+
+    while ( queue->pop(node, &rect) ) {
+        EffectInstance::RenderingFunctorRetEnum ret = tiledRenderingFunctor(args, rect, callingThread);
+        if (ret != eRenderingFunctorRetOK) {
+            // Other workers stop as soon as they are done with their current rectangle
+            queue->clear();
+
+            return ret;
+        }
+    }
+
+    return eRenderingFunctorRetOK;
+}
+
 EffectInstance::RenderingFunctorRetEnum
 EffectInstance::Implementation::tiledRenderingFunctor(const RectToRender & rectToRender,
                                                       const bool renderFullScaleThenDownscale,
@@ -2398,13 +2529,10 @@ EffectInstance::Implementation::renderHandler(const EffectTLSDataPtr& tls,
                                               const ImagePremultiplicationEnum originalImagePremultiplication,
                                               ImagePlanesToRender & planes)
 {
-    TimeLapsePtr timeRecorder;
+    // The render time is also used by the cache to evict first the images that are the cheapest to render again
+    TimeLapsePtr timeRecorder = boost::make_shared<TimeLapse>();
     const ParallelRenderArgsPtr& frameArgs = tls->frameArgs.back();
 
-    if (frameArgs->stats) {
-        timeRecorder = boost::make_shared<TimeLapse>();
-    }
-
     const EffectInstance::PlaneToRender & firstPlane = planes.planes.begin()->second;
     const double time = tls->currentRenderArgs.time;
     const ViewIdx view = tls->currentRenderArgs.view;
@@ -2908,8 +3036,22 @@ EffectInstance::Implementation::renderHandler(const EffectTLSDataPtr& tls,
             } // if (renderFullScaleThenDownscale) {
         } // if (it->second.isAllocatedOnTheFly) {
 
+        double renderTime = timeRecorder->getTimeSinceCreation();
+        it->second.fullscaleImage->addRenderCost(renderTime);
+        if (it->second.downscaleImage != it->second.fullscaleImage) {
+            it->second.downscaleImage->addRenderCost(renderTime);
+        }
         if ( frameArgs->stats && frameArgs->stats->isInDepthProfilingEnabled() ) {
-            frameArgs->stats->addRenderInfosForNode( _publicInterface->getNode(),  NodePtr(), it->first.getChannelsLabel(), renderMappedRectToRender, timeRecorder->getTimeSinceCreation() );
+            frameArgs->stats->addRenderInfosForNode( _publicInterface->getNode(),  NodePtr(), it->first.getChannelsLabel(), renderMappedRectToRender, renderTime );
+        }
+        if ( frameArgs->stats && NumaTopology::isEnabled() ) {
+            // Count the bytes written by this thread against the nodes actually holding the pages of the rectangle
+            NumaPlacementMap placement;
+            it->second.renderMappedImage->getNumaPlacement(renderMappedRectToRender, &placement);
+            const int threadNode = NumaTopology::getCurrentNode();
+            for (NumaPlacementMap::const_iterator it2 = placement.begin(); it2 != placement.end(); ++it2) {
+                frameArgs->stats->addNumaTraffic(threadNode, it2->first, it2->second);
+            }
         }
     } // for (std::map<ImagePlaneDesc,PlaneToRender>::const_iterator it = outputPlanes.begin(); it != outputPlanes.end(); ++it) {
 
@@ -5285,6 +5427,69 @@ EffectInstance::isFrameVaryingOrAnimated_Recursive() const
     return ret;
 }
 
+bool
+EffectInstance::isTimeInvariantForRequestPass(U64 hash)
+{
+    bool ret;
+
+    if ( _imp->actionsCache->getTimeInvarianceResult(hash, &ret) ) {
+        return ret;
+    }
+
+    ret = !isFrameVarying() && !getHasAnimation() && !getNode()->getRotoContext();
+    if (ret) {
+        // Expressions and links may depend on the time or on nodes outside of this tree
+        const KnobsVec & knobs = getKnobs();
+        for (KnobsVec::const_iterator it = knobs.begin(); ret && it != knobs.end(); ++it) {
+            int nDims = (*it)->getDimension();
+            for (int i = 0; i < nDims; ++i) {
+                if ( !(*it)->getExpression(i).empty() || (*it)->getMaster(i).second ) {
+                    ret = false;
+                    break;
+                }
+            }
+        }
+    }
+    if (ret) {
+        int maxInputs = getNInputs();
+        for (int i = 0; i < maxInputs; ++i) {
+            EffectInstancePtr input = getInput(i);
+            if ( input && !input->isTimeInvariantForRequestPass( input->getRenderHash() ) ) {
+                ret = false;
+                break;
+            }
+        }
+    }
+
+    _imp->actionsCache->setTimeInvarianceResult(hash, ret);
+
+    return ret;
+}
+
+bool
+EffectInstance::getRenderPlanResults(U64 hash,
+                                     ViewIdx view,
+                                     unsigned int mipMapLevel,
+                                     bool useTransforms,
+                                     RenderPlanResults* results) const
+{
+    return _imp->actionsCache->getRenderPlanResults(hash, view, mipMapLevel, useTransforms, results);
+}
+
+void
+EffectInstance::setRenderPlanResults(U64 hash,
+                                     const RenderPlanResults& results) const
+{
+    _imp->actionsCache->setRenderPlanResults(hash, results);
+}
+
+void
+EffectInstance::getActionsCacheAccessCounts(unsigned int* hits,
+                                            unsigned int* misses) const
+{
+    _imp->actionsCache->getAccessCounts(hits, misses);
+}
+
 bool
 EffectInstance::isPaintingOverItselfEnabled() const
 {
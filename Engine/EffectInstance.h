@@ -818,6 +818,26 @@ public:
      **/
     bool isFrameVaryingOrAnimated_Recursive() const;
 
+    /**
+     * @brief Returns whether the results of the request pass for this node (identity, RoD, frames needed, RoIs)
+     * are the same at any time: the node and the tree upstream are neither frame varying nor animated, and no parameter
+     * is driven by an expression or a link. The result is cached in the actions cache for the given hash.
+     **/
+    bool isTimeInvariantForRequestPass(U64 hash);
+
+    /**
+     * @brief Get/set the results of a previous request pass for this node, see RenderPlanResults.
+     **/
+    bool getRenderPlanResults(U64 hash, ViewIdx view, unsigned int mipMapLevel, bool useTransforms, RenderPlanResults* results) const;
+
+    void setRenderPlanResults(U64 hash, const RenderPlanResults& results) const;
+
+    /**
+     * @brief Returns the number of lookups in the actions cache of this node that found a result and that did not.
+     * The counters wrap around: only differences between two calls are meaningful.
+     **/
+    void getActionsCacheAccessCounts(unsigned int* hits, unsigned int* misses) const;
+
     /**
      * @brief Returns the preferred output frame rate to render with
      **/
@@ -1718,6 +1738,12 @@ public:
     virtual void onEffectCreated(bool /*mayCreateFileDialog*/,
                                  const CreateNodeArgs& /*args*/) {}
 
+    /**
+     * @brief Called when the node is destroyed, after renders were stopped and before the effect is released.
+     * The project may be closing.
+     **/
+    virtual void onEffectAboutToBeDestroyed() {}
+
     virtual void onKnobSlaved(const KnobIPtr& slave, const KnobIPtr& master,
                               int dimension,
                               bool isSlave) OVERRIDE FINAL;
@@ -1839,6 +1865,19 @@ public:
                                   const RenderScale & scale,
                                   InputMatrixMap* inputTransforms);
 
+    /**
+     * @brief Returns true if this effect only translates one of its inputs by a whole number of pixels at the given scale,
+     * in which case its output can be a view on the image of that input (see Image::makeTranslatedView()).
+     * @param translateX, translateY The translation, in pixel coordinates at the given scale
+     **/
+    bool getIntegerTranslation(double time,
+                               bool draftRender,
+                               ViewIdx view,
+                               const RenderScale & scale,
+                               EffectInstancePtr* inputToTranslate,
+                               int* translateX,
+                               int* translateY);
+
 
     static void transformInputRois(const EffectInstance* self,
                                    const InputMatrixMapPtr& inputTransforms,
@@ -25,10 +25,14 @@
 
 #include "EffectInstancePrivate.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring> // memcpy
 #include <stdexcept>
 #include <sstream> // stringstream
 
+#include <QtCore/QThread>
+
 #include "Engine/AppInstance.h"
 #include "Engine/Node.h"
 #include "Engine/NodeGroup.h"
@@ -37,68 +41,371 @@
 
 NATRON_NAMESPACE_ENTER
 
-ActionsCache::ActionsCacheInstance::ActionsCacheInstance()
-    : _hash(0)
-    , _timeDomain()
-    , _timeDomainSet(false)
-    , _identityCache()
-    , _rodCache()
-    , _framesNeededCache()
+// Capacity of the table of a new ActionsCache. Tables are at most half full.
+#define NATRON_ACTIONS_CACHE_MIN_CAPACITY 64
+
+// Number of slots in which readers announce themselves. A thread always uses the same slot: more slots means
+// less contention between render threads on the counters.
+#define NATRON_ACTIONS_CACHE_N_READER_SLOTS 16
+
+// Number of replaced results kept until the writer waits for the readers to delete them
+#define NATRON_ACTIONS_CACHE_MAX_RETIRED_ENTRIES 64
+
+// Size of a cache line: reader slots are padded so that threads do not share their counters' cache lines
+#define NATRON_ACTIONS_CACHE_LINE_SIZE 64
+
+struct ActionsCacheEntry
+{
+    ActionsCacheKey key;
+
+    ActionsCacheEntry(const ActionsCacheKey& key)
+        : key(key)
+    {
+    }
+
+    virtual ~ActionsCacheEntry()
+    {
+    }
+};
+
+template <typename T>
+struct ActionsCacheValueEntry
+    : public ActionsCacheEntry
+{
+    T value;
+
+    ActionsCacheValueEntry(const ActionsCacheKey& key,
+                           const T& value)
+        : ActionsCacheEntry(key)
+        , value(value)
+    {
+    }
+
+    virtual ~ActionsCacheValueEntry()
+    {
+    }
+};
+
+struct ActionsCacheTable
 {
+    // A power of 2
+    std::size_t capacity;
+
+    // Number of non-null slots. Only accessed by the writer.
+    std::size_t count;
+
+    // Once set, a slot never goes back to NULL: it may only be replaced by an entry with the same key, so that
+    // probing stops at the first NULL slot.
+    QAtomicPointer<ActionsCacheEntry>* slots;
+
+    ActionsCacheTable(std::size_t capacity)
+        : capacity(capacity)
+        , count(0)
+        , slots(new QAtomicPointer<ActionsCacheEntry>[capacity])
+    {
+    }
+
+    ~ActionsCacheTable()
+    {
+        delete [] slots;
+    }
+};
+
+struct ActionsCacheReaderSlot
+{
+    // Readers currently in a critical section, for each parity of the epoch
+    QAtomicInt readers[2];
+    QAtomicInt hits;
+    QAtomicInt misses;
+    char padding[NATRON_ACTIONS_CACHE_LINE_SIZE];
+};
+
+namespace {
+std::size_t
+hashActionsCacheKey(const ActionsCacheKey& key)
+{
+    U64 timeBits;
+    // 0. and -0. are equal keys: they must have the same hash
+    double time = key.time == 0. ? 0. : key.time;
+
+    std::memcpy( &timeBits, &time, sizeof(timeBits) );
+
+    // splitmix64 finalizer on a combination of all fields
+    U64 h = key.hash ^ (timeBits * 0x9e3779b97f4a7c15ULL);
+    h ^= ( (U64)(unsigned int)key.view << 32 ) ^ ( (U64)key.mipMapLevel << 8 ) ^ ( (U64)key.type << 1 ) ^ (U64)key.useTransforms;
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+
+    return (std::size_t)h;
 }
 
-std::list<ActionsCache::ActionsCacheInstance>::iterator
-ActionsCache::createActionCacheInternal(U64 newHash)
+// Returns the slot holding the key, or the NULL slot where it should be inserted
+QAtomicPointer<ActionsCacheEntry>*
+findSlot(const ActionsCacheTable* table,
+         const ActionsCacheKey& key)
 {
-    if (_instances.size() >= _maxInstances) {
-        _instances.pop_front();
+    std::size_t mask = table->capacity - 1;
+    std::size_t i = hashActionsCacheKey(key) & mask;
+
+    for (;; ) {
+        QAtomicPointer<ActionsCacheEntry>* slot = &table->slots[i];
+        ActionsCacheEntry* entry = *slot;
+        if ( !entry || (entry->key == key) ) {
+            return slot;
+        }
+        i = (i + 1) & mask;
     }
-    ActionsCacheInstance cache;
-    cache._hash = newHash;
+}
+} // anon
 
-    return _instances.insert(_instances.end(), cache);
+ActionsCache::ActionsCache(int maxAvailableHashes)
+    : _table( new ActionsCacheTable(NATRON_ACTIONS_CACHE_MIN_CAPACITY) )
+    , _epoch(0)
+    , _readerSlots(new ActionsCacheReaderSlot[NATRON_ACTIONS_CACHE_N_READER_SLOTS])
+    , _epochMutex()
+    , _writeMutex()
+    , _hashes()
+    , _maxHashes( (std::size_t)std::max(1, maxAvailableHashes) )
+    , _retiredEntries()
+    , _retiredTables()
+{
 }
 
-ActionsCache::ActionsCacheInstance &
-ActionsCache::getOrCreateActionCache(U64 newHash)
+ActionsCache::~ActionsCache()
 {
-    std::list<ActionsCacheInstance>::iterator found = _instances.end();
+    // No reader may be left at this point
+    reclaimRetired();
+    ActionsCacheTable* table = _table;
+    for (std::size_t i = 0; i < table->capacity; ++i) {
+        delete (ActionsCacheEntry*)table->slots[i];
+    }
+    delete table;
+    delete [] _readerSlots;
+}
 
-    for (std::list<ActionsCacheInstance>::iterator it = _instances.begin(); it != _instances.end(); ++it) {
-        if (it->_hash == newHash) {
-            found = it;
+ActionsCacheReaderSlot&
+ActionsCache::getReaderSlot() const
+{
+    std::size_t id = (std::size_t)QThread::currentThreadId();
+
+    // Thread ids are usually aligned addresses: mix the higher bits in
+    id ^= id >> 7;
+    id ^= id >> 13;
+
+    return _readerSlots[id & (NATRON_ACTIONS_CACHE_N_READER_SLOTS - 1)];
+}
+
+template <typename T>
+bool
+ActionsCache::getResult(const ActionsCacheKey& key,
+                        T* value)
+{
+    ActionsCacheReaderSlot& slot = getReaderSlot();
+    int parity;
+
+    // Register in the counter of the current parity of the epoch. If the epoch changed in between, a writer may have
+    // checked this counter before we registered: register again with the new parity.
+    // The table must be read after registering: a writer that did not see us has published its new table already
+    for (;; ) {
+        parity = (int)_epoch & 1;
+        slot.readers[parity].fetchAndAddOrdered(1);
+        if ( ( (int)_epoch & 1 ) == parity ) {
             break;
         }
+        slot.readers[parity].fetchAndAddOrdered(-1);
     }
-    if ( found == _instances.end() ) {
-        found = createActionCacheInternal(newHash);
+
+    ActionsCacheTable* table = _table;
+    ActionsCacheEntry* entry = *findSlot(table, key);
+    if (entry) {
+        *value = static_cast<ActionsCacheValueEntry<T>*>(entry)->value;
     }
-    assert( found != _instances.end() );
 
-    return *found;
+    slot.readers[parity].fetchAndAddOrdered(-1);
+
+    if (entry) {
+        slot.hits.fetchAndAddRelaxed(1);
+    } else {
+        slot.misses.fetchAndAddRelaxed(1);
+    }
+
+    return entry != 0;
 }
 
-ActionsCache::ActionsCache(int maxAvailableHashes)
-    : _cacheMutex()
-    , _instances()
-    , _maxInstances( (std::size_t)maxAvailableHashes )
+template <typename T>
+void
+ActionsCache::setResult(const ActionsCacheKey& key,
+                        const T& value)
 {
+    ActionsCacheEntry* newEntry = new ActionsCacheValueEntry<T>(key, value);
+    QMutexLocker l(&_writeMutex);
+
+    touchHash(key.hash);
+
+    ActionsCacheTable* table = _table;
+    if ( (table->count + 1) * 2 > table->capacity ) {
+        rebuildTable(table->capacity * 2);
+        table = _table;
+    }
+
+    QAtomicPointer<ActionsCacheEntry>* slot = findSlot(table, key);
+    ActionsCacheEntry* oldEntry = slot->fetchAndStoreOrdered(newEntry);
+    if (oldEntry) {
+        _retiredEntries.push_back(oldEntry);
+    } else {
+        ++table->count;
+    }
+    reclaimRetiredIfNeeded(&l);
+}
+
+void
+ActionsCache::touchHash(U64 hash)
+{
+    assert( !_writeMutex.tryLock() );
+    if ( !_hashes.empty() && (_hashes.back() == hash) ) {
+        return;
+    }
+    std::list<U64>::iterator found = std::find(_hashes.begin(), _hashes.end(), hash);
+    if ( found != _hashes.end() ) {
+        return;
+    }
+    _hashes.push_back(hash);
+    if (_hashes.size() > _maxHashes) {
+        _hashes.pop_front();
+        // Drop the results of the hashes no longer kept
+        rebuildTable( ( (ActionsCacheTable*)_table )->capacity );
+    }
+}
+
+void
+ActionsCache::rebuildTable(std::size_t capacity)
+{
+    assert( !_writeMutex.tryLock() );
+
+    ActionsCacheTable* oldTable = _table;
+    std::list<ActionsCacheEntry*> kept;
+    for (std::size_t i = 0; i < oldTable->capacity; ++i) {
+        ActionsCacheEntry* entry = oldTable->slots[i];
+        if (!entry) {
+            continue;
+        }
+        if ( std::find(_hashes.begin(), _hashes.end(), entry->key.hash) != _hashes.end() ) {
+            kept.push_back(entry);
+        } else {
+            _retiredEntries.push_back(entry);
+        }
+    }
+    while ( (kept.size() + 1) * 2 > capacity ) {
+        capacity *= 2;
+    }
+    // Shrink back when most results were dropped
+    while ( (capacity > NATRON_ACTIONS_CACHE_MIN_CAPACITY) && ( (kept.size() + 1) * 8 < capacity ) ) {
+        capacity /= 2;
+    }
+
+    ActionsCacheTable* newTable = new ActionsCacheTable(capacity);
+    for (std::list<ActionsCacheEntry*>::iterator it = kept.begin(); it != kept.end(); ++it) {
+        findSlot(newTable, (*it)->key)->fetchAndStoreRelaxed(*it);
+    }
+    newTable->count = kept.size();
+
+    _table.fetchAndStoreOrdered(newTable);
+    _retiredTables.push_back(oldTable);
+}
+
+void
+ActionsCache::reclaimRetiredIfNeeded(QMutexLocker* writeLocker)
+{
+    assert( !_writeMutex.tryLock() );
+    if ( _retiredTables.empty() && (_retiredEntries.size() < NATRON_ACTIONS_CACHE_MAX_RETIRED_ENTRIES) ) {
+        return;
+    }
+
+    // Everything retired so far is already unreachable from the published table
+    std::list<ActionsCacheEntry*> entries;
+    std::list<ActionsCacheTable*> tables;
+    entries.swap(_retiredEntries);
+    tables.swap(_retiredTables);
+
+    // Do not block the other writers while waiting for the readers
+    writeLocker->unlock();
+    synchronizeReaders();
+
+    for (std::list<ActionsCacheEntry*>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        delete *it;
+    }
+    for (std::list<ActionsCacheTable*>::iterator it = tables.begin(); it != tables.end(); ++it) {
+        delete *it;
+    }
+}
+
+void
+ActionsCache::synchronizeReaders()
+{
+    // Only one thread at a time flips the epoch and waits, so that a flip is never done while readers of the other
+    // parity are still waited for.
+    QMutexLocker l(&_epochMutex);
+
+    // Readers arriving from now on register with the other parity and can only see what is currently published.
+    // Wait for those that registered before to leave, after which nothing retired so far can be reached.
+    int parity = _epoch.fetchAndAddOrdered(1) & 1;
+    for (;; ) {
+        int readers = 0;
+        for (int i = 0; i < NATRON_ACTIONS_CACHE_N_READER_SLOTS; ++i) {
+            readers += (int)_readerSlots[i].readers[parity];
+        }
+        if (readers == 0) {
+            break;
+        }
+        QThread::yieldCurrentThread();
+    }
+}
+
+void
+ActionsCache::reclaimRetired()
+{
+    for (std::list<ActionsCacheEntry*>::iterator it = _retiredEntries.begin(); it != _retiredEntries.end(); ++it) {
+        delete *it;
+    }
+    _retiredEntries.clear();
+    for (std::list<ActionsCacheTable*>::iterator it = _retiredTables.begin(); it != _retiredTables.end(); ++it) {
+        delete *it;
+    }
+    _retiredTables.clear();
 }
 
 void
 ActionsCache::clearAll()
 {
-    QMutexLocker l(&_cacheMutex);
+    QMutexLocker l(&_writeMutex);
 
-    _instances.clear();
+    _hashes.clear();
+    rebuildTable(NATRON_ACTIONS_CACHE_MIN_CAPACITY);
+    reclaimRetiredIfNeeded(&l);
 }
 
 void
 ActionsCache::invalidateAll(U64 newHash)
 {
-    QMutexLocker l(&_cacheMutex);
+    QMutexLocker l(&_writeMutex);
+
+    touchHash(newHash);
+    reclaimRetiredIfNeeded(&l);
+}
 
-    createActionCacheInternal(newHash);
+void
+ActionsCache::getAccessCounts(unsigned int* hits,
+                              unsigned int* misses) const
+{
+    *hits = 0;
+    *misses = 0;
+    for (int i = 0; i < NATRON_ACTIONS_CACHE_N_READER_SLOTS; ++i) {
+        *hits += (unsigned int)(int)_readerSlots[i].hits;
+        *misses += (unsigned int)(int)_readerSlots[i].misses;
+    }
 }
 
 bool
@@ -109,29 +416,16 @@ ActionsCache::getIdentityResult(U64 hash,
                                 ViewIdx *inputView,
                                 double* identityTime)
 {
-    QMutexLocker l(&_cacheMutex);
+    IdentityResults results;
 
-    for (std::list<ActionsCacheInstance>::iterator it = _instances.begin(); it != _instances.end(); ++it) {
-        if (it->_hash == hash) {
-            ActionKey key;
-            key.time = time;
-            key.view = view;
-            key.mipMapLevel = 0;
-
-            IdentityCacheMap::const_iterator found = it->_identityCache.find(key);
-            if ( found != it->_identityCache.end() ) {
-                *inputNbIdentity = found->second.inputIdentityNb;
-                *identityTime = found->second.inputIdentityTime;
-                *inputView = found->second.inputView;
-
-                return true;
-            }
-
-            return false;
-        }
+    if ( !getResult( ActionsCacheKey(eActionsCacheResultTypeIdentity, hash, time, view), &results ) ) {
+        return false;
     }
+    *inputNbIdentity = results.inputIdentityNb;
+    *identityTime = results.inputIdentityTime;
+    *inputView = results.inputView;
 
-    return false;
+    return true;
 }
 
 void
@@ -142,50 +436,32 @@ ActionsCache::setIdentityResult(U64 hash,
                                 ViewIdx inputView,
                                 double identityTime)
 {
-    QMutexLocker l(&_cacheMutex);
-    ActionsCacheInstance & cache = getOrCreateActionCache(hash);
-    ActionKey key;
-
-    key.time = time;
-    key.view = view;
-    key.mipMapLevel = 0;
+    IdentityResults v;
 
-    IdentityResults & v = cache._identityCache[key];
     v.inputIdentityNb = inputNbIdentity;
     v.inputIdentityTime = identityTime;
     v.inputView = inputView;
+    setResult(ActionsCacheKey(eActionsCacheResultTypeIdentity, hash, time, view), v);
 }
 
 bool
 ActionsCache::getComponentsNeededResults(U64 hash, double time, ViewIdx view, EffectInstance::ComponentsNeededMap* neededComps, std::bitset<4> *processChannels, bool *processAll,
                                          std::list<ImagePlaneDesc> *passThroughPlanes, int* passThroughInputNb, ViewIdx *passThroughView, double* passThroughTime)
 {
-    QMutexLocker l(&_cacheMutex);
-
-    for (std::list<ActionsCacheInstance>::iterator it = _instances.begin(); it != _instances.end(); ++it) {
-        if (it->_hash == hash) {
-            ActionKey key;
-            key.time = time;
-            key.view = view;
-            key.mipMapLevel = 0;
-
-            ComponentsNeededCacheMap::const_iterator found = it->_componentsNeededCache.find(key);
-            if ( found != it->_componentsNeededCache.end() ) {
-                *passThroughInputNb = found->second.passThroughInputNb;
-                *passThroughTime = found->second.passThroughTime;
-                *passThroughView = found->second.passThroughView;
-                *neededComps = found->second.neededComps;
-                *processChannels = found->second.processChannels;
-                *processAll = found->second.processAll;
-                *passThroughPlanes = found->second.passThroughPlanes;
-                return true;
-            }
+    ComponentsNeededResults results;
 
-            return false;
-        }
+    if ( !getResult( ActionsCacheKey(eActionsCacheResultTypeComponentsNeeded, hash, time, view), &results ) ) {
+        return false;
     }
-    
-    return false;
+    *passThroughInputNb = results.passThroughInputNb;
+    *passThroughTime = results.passThroughTime;
+    *passThroughView = results.passThroughView;
+    *neededComps = results.neededComps;
+    *processChannels = results.processChannels;
+    *processAll = results.processAll;
+    *passThroughPlanes = results.passThroughPlanes;
+
+    return true;
 }
 
 void
@@ -194,15 +470,8 @@ ActionsCache::setComponentsNeededResults(U64 hash, double time, ViewIdx view, co
                                          bool processAll,
                                          const std::list<ImagePlaneDesc>& passThroughPlanes, int passThroughInputNb, ViewIdx passThroughView, double passThroughTime)
 {
-    QMutexLocker l(&_cacheMutex);
-    ActionsCacheInstance & cache = getOrCreateActionCache(hash);
-    ActionKey key;
-
-    key.time = time;
-    key.view = view;
-    key.mipMapLevel = 0;
+    ComponentsNeededResults v;
 
-    ComponentsNeededResults & v = cache._componentsNeededCache[key];
     v.neededComps = neededComps;
     v.passThroughTime = passThroughTime;
     v.passThroughView = passThroughView;
@@ -210,7 +479,7 @@ ActionsCache::setComponentsNeededResults(U64 hash, double time, ViewIdx view, co
     v.processChannels = processChannels;
     v.processAll = processAll;
     v.passThroughPlanes = passThroughPlanes;
-
+    setResult(ActionsCacheKey(eActionsCacheResultTypeComponentsNeeded, hash, time, view), v);
 }
 
 bool
@@ -220,27 +489,7 @@ ActionsCache::getRoDResult(U64 hash,
                            unsigned int mipMapLevel,
                            RectD* rod)
 {
-    QMutexLocker l(&_cacheMutex);
-
-    for (std::list<ActionsCacheInstance>::iterator it = _instances.begin(); it != _instances.end(); ++it) {
-        if (it->_hash == hash) {
-            ActionKey key;
-            key.time = time;
-            key.view = view;
-            key.mipMapLevel = mipMapLevel;
-
-            RoDCacheMap::const_iterator found = it->_rodCache.find(key);
-            if ( found != it->_rodCache.end() ) {
-                *rod = found->second;
-
-                return true;
-            }
-
-            return false;
-        }
-    }
-
-    return false;
+    return getResult(ActionsCacheKey(eActionsCacheResultTypeRoD, hash, time, view, mipMapLevel), rod);
 }
 
 void
@@ -250,15 +499,7 @@ ActionsCache::setRoDResult(U64 hash,
                            unsigned int mipMapLevel,
                            const RectD & rod)
 {
-    QMutexLocker l(&_cacheMutex);
-    ActionsCacheInstance & cache = getOrCreateActionCache(hash);
-    ActionKey key;
-
-    key.time = time;
-    key.view = view;
-    key.mipMapLevel = mipMapLevel;
-
-    cache._rodCache[key] = rod;
+    setResult(ActionsCacheKey(eActionsCacheResultTypeRoD, hash, time, view, mipMapLevel), rod);
 }
 
 bool
@@ -268,27 +509,7 @@ ActionsCache::getFramesNeededResult(U64 hash,
                                     unsigned int mipMapLevel,
                                     FramesNeededMap* framesNeeded)
 {
-    QMutexLocker l(&_cacheMutex);
-
-    for (std::list<ActionsCacheInstance>::iterator it = _instances.begin(); it != _instances.end(); ++it) {
-        if (it->_hash == hash) {
-            ActionKey key;
-            key.time = time;
-            key.view = view;
-            key.mipMapLevel = mipMapLevel;
-
-            FramesNeededCacheMap::const_iterator found = it->_framesNeededCache.find(key);
-            if ( found != it->_framesNeededCache.end() ) {
-                *framesNeeded = found->second;
-
-                return true;
-            }
-
-            return false;
-        }
-    }
-
-    return false;
+    return getResult(ActionsCacheKey(eActionsCacheResultTypeFramesNeeded, hash, time, view, mipMapLevel), framesNeeded);
 }
 
 void
@@ -298,15 +519,7 @@ ActionsCache::setFramesNeededResult(U64 hash,
                                     unsigned int mipMapLevel,
                                     const FramesNeededMap & framesNeeded)
 {
-    QMutexLocker l(&_cacheMutex);
-    ActionsCacheInstance & cache = getOrCreateActionCache(hash);
-    ActionKey key;
-
-    key.time = time;
-    key.view = view;
-    key.mipMapLevel = mipMapLevel;
-
-    cache._framesNeededCache[key] = framesNeeded;
+    setResult(ActionsCacheKey(eActionsCacheResultTypeFramesNeeded, hash, time, view, mipMapLevel), framesNeeded);
 }
 
 bool
@@ -314,18 +527,15 @@ ActionsCache::getTimeDomainResult(U64 hash,
                                   double *first,
                                   double* last)
 {
-    QMutexLocker l(&_cacheMutex);
+    OfxRangeD range;
 
-    for (std::list<ActionsCacheInstance>::iterator it = _instances.begin(); it != _instances.end(); ++it) {
-        if ( (it->_hash == hash) && it->_timeDomainSet ) {
-            *first = it->_timeDomain.min;
-            *last = it->_timeDomain.max;
-
-            return true;
-        }
+    if ( !getResult(ActionsCacheKey(eActionsCacheResultTypeTimeDomain, hash), &range) ) {
+        return false;
     }
+    *first = range.min;
+    *last = range.max;
 
-    return false;
+    return true;
 }
 
 void
@@ -333,12 +543,42 @@ ActionsCache::setTimeDomainResult(U64 hash,
                                   double first,
                                   double last)
 {
-    QMutexLocker l(&_cacheMutex);
-    ActionsCacheInstance & cache = getOrCreateActionCache(hash);
+    OfxRangeD range;
 
-    cache._timeDomainSet = true;
-    cache._timeDomain.min = first;
-    cache._timeDomain.max = last;
+    range.min = first;
+    range.max = last;
+    setResult(ActionsCacheKey(eActionsCacheResultTypeTimeDomain, hash), range);
+}
+
+bool
+ActionsCache::getRenderPlanResults(U64 hash,
+                                   ViewIdx view,
+                                   unsigned int mipMapLevel,
+                                   bool useTransforms,
+                                   RenderPlanResults* results)
+{
+    return getResult(ActionsCacheKey(eActionsCacheResultTypeRenderPlan, hash, 0., view, mipMapLevel, useTransforms), results);
+}
+
+void
+ActionsCache::setRenderPlanResults(U64 hash,
+                                   const RenderPlanResults& results)
+{
+    setResult(ActionsCacheKey(eActionsCacheResultTypeRenderPlan, hash, 0., results.view, results.mipMapLevel, results.useTransforms), results);
+}
+
+bool
+ActionsCache::getTimeInvarianceResult(U64 hash,
+                                      bool* timeInvariant)
+{
+    return getResult(ActionsCacheKey(eActionsCacheResultTypeTimeInvariance, hash), timeInvariant);
+}
+
+void
+ActionsCache::setTimeInvarianceResult(U64 hash,
+                                      bool timeInvariant)
+{
+    setResult(ActionsCacheKey(eActionsCacheResultTypeTimeInvariance, hash), timeInvariant);
 }
 
 EffectInstance::RenderArgs::RenderArgs()
@@ -570,42 +810,137 @@ EffectInstance::Implementation::setDuringInteractAction(bool b)
 }
 
 #if NATRON_ENABLE_TRIMAP
-void
+/**
+ * @brief Appends to out the portions of rect that are outside of hole (at most 4 rectangles).
+ **/
+static void
+subtractRect(const RectI& rect,
+             const RectI& hole,
+             std::list<RectI>* out)
+{
+    RectI inter;
+    if ( !rect.intersect(hole, &inter) ) {
+        out->push_back(rect);
+
+        return;
+    }
+    if (rect.y1 < inter.y1) {
+        out->push_back( RectI(rect.x1, rect.y1, rect.x2, inter.y1) );
+    }
+    if (inter.y2 < rect.y2) {
+        out->push_back( RectI(rect.x1, inter.y2, rect.x2, rect.y2) );
+    }
+    if (rect.x1 < inter.x1) {
+        out->push_back( RectI(rect.x1, inter.y1, inter.x1, inter.y2) );
+    }
+    if (inter.x2 < rect.x2) {
+        out->push_back( RectI(inter.x2, inter.y1, rect.x2, inter.y2) );
+    }
+}
+
+/**
+ * @brief Publishes the result of a claim: its pixels are marked as rendered (or cleared if the render failed)
+ * and the threads waiting for it are woken up. Must be called with the lock of ibr taken.
+ **/
+static void
+finishClaim(const ImagePtr & img,
+            EffectInstance::Implementation::ImageBeingRendered& ibr,
+            const EffectInstance::Implementation::RectsBeingRenderedPtr& claim,
+            bool renderFailed)
+{
+    if (claim->done) {
+        return;
+    }
+    for (std::list<RectI>::const_iterator it = claim->rects.begin(); it != claim->rects.end(); ++it) {
+        if (renderFailed) {
+            img->clearBitmap(*it);
+        } else {
+            img->markForRendered(*it);
+        }
+    }
+    claim->done = true;
+    claim->failed = renderFailed;
+    ibr.claims.remove(claim);
+
+    // Only the threads waiting for this claim are woken up
+    claim->cond.wakeAll();
+}
+
+EffectInstance::Implementation::RectsBeingRenderedPtr
 EffectInstance::Implementation::markImageAsBeingRendered(const ImagePtr & img, const RectI& roi, std::list<RectI>* restToRender, bool *renderedElsewhere)
 {
     if ( !img->usesBitMap() ) {
-        return;
+        return RectsBeingRenderedPtr();
     }
 
     QMutexLocker k(&imagesBeingRenderedMutex);
+    ImageBeingRenderedPtr ibr;
     ImageBeingRenderedMap::iterator found = imagesBeingRendered.find(img);
     if ( found != imagesBeingRendered.end() ) {
-        ImageBeingRenderedPtr ibr = found->second;
-        k.unlock(); // imagesBeingRenderedMutex
-        QMutexLocker k2(&ibr->lock);
-        ++(ibr->refCount);
-        img->getRestToRender_trimap(roi, *restToRender, renderedElsewhere);
-        for (std::list<RectI>::const_iterator it = restToRender->begin(); it!=restToRender->end();++it) {
-            img->markForRendering(*it);
-        }
+        ibr = found->second;
     } else {
-        ImageBeingRenderedPtr ibr = boost::make_shared<Implementation::ImageBeingRendered>();
-        ++ibr->refCount;
+        ibr = boost::make_shared<Implementation::ImageBeingRendered>();
         std::pair<ImageBeingRenderedMap::iterator, bool> ok = imagesBeingRendered.insert( std::make_pair(img, ibr) );
         assert(ok.second);
         Q_UNUSED(ok);
-        k.unlock(); // imagesBeingRenderedMutex
-        QMutexLocker k2(&ibr->lock);
-        img->getRestToRender_trimap(roi, *restToRender, renderedElsewhere);
-        for (std::list<RectI>::const_iterator it = restToRender->begin(); it!=restToRender->end();++it) {
-            img->markForRendering(*it);
+    }
+    QMutexLocker k2(&ibr->lock);
+    k.unlock(); // imagesBeingRenderedMutex
+    ++ibr->refCount;
+
+    // Only the pixels that nobody has claimed yet are claimed. The rectangles returned by the bitmap may cover pixels
+    // claimed by other threads: cut them out so that claims never overlap, otherwise finishing this claim would
+    // publish pixels that another thread is still rendering and two renders could wait for each other.
+    RectsBeingRenderedPtr claim = boost::make_shared<Implementation::RectsBeingRendered>();
+    img->getRestToRender_trimap(roi, claim->rects, renderedElsewhere);
+    for (std::list<RectsBeingRenderedPtr>::const_iterator it = ibr->claims.begin(); it != ibr->claims.end(); ++it) {
+        for (std::list<RectI>::const_iterator it2 = (*it)->rects.begin(); it2 != (*it)->rects.end(); ++it2) {
+            std::list<RectI> remaining;
+            for (std::list<RectI>::const_iterator it3 = claim->rects.begin(); it3 != claim->rects.end(); ++it3) {
+                if ( it3->intersects(*it2) ) {
+                    *renderedElsewhere = true;
+                }
+                subtractRect(*it3, *it2, &remaining);
+            }
+            claim->rects.swap(remaining);
         }
     }
+    for (std::list<RectI>::const_iterator it = claim->rects.begin(); it != claim->rects.end(); ++it) {
+        img->markForRendering(*it);
+    }
+    restToRender->insert( restToRender->end(), claim->rects.begin(), claim->rects.end() );
+    ibr->claims.push_back(claim);
+
+    return claim;
+}
+
+void
+EffectInstance::Implementation::finishRenderingClaim(const ImagePtr & img,
+                                                     const RectsBeingRenderedPtr& claim,
+                                                     bool renderFailed)
+{
+    if ( !img->usesBitMap() || !claim ) {
+        return;
+    }
+    ImageBeingRenderedPtr ibr;
+    QMutexLocker k(&imagesBeingRenderedMutex);
+    ImageBeingRenderedMap::iterator found = imagesBeingRendered.find(img);
+    if( found != imagesBeingRendered.end() ) {
+        ibr = found->second;
+    }
+    if (!ibr) {
+        return;
+    }
+    k.unlock(); // imagesBeingRenderedMutex
+    QMutexLocker kk(&ibr->lock);
+    finishClaim(img, *ibr, claim, renderFailed);
 }
 
 bool
 EffectInstance::Implementation::waitForImageBeingRenderedElsewhere(const RectI & roi,
-                                                                            const ImagePtr & img)
+                                                                   const ImagePtr & img,
+                                                                   const RectsBeingRenderedPtr& ownClaim,
+                                                                   bool* abandonedRegions)
 {
     if ( !img->usesBitMap() ) {
         return true;
@@ -620,30 +955,54 @@ EffectInstance::Implementation::waitForImageBeingRenderedElsewhere(const RectI &
         return true;
     }
     k.unlock(); // imagesBeingRenderedMutex
-    std::list<RectI> restToRender;
-    bool isBeingRenderedElseWhere = false;
-    img->getRestToRender_trimap(roi, restToRender, &isBeingRenderedElseWhere);
-
-    bool ab = _publicInterface->aborted();
 
     QMutexLocker kk(&ibr->lock);
-    while (!ab && isBeingRenderedElseWhere && !ibr->failed && ibr->refCount > 1) {
-        ibr->cond.wait(&ibr->lock, 50);
-        restToRender.clear();
-        isBeingRenderedElseWhere = false;
-        img->getRestToRender_trimap(roi, restToRender, &isBeingRenderedElseWhere);
-        ab = _publicInterface->aborted();
+    for (;;) {
+        if ( _publicInterface->aborted() ) {
+            return false;
+        }
+
+        // Find a claim of another thread on pixels of the roi: claims of other portions of the image are not waited for
+        RectsBeingRenderedPtr pending;
+        for (std::list<RectsBeingRenderedPtr>::const_iterator it = ibr->claims.begin(); it != ibr->claims.end() && !pending; ++it) {
+            if (*it == ownClaim) {
+                continue;
+            }
+            for (std::list<RectI>::const_iterator it2 = (*it)->rects.begin(); it2 != (*it)->rects.end(); ++it2) {
+                if ( it2->intersects(roi) ) {
+                    pending = *it;
+                    break;
+                }
+            }
+        }
+        if (!pending) {
+            break;
+        }
+        while ( !pending->done && !_publicInterface->aborted() ) {
+            pending->cond.wait(&ibr->lock, 50);
+        }
+    }
+
+    // A failed or aborted render clears the bitmap of its claim: these pixels of the roi are left to render
+    RectI realRoi;
+    if ( roi.intersect(img->getBounds(), &realRoi) ) {
+        std::list<RectI> restToRender;
+        bool isBeingRenderedElseWhere = false;
+        img->getRestToRender_trimap(realRoi, restToRender, &isBeingRenderedElseWhere);
+        if ( !restToRender.empty() ) {
+            *abandonedRegions = true;
+        }
     }
-    ///Everything should be rendered now unless we are aborted
-    return restToRender.empty() && !ibr->failed && !ab;
+
+    return true;
 }
 
 void
 EffectInstance::Implementation::unmarkImageAsBeingRendered(const ImagePtr & img,
-                                                           const std::list<RectI>& rects,
+                                                           const RectsBeingRenderedPtr& claim,
                                                            bool renderFailed)
 {
-    if ( !img->usesBitMap() ) {
+    if ( !img->usesBitMap() || !claim ) {
         return;
     }
     ImageBeingRenderedPtr ibr;
@@ -657,25 +1016,19 @@ EffectInstance::Implementation::unmarkImageAsBeingRendered(const ImagePtr & img,
     }
     k.unlock(); // imagesBeingRenderedMutex
     QMutexLocker kk(&ibr->lock);
-    if (renderFailed) {
-        ibr->failed = true;
-    }
-    for (std::list<RectI>::const_iterator it = rects.begin(); it!=rects.end();++it) {
-        if (renderFailed) {
-            img->clearBitmap(*it);
-        } else {
-            img->markForRendered(*it);
-        }
-    }
+    finishClaim(img, *ibr, claim, renderFailed);
 
     --ibr->refCount;
-    ibr->cond.wakeAll();
     if (!ibr->refCount) {
-        kk.unlock(); // < unlock before erase which is going to delete the lock
+        kk.unlock(); // < imagesBeingRenderedMutex must be locked first
         k.relock(); // imagesBeingRenderedMutex
-        ImageBeingRenderedMap::iterator found = imagesBeingRendered.find(img);
-        if( found != imagesBeingRendered.end() ) {
-            imagesBeingRendered.erase(found);
+        QMutexLocker kk2(&ibr->lock);
+        // Another render may have claimed a portion of the image in the meantime
+        if (!ibr->refCount) {
+            ImageBeingRenderedMap::iterator found = imagesBeingRendered.find(img);
+            if ( (found != imagesBeingRendered.end()) && (found->second == ibr) ) {
+                imagesBeingRendered.erase(found);
+            }
         }
     }
 }
@@ -33,10 +33,13 @@
 #include <map>
 #include <list>
 #include <string>
+#include <vector>
 
 #include <QtCore/QCoreApplication>
 #include <QtCore/QWaitCondition>
 #include <QtCore/QMutex>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QAtomicPointer>
 
 #include "Global/GlobalDefines.h"
 
@@ -49,13 +52,6 @@
 
 NATRON_NAMESPACE_ENTER
 
-struct ActionKey
-{
-    double time;
-    ViewIdx view;
-    unsigned int mipMapLevel;
-};
-
 struct IdentityResults
 {
     int inputIdentityNb;
@@ -74,50 +70,82 @@ struct ComponentsNeededResults
     ViewIdx passThroughView;
 };
 
-struct CompareActionsCacheKeys
+enum ActionsCacheResultTypeEnum
+{
+    eActionsCacheResultTypeIdentity = 0,
+    eActionsCacheResultTypeRoD,
+    eActionsCacheResultTypeFramesNeeded,
+    eActionsCacheResultTypeComponentsNeeded,
+    eActionsCacheResultTypeTimeDomain,
+    eActionsCacheResultTypeRenderPlan,
+    eActionsCacheResultTypeTimeInvariance
+};
+
+/**
+ * @brief Identifies a result in the ActionsCache. Fields that do not apply to a type of result are left to 0.
+ **/
+struct ActionsCacheKey
 {
-    bool operator() (const ActionKey & lhs,
-                     const ActionKey & rhs) const
+    U64 hash;
+    double time;
+    int view;
+    unsigned int mipMapLevel;
+    ActionsCacheResultTypeEnum type;
+
+    // Render plans only: whether transforms were concatenated
+    bool useTransforms;
+
+    ActionsCacheKey(ActionsCacheResultTypeEnum type,
+                    U64 hash,
+                    double time = 0.,
+                    ViewIdx view = ViewIdx(0),
+                    unsigned int mipMapLevel = 0,
+                    bool useTransforms = false)
+        : hash(hash)
+        , time(time)
+        , view(view)
+        , mipMapLevel(mipMapLevel)
+        , type(type)
+        , useTransforms(useTransforms)
     {
-        if (lhs.time < rhs.time) {
-            return true;
-        } else if (lhs.time == rhs.time) {
-            if (lhs.mipMapLevel < rhs.mipMapLevel) {
-                return true;
-            } else if (lhs.mipMapLevel == rhs.mipMapLevel) {
-                if (lhs.view < rhs.view) {
-                    return true;
-                } else {
-                    return false;
-                }
-            } else {
-                return false;
-            }
-        } else {
-            return false;
-        }
+    }
+
+    bool operator==(const ActionsCacheKey& other) const
+    {
+        return hash == other.hash && time == other.time && view == other.view && mipMapLevel == other.mipMapLevel &&
+               type == other.type && useTransforms == other.useTransforms;
     }
 };
 
-typedef std::map<ActionKey, IdentityResults, CompareActionsCacheKeys> IdentityCacheMap;
-typedef std::map<ActionKey, RectD, CompareActionsCacheKeys> RoDCacheMap;
-typedef std::map<ActionKey, FramesNeededMap, CompareActionsCacheKeys> FramesNeededCacheMap;
-typedef std::map<ActionKey, ComponentsNeededResults, CompareActionsCacheKeys> ComponentsNeededCacheMap;
+struct ActionsCacheEntry;
+struct ActionsCacheTable;
+struct ActionsCacheReaderSlot;
 
 /**
  * @brief This class stores all results of the following actions:
    - getRegionOfDefinition (invalidated on hash change, mapped across time + scale)
    - getTimeDomain (invalidated on hash change, only 1 value possible
    - isIdentity (invalidated on hash change,mapped across time + scale)
+ * It also stores the results of the request pass (see RenderPlanResults), which are kept for each
+ * view/mipmap level and reused across frames when the tree is not animated.
  * The reason we store them is that the OFX Clip API can potentially call these actions recursively
  * but this is forbidden by the spec:
  * http://openfx.sourceforge.net/Documentation/1.3/ofxProgrammingReference.html#id475585
+ *
+ * The cache is read by every render thread, several times for each tile of each node, and written once per result.
+ * Results are kept in an open-addressing hash table keyed on (node hash, time, view, mipmap level) whose reads
+ * take no lock: a reader only announces itself in a counter of its reader slot. Writers are serialized by a mutex
+ * and never modify a published result: they replace it, or build a new table when it is full or when the results of
+ * the oldest node hashes are dropped. Replaced results and tables are deleted once all readers that could have
+ * seen them are done (epoch-based reclamation), see synchronizeReaders().
  **/
 class ActionsCache
 {
 public:
     ActionsCache(int maxAvailableHashes);
 
+    ~ActionsCache();
+
     void clearAll();
 
     void invalidateAll(U64 newHash);
@@ -144,26 +172,84 @@ public:
 
     void setTimeDomainResult(U64 hash, double first, double last);
 
+    bool getRenderPlanResults(U64 hash, ViewIdx view, unsigned int mipMapLevel, bool useTransforms, RenderPlanResults* results);
+
+    void setRenderPlanResults(U64 hash, const RenderPlanResults& results);
+
+    bool getTimeInvarianceResult(U64 hash, bool* timeInvariant);
+
+    void setTimeInvarianceResult(U64 hash, bool timeInvariant);
+
+    /**
+     * @brief Returns the number of lookups that found a result and that did not, since the cache was created.
+     * The counters wrap around: only differences between two calls are meaningful.
+     **/
+    void getAccessCounts(unsigned int* hits, unsigned int* misses) const;
+
 private:
-    mutable QMutex _cacheMutex; //< protects everything in the cache
-    struct ActionsCacheInstance
-    {
-        U64 _hash;
-        OfxRangeD _timeDomain;
-        bool _timeDomainSet;
-        IdentityCacheMap _identityCache;
-        RoDCacheMap _rodCache;
-        FramesNeededCacheMap _framesNeededCache;
-        ComponentsNeededCacheMap _componentsNeededCache;
-
-        ActionsCacheInstance();
-    };
 
-    //In  a list to track the LRU
-    std::list<ActionsCacheInstance> _instances;
-    std::size_t _maxInstances;
-    std::list<ActionsCacheInstance>::iterator createActionCacheInternal(U64 newHash);
-    ActionsCacheInstance & getOrCreateActionCache(U64 newHash);
+    template <typename T>
+    bool getResult(const ActionsCacheKey& key, T* value);
+
+    template <typename T>
+    void setResult(const ActionsCacheKey& key, const T& value);
+
+    ActionsCacheReaderSlot& getReaderSlot() const;
+
+    // Must be called with _writeMutex held
+    void touchHash(U64 hash);
+    void rebuildTable(std::size_t capacity);
+
+    // Deletes the retired results and tables if there are enough of them. Must be called with _writeMutex held, which
+    // is released while waiting for the readers.
+    void reclaimRetiredIfNeeded(QMutexLocker* writeLocker);
+
+    // Waits for the readers that may have seen a result retired before the call
+    void synchronizeReaders();
+    void reclaimRetired();
+
+    // The current table, read without any lock
+    QAtomicPointer<ActionsCacheTable> _table;
+
+    // Incremented each time the writer waits for readers: readers register in the counter of the parity of the epoch
+    QAtomicInt _epoch;
+    ActionsCacheReaderSlot* _readerSlots;
+    QMutex _epochMutex; //< serializes the changes of _epoch
+
+    mutable QMutex _writeMutex; //< serializes writers and protects the fields below
+    // Node hashes for which results are kept, most recent last
+    std::list<U64> _hashes;
+    std::size_t _maxHashes;
+    // Results and tables no longer reachable, deleted once readers are done with them
+    std::list<ActionsCacheEntry*> _retiredEntries;
+    std::list<ActionsCacheTable*> _retiredTables;
+};
+
+/**
+ * @brief The rectangles of a render, split in contiguous bands, one per NUMA node, used when the NUMA mode is enabled
+ * (see NumaTopology). A worker takes the rectangles of the node it runs on first, so that each band of the image is
+ * written (and thus first touched) by threads of a same node, and only takes rectangles of other nodes once its own are done.
+ **/
+class NumaTileQueue
+{
+public:
+
+    NumaTileQueue(const std::list<EffectInstance::RectToRender>& rects, int nNodes);
+
+    /**
+     * @brief Pops the next rectangle to render by a thread of the given node. Returns false if there is nothing left to render.
+     **/
+    bool pop(int node, EffectInstance::RectToRender* rect);
+
+    /**
+     * @brief Drops all remaining rectangles, e.g: when the render failed
+     **/
+    void clear();
+
+private:
+
+    QMutex _lock;
+    std::vector<std::list<EffectInstance::RectToRender> > _nodesRects;
 };
 
 
@@ -196,16 +282,32 @@ public:
     ActionsCachePtr actionsCache;
 
 #if NATRON_ENABLE_TRIMAP
+    ///The portions of an image claimed by a render: the renders needing some of these pixels wait for this claim only
+    struct RectsBeingRendered
+    {
+        QWaitCondition cond;
+        std::list<RectI> rects;
+        bool done;
+        bool failed;
+
+        RectsBeingRendered()
+            : cond(), rects(), done(false), failed(false)
+        {
+        }
+    };
+
+    typedef boost::shared_ptr<RectsBeingRendered> RectsBeingRenderedPtr;
+
     ///Store all images being rendered to avoid 2 threads rendering the same portion of an image
     struct ImageBeingRendered
     {
-        QWaitCondition cond;
+        // Protects the fields below and the claims
         QMutex lock;
         int refCount;
-        bool failed;
+        std::list<RectsBeingRenderedPtr> claims;
 
         ImageBeingRendered()
-            : cond(), lock(), refCount(0), failed(false)
+            : lock(), refCount(0), claims()
         {
         }
     };
@@ -245,11 +347,27 @@ public:
     void setDuringInteractAction(bool b);
 
 #if NATRON_ENABLE_TRIMAP
-    void markImageAsBeingRendered(const ImagePtr & img, const RectI& roi, std::list<RectI>* restToRender, bool *renderedElsewhere);
+    /**
+     * @brief Claims the portions of roi that are not rendered nor claimed by another thread and appends them to restToRender.
+     * Claims never overlap. Returns the claim, that must be given back to unmarkImageAsBeingRendered, or NULL if the image has no bitmap.
+     **/
+    RectsBeingRenderedPtr markImageAsBeingRendered(const ImagePtr & img, const RectI& roi, std::list<RectI>* restToRender, bool *renderedElsewhere);
 
-    bool waitForImageBeingRenderedElsewhere(const RectI & roi, const ImagePtr & img);
+    /**
+     * @brief Marks the pixels of the claim as rendered (or clears them if the render failed) and wakes up the threads
+     * waiting for them. This must be called before waiting for the claims of other threads, so that no two renders wait for each other.
+     **/
+    void finishRenderingClaim(const ImagePtr & img, const RectsBeingRenderedPtr& claim, bool renderFailed);
 
-    void unmarkImageAsBeingRendered(const ImagePtr & img, const std::list<RectI>& rects, bool renderFailed);
+    /**
+     * @brief Waits for the claims of other threads that intersect roi, the renders of other portions of the image are not waited for.
+     * The own claim of the caller must have been finished with finishRenderingClaim first.
+     * Returns false if the render was aborted while waiting. If one of these renders failed or was aborted, its pixels are
+     * left to render and abandonedRegions is set to true.
+     **/
+    bool waitForImageBeingRenderedElsewhere(const RectI & roi, const ImagePtr & img, const RectsBeingRenderedPtr& ownClaim, bool* abandonedRegions);
+
+    void unmarkImageAsBeingRendered(const ImagePtr & img, const RectsBeingRenderedPtr& claim, bool renderFailed);
 #endif
 
     /**
@@ -335,11 +453,20 @@ public:
         bool byPassCache;
         std::bitset<4> processChannels;
         ImagePlanesToRenderPtr planes;
+        // The parameters snapshot active on the thread that launched the tiles, activated again on each tile thread
+        KnobValuesSnapshotPtr knobsSnapshot;
     };
 
     RenderingFunctorRetEnum tiledRenderingFunctor(TiledRenderingFunctorArgs & args,  const RectToRender & specificData,
                                                   QThread* callingThread);
 
+    /**
+     * @brief Renders rectangles popped from the queue until it is empty, preferring the rectangles of the NUMA node of the
+     * calling thread. The worker index is ignored, it is only there so that this can be mapped over a sequence of workers.
+     **/
+    RenderingFunctorRetEnum numaTiledRenderingFunctor(TiledRenderingFunctorArgs & args, NumaTileQueue* queue, int workerIndex,
+                                                      QThread* callingThread);
+
     RenderingFunctorRetEnum tiledRenderingFunctor(const RectToRender & rectToRender,
                                                   const bool renderFullScaleThenDownscale,
                                                   const bool isSequentialRender,
@@ -56,12 +56,15 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/BlockingBackgroundRender.h"
 #include "Engine/DiskCacheNode.h"
 #include "Engine/Cache.h"
+#include "Engine/CombinedRender.h"
 #include "Engine/Image.h"
 #include "Engine/ImageParams.h"
 #include "Engine/KnobFile.h"
 #include "Engine/KnobTypes.h"
+#include "Engine/KnobValuesSnapshot.h"
 #include "Engine/Log.h"
 #include "Engine/Node.h"
+#include "Engine/NumaTopology.h"
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/OfxImageEffectInstance.h"
@@ -240,9 +243,11 @@ class ImageBitMapMarker_RAII
     RectI _roi;
     EffectInstance* _effect;
     std::list<RectI> _rectsToRender;
+    // The portions of each image claimed by this render
+    std::list<std::pair<ImagePtr, EffectInstance::Implementation::RectsBeingRenderedPtr> > _claims;
     bool _isBeingRenderedElseWhere;
+    bool _hasAbandonedRegions;
     bool _isValid;
-    bool _renderFullScale;
 
 public:
 
@@ -254,9 +259,10 @@ public:
     , _roi(roi)
     , _effect(effect)
     , _rectsToRender()
+    , _claims()
     , _isBeingRenderedElseWhere(false)
+    , _hasAbandonedRegions(false)
     , _isValid(true)
-    , _renderFullScale(renderFullScale)
     {
         for (std::map<ImagePlaneDesc,EffectInstance::PlaneToRender>::const_iterator it = _image.begin(); it != _image.end(); ++it) {
             ImagePtr cacheImage;
@@ -266,7 +272,8 @@ public:
                 cacheImage = it->second.fullscaleImage;
             }
             if (cacheImage && cacheImage->usesBitMap()) {
-                _effect->_imp->markImageAsBeingRendered(cacheImage, roi, &_rectsToRender, &_isBeingRenderedElseWhere);
+                EffectInstance::Implementation::RectsBeingRenderedPtr claim = _effect->_imp->markImageAsBeingRendered(cacheImage, roi, &_rectsToRender, &_isBeingRenderedElseWhere);
+                _claims.push_back( std::make_pair(cacheImage, claim) );
             }
         }
 
@@ -282,38 +289,43 @@ public:
         _isValid = false;
     }
 
-    void waitForPendingRegions()
+    /**
+     * @brief Publishes the pixels claimed by this render, which must be rendered, then waits for the other renders
+     * of the pixels of the roi that this render did not claim.
+     * Returns false if the render was aborted while waiting.
+     **/
+    bool waitForPendingRegions()
     {
-        if (!_isBeingRenderedElseWhere || !_isValid) {
-            return;
+        if (!_isValid) {
+            return true;
         }
-        for (std::map<ImagePlaneDesc,EffectInstance::PlaneToRender>::const_iterator it = _image.begin(); it != _image.end(); ++it) {
-            ImagePtr cacheImage;
-            if (!_renderFullScale) {
-                cacheImage = it->second.downscaleImage;
-            } else {
-                cacheImage = it->second.fullscaleImage;
-            }
-            if (cacheImage && cacheImage->usesBitMap()) {
-                if (!_effect->_imp->waitForImageBeingRenderedElsewhere(_roi, cacheImage)) {
-                    _isValid = false;
-                }
+        for (std::list<std::pair<ImagePtr, EffectInstance::Implementation::RectsBeingRenderedPtr> >::const_iterator it = _claims.begin(); it != _claims.end(); ++it) {
+            _effect->_imp->finishRenderingClaim(it->first, it->second, false);
+        }
+        if (!_isBeingRenderedElseWhere) {
+            return true;
+        }
+        for (std::list<std::pair<ImagePtr, EffectInstance::Implementation::RectsBeingRenderedPtr> >::const_iterator it = _claims.begin(); it != _claims.end(); ++it) {
+            if ( !_effect->_imp->waitForImageBeingRenderedElsewhere(_roi, it->first, it->second, &_hasAbandonedRegions) ) {
+                return false;
             }
         }
+
+        return true;
+    }
+
+    /**
+     * @brief Returns true if another render of pixels of the roi failed or was aborted: they must be rendered again.
+     **/
+    bool hasAbandonedRegions() const
+    {
+        return _hasAbandonedRegions;
     }
 
     ~ImageBitMapMarker_RAII()
     {
-        for (std::map<ImagePlaneDesc,EffectInstance::PlaneToRender>::const_iterator it = _image.begin(); it != _image.end(); ++it) {
-            ImagePtr cacheImage;
-            if (!_renderFullScale) {
-                cacheImage = it->second.downscaleImage;
-            } else {
-                cacheImage = it->second.fullscaleImage;
-            }
-            if (cacheImage && cacheImage->usesBitMap()) {
-                _effect->_imp->unmarkImageAsBeingRendered(cacheImage, _rectsToRender, !_isValid);
-            }
+        for (std::list<std::pair<ImagePtr, EffectInstance::Implementation::RectsBeingRenderedPtr> >::const_iterator it = _claims.begin(); it != _claims.end(); ++it) {
+            _effect->_imp->unmarkImageAsBeingRendered(it->first, it->second, !_isValid);
         }
  
     }
@@ -731,6 +743,48 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
         }
     }
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ////////////////////////////// Integer translations ///////////////////////////////////////////////////////////////////
+    /*
+     * If this effect only translates its input by a whole number of pixels, its output is the image of the input over the
+     * translated RoI: return views on the input planes instead of rendering a copy of them.
+     * Like the identity case above, this happens before the cache of this effect is looked up and nothing is inserted in it:
+     * the pixels are cached once, by the input. An image of this effect that is already in the cache (e.g. rendered while
+     * concatenation was disabled) is not used, which costs a render of the input only if it is not cached either.
+     */
+    if ( !renderFullScaleThenDownscale && (args.returnStorage == eStorageModeRAM) ) {
+        SettingsPtr settings = appPTR->getCurrentSettings();
+        EffectInstancePtr inputToTranslate;
+        int translateX, translateY;
+        if ( settings && settings->isTransformConcatenationEnabled() &&
+             getIntegerTranslation(args.time, frameArgs->draftMode, args.view, renderMappedScale, &inputToTranslate, &translateX, &translateY) ) {
+            boost::scoped_ptr<RenderRoIArgs> inputArgs( new RenderRoIArgs(args) );
+            inputArgs->roi.translate(-translateX, -translateY);
+            inputArgs->components = requestedComponents;
+            inputArgs->preComputedRoD.clear();
+
+            std::map<ImagePlaneDesc, ImagePtr> inputPlanes;
+            RenderRoIRetCode ret = inputToTranslate->renderRoI(*inputArgs, &inputPlanes);
+            if (ret != eRenderRoIRetCodeOk) {
+                return ret;
+            }
+            for (std::map<ImagePlaneDesc, ImagePtr>::iterator it = inputPlanes.begin(); it != inputPlanes.end(); ++it) {
+                if ( !it->second || (it->second->getStorageMode() != eStorageModeRAM) ) {
+                    continue;
+                }
+                // The view must cover the translated input so that its pixels lie within its region of definition
+                RectD viewRod = it->second->getRoD();
+                double canonicalDx = translateX * par / renderMappedScale.x;
+                double canonicalDy = translateY / renderMappedScale.y;
+                viewRod.set(viewRod.x1 + canonicalDx, viewRod.y1 + canonicalDy, viewRod.x2 + canonicalDx, viewRod.y2 + canonicalDy);
+                viewRod.merge(rod);
+                outputPlanes->insert( std::make_pair( it->first, Image::makeTranslatedView(it->second, translateX, translateY, viewRod) ) );
+            }
+
+            return eRenderRoIRetCodeOk;
+        }
+    }
+
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     ////////////////////////////// Transform concatenations ///////////////////////////////////////////////////////////////
     ///Try to concatenate transform effects
@@ -894,6 +948,11 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
         // in Analysis, the node upstream of the analysis node should always cache
         createInCache = (frameArgs->isAnalysis && frameArgs->treeRoot->getEffectInstance().get() == args.caller) ? true : shouldCacheOutput(isFrameVaryingOrAnimated, args.time, args.view, frameArgs->visitsCount);
     }
+    // When several writers render together, the output of the nodes they share must be cached so that it is computed only once
+    const bool pinOutputForCombinedRender = storage != eStorageModeGLTex && frameArgs->combinedRender && frameArgs->combinedRender->isSharedNode( getNode().get() );
+    if (pinOutputForCombinedRender) {
+        createInCache = true;
+    }
     ///Do we want to render the graph upstream at scale 1 or at the requested render scale ? (user setting)
     bool renderScaleOneUpstreamIfRenderScaleSupportDisabled = getNode()->useScaleOneImagesWhenRenderScaleSupportIsDisabled();
     ///For multi-resolution we want input images with exactly the same size as the output image
@@ -1649,15 +1708,26 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
 
 #if NATRON_ENABLE_TRIMAP
     assert(guard);
+    bool mustRenderAbandonedRegions = false;
     if (renderAborted && renderRetCode != EffectInstance::eRenderRoIStatusImageRendered  && renderRetCode != EffectInstance::eRenderRoIStatusImageAlreadyRendered) {
         guard->invalidate();
+    } else if ( (renderRetCode == eRenderRoIStatusRenderFailed) || (renderRetCode == eRenderRoIStatusRenderOutOfGPUMemory) ) {
+        // Do not leave the pixels this render claimed marked as rendered: other renders waiting for them render them again
+        guard->invalidate();
+    } else if ( !guard->waitForPendingRegions() ) {
+        renderAborted = true;
     } else {
-        guard->waitForPendingRegions();
+        mustRenderAbandonedRegions = guard->hasAbandonedRegions();
     }
 #endif // NATRON_ENABLE_TRIMAP
 
 #if NATRON_ENABLE_TRIMAP
     guard.reset();
+
+    if (mustRenderAbandonedRegions) {
+        // Another render of some pixels of the roi failed or was aborted, they are still in the cache: render them now
+        return renderRoI(args, outputPlanes);
+    }
 #endif
 
     if ( renderAborted && (renderRetCode != eRenderRoIStatusImageAlreadyRendered) ) {
@@ -1833,6 +1903,15 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
 
 
     ///// Termination
+    if (pinOutputForCombinedRender) {
+        // Keep the images we rendered in the cache until the other writers of the group have rendered this frame
+        for (std::map<ImagePlaneDesc, EffectInstance::PlaneToRender>::iterator it = planesToRender->planes.begin(); it != planesToRender->planes.end(); ++it) {
+            if (it->second.fullscaleImage) {
+                frameArgs->combinedRender->pinImage( (int)frameArgs->time, it->second.fullscaleImage );
+            }
+        }
+    }
+
 #ifdef DEBUG
     if ( outputPlanes->size() != args.components.size() ) {
         qDebug() << "Requested:";
@@ -1981,6 +2060,7 @@ EffectInstance::renderRoIInternal(EffectInstance* self,
             tiledArgs->processChannels = processChannels;
             tiledArgs->planes = planesToRender;
             tiledArgs->compsNeeded = compsNeeded;
+            tiledArgs->knobsSnapshot = KnobValuesSnapshot::getCurrentSnapshot();
 
 
 #ifdef NATRON_HOSTFRAMETHREADING_SEQUENTIAL
@@ -1996,12 +2076,30 @@ EffectInstance::renderRoIInternal(EffectInstance* self,
 #else
 
 
-            QFuture<RenderingFunctorRetEnum> ret = QtConcurrent::mapped( planesToRender->rectsToRender,
-                                                                         boost::bind(&EffectInstance::Implementation::tiledRenderingFunctor,
-                                                                                     self->_imp.get(),
-                                                                                     *tiledArgs,
-                                                                                     _1,
-                                                                                     currentThread) );
+            QFuture<RenderingFunctorRetEnum> ret;
+            boost::scoped_ptr<NumaTileQueue> numaQueue;
+            if ( NumaTopology::isEnabled() ) {
+                // Instead of handing rectangles to whichever thread is free, let each thread render the rectangles of its NUMA node
+                numaQueue.reset( new NumaTileQueue( planesToRender->rectsToRender, NumaTopology::getNumNodes() ) );
+                std::vector<int> workers( std::min( (int)planesToRender->rectsToRender.size(), std::max(1, QThreadPool::globalInstance()->maxThreadCount()) ) );
+                for (std::size_t i = 0; i < workers.size(); ++i) {
+                    workers[i] = (int)i;
+                }
+                ret = QtConcurrent::mapped( workers,
+                                            boost::bind(&EffectInstance::Implementation::numaTiledRenderingFunctor,
+                                                        self->_imp.get(),
+                                                        *tiledArgs,
+                                                        numaQueue.get(),
+                                                        _1,
+                                                        currentThread) );
+            } else {
+                ret = QtConcurrent::mapped( planesToRender->rectsToRender,
+                                            boost::bind(&EffectInstance::Implementation::tiledRenderingFunctor,
+                                                        self->_imp.get(),
+                                                        *tiledArgs,
+                                                        _1,
+                                                        currentThread) );
+            }
             ret.waitForFinished();
             QFuture<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
 
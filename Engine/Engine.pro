@@ -77,18 +77,21 @@ SOURCES += \
     BlockingBackgroundRender.cpp \
     CLArgs.cpp \
     Cache.cpp \
+    CombinedRender.cpp \
     CoonsRegularization.cpp \
     CreateNodeArgs.cpp \
     Curve.cpp \
     CurveSerialization.cpp \
     DefaultShaders.cpp \
     DiskCacheNode.cpp \
+    DiskCacheStore.cpp \
     Dot.cpp \
     EffectInstance.cpp \
     EffectInstancePrivate.cpp \
     EffectInstanceRenderRoI.cpp \
     ExistenceCheckThread.cpp \
     FileDownloader.cpp \
+    FilePrefetcher.cpp \
     FileSystemModel.cpp \
     FitCurve.cpp \
     FrameEntry.cpp \
@@ -117,11 +120,13 @@ SOURCES += \
     KnobFile.cpp \
     KnobSerialization.cpp \
     KnobTypes.cpp \
+    KnobValuesSnapshot.cpp \
     LibraryBinary.cpp \
     Log.cpp \
     Lut.cpp \
     Markdown.cpp \
     MemoryFile.cpp \
+    MemoryGovernor.cpp \
     MemoryInfo.cpp \
     NoOpBase.cpp \
     Node.cpp \
@@ -137,6 +142,7 @@ SOURCES += \
     Noise.cpp \
     NonKeyParams.cpp \
     NonKeyParamsSerialization.cpp \
+    NumaTopology.cpp \
     OSGLContext.cpp \
     OSGLContext_mac.cpp \
     OSGLContext_win.cpp \
@@ -160,6 +166,7 @@ SOURCES += \
     ProjectPrivate.cpp \
     ProjectSerialization.cpp \
     PyAppInstance.cpp \
+    PyDoubleArray.cpp \
     PyExprUtils.cpp \
     PyNode.cpp \
     PyNodeGroup.cpp \
@@ -167,6 +174,7 @@ SOURCES += \
     PyRoto.cpp \
     PySideCompat.cpp \
     PyTracker.cpp \
+    RamBufferPool.cpp \
     ReadNode.cpp \
     RectD.cpp \
     RectI.cpp \
@@ -176,6 +184,7 @@ SOURCES += \
     RotoItem.cpp \
     RotoLayer.cpp \
     RotoPaint.cpp \
+    RotoPaintCompositor.cpp \
     RotoPaintInteract.cpp \
     RotoSmear.cpp \
     RotoStrokeItem.cpp \
@@ -277,6 +286,7 @@ HEADERS += \
     CacheEntryHolder.h \
     CacheSerialization.h \
     ChoiceOption.h \
+    CombinedRender.h \
     CoonsRegularization.h \
     CreateNodeArgs.h \
     Curve.h \
@@ -284,6 +294,7 @@ HEADERS += \
     CurveSerialization.h \
     DefaultShaders.h \
     DiskCacheNode.h \
+    DiskCacheStore.h \
     DockablePanelI.h \
     Dot.h \
     EffectInstance.h \
@@ -292,6 +303,7 @@ HEADERS += \
     ExistenceCheckThread.h \
     FeatherPoint.h \
     FileDownloader.h \
+    FilePrefetcher.h \
     FileSystemModel.h \
     FitCurve.h \
     Format.h \
@@ -327,6 +339,7 @@ HEADERS += \
     KnobImpl.h \
     KnobSerialization.h \
     KnobTypes.h \
+    KnobValuesSnapshot.h \
     LRUHashTable.h \
     LibraryBinary.h \
     Log.h \
@@ -334,6 +347,7 @@ HEADERS += \
     Lut.h \
     Markdown.h \
     MemoryFile.h \
+    MemoryGovernor.h \
     MemoryInfo.h \
     MergingEnum.h \
     NoOpBase.h \
@@ -349,6 +363,7 @@ HEADERS += \
     NoiseTables.h \
     NonKeyParams.h \
     NonKeyParamsSerialization.h \
+    NumaTopology.h \
     OSGLContext.h \
     OSGLContext_mac.h \
     OSGLContext_win.h \
@@ -375,6 +390,7 @@ HEADERS += \
     ProjectPrivate.h \
     ProjectSerialization.h \
     PyAppInstance.h \
+    PyDoubleArray.h \
     PyExprUtils.h \
     PyGlobalFunctions.h \
     PyNode.h \
@@ -383,6 +399,7 @@ HEADERS += \
     PyRoto.h \
     PyTracker.h \
     Pyside_Engine_Python.h \
+    RamBufferPool.h \
     ReadNode.h \
     RectD.h \
     RectDSerialization.h \
@@ -399,6 +416,7 @@ HEADERS += \
     RotoLayer.h \
     RotoLayerSerialization.h \
     RotoPaint.h \
+    RotoPaintCompositor.h \
     RotoPaintInteract.h \
     RotoPoint.h \
     RotoSmear.h \
@@ -133,6 +133,7 @@ class CLArgs;
 class CacheEntryHolder;
 class CacheSignalEmitter;
 class ChoiceExtraData;
+class CombinedRender;
 class CreateNodeArgs;
 class Curve;
 class Dimension;
@@ -142,6 +143,7 @@ class ExistenceCheckerThread;
 class FileSystemItem;
 class FileSystemModel;
 class Format;
+class FilePrefetcher;
 class FrameEntry;
 class FrameKey;
 class FrameParams;
@@ -190,10 +192,12 @@ class KnobSerializationBase;
 class KnobSignalSlotHandler;
 class KnobString;
 class KnobTLSData;
+class KnobValuesSnapshot;
 class KnobTable;
 class LibraryBinary;
 class LogEntry;
 class MemoryFile;
+class MemoryGovernor;
 class Node;
 class NodeCollection;
 class NodeFrameRequest;
@@ -331,6 +335,7 @@ typedef boost::shared_ptr<BezierCP> BezierCPPtr;
 typedef boost::shared_ptr<BezierSerialization> BezierSerializationPtr;
 typedef boost::shared_ptr<BufferableObject> BufferableObjectPtr;
 typedef boost::shared_ptr<CacheSignalEmitter> CacheSignalEmitterPtr;
+typedef boost::shared_ptr<CombinedRender> CombinedRenderPtr;
 typedef boost::shared_ptr<Curve> CurvePtr;
 typedef boost::shared_ptr<EffectInstance> EffectInstancePtr;
 typedef boost::shared_ptr<ExistenceCheckerThread> ExistenceCheckerThreadPtr;
@@ -377,6 +382,7 @@ typedef boost::shared_ptr<KnobSerializationBase> KnobsSerializationBasePtr;
 typedef boost::shared_ptr<KnobSignalSlotHandler> KnobSignalSlotHandlerPtr;
 typedef boost::shared_ptr<KnobString> KnobStringPtr;
 typedef boost::shared_ptr<KnobTLSData> KnobTLSDataPtr;
+typedef boost::shared_ptr<KnobValuesSnapshot> KnobValuesSnapshotPtr;
 typedef boost::shared_ptr<KnobTable> KnobTablePtr;
 typedef boost::shared_ptr<MemoryFile> MemoryFilePtr;
 typedef boost::shared_ptr<Node> NodePtr;
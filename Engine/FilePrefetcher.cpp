@@ -0,0 +1,207 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "FilePrefetcher.h"
+
+#include <list>
+#include <set>
+#include <vector>
+
+#if defined(__NATRON_UNIX__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#include <QtCore/QMutex>
+#include <QtCore/QThreadPool>
+#include <QtCore/QRunnable>
+#include <QtCore/QFile>
+
+#include "Global/GlobalDefines.h"
+
+NATRON_NAMESPACE_ENTER
+
+struct FilePrefetcherPrivate
+{
+    // Protects all fields below except the thread pool
+    QMutex lock;
+
+    // Recently prefetched or queued files, most recent last
+    std::list<std::string> history;
+    std::set<std::string> knownFiles;
+
+    // Incremented by clear() so that pending tasks know they were cancelled
+    U64 generation;
+
+    QThreadPool pool;
+
+    FilePrefetcherPrivate()
+        : lock()
+        , history()
+        , knownFiles()
+        , generation(0)
+        , pool()
+    {
+        pool.setMaxThreadCount(NATRON_FILE_PREFETCHER_N_THREADS);
+        // Prefetching threads are idle most of the time, do not keep them around
+        pool.setExpiryTimeout(5000);
+    }
+
+    bool isCancelled(U64 taskGeneration)
+    {
+        QMutexLocker k(&lock);
+
+        return taskGeneration != generation;
+    }
+};
+
+class FilePrefetchTask
+    : public QRunnable
+{
+    FilePrefetcherPrivate* _imp;
+    std::string _filePath;
+    bool _readFully;
+    U64 _generation;
+
+public:
+
+    FilePrefetchTask(FilePrefetcherPrivate* imp,
+                     const std::string& filePath,
+                     bool readFully,
+                     U64 generation)
+        : QRunnable()
+        , _imp(imp)
+        , _filePath(filePath)
+        , _readFully(readFully)
+        , _generation(generation)
+    {
+        setAutoDelete(true);
+    }
+
+    virtual ~FilePrefetchTask()
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        if ( _imp->isCancelled(_generation) ) {
+            return;
+        }
+#if defined(__NATRON_UNIX__)
+        int fd = ::open(_filePath.c_str(), O_RDONLY);
+        if (fd == -1) {
+            return;
+        }
+        // Let the kernel start fetching the file in the background
+#if defined(POSIX_FADV_WILLNEED)
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+        if (!_readFully) {
+#if defined(__NATRON_LINUX__)
+            struct stat st;
+            if (::fstat(fd, &st) == 0) {
+                ::readahead(fd, 0, (size_t)st.st_size);
+            }
+#endif
+        } else {
+            // Some network file systems ignore the hints above: read the file through a bounded buffer
+            std::vector<char> buffer(NATRON_FILE_PREFETCHER_BUFFER_SIZE);
+            for (;;) {
+                ssize_t n = ::read(fd, &buffer.front(), buffer.size());
+                if ( (n <= 0) || _imp->isCancelled(_generation) ) {
+                    break;
+                }
+            }
+        }
+        ::close(fd);
+#else
+        if (_readFully) {
+            QFile file( QString::fromUtf8( _filePath.c_str() ) );
+            if ( file.open(QIODevice::ReadOnly) ) {
+                std::vector<char> buffer(NATRON_FILE_PREFETCHER_BUFFER_SIZE);
+                while ( file.read( &buffer.front(), (qint64)buffer.size() ) > 0 ) {
+                    if ( _imp->isCancelled(_generation) ) {
+                        break;
+                    }
+                }
+            }
+        }
+#endif
+    } // run
+};
+
+FilePrefetcher::FilePrefetcher()
+    : _imp( new FilePrefetcherPrivate() )
+{
+}
+
+FilePrefetcher::~FilePrefetcher()
+{
+    clear();
+    _imp->pool.waitForDone();
+}
+
+void
+FilePrefetcher::prefetchFiles(const std::vector<std::string>& files,
+                              bool readFully)
+{
+    QMutexLocker k(&_imp->lock);
+
+    for (std::vector<std::string>::const_iterator it = files.begin(); it != files.end(); ++it) {
+        if ( it->empty() || !_imp->knownFiles.insert(*it).second ) {
+            continue;
+        }
+        _imp->history.push_back(*it);
+        while ( (int)_imp->history.size() > NATRON_FILE_PREFETCHER_HISTORY_SIZE ) {
+            _imp->knownFiles.erase( _imp->history.front() );
+            _imp->history.pop_front();
+        }
+        _imp->pool.start( new FilePrefetchTask(_imp.get(), *it, readFully, _imp->generation) );
+    }
+}
+
+void
+FilePrefetcher::clear()
+{
+    QMutexLocker k(&_imp->lock);
+
+    ++_imp->generation;
+    _imp->history.clear();
+    _imp->knownFiles.clear();
+}
+
+void
+FilePrefetcher::forgetPrefetchedFiles()
+{
+    QMutexLocker k(&_imp->lock);
+
+    _imp->history.clear();
+    _imp->knownFiles.clear();
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,96 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_FILEPREFETCHER_H
+#define NATRON_ENGINE_FILEPREFETCHER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Engine/EngineFwd.h"
+
+// Number of threads dedicated to prefetching files. They mostly wait on I/O.
+#define NATRON_FILE_PREFETCHER_N_THREADS 2
+
+// Size of the buffer used by each prefetching thread when reading files fully.
+// The memory used by the prefetcher is thus bounded to NATRON_FILE_PREFETCHER_N_THREADS * NATRON_FILE_PREFETCHER_BUFFER_SIZE.
+#define NATRON_FILE_PREFETCHER_BUFFER_SIZE (4 * 1024 * 1024)
+
+// Number of recently prefetched files remembered so that they are not prefetched again
+#define NATRON_FILE_PREFETCHER_HISTORY_SIZE 512
+
+NATRON_NAMESPACE_ENTER
+
+struct FilePrefetcherPrivate;
+
+/**
+ * @brief Warms up the operating system page cache with files that are about to be read by reader plug-ins,
+ * e.g: the next frames of an image sequence during playback.
+ * Requests are processed asynchronously on a small thread pool dedicated to I/O so that render threads never wait on it.
+ * Each file is either hinted to the kernel (posix_fadvise(POSIX_FADV_WILLNEED) and readahead() on Linux), which is cheap
+ * but may be ignored by some network file systems, or read fully through a bounded buffer which forces its pages in the cache.
+ *
+ * This class is MT-safe.
+ **/
+class FilePrefetcher
+{
+public:
+
+    FilePrefetcher();
+
+    ~FilePrefetcher();
+
+    /**
+     * @brief Queues the given files for prefetching, in order. Files that were prefetched recently or that are already
+     * queued are ignored.
+     * @param readFully If true, the files are read entirely instead of only being hinted to the kernel.
+     **/
+    void prefetchFiles(const std::vector<std::string>& files, bool readFully);
+
+    /**
+     * @brief Cancels all pending requests and forgets about files prefetched so far.
+     **/
+    void clear();
+
+    /**
+     * @brief Forgets about the files prefetched so far without cancelling pending requests, so that they may be
+     * prefetched again, e.g: when playback loops back to the start of the sequence and the files may have been evicted.
+     **/
+    void forgetPrefetchedFiles();
+
+private:
+
+    boost::scoped_ptr<FilePrefetcherPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_FILEPREFETCHER_H
@@ -26,10 +26,16 @@
 #include "FileSystemModel.h"
 
 #include <vector>
+#include <list>
+#include <algorithm> // sort, reverse, min, max
 #include <cassert>
 #include <stdexcept>
 
 #include <boost/make_shared.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #ifdef __NATRON_WIN32__
 #include <windows.h>
@@ -49,11 +55,17 @@ CLANG_DIAG_OFF(uninitialized)
 #include <QtCore/QDebug>
 #include <QtCore/QUrl>
 #include <QtCore/QMimeData>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QThreadPool>
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
 #include <SequenceParsing.h>
 
+#include "Engine/Timer.h"
+
 #ifdef DEBUG
 #include "Global/FloatingPointExceptions.h"
 #endif
@@ -100,6 +112,141 @@ getSplitPath(const QString& path)
     return splitPath;
 }
 
+/////////Directory listings
+
+// Number of directory listings kept in the directoryListingCache
+#define NATRON_DIRECTORY_LISTING_CACHE_SIZE 16
+
+typedef boost::shared_ptr<SequenceParsing::FileNameContent> FileNameContentPtr;
+
+/**
+ * @brief The names of the entries of a directory, along with the attributes and the parsed names of those that were
+ * already gathered. The modification date of a directory does not change when one of its files is modified:
+ * the attributes kept here are only a starting point and must be fetched again before being used.
+ **/
+struct DirectoryListing
+{
+    // Last modification date of the directory when it was listed
+    QDateTime dirLastModified;
+    QDateTime listingDate;
+    QStringList names;
+    QSet<QString> dirNames;
+    QHash<QString, QFileInfo> infos;
+    QHash<QString, FileNameContentPtr> contents;
+};
+
+/**
+ * @brief The last directories that were listed, keyed on their path and the filters used to list them, most recently used first.
+ * This is MT-safe.
+ **/
+class DirectoryListingCache
+{
+    QMutex _lock;
+    std::list<std::pair<QString, DirectoryListing> > _listings;
+
+public:
+
+    DirectoryListingCache()
+        : _lock()
+        , _listings()
+    {
+    }
+
+    bool get(const QString& key,
+             DirectoryListing* listing)
+    {
+        QMutexLocker k(&_lock);
+
+        for (std::list<std::pair<QString, DirectoryListing> >::iterator it = _listings.begin(); it != _listings.end(); ++it) {
+            if (it->first == key) {
+                _listings.splice(_listings.begin(), _listings, it);
+                *listing = _listings.front().second;
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void insert(const QString& key,
+                const DirectoryListing& listing)
+    {
+        QMutexLocker k(&_lock);
+
+        for (std::list<std::pair<QString, DirectoryListing> >::iterator it = _listings.begin(); it != _listings.end(); ++it) {
+            if (it->first == key) {
+                _listings.erase(it);
+                break;
+            }
+        }
+        _listings.push_front( std::make_pair(key, listing) );
+        while ( (int)_listings.size() > NATRON_DIRECTORY_LISTING_CACHE_SIZE ) {
+            _listings.pop_back();
+        }
+    }
+};
+
+static DirectoryListingCache directoryListingCache;
+
+static QString
+getDirectoryListingKey(const QString& dirPath,
+                       QDir::Filters filters)
+{
+    return dirPath + QChar::fromLatin1('|') + QString::number( (int)filters );
+}
+
+/**
+ * @brief Lists the entries of the given directory. The listing of the directoryListingCache is returned as is if the directory
+ * was not modified since then. Otherwise the directory is listed again and what was known of the entries that were
+ * already in the cached listing is kept, so that only the names of new entries need to be parsed.
+ **/
+static void
+listDirectory(const QString& dirPath,
+              QDir::Filters filters,
+              DirectoryListing* listing)
+{
+    const QDateTime dirLastModified = QFileInfo(dirPath).lastModified();
+    DirectoryListing cached;
+    bool hasCached = directoryListingCache.get(getDirectoryListingKey(dirPath, filters), &cached);
+
+    // The modification date of a directory may have a resolution of a second on some file systems: a listing made
+    // in the same second as the last modification of the directory might miss entries added right after it.
+    if ( hasCached && (cached.dirLastModified == dirLastModified) && (cached.dirLastModified.secsTo(cached.listingDate) >= 2) ) {
+        *listing = cached;
+
+        return;
+    }
+
+    QDir dir(dirPath);
+    listing->dirLastModified = dirLastModified;
+    listing->listingDate = QDateTime::currentDateTime();
+    listing->names = dir.entryList(filters, QDir::Unsorted);
+    listing->dirNames.clear();
+    listing->infos.clear();
+    listing->contents.clear();
+    if (filters & QDir::Dirs) {
+        QDir::Filters dirFilters = filters;
+        dirFilters &= ~(QDir::Files | QDir::Drives);
+        QStringList dirNames = dir.entryList(dirFilters, QDir::Unsorted);
+        for (QStringList::const_iterator it = dirNames.begin(); it != dirNames.end(); ++it) {
+            listing->dirNames.insert(*it);
+        }
+    }
+    if (hasCached) {
+        for (QStringList::const_iterator it = listing->names.begin(); it != listing->names.end(); ++it) {
+            QHash<QString, QFileInfo>::const_iterator found = cached.infos.find(*it);
+            if ( found != cached.infos.end() ) {
+                listing->infos.insert( *it, found.value() );
+            }
+            QHash<QString, FileNameContentPtr>::const_iterator foundContent = cached.contents.find(*it);
+            if ( foundContent != cached.contents.end() ) {
+                listing->contents.insert( *it, foundContent.value() );
+            }
+        }
+    }
+} // listDirectory
+
 struct FileSystemModelPrivate
 {
     FileSystemModel* _publicInterface;
@@ -1249,6 +1396,7 @@ FileSystemModel::initGatherer()
         _imp->gatherer.reset( new FileGathererThread( shared_from_this() ) );
         assert(_imp->gatherer);
         QObject::connect( _imp->gatherer.get(), SIGNAL(directoryLoaded(QString)), this, SLOT(onDirectoryLoadedByGatherer(QString)) );
+        QObject::connect( _imp->gatherer.get(), SIGNAL(directoryPartiallyLoaded(QString)), this, SLOT(onDirectoryPartiallyLoadedByGatherer(QString)) );
     }
 }
 
@@ -1261,9 +1409,53 @@ FileSystemModelPrivate::populateItem(const FileSystemItemPtr &item)
     gatherer->fetchDirectory(item);
 }
 
+void
+FileSystemModel::applyGatheredChildren()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+    if (!_imp->gatherer) {
+        return;
+    }
+
+    std::list<std::pair<FileSystemItemPtr, FileSequences> > gathered;
+    _imp->gatherer->takeGatheredChildren(&gathered);
+
+    for (std::list<std::pair<FileSystemItemPtr, FileSequences> >::iterator it = gathered.begin(); it != gathered.end(); ++it) {
+        const FileSystemItemPtr& item = it->first;
+        QModelIndex idx = index(item.get(), 0);
+        if ( !idx.isValid() && (item != _imp->rootItem) ) {
+            ///The item is no longer in the model
+            continue;
+        }
+
+        ///Replace the children in the model so that the views do not hold indexes to destroyed items
+        int count = item->childCount();
+        if (count > 0) {
+            beginRemoveRows(idx, 0, count - 1);
+            item->clearChildren();
+            endRemoveRows();
+        }
+        if ( !it->second.empty() ) {
+            beginInsertRows(idx, 0, (int)it->second.size() - 1);
+            for (FileSequences::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+                item->addChild(it2->first, it2->second);
+            }
+            endInsertRows();
+        }
+    }
+}
+
+void
+FileSystemModel::onDirectoryPartiallyLoadedByGatherer(const QString& /*directory*/)
+{
+    applyGatheredChildren();
+}
+
 void
 FileSystemModel::onDirectoryLoadedByGatherer(const QString& directory)
 {
+    applyGatheredChildren();
+
     ///Get the item corresponding to the directory
     FileSystemItemPtr item = _imp->getItemFromPath(directory);
 
@@ -1287,6 +1479,14 @@ FileSystemModel::onWatchedDirectoryChanged(const QString& directory)
 {
     FileSystemItemPtr item = _imp->getItemFromPath(directory);
 
+    if ( item && (directory == _imp->currentRootPath) && QDir(directory).exists() ) {
+        ///Only list the directory again: the names of the entries that were already listed are not parsed again and
+        ///the current children are shown until the new ones are gathered
+        _imp->populateItem(item);
+
+        return;
+    }
+
     if (item) {
         if (directory == _imp->currentRootPath) {
             cleanAndRefreshItem(item);
@@ -1323,8 +1523,9 @@ FileSystemModel::onWatchedFileChanged(const QString& file)
     QFileInfo info(file);
     FileSystemItemPtr parent = _imp->getItemFromPath( info.absolutePath() );
 
+    ///The attributes of the files are fetched again by the gatherer: the current children are shown until then
     if (parent) {
-        cleanAndRefreshItem(parent);
+        _imp->populateItem(parent);
     }
 }
 
@@ -1381,6 +1582,10 @@ struct FileGathererThreadPrivate
     FileSystemItemPtr requestedItem, itemBeingFetched;
     QMutex requestedDirMutex;
 
+    ///Children gathered for each directory, waiting to be set on the items by the model on the main thread
+    std::list<std::pair<FileSystemItemPtr, FileSequences> > gatheredChildren;
+    QMutex gatheredChildrenMutex;
+
     FileGathererThreadPrivate(const FileSystemModelPtr& model)
         : model(model)
         , mustQuit(false)
@@ -1397,6 +1602,8 @@ struct FileGathererThreadPrivate
         , requestedItem()
         , itemBeingFetched()
         , requestedDirMutex()
+        , gatheredChildren()
+        , gatheredChildrenMutex()
     {
     }
 
@@ -1428,6 +1635,16 @@ struct FileGathererThreadPrivate
         return false;
     }
 
+    /**
+     * @brief Same as checkForAbort() but does not acknowledge the request, this can be called from any thread
+     **/
+    bool isAbortRequested() const
+    {
+        QMutexLocker k(&abortRequestsMutex);
+
+        return abortRequests > 0;
+    }
+
     FileSystemModelPtr getModel() const
     {
         return model.lock();
@@ -1574,26 +1791,196 @@ isVideoFileExtension(const std::string& ext)
     return false;
 }
 
-typedef std::list<std::pair<SequenceParsing::SequenceFromFilesPtr, QFileInfo > > FileSequences;
+// Number of entries of which attributes are fetched and that are grouped into sequences before checking
+// if the children gathered so far should be shown
+#define NATRON_FILE_GATHERER_BATCH_SIZE 4096
+
+// Time after which the children gathered so far are shown while gathering a large directory, in milliseconds.
+// It is doubled after each time they are shown since all children are set again on the item.
+#define NATRON_FILE_GATHERER_PUBLISH_INTERVAL_MS 250
+
+
+struct GatheredEntry
+{
+    QString name;
+    bool isDir;
+
+    // True once the attributes of the file were fetched in info
+    bool hasInfo;
+
+    // True if info comes from a previous listing and its attributes must be fetched again
+    bool infoOutdated;
+    QFileInfo info;
+
+    // Only for files, in sequence mode
+    FileNameContentPtr content;
+
+    GatheredEntry()
+        : name()
+        , isDir(false)
+        , hasInfo(false)
+        , infoOutdated(false)
+        , info()
+        , content()
+    {
+    }
+};
+
+typedef std::vector<GatheredEntry> GatheredEntries;
+
+struct GatheredEntriesRange
+{
+    GatheredEntries* entries;
+    std::size_t begin, end;
+};
+
+static QString
+getFileNameSuffix(const QString& filename)
+{
+    int lastDotPos = filename.lastIndexOf( QChar::fromLatin1('.') );
+
+    return lastDotPos == -1 ? QString() : filename.mid(lastDotPos + 1);
+}
+
+/**
+ * @brief Orders entries the same way QDir does with the QDir::DirsFirst and QDir::IgnoreCase flags
+ **/
+class GatheredEntryCompare
+{
+    FileSystemModel::Sections _section;
+
+public:
+
+    GatheredEntryCompare(FileSystemModel::Sections section)
+        : _section(section)
+    {
+    }
+
+    bool operator()(const GatheredEntry& a,
+                    const GatheredEntry& b) const
+    {
+        if (a.isDir != b.isDir) {
+            return a.isDir;
+        }
+        int r = 0;
+        switch (_section) {
+        case FileSystemModel::Size: {
+            // Largest first
+            qint64 sa = a.info.size();
+            qint64 sb = b.info.size();
+            r = sa > sb ? -1 : (sa < sb ? 1 : 0);
+            break;
+        }
+        case FileSystemModel::DateModified: {
+            // Most recent first
+            QDateTime da = a.info.lastModified();
+            QDateTime db = b.info.lastModified();
+            r = da > db ? -1 : (da < db ? 1 : 0);
+            break;
+        }
+        case FileSystemModel::Type:
+            r = QString::compare(getFileNameSuffix(a.name), getFileNameSuffix(b.name), Qt::CaseInsensitive);
+            break;
+        default:
+            break;
+        }
+        if (r == 0) {
+            r = QString::compare(a.name, b.name, Qt::CaseInsensitive);
+        }
+
+        return r < 0;
+    }
+};
+
+/**
+ * @brief Fetches the attributes of the entries in the given range and parses the file names, this is called
+ * concurrently on distinct ranges.
+ **/
+static void
+prepareGatheredEntries(const FileGathererThreadPrivate* imp,
+                       const QString& dirPath,
+                       bool parseFileNames,
+                       GatheredEntriesRange& range)
+{
+    QString prefix = dirPath;
+
+    if ( !prefix.endsWith( QChar::fromLatin1('/') ) ) {
+        prefix.append( QChar::fromLatin1('/') );
+    }
+    for (std::size_t i = range.begin; i < range.end; ++i) {
+        if ( ( (i - range.begin) % 64 == 0 ) && imp->isAbortRequested() ) {
+            return;
+        }
+        GatheredEntry& entry = (*range.entries)[i];
+        QString absoluteFilePath = prefix + entry.name;
+        if (!entry.hasInfo || entry.infoOutdated) {
+            if (entry.infoOutdated) {
+                entry.info.refresh();
+            } else {
+                entry.info = QFileInfo(absoluteFilePath);
+            }
+            // Fetch the attributes now, this is what is expensive on network file systems
+            entry.info.size();
+            entry.info.lastModified();
+            entry.hasInfo = true;
+            entry.infoOutdated = false;
+        }
+        if ( parseFileNames && !entry.isDir && !entry.content ) {
+            entry.content = boost::make_shared<SequenceParsing::FileNameContent>( absoluteFilePath.toStdString() );
+        }
+    }
+}
+
+static void
+prepareGatheredEntriesInParallel(const FileGathererThreadPrivate* imp,
+                                 const QString& dirPath,
+                                 bool parseFileNames,
+                                 GatheredEntries& entries,
+                                 std::size_t begin,
+                                 std::size_t end)
+{
+    if (begin >= end) {
+        return;
+    }
+    std::size_t nThreads = (std::size_t)std::max(1, QThreadPool::globalInstance()->maxThreadCount());
+    std::size_t rangeSize = std::max( (std::size_t)64, (end - begin + nThreads - 1) / nThreads );
+    std::vector<GatheredEntriesRange> ranges;
+    for (std::size_t i = begin; i < end; i += rangeSize) {
+        GatheredEntriesRange range;
+        range.entries = &entries;
+        range.begin = i;
+        range.end = std::min(end, i + rangeSize);
+        ranges.push_back(range);
+    }
+    if (ranges.size() == 1) {
+        prepareGatheredEntries(imp, dirPath, parseFileNames, ranges.front());
+    } else {
+        QtConcurrent::blockingMap( ranges, boost::bind(&prepareGatheredEntries, imp, dirPath, parseFileNames, _1) );
+    }
+}
 
-#define KERNEL_INCR() \
-    switch (viewOrder) \
-    { \
-    case Qt::AscendingOrder: \
-        ++i; \
-        break; \
-    case Qt::DescendingOrder: \
-        --i; \
-        break; \
+/**
+ * @brief Returns a sequence made of the same files as a sequence being gathered, so that it can be read by
+ * the main thread while the original keeps being modified.
+ **/
+static SequenceParsing::SequenceFromFilesPtr
+copySequence(const std::vector<FileNameContentPtr>& files)
+{
+    assert( !files.empty() );
+    SequenceParsing::SequenceFromFilesPtr copy = boost::make_shared<SequenceParsing::SequenceFromFiles>(*files.front(), true);
+    for (std::size_t i = 1; i < files.size(); ++i) {
+        copy->tryInsertFile(*files[i], false);
     }
 
+    return copy;
+}
+
 void
 FileGathererThread::gatheringKernel(const FileSystemItemPtr& item)
 {
     if (!item) {
         return;
     }
-    QDir dir( item->absoluteFilePath() );
     FileSystemModelPtr model = _imp->getModel();
     if (!model) {
         return;
@@ -1601,80 +1988,96 @@ FileGathererThread::gatheringKernel(const FileSystemItemPtr& item)
 
     Qt::SortOrder viewOrder = model->sortIndicatorOrder();
     FileSystemModel::Sections sortSection = (FileSystemModel::Sections)model->sortIndicatorSection();
-    QDir::SortFlags sort;
-    switch (sortSection) {
-    case FileSystemModel::Name:
-        sort = QDir::Name;
-        break;
-    case FileSystemModel::Size:
-        sort = QDir::Size;
-        break;
-    case FileSystemModel::Type:
-        sort = QDir::Type;
-        break;
-    case FileSystemModel::DateModified:
-        sort = QDir::Time;
-        break;
-    default:
-        break;
-    }
-    sort |= QDir::IgnoreCase;
-    sort |= QDir::DirsFirst;
+    const QString dirPath = item->absoluteFilePath();
+    const QDir::Filters filters = model->filter();
+    const bool sequenceMode = model->isSequenceModeEnabled();
 
     ///All entries in the directory
-    QFileInfoList all = dir.entryInfoList(model->filter(), sort);
+    DirectoryListing listing;
+    listDirectory(dirPath, filters, &listing);
+
+    GatheredEntries entries( listing.names.size() );
+    for (int i = 0; i < listing.names.size(); ++i) {
+        GatheredEntry& entry = entries[i];
+        entry.name = listing.names[i];
+        entry.isDir = listing.dirNames.contains(entry.name);
+        QHash<QString, QFileInfo>::const_iterator found = listing.infos.find(entry.name);
+        if ( found != listing.infos.end() ) {
+            // The file may have been modified since it was listed
+            entry.info = found.value();
+            entry.hasInfo = true;
+            entry.infoOutdated = true;
+        }
+        QHash<QString, FileNameContentPtr>::const_iterator foundContent = listing.contents.find(entry.name);
+        if ( foundContent != listing.contents.end() ) {
+            entry.content = foundContent.value();
+        }
+    }
+
+    ///Sorting by size or date needs the attributes of all entries first, otherwise they are fetched batch by batch below
+    if ( (sortSection == FileSystemModel::Size) || (sortSection == FileSystemModel::DateModified) ) {
+        prepareGatheredEntriesInParallel(_imp.get(), dirPath, false, entries, 0, entries.size());
+        if ( _imp->checkForAbort() ) {
+            return;
+        }
+    }
+    std::sort( entries.begin(), entries.end(), GatheredEntryCompare(sortSection) );
+    if (viewOrder == Qt::DescendingOrder) {
+        std::reverse( entries.begin(), entries.end() );
+    }
 
     ///List of all possible file sequences in the directory or directories
     FileSequences sequences;
-    int start = 0;
-    int end = 0;
-    switch (viewOrder) {
-    case Qt::AscendingOrder:
-        start = 0;
-        end = all.size();
-        break;
-    case Qt::DescendingOrder:
-        start = all.size() - 1;
-        end = -1;
-        break;
-    }
 
-    int i = start;
-    while (i != end) {
+    ///The sequences of each file extension: a file is only matched against sequences with the same extension
+    std::map<std::string, std::vector<SequenceParsing::SequenceFromFilesPtr> > sequencesPerExtension;
+
+    ///The files inserted in each sequence, in order, to copy them when showing partial results
+    std::map<SequenceParsing::SequenceFromFiles*, std::vector<FileNameContentPtr> > sequencesFiles;
+
+    double publishInterval = NATRON_FILE_GATHERER_PUBLISH_INTERVAL_MS / 1000.;
+    double lastPublishTime = 0.;
+    TimeLapse gatheringTimer;
+    for (std::size_t batchStart = 0; batchStart < entries.size(); batchStart += NATRON_FILE_GATHERER_BATCH_SIZE) {
+        std::size_t batchEnd = std::min(entries.size(), batchStart + NATRON_FILE_GATHERER_BATCH_SIZE);
+
+        prepareGatheredEntriesInParallel(_imp.get(), dirPath, sequenceMode, entries, batchStart, batchEnd);
+
         ///If we must abort we do it now
         if ( _imp->checkForAbort() ) {
             return;
         }
 
-        if ( all[i].isDir() ) {
-            ///This is a directory
-            sequences.push_back( std::make_pair(SequenceParsing::SequenceFromFilesPtr(), all[i]) );
-        } else {
-            QString filename = all[i].fileName();
+        for (std::size_t i = batchStart; i < batchEnd; ++i) {
+            const GatheredEntry& entry = entries[i];
+            if (entry.isDir) {
+                ///This is a directory
+                sequences.push_back( std::make_pair(SequenceParsing::SequenceFromFilesPtr(), entry.info) );
+                continue;
+            }
+
             /// If the item does not match the filter regexp set by the user, discard it
-            if ( !model->isAcceptedByRegexps(filename) ) {
-                KERNEL_INCR();
+            if ( !model->isAcceptedByRegexps(entry.name) ) {
                 continue;
             }
 
             /// If file sequence fetching is disabled, accept it
-            if ( !model->isSequenceModeEnabled() ) {
-                sequences.push_back( std::make_pair(SequenceParsing::SequenceFromFilesPtr(), all[i]) );
-                KERNEL_INCR();
+            if (!sequenceMode) {
+                sequences.push_back( std::make_pair(SequenceParsing::SequenceFromFilesPtr(), entry.info) );
                 continue;
             }
 
-            std::string absoluteFilePath = generateChildAbsoluteName(item.get(), filename).toStdString();
-            bool foundMatchingSequence = false;
-
             /// If we reach here, this is a valid file and we need to determine if it belongs to another sequence or we need
             /// to create a new one
-            SequenceParsing::FileNameContent fileContent(absoluteFilePath);
-
+            assert(entry.content);
+            const SequenceParsing::FileNameContent& fileContent = *entry.content;
+            std::vector<SequenceParsing::SequenceFromFilesPtr>& candidates = sequencesPerExtension[fileContent.getExtension()];
+            bool foundMatchingSequence = false;
             if ( !isVideoFileExtension( fileContent.getExtension() ) ) {
                 ///Note that we use a reverse iterator because we have more chance to find a match in the last recently added entries
-                for (FileSequences::reverse_iterator it = sequences.rbegin(); it != sequences.rend(); ++it) {
-                    if ( it->first && it->first->tryInsertFile(fileContent, false) ) {
+                for (std::vector<SequenceParsing::SequenceFromFilesPtr>::reverse_iterator it = candidates.rbegin(); it != candidates.rend(); ++it) {
+                    if ( (*it)->tryInsertFile(fileContent, false) ) {
+                        sequencesFiles[it->get()].push_back(entry.content);
                         foundMatchingSequence = true;
                         break;
                     }
@@ -1683,20 +2086,71 @@ FileGathererThread::gatheringKernel(const FileSystemItemPtr& item)
 
             if (!foundMatchingSequence) {
                 SequenceParsing::SequenceFromFilesPtr newSequence = boost::make_shared<SequenceParsing::SequenceFromFiles>(fileContent, true);
-                sequences.push_back( std::make_pair(newSequence, all[i]) );
+                candidates.push_back(newSequence);
+                sequencesFiles[newSequence.get()].push_back(entry.content);
+                sequences.push_back( std::make_pair(newSequence, entry.info) );
+            }
+        }
+
+        ///Show what was gathered so far when the directory is large
+        if ( (batchEnd < entries.size()) && (gatheringTimer.getTimeSinceCreation() - lastPublishTime >= publishInterval) ) {
+            FileSequences gatheredSoFar;
+            for (FileSequences::const_iterator it = sequences.begin(); it != sequences.end(); ++it) {
+                SequenceParsing::SequenceFromFilesPtr sequence = it->first ? copySequence(sequencesFiles[it->first.get()]) : it->first;
+                gatheredSoFar.push_back( std::make_pair(sequence, it->second) );
             }
+            publishChildren(item, gatheredSoFar, false);
+            lastPublishTime = gatheringTimer.getTimeSinceCreation();
+            publishInterval *= 2;
         }
-        KERNEL_INCR();
     }
 
-    ///Now iterate through the sequences and create the children as necessary
-    for (FileSequences::iterator it = sequences.begin(); it != sequences.end(); ++it) {
-        item->addChild(it->first, it->second);
+    ///Remember the entries so that their names are not parsed again
+    for (GatheredEntries::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        if (it->hasInfo) {
+            listing.infos.insert(it->name, it->info);
+        }
+        if (it->content) {
+            listing.contents.insert(it->name, it->content);
+        }
     }
+    directoryListingCache.insert(getDirectoryListingKey(dirPath, filters), listing);
 
-    Q_EMIT directoryLoaded( item->absoluteFilePath() );
+    publishChildren(item, sequences, true);
 } // FileGathererThread::gatheringKernel
 
+void
+FileGathererThread::publishChildren(const FileSystemItemPtr& item,
+                                    const FileSequences& children,
+                                    bool finished)
+{
+    {
+        QMutexLocker k(&_imp->gatheredChildrenMutex);
+        ///Only the last children gathered for an item are relevant
+        for (std::list<std::pair<FileSystemItemPtr, FileSequences> >::iterator it = _imp->gatheredChildren.begin(); it != _imp->gatheredChildren.end(); ++it) {
+            if (it->first == item) {
+                _imp->gatheredChildren.erase(it);
+                break;
+            }
+        }
+        _imp->gatheredChildren.push_back( std::make_pair(item, children) );
+    }
+
+    if (finished) {
+        Q_EMIT directoryLoaded( item->absoluteFilePath() );
+    } else {
+        Q_EMIT directoryPartiallyLoaded( item->absoluteFilePath() );
+    }
+}
+
+void
+FileGathererThread::takeGatheredChildren(std::list<std::pair<FileSystemItemPtr, FileSequences> >* gathered)
+{
+    QMutexLocker k(&_imp->gatheredChildrenMutex);
+
+    gathered->swap(_imp->gatheredChildren);
+}
+
 void
 FileGathererThread::fetchDirectory(const FileSystemItemPtr& item)
 {
@@ -1721,15 +2175,21 @@ FileSystemModel::filesListFromPattern(const std::string& pattern, SequenceParsin
     std::string patternCpy = pattern;
     std::string patternPath = SequenceParsing::removePath(patternCpy);
 
-    QDir dir(QString::fromUtf8(patternPath.c_str()));
+    QString dirPath = QString::fromUtf8( patternPath.c_str() );
+    QDir dir(dirPath);
     if (!dir.exists()) {
         return false;
     }
 
-    QStringList files = dir.entryList(QDir::Files | QDir::NoDotAndDotDot);
+    ///Patterns are expanded often for the same directories: reuse the listing while the directory is not modified
+    const QDir::Filters filters = QDir::Files | QDir::NoDotAndDotDot;
+    DirectoryListing listing;
+    listDirectory(dirPath, filters, &listing);
+    directoryListingCache.insert(getDirectoryListingKey(dirPath, filters), listing);
+    const QStringList& files = listing.names;
 
     SequenceParsing::StringList filesList;
-    for (QStringList::iterator it = files.begin(); it!=files.end(); ++it) {
+    for (QStringList::const_iterator it = files.begin(); it!=files.end(); ++it) {
         filesList.push_back(it->toStdString());
     }
     return SequenceParsing::filesListFromPattern_fast(pattern, filesList, sequence);
@@ -29,6 +29,7 @@
 #include "Global/Macros.h"
 
 #include <map>
+#include <list>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
@@ -140,6 +141,11 @@ private:
     boost::scoped_ptr<FileSystemItemPrivate> _imp;
 };
 
+/**
+ * @brief The children of a directory: a null sequence designates a directory or a file that is not part of a sequence
+ **/
+typedef std::list<std::pair<SequenceParsing::SequenceFromFilesPtr, QFileInfo> > FileSequences;
+
 class FileSystemModel;
 struct FileGathererThreadPrivate;
 class FileGathererThread
@@ -162,8 +168,20 @@ public:
     void fetchDirectory(const FileSystemItemPtr& item);
 
     bool isWorking() const;
+
+    /**
+     * @brief Returns the children gathered for each directory since the last call, so that the model
+     * can set them on the items from the main thread.
+     **/
+    void takeGatheredChildren(std::list<std::pair<FileSystemItemPtr, FileSequences> >* gathered);
+
 Q_SIGNALS:
 
+    /**
+     * @brief Emitted while a large directory is being gathered, when children gathered so far are available
+     **/
+    void directoryPartiallyLoaded(QString);
+
     void directoryLoaded(QString);
 
 private:
@@ -172,6 +190,8 @@ private:
 
     void gatheringKernel(const FileSystemItemPtr& item);
 
+    void publishChildren(const FileSystemItemPtr& item, const FileSequences& children, bool finished);
+
     boost::scoped_ptr<FileGathererThreadPrivate> _imp;
 };
 
@@ -333,6 +353,8 @@ public Q_SLOTS:
 
     void onDirectoryLoadedByGatherer(const QString& directory);
 
+    void onDirectoryPartiallyLoadedByGatherer(const QString& directory);
+
     void onWatchedDirectoryChanged(const QString& directory);
 
     void onWatchedFileChanged(const QString& file);
@@ -355,6 +377,8 @@ private:
 
     void cleanAndRefreshItem(const FileSystemItemPtr& item);
 
+    void applyGatheredChildren();
+
     friend class FileSystemItem;
 
     boost::scoped_ptr<FileSystemModelPrivate> _imp;
@@ -29,6 +29,8 @@
 #include <cassert>
 #include <cstring> // for std::memcpy, std::memset
 #include <stdexcept>
+#include <utility> // pair
+#include <vector>
 
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
@@ -43,6 +45,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/GPUContextPool.h"
 #include "Engine/OSGLContext.h"
 #include "Engine/GLShader.h"
+#include "Engine/NumaTopology.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -686,6 +689,11 @@ Image::Image(const ImageKey & key,
              const CacheAPI* cache)
     : CacheEntryHelper<unsigned char, ImageKey, ImageParams>(key, params, cache)
     , _useBitmap(true)
+    , _viewSource()
+    , _viewOffsetX(0)
+    , _viewOffsetY(0)
+    , _viewsLock()
+    , _views()
 {
     _bitDepth = params->getBitDepth();
     _depthBytesSize = getSizeOfForBitDepth(_bitDepth);
@@ -701,6 +709,11 @@ Image::Image(const ImageKey & key,
              const ImageParamsPtr& params)
     : CacheEntryHelper<unsigned char, ImageKey, ImageParams>( key, params, NULL )
     , _useBitmap(false)
+    , _viewSource()
+    , _viewOffsetX(0)
+    , _viewOffsetY(0)
+    , _viewsLock()
+    , _views()
 {
     _bitDepth = params->getBitDepth();
     _depthBytesSize = getSizeOfForBitDepth(_bitDepth);
@@ -730,6 +743,11 @@ Image::Image(const ImagePlaneDesc& components,
              U32 textureTarget)
     : CacheEntryHelper<unsigned char, ImageKey, ImageParams>()
     , _useBitmap(useBitmap)
+    , _viewSource()
+    , _viewOffsetX(0)
+    , _viewOffsetY(0)
+    , _viewsLock()
+    , _views()
 {
     setCacheEntry(makeKey(0, 0, false, 0, ViewIdx(0), false, false),
 #ifdef BOOST_NO_CXX11_VARIADIC_TEMPLATES
@@ -772,11 +790,118 @@ Image::Image(const ImagePlaneDesc& components,
     allocateMemory();
 }
 
+Image::Image(const ImagePtr& source,
+             int dx,
+             int dy,
+             const RectD & regionOfDefinition)
+    : CacheEntryHelper<unsigned char, ImageKey, ImageParams>()
+    , _useBitmap(false)
+    , _viewSource(source)
+    , _viewOffsetX(dx)
+    , _viewOffsetY(dy)
+    , _viewsLock()
+    , _views()
+{
+    assert(source && source->getStorageMode() == eStorageModeRAM);
+
+    // Views of views read the image owning the buffer directly
+    if (source->_viewSource) {
+        _viewSource = source->_viewSource;
+        _viewOffsetX += source->_viewOffsetX;
+        _viewOffsetY += source->_viewOffsetY;
+    }
+
+    RectI bounds = source->getBounds();
+    bounds.translate(dx, dy);
+
+    setCacheEntry(makeKey(0, 0, false, 0, ViewIdx(0), false, false),
+#ifdef BOOST_NO_CXX11_VARIADIC_TEMPLATES
+                  ImageParamsPtr( new ImageParams(regionOfDefinition,
+                                                  source->getPixelAspectRatio(),
+                                                  source->getMipMapLevel(),
+                                                  bounds,
+                                                  source->getBitDepth(),
+                                                  source->getFieldingOrder(),
+                                                  source->getPremultiplication(),
+                                                  false /*isRoDProjectFormat*/,
+                                                  source->getComponents(),
+                                                  eStorageModeRAM,
+                                                  GL_TEXTURE_2D) ),
+#else
+                  boost::make_shared<ImageParams>(regionOfDefinition,
+                                                  source->getPixelAspectRatio(),
+                                                  source->getMipMapLevel(),
+                                                  bounds,
+                                                  source->getBitDepth(),
+                                                  source->getFieldingOrder(),
+                                                  source->getPremultiplication(),
+                                                  false /*isRoDProjectFormat*/,
+                                                  source->getComponents(),
+                                                  eStorageModeRAM,
+                                                  GL_TEXTURE_2D),
+#endif
+                  NULL /*cacheAPI*/
+                  );
+
+    _bitDepth = source->getBitDepth();
+    _depthBytesSize = getSizeOfForBitDepth(_bitDepth);
+    _nbComponents = source->getComponentsCount();
+    _rod = regionOfDefinition;
+    _bounds = bounds;
+    _par = source->getPixelAspectRatio();
+    _premult = source->getPremultiplication();
+    _fielding = source->getFieldingOrder();
+
+    // No memory is allocated: pixelAt() reads the buffer of the source
+}
+
 Image::~Image()
 {
     deallocate();
 }
 
+void
+Image::updateViewsBounds()
+{
+    QMutexLocker k(&_viewsLock);
+    for (std::list<ImageWPtr>::iterator it = _views.begin(); it != _views.end();) {
+        ImagePtr view = it->lock();
+        if (!view) {
+            it = _views.erase(it);
+            continue;
+        }
+        RectI bounds = _bounds;
+        bounds.translate(view->_viewOffsetX, view->_viewOffsetY);
+        {
+            QWriteLocker viewLocker(&view->_entryLock);
+            view->_bounds = bounds;
+            view->_params->setBounds(bounds);
+        }
+        ++it;
+    }
+}
+
+ImagePtr
+Image::makeTranslatedView(const ImagePtr& source,
+                          int dx,
+                          int dy,
+                          const RectD & regionOfDefinition)
+{
+    assert(source);
+    Image* owner = source->_viewSource ? source->_viewSource.get() : source.get();
+
+    // The bounds of the view are computed from the bounds of its owner: prevent ensureBounds() from resizing it
+    // until the view is registered
+    QReadLocker ownerLocker(&owner->_entryLock);
+    ImagePtr view( new Image(source, dx, dy, regionOfDefinition) );
+    {
+        QMutexLocker k(&owner->_viewsLock);
+        owner->_views.push_back(view);
+    }
+
+    return view;
+}
+
 void
 Image::onMemoryAllocated(bool diskRestoration)
 {
@@ -1152,6 +1277,11 @@ Image::ensureBounds(const RectI& newBounds,
     if ( getBounds().contains(newBounds) ) {
         return false;
     }
+    // Views do not own their buffer, use copyAndResizeIfNeeded() instead
+    assert(!_viewSource);
+    if (_viewSource) {
+        return false;
+    }
 
     QWriteLocker k(&_entryLock);
     RectI merge = newBounds;
@@ -1169,6 +1299,7 @@ Image::ensureBounds(const RectI& newBounds,
     if ( usesBitMap() ) {
         _bitmap.swap(tmpImg->_bitmap);
     }
+    updateViewsBounds();
 
     return true;
 }
@@ -1627,6 +1758,9 @@ Image::pixelAt(int x,
     if ( ( x < _bounds.x1 ) || ( x >= _bounds.x2 ) || ( y < _bounds.y1 ) || ( y >= _bounds.y2 ) ) {
         return NULL;
     } else {
+        if (_viewSource) {
+            return _viewSource->pixelAt(x - _viewOffsetX, y - _viewOffsetY);
+        }
         unsigned char* ret =  (unsigned char*)this->_data.writable();
         if (!ret) {
             return 0;
@@ -1639,6 +1773,32 @@ Image::pixelAt(int x,
     }
 }
 
+void
+Image::getNumaPlacement(const RectI& rect,
+                        NumaPlacementMap* placement) const
+{
+    const Image* storage = _viewSource ? _viewSource.get() : this;
+
+    if (storage->getStorageMode() != eStorageModeRAM) {
+        return;
+    }
+    RectI area;
+    if ( !rect.intersect(_bounds, &area) ) {
+        return;
+    }
+    const std::size_t rowBytes = (std::size_t)area.width() * _nbComponents * _depthBytesSize;
+    std::vector<std::pair<const void*, std::size_t> > rows;
+    rows.reserve( area.height() );
+    for (int y = area.y1; y < area.y2; ++y) {
+        const unsigned char* row = pixelAt(area.x1, y);
+        if (!row) {
+            return;
+        }
+        rows.push_back( std::make_pair( (const void*)row, rowBytes ) );
+    }
+    NumaTopology::getMemoryPlacement(rows, placement);
+}
+
 unsigned char*
 Image::pixelAtStatic(int x,
                      int y,
@@ -1669,6 +1829,9 @@ Image::pixelAt(int x,
     if ( ( x < _bounds.x1 ) || ( x >= _bounds.x2 ) || ( y < _bounds.y1 ) || ( y >= _bounds.y2 ) ) {
         return NULL;
     } else {
+        if (_viewSource) {
+            return _viewSource->pixelAt(x - _viewOffsetX, y - _viewOffsetY);
+        }
         unsigned char* ret = (unsigned char*)this->_data.readable();
         if (!ret) {
             return 0;
@@ -1808,6 +1971,16 @@ Image::getRowElements() const
     return getComponentsCount() * _bounds.width();
 }
 
+std::size_t
+Image::getRowBytes() const
+{
+    if (_viewSource) {
+        return _viewSource->getRowBytes();
+    }
+
+    return (std::size_t)getRowElements() * _depthBytesSize;
+}
+
 // code proofread and fixed by @devernay on 4/12/2014
 template <typename PIX, int maxValue>
 void
@@ -38,8 +38,13 @@
 CLANG_DIAG_OFF(deprecated)
 #include <QtCore/QHash>
 CLANG_DIAG_ON(deprecated)
+#include <QtCore/QMutex>
 #include <QtCore/QReadWriteLock>
 
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/weak_ptr.hpp>
+#endif
+
 #include "Engine/ImageKey.h"
 #include "Engine/ImagePlaneDesc.h"
 #include "Engine/ImageParams.h"
@@ -202,9 +207,35 @@ public:
     Image(const ImageKey & key,
           const ImageParamsPtr& params);
 
+private:
+
+    // Constructs a view on source, see makeTranslatedView()
+    Image(const ImagePtr& source,
+          int dx,
+          int dy,
+          const RectD & regionOfDefinition);
+
+public:
 
     virtual ~Image();
 
+    /**
+     * @brief Returns an image whose pixels are the pixels of source translated by (dx,dy) pixels, without copying them:
+     * the view reads the buffer of source and keeps source alive.
+     * A view is meant to be read: taking its write lock takes the write lock of source, since writing through the view
+     * writes to the buffer of source. It is never inserted in the cache.
+     * @param regionOfDefinition The region of definition of the view, in canonical coordinates.
+     **/
+    static ImagePtr makeTranslatedView(const ImagePtr& source, int dx, int dy, const RectD & regionOfDefinition);
+
+    /**
+     * @brief Returns true if this image does not own its buffer but shares the buffer of another image (see makeTranslatedView())
+     **/
+    bool isView() const
+    {
+        return _viewSource.get() != 0;
+    }
+
     bool usesBitMap() const { return _useBitmap; }
 
     StorageModeEnum getStorageMode() const
@@ -212,6 +243,12 @@ public:
         return _params->getStorageInfo().mode;
     }
 
+    /**
+     * @brief Adds to placement the number of bytes of the portion rect of the image held by each NUMA node, as placed
+     * by the kernel. Does nothing if the image is not stored in RAM.
+     **/
+    void getNumaPlacement(const RectI& rect, NumaPlacementMap* placement) const;
+
     virtual void onMemoryAllocated(bool diskRestoration) OVERRIDE FINAL;
     static ImageKey makeKey(const CacheEntryHolder* holder,
                             U64 nodeHashKey,
@@ -361,6 +398,12 @@ public:
      **/
     unsigned int getRowElements() const;
 
+    /**
+     * @brief Returns the number of bytes between the start of two consecutive rows of the buffer.
+     * For a view, this is the row size of the image owning the buffer.
+     **/
+    std::size_t getRowBytes() const;
+
 
     /**
      * @brief Lock the image for reading, while this object is living, the image buffer can't be written to.
@@ -533,19 +576,40 @@ private:
      **/
     void lockForRead() const
     {
+        // The bounds of a view only change while the write lock of its source is taken, see ensureBounds()
+        if (_viewSource) {
+            _viewSource->lockForRead();
+        }
         _entryLock.lockForRead();
     }
 
     void lockForWrite() const
     {
+        // Writing through a view writes to the buffer of its source
+        if (_viewSource) {
+            _viewSource->lockForWrite();
+        }
         _entryLock.lockForWrite();
     }
 
     void unlock() const
     {
         _entryLock.unlock();
+        if (_viewSource) {
+            _viewSource->unlock();
+        }
     }
 
+private:
+
+    /**
+     * @brief Makes the bounds of the views on this image follow the bounds of this image, so that their rows keep
+     * the same length. Must be called with the write lock of this image taken: no thread holds the lock of a view meanwhile.
+     **/
+    void updateViewsBounds();
+
+public:
+
     template <typename SRCPIX, typename DSTPIX, int srcMaxValue, int dstMaxValue>
     static void convertToFormatInternal_sameComps(const RectI & renderWindow,
                                                   const Image & srcImg,
@@ -1037,6 +1101,14 @@ private:
     ImagePremultiplicationEnum _premult;
     bool _useBitmap;
     int _nbComponents;
+
+    // If this image is a view, the image owning the buffer and the offset of this image relative to it, in pixels
+    ImagePtr _viewSource;
+    int _viewOffsetX, _viewOffsetY;
+
+    // If this image owns its buffer, the views on it. Protected by _viewsLock
+    mutable QMutex _viewsLock;
+    std::list<ImageWPtr> _views;
 };
 
 //template <> inline unsigned char clamp(unsigned char v) { return v; }
@@ -773,6 +773,7 @@ KnobHelper::deleteValuesAtTime(CurveChangeReason curveChangeReason,
     if (_imp->holder) {
         _imp->holder->updateHasAnimation();
     }
+    refreshTimeDependency();
 
 
     ValueChangedReasonEnum reason = eValueChangedReasonNatronInternalEdited;
@@ -844,6 +845,7 @@ KnobHelper::deleteValueAtTime(CurveChangeReason curveChangeReason,
     if (_imp->holder) {
         _imp->holder->updateHasAnimation();
     }
+    refreshTimeDependency();
 
 
     ValueChangedReasonEnum reason = eValueChangedReasonNatronInternalEdited;
@@ -1179,6 +1181,7 @@ KnobHelper::cloneCurve(ViewSpec view,
     }
     animationRemoved_virtual(dimension);
     thisCurve->clone(curve);
+    refreshTimeDependency();
     if (!useGuiCurve) {
         evaluateValueChange(dimension, getCurrentTime(), view,  eValueChangedReasonNatronInternalEdited);
         guiCurveCloneInternalCurve(eCurveChangeReasonInternal, view, dimension, eValueChangedReasonNatronInternalEdited);
@@ -1424,6 +1427,7 @@ KnobHelper::removeAnimationWithReason(ViewSpec view,
     if (_imp->holder) {
         _imp->holder->updateHasAnimation();
     }
+    refreshTimeDependency();
 
 
     if (!useGuiCurve) {
@@ -1504,6 +1508,7 @@ KnobHelper::cloneGuiCurvesIfNeeded(std::map<int, ValueChangedReasonEnum>& modifi
     }
     if (hasChanged && _imp->holder) {
         _imp->holder->updateHasAnimation();
+        refreshTimeDependency();
     }
 }
 
@@ -2009,6 +2014,29 @@ KnobHelper::hasAnimation() const
     return false;
 }
 
+bool
+KnobHelper::isTimeDependent() const
+{
+    if ( evaluateValueChangeOnTimeChange() ) {
+        return true;
+    }
+    for (int i = 0; i < getDimension(); ++i) {
+        if ( getMaster(i).second || !getExpression(i).empty() || isAnimated( i, ViewIdx(0) ) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+KnobHelper::refreshTimeDependency()
+{
+    if (_imp->holder) {
+        _imp->holder->refreshKnobTimeDependency( this, isTimeDependent() );
+    }
+}
+
 static std::size_t
 getMatchingParenthesisPosition(std::size_t openingParenthesisPos,
                                char openingChar,
@@ -2876,6 +2904,7 @@ KnobHelper::expressionChanged(int dimension)
     if (_imp->holder) {
         _imp->holder->updateHasAnimation();
     }
+    refreshTimeDependency();
 
     if (_signalSlotHandler) {
         _signalSlotHandler->s_expressionChanged(dimension);
@@ -3573,6 +3602,7 @@ KnobHelper::slaveToInternal(int dimension,
     if (masterKnob) {
         masterKnob->addListener( false, dimension, otherDimension, shared_from_this() );
     }
+    refreshTimeDependency();
 
     return true;
 } // KnobHelper::slaveTo
@@ -3703,6 +3733,7 @@ KnobHelper::deleteAnimationConditional(double time,
     } else {
         curve->removeKeyFramesAfterTime(time, &keysRemoved);
     }
+    refreshTimeDependency();
 
     if (!useGuiCurve) {
         checkAnimationLevel(view, dimension);
@@ -3993,6 +4024,7 @@ KnobHelper::cloneOneCurve(KnobI* other,
         }
     }
     checkAnimationLevel(ViewIdx(0), dimension);
+    refreshTimeDependency();
 }
 
 void
@@ -4074,6 +4106,9 @@ KnobHelper::cloneOneCurveAndCheckIfChanged(KnobI* other,
     } else if (!updateGui) {
         checkAnimationLevel(ViewIdx(0), dimension);
     }
+    if (cloningCurveChanged) {
+        refreshTimeDependency();
+    }
 
     return cloningCurveChanged;
 } // KnobHelper::cloneOneCurveAndCheckIfChanged
@@ -4727,6 +4762,11 @@ struct KnobHolder::KnobHolderPrivate
     bool knobsFrozen;
     mutable QMutex hasAnimationMutex;
     bool hasAnimation;
+
+    // The knobs for which KnobI::isTimeDependent() returns true, the only ones refreshed when the time changes.
+    // Maintained by the knobs themselves when their animation, expressions or masters change.
+    mutable QMutex timeDependentKnobsMutex;
+    std::map<KnobI*, KnobIWPtr> timeDependentKnobs;
     DockablePanelI* settingsPanel;
 
     KnobHolderPrivate(const AppInstancePtr& appInstance_)
@@ -4752,11 +4792,42 @@ struct KnobHolder::KnobHolderPrivate
         , knobsFrozen(false)
         , hasAnimationMutex()
         , hasAnimation(false)
+        , timeDependentKnobsMutex()
+        , timeDependentKnobs()
         , settingsPanel(0)
 
     {
     }
 
+    void addTimeDependentKnob(const KnobIPtr& knob)
+    {
+        if ( knob->isTimeDependent() ) {
+            QMutexLocker k(&timeDependentKnobsMutex);
+            timeDependentKnobs[knob.get()] = knob;
+        }
+    }
+
+    void removeTimeDependentKnob(const KnobI* knob)
+    {
+        QMutexLocker k(&timeDependentKnobsMutex);
+
+        timeDependentKnobs.erase( const_cast<KnobI*>(knob) );
+    }
+
+    // Returns the time-dependent knobs that are still alive
+    void getTimeDependentKnobs(KnobsVec* knobs) const
+    {
+        QMutexLocker k(&timeDependentKnobsMutex);
+
+        knobs->reserve( timeDependentKnobs.size() );
+        for (std::map<KnobI*, KnobIWPtr>::const_iterator it = timeDependentKnobs.begin(); it != timeDependentKnobs.end(); ++it) {
+            KnobIPtr knob = it->second.lock();
+            if (knob) {
+                knobs->push_back(knob);
+            }
+        }
+    }
+
     KnobHolderPrivate(const KnobHolderPrivate& other)
     : app(other.app)
     , knobsMutex()
@@ -4780,6 +4851,8 @@ struct KnobHolder::KnobHolderPrivate
     , knobsFrozen(false)
     , hasAnimationMutex()
     , hasAnimation(other.hasAnimation)
+    , timeDependentKnobsMutex()
+    , timeDependentKnobs(other.timeDependentKnobs)
     , settingsPanel(other.settingsPanel)
     {
 
@@ -4880,6 +4953,7 @@ KnobHolder::addKnob(const KnobIPtr& k)
         }
     }
     _imp->knobs.push_back(k);
+    _imp->addTimeDependentKnob(k);
 }
 
 void
@@ -4902,11 +4976,14 @@ KnobHolder::insertKnob(int index,
         std::advance(it, index);
         _imp->knobs.insert(it, k);
     }
+    _imp->addTimeDependentKnob(k);
 }
 
 void
 KnobHolder::removeKnobFromList(const KnobI* knob)
 {
+    _imp->removeTimeDependentKnob(knob);
+
     QMutexLocker kk(&_imp->knobsMutex);
 
     for (KnobsVec::iterator it = _imp->knobs.begin(); it != _imp->knobs.end(); ++it) {
@@ -4987,6 +5064,7 @@ KnobHolder::deleteKnob(KnobI* knob,
             }
         }
     }
+    _imp->removeTimeDependentKnob(knob);
 
     if (alsoDeleteGui && _imp->settingsPanel) {
         _imp->settingsPanel->deleteKnobGui(sharedKnob);
@@ -5849,8 +5927,11 @@ KnobHolder::refreshAfterTimeChange(bool isPlayback,
     if ( !app || app->isGuiFrozen() ) {
         return;
     }
-    for (std::size_t i = 0; i < _imp->knobs.size(); ++i) {
-        _imp->knobs[i]->onTimeChanged(isPlayback, time);
+    // onTimeChanged() does nothing on the knobs that do not depend on the time
+    KnobsVec knobs;
+    _imp->getTimeDependentKnobs(&knobs);
+    for (std::size_t i = 0; i < knobs.size(); ++i) {
+        knobs[i]->onTimeChanged(isPlayback, time);
     }
     refreshExtraStateAfterTimeChanged(isPlayback, time);
 }
@@ -5859,11 +5940,45 @@ void
 KnobHolder::refreshAfterTimeChangeOnlyKnobsWithTimeEvaluation(double time)
 {
     assert( QThread::currentThread() == qApp->thread() );
-    for (std::size_t i = 0; i < _imp->knobs.size(); ++i) {
-        if ( _imp->knobs[i]->evaluateValueChangeOnTimeChange() ) {
-            _imp->knobs[i]->onTimeChanged(false, time);
+    KnobsVec knobs;
+    _imp->getTimeDependentKnobs(&knobs);
+    for (std::size_t i = 0; i < knobs.size(); ++i) {
+        if ( knobs[i]->evaluateValueChangeOnTimeChange() ) {
+            knobs[i]->onTimeChanged(false, time);
+        }
+    }
+}
+
+void
+KnobHolder::refreshKnobTimeDependency(KnobI* knob,
+                                      bool timeDependent)
+{
+    if (!timeDependent) {
+        _imp->removeTimeDependentKnob(knob);
+
+        return;
+    }
+    {
+        QMutexLocker k(&_imp->timeDependentKnobsMutex);
+        if ( _imp->timeDependentKnobs.find(knob) != _imp->timeDependentKnobs.end() ) {
+            return;
         }
     }
+    // The knob only becomes time-dependent once it is added to the holder, see addKnob()
+    KnobIPtr sharedKnob;
+    {
+        QMutexLocker k(&_imp->knobsMutex);
+        for (KnobsVec::const_iterator it = _imp->knobs.begin(); it != _imp->knobs.end(); ++it) {
+            if (it->get() == knob) {
+                sharedKnob = *it;
+                break;
+            }
+        }
+    }
+    if (sharedKnob) {
+        QMutexLocker k(&_imp->timeDependentKnobsMutex);
+        _imp->timeDependentKnobs[knob] = sharedKnob;
+    }
 }
 
 void
@@ -5874,9 +5989,11 @@ KnobHolder::refreshInstanceSpecificKnobsOnly(bool isPlayback,
     if ( !getApp() || getApp()->isGuiFrozen() ) {
         return;
     }
-    for (U32 i = 0; i < _imp->knobs.size(); ++i) {
-        if ( _imp->knobs[i]->isInstanceSpecific() ) {
-            _imp->knobs[i]->onTimeChanged(isPlayback, time);
+    KnobsVec knobs;
+    _imp->getTimeDependentKnobs(&knobs);
+    for (std::size_t i = 0; i < knobs.size(); ++i) {
+        if ( knobs[i]->isInstanceSpecific() ) {
+            knobs[i]->onTimeChanged(isPlayback, time);
         }
     }
 }
@@ -784,6 +784,13 @@ public:
      **/
     virtual bool hasAnimation() const = 0;
 
+    /**
+     * @brief Returns true if the value of the knob may change with the time: it is animated, has an expression, is slaved
+     * to another knob or must be evaluated on time changes (see evaluateValueChangeOnTimeChange()).
+     * Only these knobs are refreshed when the time changes.
+     **/
+    virtual bool isTimeDependent() const = 0;
+
     /**
      * @brief Returns a const ref to the curves held by this knob. This is MT-safe as they're
      * never deleted (except on program exit).
@@ -1434,6 +1441,7 @@ public:
     virtual boost::shared_ptr<Curve> getCurve(ViewSpec view, int dimension, bool byPassMaster = false) const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual bool isAnimated( int dimension, ViewSpec view = ViewSpec::current() ) const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual bool hasAnimation() const OVERRIDE FINAL WARN_UNUSED_RETURN;
+    virtual bool isTimeDependent() const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual bool checkInvalidExpressions() OVERRIDE FINAL;
     virtual bool isExpressionValid(int dimension, std::string* error) const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual void setExpressionInvalid(int dimension, bool valid, const std::string& error) OVERRIDE FINAL;
@@ -1586,6 +1594,12 @@ protected:
      **/
     void resetMaster(int dimension);
 
+    /**
+     * @brief Must be called whenever the animation, the expressions or the masters of the knob change, so that the
+     * holder keeps track of the knobs to refresh when the time changes.
+     **/
+    void refreshTimeDependency();
+
     ///The return value must be Py_DECRREF
     bool executeExpression(double time, ViewIdx view, int dimension, PyObject** ret, std::string* error) const;
 
@@ -2066,6 +2080,11 @@ public:
 
     bool getValueFromCurve(double time, ViewSpec view, int dimension, bool useGuiCurve, bool byPassMaster, bool clamp, T* ret);
 
+    /**
+     * @brief Returns the value from the KnobValuesSnapshot active on the current render thread, if any.
+     **/
+    bool getValueFromSnapshot(double time, int dimension, T* ret) const;
+
 protected:
 
     virtual void resetExtraToDefaultValue(int /*dimension*/) {}
@@ -2384,8 +2403,18 @@ public:
     const std::vector<KnobIPtr> & getKnobs() const WARN_UNUSED_RETURN;
     std::vector<KnobIPtr>  getKnobs_mt_safe() const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Refreshes the knobs whose value depends on the time (see KnobI::isTimeDependent()) at the given time,
+     * the other knobs are not visited.
+     **/
     void refreshAfterTimeChange(bool isPlayback, double time);
 
+    /**
+     * @brief Called by a knob of this holder when the result of KnobI::isTimeDependent() may have changed, to keep
+     * the list of time-dependent knobs up to date. MT-safe
+     **/
+    void refreshKnobTimeDependency(KnobI* knob, bool timeDependent);
+
     /**
      * @brief Same as refreshAfterTimeChange but refreshes only the knobs
      * whose function evaluateValueChangeOnTimeChange() return true so that
@@ -57,6 +57,7 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/Project.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/KnobTypes.h"
+#include "Engine/KnobValuesSnapshot.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
 
@@ -819,6 +820,47 @@ KnobStringBase::getValueFromCurve(double time,
     return false;
 }
 
+template <typename T>
+bool
+Knob<T>::getValueFromSnapshot(double time,
+                              int dimension,
+                              T* ret) const
+{
+    double value;
+
+    if ( !KnobValuesSnapshot::getCurrentValue(this, time, dimension, &value) ) {
+        return false;
+    }
+    *ret = (T)value;
+
+    return true;
+}
+
+template <>
+bool
+KnobStringBase::getValueFromSnapshot(double /*time*/,
+                                     int /*dimension*/,
+                                     std::string* /*ret*/) const
+{
+    return false;
+}
+
+template <>
+bool
+KnobBoolBase::getValueFromSnapshot(double time,
+                                   int dimension,
+                                   bool* ret) const
+{
+    double value;
+
+    if ( !KnobValuesSnapshot::getCurrentValue(this, time, dimension, &value) ) {
+        return false;
+    }
+    *ret = value != 0.;
+
+    return true;
+}
+
 template<typename T>
 T
 Knob<T>::getValueAtTime(double time,
@@ -832,6 +874,14 @@ Knob<T>::getValueAtTime(double time,
         return T();
     }
 
+    ///During a render, read the value captured when the render started if possible, see KnobValuesSnapshot
+    if (clamp && !byPassMaster) {
+        T ret;
+        if ( getValueFromSnapshot(time, dimension, &ret) ) {
+            return ret;
+        }
+    }
+
     bool useGuiValues = QThread::currentThread() == qApp->thread();
     std::string hasExpr = getExpression(dimension);
     if ( !hasExpr.empty() ) {
@@ -1591,6 +1641,9 @@ Knob<T>::setValueAtTime(double time,
     if (holder) {
         holder->setHasAnimation(true);
     }
+    if (newKeyFrame) {
+        refreshTimeDependency();
+    }
     guiCurveCloneInternalCurve(eCurveChangeReasonInternal, view, dimension, reason);
 
     if (_signalSlotHandler && newKeyFrame) {
@@ -1800,6 +1853,7 @@ Knob<T>::unSlaveInternal(int dimension,
     if (masterHelper) {
         masterHelper->removeListener(this, dimension);
     }
+    refreshTimeDependency();
     if (hasChanged) {
         evaluateValueChange(dimension, getCurrentTime(), ViewIdx(0), reason);
     } else {
@@ -2238,6 +2292,9 @@ Knob<T>::setKeyFrame(const KeyFrame& key,
     }
 
     bool ret = curve->addKeyFrame(key);
+    if (ret && !useGuiCurve) {
+        refreshTimeDependency();
+    }
 
     if (!useGuiCurve) {
         guiCurveCloneInternalCurve(eCurveChangeReasonInternal, view, dimension, reason);
@@ -2883,6 +2940,7 @@ Knob<T>::dequeueValuesSet(bool disableEvaluation)
 {
     std::map<int, ValueChangedReasonEnum> dimensionChanged;
     bool ret = false;
+    bool keyFramesAdded = false;
 
     cloneGuiCurvesIfNeeded(dimensionChanged);
     {
@@ -2896,7 +2954,7 @@ Knob<T>::dequeueValuesSet(bool disableEvaluation)
                 if ( (*it)->useKey() ) {
                     CurvePtr curve = getCurve( (*it)->view(), (*it)->dimension() );
                     if (curve) {
-                        curve->addKeyFrame( (*it)->key() );
+                        keyFramesAdded |= curve->addKeyFrame( (*it)->key() );
                     }
 
                     if ( getHolder() ) {
@@ -2923,7 +2981,7 @@ Knob<T>::dequeueValuesSet(bool disableEvaluation)
                         if (!blockValueChanges) {
                             dimensionChanged.insert( std::make_pair( (*it)->dimension(), (*it)->reason() ) );
                         }
-                        curve->addKeyFrame( key );
+                        keyFramesAdded |= curve->addKeyFrame( key );
                     }
                 }
 
@@ -2934,6 +2992,9 @@ Knob<T>::dequeueValuesSet(bool disableEvaluation)
         }
         _setValuesQueue.clear();
     }
+    if (keyFramesAdded) {
+        refreshTimeDependency();
+    }
     cloneInternalCurvesIfNeeded(dimensionChanged);
 
     clearExpressionsResultsIfNeeded(dimensionChanged);
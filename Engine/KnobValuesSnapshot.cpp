@@ -0,0 +1,271 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "KnobValuesSnapshot.h"
+
+#include <algorithm> // sort, lower_bound
+
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QCoreApplication>
+
+#include "Engine/Knob.h"
+#include "Engine/ThreadStorage.h"
+#include "Engine/Timer.h"
+#include "Engine/ViewIdx.h"
+
+NATRON_NAMESPACE_ENTER
+
+namespace {
+struct KnobValuesSnapshotThreadData
+{
+    // Snapshots activated on this thread, the last one is the current one
+    std::vector<KnobValuesSnapshotPtr> snapshots;
+
+    // Counted per thread so that reads do not touch shared memory, flushed in popCurrentSnapshot()
+    U64 nHits;
+    U64 nMisses;
+
+    KnobValuesSnapshotThreadData()
+        : snapshots()
+        , nHits(0)
+        , nMisses(0)
+    {
+    }
+};
+
+struct KnobValuesSnapshotGlobals
+{
+    QMutex lock;
+    KnobValuesSnapshotStats stats;
+
+    // QThreadStorage deletes the data when the thread exits
+    ThreadStorage<KnobValuesSnapshotThreadData*> threadData;
+
+    KnobValuesSnapshotGlobals()
+        : lock()
+        , stats()
+        , threadData()
+    {
+    }
+};
+
+KnobValuesSnapshotGlobals globals;
+
+template <typename T>
+void
+captureKnobValues(Knob<T>* knob,
+                  double time,
+                  std::vector<T>* values,
+                  std::vector<bool>* captured)
+{
+    int nDims = knob->getDimension();
+
+    values->resize(nDims);
+    captured->resize(nDims);
+    for (int i = 0; i < nDims; ++i) {
+        // Expressions may depend on the state of the thread at the time they are evaluated, always evaluate them
+        (*captured)[i] = knob->getExpression(i).empty();
+        if ( (*captured)[i] ) {
+            (*values)[i] = knob->getValueAtTime(time, i, ViewIdx(0), /*clamp*/ true);
+        }
+    }
+}
+} // anon namespace
+
+KnobValuesSnapshot::KnobValuesSnapshot(double time,
+                                       const std::vector<KnobHolder*>& holders)
+    : _time(time)
+    , _entries()
+{
+    TimeLapse timer;
+
+    for (std::vector<KnobHolder*>::const_iterator it = holders.begin(); it != holders.end(); ++it) {
+        if (!*it) {
+            continue;
+        }
+        const KnobsVec& knobs = (*it)->getKnobs();
+        for (KnobsVec::const_iterator it2 = knobs.begin(); it2 != knobs.end(); ++it2) {
+            Entry e;
+            e.knob = it2->get();
+
+            std::vector<bool> captured;
+            if ( Knob<double>* isDouble = dynamic_cast<Knob<double>*>( it2->get() ) ) {
+                std::vector<double> values;
+                captureKnobValues(isDouble, time, &values, &captured);
+                for (std::size_t i = 0; i < values.size(); ++i) {
+                    if (captured[i]) {
+                        e.dimension = (int)i;
+                        e.value = values[i];
+                        _entries.push_back(e);
+                    }
+                }
+            } else if ( Knob<int>* isInt = dynamic_cast<Knob<int>*>( it2->get() ) ) {
+                std::vector<int> values;
+                captureKnobValues(isInt, time, &values, &captured);
+                for (std::size_t i = 0; i < values.size(); ++i) {
+                    if (captured[i]) {
+                        e.dimension = (int)i;
+                        e.value = values[i];
+                        _entries.push_back(e);
+                    }
+                }
+            } else if ( Knob<bool>* isBool = dynamic_cast<Knob<bool>*>( it2->get() ) ) {
+                std::vector<bool> values;
+                captureKnobValues(isBool, time, &values, &captured);
+                for (std::size_t i = 0; i < values.size(); ++i) {
+                    if (captured[i]) {
+                        e.dimension = (int)i;
+                        e.value = values[i] ? 1. : 0.;
+                        _entries.push_back(e);
+                    }
+                }
+            }
+        }
+    }
+    std::sort( _entries.begin(), _entries.end() );
+
+    double creationTime = timer.getTimeSinceCreation();
+    QMutexLocker k(&globals.lock);
+    ++globals.stats.nSnapshots;
+    globals.stats.nValues += _entries.size();
+    globals.stats.memoryBytes += getMemoryBytes();
+    globals.stats.creationTime += creationTime;
+}
+
+KnobValuesSnapshot::~KnobValuesSnapshot()
+{
+    QMutexLocker k(&globals.lock);
+
+    globals.stats.memoryBytes -= getMemoryBytes();
+}
+
+std::size_t
+KnobValuesSnapshot::getMemoryBytes() const
+{
+    return sizeof(KnobValuesSnapshot) + _entries.capacity() * sizeof(Entry);
+}
+
+bool
+KnobValuesSnapshot::getValue(const KnobI* knob,
+                             int dimension,
+                             double* value) const
+{
+    Entry e;
+
+    e.knob = knob;
+    e.dimension = dimension;
+    std::vector<Entry>::const_iterator found = std::lower_bound(_entries.begin(), _entries.end(), e);
+    if ( ( found == _entries.end() ) || (found->knob != knob) || (found->dimension != dimension) ) {
+        return false;
+    }
+    *value = found->value;
+
+    return true;
+}
+
+bool
+KnobValuesSnapshot::pushCurrentSnapshot(const KnobValuesSnapshotPtr& snapshot)
+{
+    // The main thread uses the GUI values of the knobs, which are not captured
+    if ( !snapshot || ( qApp && QThread::currentThread() == qApp->thread() ) ) {
+        return false;
+    }
+    if ( !globals.threadData.hasLocalData() ) {
+        globals.threadData.setLocalData(new KnobValuesSnapshotThreadData);
+    }
+    globals.threadData.localData()->snapshots.push_back(snapshot);
+
+    QMutexLocker k(&globals.lock);
+    ++globals.stats.nActivations;
+
+    return true;
+}
+
+void
+KnobValuesSnapshot::popCurrentSnapshot()
+{
+    if ( !globals.threadData.hasLocalData() ) {
+        return;
+    }
+    KnobValuesSnapshotThreadData* data = globals.threadData.localData();
+    if ( !data || data->snapshots.empty() ) {
+        return;
+    }
+    data->snapshots.pop_back();
+
+    QMutexLocker k(&globals.lock);
+    globals.stats.nHits += data->nHits;
+    globals.stats.nMisses += data->nMisses;
+    data->nHits = data->nMisses = 0;
+}
+
+KnobValuesSnapshotPtr
+KnobValuesSnapshot::getCurrentSnapshot()
+{
+    if ( !globals.threadData.hasLocalData() ) {
+        return KnobValuesSnapshotPtr();
+    }
+    KnobValuesSnapshotThreadData* data = globals.threadData.localData();
+    if ( !data || data->snapshots.empty() ) {
+        return KnobValuesSnapshotPtr();
+    }
+
+    return data->snapshots.back();
+}
+
+bool
+KnobValuesSnapshot::getCurrentValue(const KnobI* knob,
+                                    double time,
+                                    int dimension,
+                                    double* value)
+{
+    if ( !globals.threadData.hasLocalData() ) {
+        return false;
+    }
+    KnobValuesSnapshotThreadData* data = globals.threadData.localData();
+    if ( !data || data->snapshots.empty() ) {
+        return false;
+    }
+    const KnobValuesSnapshotPtr& snapshot = data->snapshots.back();
+    if ( (snapshot->getTime() != time) || !snapshot->getValue(knob, dimension, value) ) {
+        ++data->nMisses;
+
+        return false;
+    }
+    ++data->nHits;
+
+    return true;
+}
+
+void
+KnobValuesSnapshot::getStatistics(KnobValuesSnapshotStats* stats)
+{
+    QMutexLocker k(&globals.lock);
+
+    *stats = globals.stats;
+}
+
+NATRON_NAMESPACE_EXIT
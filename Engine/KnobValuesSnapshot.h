@@ -0,0 +1,166 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_KNOBVALUESSNAPSHOT_H
+#define NATRON_ENGINE_KNOBVALUESSNAPSHOT_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Statistics on the knob values snapshots made since the application started
+ **/
+struct KnobValuesSnapshotStats
+{
+    // Number of snapshots made
+    U64 nSnapshots;
+
+    // Total number of values captured
+    U64 nValues;
+
+    // Memory used by the snapshots currently alive, in bytes
+    U64 memoryBytes;
+
+    // Total time spent capturing values, in seconds
+    double creationTime;
+
+    // Number of reads served by a snapshot, and number of reads made while a snapshot was active but that
+    // could not be served by it (other time, expression, parameter not in the tree...)
+    U64 nHits;
+    U64 nMisses;
+
+    // Number of times a snapshot was activated on a thread: once per frame on the thread rendering the tree, plus
+    // once per thread spawned for this frame (tiles rendered in parallel, OpenFX multi-thread suite)
+    U64 nActivations;
+
+    KnobValuesSnapshotStats()
+        : nSnapshots(0)
+        , nValues(0)
+        , memoryBytes(0)
+        , creationTime(0)
+        , nHits(0)
+        , nMisses(0)
+        , nActivations(0)
+    {
+    }
+};
+
+/**
+ * @brief An immutable copy of the values at a given time of all the int, bool and double parameters of the nodes
+ * of a tree, made when the render of a frame starts (see ParallelRenderArgsSetter).
+ * While the snapshot is active on a render thread, Knob::getValueAtTime reads the values from the snapshot,
+ * which is a flat sorted table, instead of locking the knob and evaluating its curve or master.
+ * Dimensions driven by an expression are not captured and are always evaluated.
+ *
+ * Once built, this class is MT-safe since it is never modified.
+ **/
+class KnobValuesSnapshot
+{
+    struct Entry
+    {
+        const KnobI* knob;
+        int dimension;
+        double value;
+
+        bool operator<(const Entry& other) const
+        {
+            if (knob != other.knob) {
+                return knob < other.knob;
+            }
+
+            return dimension < other.dimension;
+        }
+    };
+
+public:
+
+    /**
+     * @brief Captures the values at the given time of all the parameters of the given holders.
+     **/
+    KnobValuesSnapshot(double time,
+                       const std::vector<KnobHolder*>& holders);
+
+    ~KnobValuesSnapshot();
+
+    double getTime() const
+    {
+        return _time;
+    }
+
+    int getNumValues() const
+    {
+        return (int)_entries.size();
+    }
+
+    std::size_t getMemoryBytes() const;
+
+    /**
+     * @brief Returns the clamped value of the given dimension of the knob if it was captured.
+     **/
+    bool getValue(const KnobI* knob, int dimension, double* value) const;
+
+    /**
+     * @brief Makes the snapshot active on the current thread until popCurrentSnapshot() is called.
+     * Snapshots are never activated on the main thread.
+     * Returns true if the snapshot was activated.
+     **/
+    static bool pushCurrentSnapshot(const KnobValuesSnapshotPtr& snapshot);
+    static void popCurrentSnapshot();
+
+    /**
+     * @brief Returns the snapshot active on the current thread, if any. Threads spawned to help rendering a frame
+     * do not inherit it: the spawner must pass it along and the spawned thread must push it itself.
+     **/
+    static KnobValuesSnapshotPtr getCurrentSnapshot();
+
+    /**
+     * @brief Returns the clamped value of the given dimension of the knob at the given time from the snapshot active
+     * on the current thread, if any. This does not take any lock.
+     **/
+    static bool getCurrentValue(const KnobI* knob, double time, int dimension, double* value);
+
+    static void getStatistics(KnobValuesSnapshotStats* stats);
+
+private:
+
+    double _time;
+    std::vector<Entry> _entries;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_KNOBVALUESSNAPSHOT_H
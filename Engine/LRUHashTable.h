@@ -220,6 +220,52 @@ public:
         return std::make_pair( key_type(), V() );
     }
 
+    /**
+     * @brief Same as evict(), but the value evicted is the one with the lowest score among the first window values
+     * that can be evicted, in the least recently used order.
+     * SCORE is a functor with the signature bool(const V& value, double* score): if it returns false, the value is
+     * never evicted and it does not count in the window.
+     **/
+    template <typename SCORE>
+    std::pair<key_type, V> evict(const SCORE& scoreFunctor,
+                                 int window)
+    {
+        typename key_to_value_type::iterator best = _key_to_value.end();
+        typename std::list<V>::iterator bestValue;
+        double bestScore = 0.;
+        int nCandidates = 0;
+
+        for (typename key_tracker_type::iterator it = _key_tracker.begin(); it != _key_tracker.end() && nCandidates < window; ++it) {
+            typename key_to_value_type::iterator found = _key_to_value.find(*it);
+            assert( found != _key_to_value.end() );
+            for (typename std::list<V>::iterator it2 = found->second.first.begin();
+                 it2 != found->second.first.end() && nCandidates < window;
+                 ++it2) {
+                double score;
+                if ( ( (*it2).use_count() != 1 ) || !scoreFunctor(*it2, &score) ) {
+                    continue;
+                }
+                ++nCandidates;
+                if ( ( best == _key_to_value.end() ) || (score < bestScore) ) {
+                    best = found;
+                    bestValue = it2;
+                    bestScore = score;
+                }
+            }
+        }
+        if ( best == _key_to_value.end() ) {
+            return std::make_pair( key_type(), V() );
+        }
+        std::pair<key_type, V> ret = std::make_pair(best->first, *bestValue);
+        if (best->second.first.size() == 1) {
+            erase(best);
+        } else {
+            best->second.first.erase(bestValue);
+        }
+
+        return ret;
+    }
+
     unsigned int size()
     {
         return _container.size();
@@ -333,6 +379,48 @@ public:
         return std::make_pair( key_type(), V() );
     }
 
+    /**
+     * @brief Same as evict(), but the value evicted is the one with the lowest score among the first window values
+     * that can be evicted, in the least recently used order.
+     * SCORE is a functor with the signature bool(const V& value, double* score): if it returns false, the value is
+     * never evicted and it does not count in the window.
+     **/
+    template <typename SCORE>
+    std::pair<key_type, V> evict(const SCORE& scoreFunctor,
+                                 int window)
+    {
+        typename container_type::right_iterator best = _container.right.end();
+        typename std::list<V>::iterator bestValue;
+        double bestScore = 0.;
+        int nCandidates = 0;
+
+        for (typename container_type::right_iterator it = _container.right.begin(); it != _container.right.end() && nCandidates < window; ++it) {
+            for (typename std::list<V>::iterator it2 = it->first.begin(); it2 != it->first.end() && nCandidates < window; ++it2) {
+                double score;
+                if ( ( (*it2).use_count() != 1 ) || !scoreFunctor(*it2, &score) ) {
+                    continue;
+                }
+                ++nCandidates;
+                if ( ( best == _container.right.end() ) || (score < bestScore) ) {
+                    best = it;
+                    bestValue = it2;
+                    bestScore = score;
+                }
+            }
+        }
+        if ( best == _container.right.end() ) {
+            return std::make_pair( key_type(), V() );
+        }
+        std::pair<key_type, V> ret = std::make_pair(best->second, *bestValue);
+        if (best->first.size() == 1) {
+            _container.right.erase(best);
+        } else {
+            best->first.erase(bestValue);
+        }
+
+        return ret;
+    }
+
     unsigned int size()
     {
         return _container.size();
@@ -454,6 +542,52 @@ public:
         return std::make_pair( key_type(), V() );
     }
 
+    /**
+     * @brief Same as evict(), but the value evicted is the one with the lowest score among the first window values
+     * that can be evicted, in the least recently used order.
+     * SCORE is a functor with the signature bool(const V& value, double* score): if it returns false, the value is
+     * never evicted and it does not count in the window.
+     **/
+    template <typename SCORE>
+    std::pair<key_type, V> evict(const SCORE& scoreFunctor,
+                                 int window)
+    {
+        typename key_to_value_type::iterator best = _key_to_value.end();
+        typename std::list<V>::iterator bestValue;
+        double bestScore = 0.;
+        int nCandidates = 0;
+
+        for (typename key_tracker_type::iterator it = _key_tracker.begin(); it != _key_tracker.end() && nCandidates < window; ++it) {
+            typename key_to_value_type::iterator found = _key_to_value.find(*it);
+            assert( found != _key_to_value.end() );
+            for (typename std::list<V>::iterator it2 = found->second.first.begin();
+                 it2 != found->second.first.end() && nCandidates < window;
+                 ++it2) {
+                double score;
+                if ( ( (*it2).use_count() != 1 ) || !scoreFunctor(*it2, &score) ) {
+                    continue;
+                }
+                ++nCandidates;
+                if ( ( best == _key_to_value.end() ) || (score < bestScore) ) {
+                    best = found;
+                    bestValue = it2;
+                    bestScore = score;
+                }
+            }
+        }
+        if ( best == _key_to_value.end() ) {
+            return std::make_pair( key_type(), V() );
+        }
+        std::pair<key_type, V> ret = std::make_pair(best->first, *bestValue);
+        if (best->second.first.size() == 1) {
+            erase(best);
+        } else {
+            best->second.first.erase(bestValue);
+        }
+
+        return ret;
+    }
+
     unsigned int size()
     {
         return _key_to_value.size();
@@ -561,6 +695,48 @@ public:
         return std::make_pair( key_type(), V() );
     }
 
+    /**
+     * @brief Same as evict(), but the value evicted is the one with the lowest score among the first window values
+     * that can be evicted, in the least recently used order.
+     * SCORE is a functor with the signature bool(const V& value, double* score): if it returns false, the value is
+     * never evicted and it does not count in the window.
+     **/
+    template <typename SCORE>
+    std::pair<key_type, V> evict(const SCORE& scoreFunctor,
+                                 int window)
+    {
+        typename container_type::right_iterator best = _container.right.end();
+        typename std::list<V>::iterator bestValue;
+        double bestScore = 0.;
+        int nCandidates = 0;
+
+        for (typename container_type::right_iterator it = _container.right.begin(); it != _container.right.end() && nCandidates < window; ++it) {
+            for (typename std::list<V>::iterator it2 = it->first.begin(); it2 != it->first.end() && nCandidates < window; ++it2) {
+                double score;
+                if ( ( (*it2).use_count() != 1 ) || !scoreFunctor(*it2, &score) ) {
+                    continue;
+                }
+                ++nCandidates;
+                if ( ( best == _container.right.end() ) || (score < bestScore) ) {
+                    best = it;
+                    bestValue = it2;
+                    bestScore = score;
+                }
+            }
+        }
+        if ( best == _container.right.end() ) {
+            return std::make_pair( key_type(), V() );
+        }
+        std::pair<key_type, V> ret = std::make_pair(best->second, *bestValue);
+        if (best->first.size() == 1) {
+            _container.right.erase(best);
+        } else {
+            best->first.erase(bestValue);
+        }
+
+        return ret;
+    }
+
     unsigned int size()
     {
         return _container.size();
@@ -663,6 +839,48 @@ public:
         return std::make_pair( key_type(), V() );
     }
 
+    /**
+     * @brief Same as evict(), but the value evicted is the one with the lowest score among the first window values
+     * that can be evicted, in the least recently used order.
+     * SCORE is a functor with the signature bool(const V& value, double* score): if it returns false, the value is
+     * never evicted and it does not count in the window.
+     **/
+    template <typename SCORE>
+    std::pair<key_type, V> evict(const SCORE& scoreFunctor,
+                                 int window)
+    {
+        typename container_type::right_iterator best = _container.right.end();
+        typename std::list<V>::iterator bestValue;
+        double bestScore = 0.;
+        int nCandidates = 0;
+
+        for (typename container_type::right_iterator it = _container.right.begin(); it != _container.right.end() && nCandidates < window; ++it) {
+            for (typename std::list<V>::iterator it2 = it->first.begin(); it2 != it->first.end() && nCandidates < window; ++it2) {
+                double score;
+                if ( ( (*it2).use_count() != 1 ) || !scoreFunctor(*it2, &score) ) {
+                    continue;
+                }
+                ++nCandidates;
+                if ( ( best == _container.right.end() ) || (score < bestScore) ) {
+                    best = it;
+                    bestValue = it2;
+                    bestScore = score;
+                }
+            }
+        }
+        if ( best == _container.right.end() ) {
+            return std::make_pair( key_type(), V() );
+        }
+        std::pair<key_type, V> ret = std::make_pair(best->second, *bestValue);
+        if (best->first.size() == 1) {
+            _container.right.erase(best);
+        } else {
+            best->first.erase(bestValue);
+        }
+
+        return ret;
+    }
+
     unsigned int size()
     {
         return _container.size();
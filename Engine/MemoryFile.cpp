@@ -38,6 +38,7 @@
 #include <cerrno>
 #include <cstdio>
 #endif
+#include <algorithm> // min
 #include <sstream> // stringstream
 #include <iostream>
 #include <cassert>
@@ -55,6 +56,7 @@ struct MemoryFilePrivate
     std::string path; //< filepath of the backing file
     char* data; //< pointer to the beginning of the mapped file
     size_t size; //< the effective size of the file
+    int mappingFlags; //< MemoryFile::MappingFlagsEnum hints given for every mapping
 #if defined(__NATRON_UNIX__)
     int file_handle; //< unix file handle
 #elif defined(__NATRON_WIN32__)
@@ -64,10 +66,12 @@ struct MemoryFilePrivate
 #error Only Unix or Windows systems can use memory-mapped files.
 #endif
 
-    MemoryFilePrivate(const std::string & filepath)
+    MemoryFilePrivate(const std::string & filepath,
+                      int mappingFlags)
         : path(filepath)
         , data(0)
         , size(0)
+        , mappingFlags(mappingFlags)
 #if defined(__NATRON_UNIX__)
         , file_handle(-1)
 #elif defined(__NATRON_WIN32__)
@@ -79,25 +83,34 @@ struct MemoryFilePrivate
 
     void openInternal(MemoryFile::FileOpenModeEnum open_mode);
 
+#if defined(__NATRON_UNIX__)
+    /**
+     * @brief Maps the first mapSize bytes of the file with the hints of mappingFlags, returns MAP_FAILED on failure
+     **/
+    void* mapFile(size_t mapSize) const;
+#endif
+
     void closeMapping(bool drop_pages);
 };
 
 MemoryFile::MemoryFile()
-    : _imp( new MemoryFilePrivate( std::string() ) )
+    : _imp( new MemoryFilePrivate(std::string(), eMappingFlagsNone) )
 {
 }
 
 MemoryFile::MemoryFile(const std::string & filepath,
-                       FileOpenModeEnum open_mode)
-    : _imp( new MemoryFilePrivate(filepath) )
+                       FileOpenModeEnum open_mode,
+                       int mappingFlags)
+    : _imp( new MemoryFilePrivate(filepath, mappingFlags) )
 {
     _imp->openInternal(open_mode);
 }
 
 MemoryFile::MemoryFile(const std::string & filepath,
                        size_t size,
-                       FileOpenModeEnum open_mode)
-    : _imp( new MemoryFilePrivate(filepath) )
+                       FileOpenModeEnum open_mode,
+                       int mappingFlags)
+    : _imp( new MemoryFilePrivate(filepath, mappingFlags) )
 {
     _imp->openInternal(open_mode);
     resize(size);
@@ -105,15 +118,55 @@ MemoryFile::MemoryFile(const std::string & filepath,
 
 void
 MemoryFile::open(const std::string & filepath,
-                 FileOpenModeEnum open_mode)
+                 FileOpenModeEnum open_mode,
+                 int mappingFlags)
 {
     if (!_imp->path.empty() || _imp->data) {
         return;
     }
     _imp->path = filepath;
+    _imp->mappingFlags = mappingFlags;
     _imp->openInternal(open_mode);
 }
 
+#if defined(__NATRON_UNIX__)
+void*
+MemoryFilePrivate::mapFile(size_t mapSize) const
+{
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    if (mappingFlags & MemoryFile::eMappingFlagsPopulate) {
+        flags |= MAP_POPULATE;
+    }
+#endif
+    void* ret = ::mmap(0, mapSize, PROT_READ | PROT_WRITE, flags, file_handle, 0);
+    if (ret == MAP_FAILED) {
+        return ret;
+    }
+
+    // The hints are best effort: failures are ignored
+    int rc = 0;
+#ifdef MADV_HUGEPAGE
+    if (mappingFlags & MemoryFile::eMappingFlagsHugePages) {
+        rc = ::madvise(ret, mapSize, MADV_HUGEPAGE);
+    }
+#endif
+    if (mappingFlags & MemoryFile::eMappingFlagsSequential) {
+        rc = ::madvise(ret, mapSize, MADV_SEQUENTIAL);
+    } else if (mappingFlags & MemoryFile::eMappingFlagsRandom) {
+        rc = ::madvise(ret, mapSize, MADV_RANDOM);
+    }
+#ifndef MAP_POPULATE
+    if (mappingFlags & MemoryFile::eMappingFlagsPopulate) {
+        rc = ::madvise(ret, mapSize, MADV_WILLNEED);
+    }
+#endif
+    Q_UNUSED(rc);
+
+    return ret;
+}
+#endif // if defined(__NATRON_UNIX__)
+
 void
 MemoryFilePrivate::openInternal(MemoryFile::FileOpenModeEnum open_mode)
 {
@@ -181,8 +234,7 @@ MemoryFilePrivate::openInternal(MemoryFile::FileOpenModeEnum open_mode)
      ********************************************************
      *********************************************************/
     if (sbuf.st_size > 0) {
-        data = static_cast<char*>( ::mmap(
-                                       0, sbuf.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, file_handle, 0) );
+        data = static_cast<char*>( mapFile(sbuf.st_size) );
         if (data == MAP_FAILED) {
             data = 0;
             std::stringstream ss;
@@ -306,8 +358,7 @@ MemoryFile::resize(size_t new_size)
         ss << "MemoryFile EXC : Failed to truncate the file \"" << _imp->path << "\": " << std::strerror(errno) << " (" << errno << ")";
         throw std::runtime_error( ss.str() );
     }
-    _imp->data = static_cast<char*>( ::mmap(
-                                         0, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, _imp->file_handle, 0) );
+    _imp->data = static_cast<char*>( _imp->mapFile(new_size) );
     if (_imp->data == MAP_FAILED) {
         _imp->data = 0;
         std::stringstream ss;
@@ -413,6 +464,90 @@ MemoryFile::flush(FlushTypeEnum type, void* data, std::size_t size)
     return false;
 }
 
+bool
+MemoryFile::advise(AccessAdviceEnum advice,
+                   void* data,
+                   std::size_t size)
+{
+    if (!_imp->data) {
+        return false;
+    }
+#if defined(__NATRON_UNIX__)
+    char* begin = data ? static_cast<char*>(data) : _imp->data;
+    char* end = data ? begin + size : _imp->data + _imp->size;
+
+    // madvise works on whole pages: pages partially covered are only released with DontNeed if they are also
+    // entirely in the mapping, they are included otherwise.
+    std::size_t pageSize = (std::size_t)::sysconf(_SC_PAGESIZE);
+    std::size_t beginOffset = begin - _imp->data;
+    std::size_t endOffset = end - _imp->data;
+    if (advice == eAccessAdviceDontNeed) {
+        beginOffset = (beginOffset + pageSize - 1) / pageSize * pageSize;
+        endOffset = endOffset / pageSize * pageSize;
+    } else {
+        beginOffset = beginOffset / pageSize * pageSize;
+        endOffset = std::min( (endOffset + pageSize - 1) / pageSize * pageSize, _imp->size );
+    }
+    if (endOffset <= beginOffset) {
+        return true;
+    }
+    int posixAdvice;
+    switch (advice) {
+    case eAccessAdviceSequential:
+        posixAdvice = MADV_SEQUENTIAL;
+        break;
+    case eAccessAdviceRandom:
+        posixAdvice = MADV_RANDOM;
+        break;
+    case eAccessAdviceWillNeed:
+        posixAdvice = MADV_WILLNEED;
+        break;
+    case eAccessAdviceDontNeed:
+        posixAdvice = MADV_DONTNEED;
+        break;
+    case eAccessAdviceNormal:
+    default:
+        posixAdvice = MADV_NORMAL;
+        break;
+    }
+
+    return ::madvise(_imp->data + beginOffset, endOffset - beginOffset, posixAdvice) == 0;
+#elif defined(__NATRON_WIN32__)
+    Q_UNUSED(advice);
+    Q_UNUSED(data);
+    Q_UNUSED(size);
+
+    return false;
+#endif
+}
+
+void
+MemoryFile::prefetch(const std::string & filepath)
+{
+#if defined(__NATRON_UNIX__)
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+#if defined(POSIX_FADV_WILLNEED)
+    int rc = ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    Q_UNUSED(rc);
+#elif defined(F_RDADVISE)
+    struct stat sbuf;
+    if (::fstat(fd, &sbuf) == 0) {
+        struct radvisory ra;
+        ra.ra_offset = 0;
+        ra.ra_count = (int)sbuf.st_size;
+        int rc = ::fcntl(fd, F_RDADVISE, &ra);
+        Q_UNUSED(rc);
+    }
+#endif
+    ::close(fd);
+#elif defined(__NATRON_WIN32__)
+    Q_UNUSED(filepath);
+#endif
+}
+
 MemoryFile::~MemoryFile()
 {
     if (_imp->data) {
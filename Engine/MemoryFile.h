@@ -59,6 +59,27 @@ public:
         eFileOpenModeEnumIfExistsTruncateElseCreate
     };
 
+    /**
+     * @brief Hints given to the system when the file is mapped. They can be combined and are ignored where the
+     * system does not support them.
+     **/
+    enum MappingFlagsEnum
+    {
+        eMappingFlagsNone = 0x0,
+
+        // Read the whole file when it is mapped instead of faulting its pages one at a time
+        eMappingFlagsPopulate = 0x1,
+
+        // The mapping is read sequentially: the system reads ahead of the accessed pages more aggressively
+        eMappingFlagsSequential = 0x2,
+
+        // The mapping is accessed randomly: the system does not read ahead of the accessed pages
+        eMappingFlagsRandom = 0x4,
+
+        // Back the mapping with huge pages, this reduces the number of page faults and TLB misses
+        eMappingFlagsHugePages = 0x8
+    };
+
     /**
      * @brief Creates an empty object. No file is created/opened and no mapping is effective yet.
      * You can then call open(...) to open a file and then resize(...) it as needed.
@@ -77,7 +98,8 @@ public:
      * http://www.parashift.com/c++-faq-lite/ctors-can-throw.html
      **/
     MemoryFile(const std::string & filepath,
-               FileOpenModeEnum open_mode);
+               FileOpenModeEnum open_mode,
+               int mappingFlags = eMappingFlagsNone);
 
     /**
      * @brief The constructor attempts to create the file if the file
@@ -92,7 +114,8 @@ public:
      **/
     MemoryFile(const std::string & filepath,
                size_t size,
-               FileOpenModeEnum open_mode);
+               FileOpenModeEnum open_mode,
+               int mappingFlags = eMappingFlagsNone);
 
     /**
      * @brief The destructor closes the mapping, effectively removing the RAM portion but not the file.
@@ -107,8 +130,9 @@ public:
      *
      * WARNING: Calling this function whilst the mapping is already opened has no effect
      * This function might throw an exception upon failure to open the file.
+     * mappingFlags is a combination of MappingFlagsEnum applied to all the mappings of the file.
      **/
-    void open(const std::string & filepath, FileOpenModeEnum open_mode);
+    void open(const std::string & filepath, FileOpenModeEnum open_mode, int mappingFlags = eMappingFlagsNone);
 
     /**
      * @brief Returns a pointer to the beginning of the file,
@@ -146,6 +170,29 @@ public:
      **/
     bool flush(FlushTypeEnum type, void* data, std::size_t size);
 
+    enum AccessAdviceEnum
+    {
+        eAccessAdviceNormal,
+        eAccessAdviceSequential,
+        eAccessAdviceRandom,
+        eAccessAdviceWillNeed,
+        eAccessAdviceDontNeed
+    };
+
+    /**
+     * @brief Tells the system how a portion of the mapping is going to be accessed. WillNeed starts reading the
+     * pages in the background, DontNeed lets the system reclaim them (their content is kept in the file).
+     * @param data If non null, only the pages spanned by data and size are concerned
+     * Returns false if the advice could not be given.
+     **/
+    bool advise(AccessAdviceEnum advice, void* data, std::size_t size);
+
+    /**
+     * @brief Asks the system to start reading the given file in the background, without mapping it, so that it does not
+     * have to wait for the disk when the file is mapped later on. Errors are ignored.
+     **/
+    static void prefetch(const std::string & filepath);
+
     /**
      * @brief Returns the filepath of the backing file.
      **/
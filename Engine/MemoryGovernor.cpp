@@ -0,0 +1,520 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "MemoryGovernor.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+#include "Engine/AppManager.h"
+#include "Engine/MemoryInfo.h" // getSystemTotalRAM_conditionnally, getAmountFreePhysicalRAM
+#include "Engine/Settings.h"
+
+// The PSI "avg10" value is averaged over 10 seconds: after shrinking the caches because of memory pressure,
+// wait for that long before looking at the pressure again, otherwise the same stall would be accounted several times.
+#define NATRON_MEMORY_GOVERNOR_PRESSURE_WINDOW_MS 10000
+
+NATRON_NAMESPACE_ENTER
+
+namespace {
+#if defined(__NATRON_LINUX__)
+// Cgroups report limits this large when there is no limit (v1 reports the largest page-aligned 64 bit value)
+#define CGROUP_UNLIMITED (1ULL << 60)
+
+bool
+readFirstLine(const std::string& path,
+              std::string* line)
+{
+    std::ifstream file( path.c_str() );
+
+    if (!file) {
+        return false;
+    }
+
+    return !std::getline(file, *line).fail();
+}
+
+// Reads a file holding a single number of bytes, or "max" if there is no limit, in which case value is set to ULLONG_MAX
+bool
+readBytes(const std::string& path,
+          U64* value)
+{
+    std::string line;
+
+    if ( !readFirstLine(path, &line) ) {
+        return false;
+    }
+    if (line.compare(0, 3, "max") == 0) {
+        *value = ULLONG_MAX;
+
+        return true;
+    }
+    unsigned long long v;
+    if (std::sscanf(line.c_str(), "%llu", &v) != 1) {
+        return false;
+    }
+    *value = v >= CGROUP_UNLIMITED ? ULLONG_MAX : (U64)v;
+
+    return true;
+}
+
+// Reads a field of a memory.stat file
+bool
+readStat(const std::string& path,
+         const std::string& key,
+         U64* value)
+{
+    std::ifstream file( path.c_str() );
+
+    if (!file) {
+        return false;
+    }
+    std::string name;
+    unsigned long long v;
+    while (file >> name >> v) {
+        if (name == key) {
+            *value = v;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool
+fileExists(const std::string& path)
+{
+    std::ifstream file( path.c_str() );
+
+    return file.is_open();
+}
+
+// The memory cgroup of the process, found once in /proc/self/cgroup. The process is not expected to change cgroup.
+struct CGroupInfo
+{
+    // 0 if the process has no memory cgroup (or it could not be found), 1 or 2 otherwise
+    int version;
+
+    // Directory of the cgroup, in the cgroup file system
+    std::string dir;
+
+    // Root of the cgroup hierarchy: limits of the parents of dir are taken into account up to this directory
+    std::string root;
+
+    CGroupInfo()
+        : version(0)
+        , dir()
+        , root()
+    {
+        detect();
+    }
+
+    void detect();
+
+    bool readLimit(U64* limit) const;
+
+    bool readUsage(U64* usage) const;
+
+    bool readPressure(double* pressure) const;
+};
+
+void
+CGroupInfo::detect()
+{
+    std::ifstream file("/proc/self/cgroup");
+
+    if (!file) {
+        return;
+    }
+    // Lines are "hierarchy-ID:controller-list:cgroup-path". The unified (v2) hierarchy is "0::path".
+    std::string v1Path;
+    bool hasV1 = false;
+    std::string v2Path;
+    bool hasV2 = false;
+    std::string line;
+    while ( std::getline(file, line) ) {
+        std::size_t first = line.find(':');
+        std::size_t second = first == std::string::npos ? std::string::npos : line.find(':', first + 1);
+        if (second == std::string::npos) {
+            continue;
+        }
+        std::string controllers = line.substr(first + 1, second - first - 1);
+        std::string path = line.substr(second + 1);
+        if ( controllers.empty() && (line.compare(0, first, "0") == 0) ) {
+            v2Path = path;
+            hasV2 = true;
+        } else {
+            std::stringstream ss(controllers);
+            std::string controller;
+            while ( std::getline(ss, controller, ',') ) {
+                if (controller == "memory") {
+                    v1Path = path;
+                    hasV1 = true;
+                }
+            }
+        }
+    }
+
+    // The memory controller of v1, when mounted, takes precedence: on hybrid systems the v2 hierarchy has no memory controller.
+    // Inside a container with a private cgroup namespace the path may not be visible: the cgroup is then the root of the mount.
+    if (hasV1) {
+        root = "/sys/fs/cgroup/memory";
+        dir = root + ( v1Path == "/" ? std::string() : v1Path );
+        if ( !fileExists(dir + "/memory.limit_in_bytes") ) {
+            dir = root;
+        }
+        if ( fileExists(dir + "/memory.limit_in_bytes") ) {
+            version = 1;
+
+            return;
+        }
+    }
+    if (hasV2) {
+        root = "/sys/fs/cgroup";
+        dir = root + ( v2Path == "/" ? std::string() : v2Path );
+        if ( !fileExists(dir + "/memory.current") ) {
+            dir = root;
+        }
+        if ( fileExists(dir + "/memory.current") ) {
+            version = 2;
+
+            return;
+        }
+    }
+    dir.clear();
+    root.clear();
+}
+
+bool
+CGroupInfo::readLimit(U64* limit) const
+{
+    if (version == 1) {
+        return readBytes(dir + "/memory.limit_in_bytes", limit) && *limit != ULLONG_MAX;
+    } else if (version != 2) {
+        return false;
+    }
+    // The effective limit is the lowest of the limits of the cgroup and its parents. memory.high is where the kernel
+    // starts reclaiming and throttling the cgroup, which is what we want to avoid as well.
+    *limit = ULLONG_MAX;
+    std::string path = dir;
+    for (;; ) {
+        U64 value;
+        if ( readBytes(path + "/memory.max", &value) ) {
+            *limit = std::min(*limit, value);
+        }
+        if ( readBytes(path + "/memory.high", &value) ) {
+            *limit = std::min(*limit, value);
+        }
+        if ( path.size() <= root.size() ) {
+            break;
+        }
+        path = path.substr( 0, path.rfind('/') );
+    }
+
+    return *limit != ULLONG_MAX;
+}
+
+bool
+CGroupInfo::readUsage(U64* usage) const
+{
+    // The inactive page cache is charged to the cgroup but is the first thing reclaimed by the kernel: do not count it
+    U64 inactiveFile = 0;
+
+    if (version == 1) {
+        if ( !readBytes(dir + "/memory.usage_in_bytes", usage) ) {
+            return false;
+        }
+        readStat(dir + "/memory.stat", "total_inactive_file", &inactiveFile);
+    } else if (version == 2) {
+        if ( !readBytes(dir + "/memory.current", usage) ) {
+            return false;
+        }
+        readStat(dir + "/memory.stat", "inactive_file", &inactiveFile);
+    } else {
+        return false;
+    }
+    *usage = *usage > inactiveFile ? *usage - inactiveFile : 0;
+
+    return true;
+}
+
+bool
+CGroupInfo::readPressure(double* pressure) const
+{
+    // e.g: "some avg10=0.00 avg60=0.00 avg300=0.00 total=0"
+    std::string line;
+
+    if ( ( (version != 2) || !readFirstLine(dir + "/memory.pressure", &line) ) &&
+         !readFirstLine("/proc/pressure/memory", &line) ) {
+        return false;
+    }
+
+    return std::sscanf(line.c_str(), "some avg10=%lf", pressure) == 1;
+}
+
+// Never destroyed: it may be used by threads outliving any static object.
+const CGroupInfo*
+getCGroup()
+{
+    static const CGroupInfo* cgroup = new CGroupInfo;
+
+    return cgroup;
+}
+#endif // __NATRON_LINUX__
+
+// The budget is published in MiB so that it fits in a QAtomicInt
+#define BUDGET_UNIT_SHIFT 20
+} // anon
+
+struct MemoryGovernorPrivate;
+
+class MemoryGovernorThread
+    : public QThread
+{
+    MemoryGovernorPrivate* _imp;
+
+public:
+
+    MemoryGovernorThread(MemoryGovernorPrivate* imp)
+        : QThread()
+        , _imp(imp)
+    {
+        setObjectName( QString::fromUtf8("MemoryGovernor") );
+    }
+
+    virtual ~MemoryGovernorThread()
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+};
+
+struct MemoryGovernorPrivate
+{
+    // Protects mustQuit and updateRequested
+    QMutex lock;
+    QWaitCondition cond;
+    bool mustQuit;
+    bool updateRequested;
+
+    // Budget of the caches, in MiB
+    QAtomicInt budget;
+
+    // Budget of the caches while the system is under memory pressure, and the number of samples until
+    // the pressure is looked at again
+    double pressureBudget;
+    int pressureSamplesToSkip;
+
+    MemoryGovernorThread thread;
+
+    MemoryGovernorPrivate()
+        : lock()
+        , cond()
+        , mustQuit(false)
+        , updateRequested(false)
+        , budget(INT_MAX)
+        , pressureBudget(-1.)
+        , pressureSamplesToSkip(0)
+        , thread(this)
+    {
+    }
+
+    void update();
+};
+
+void
+MemoryGovernorPrivate::update()
+{
+    if (!appPTR) {
+        return;
+    }
+    SettingsPtr settings = appPTR->getCurrentSettings();
+    if (!settings) {
+        return;
+    }
+
+    MemoryStatus status;
+    MemoryGovernor::getMemoryStatus(&status);
+
+    // The caches may grow by what is still available, minus what the user wants to keep free for other applications
+    double ramToKeepFree = (double)status.totalRAM * settings->getUnreachableRamPercent();
+    double cachesSize = (double)appPTR->getCachesInMemorySize();
+    double newBudget = cachesSize + (double)status.availableRAM - ramToKeepFree;
+
+    // Under pressure the kernel is already reclaiming memory from the process: give some back before reaching the limit
+    if (status.pressure > NATRON_MEMORY_GOVERNOR_PRESSURE_THRESHOLD) {
+        if ( (pressureBudget < 0.) || (pressureSamplesToSkip <= 0) ) {
+            pressureBudget = cachesSize * ( 1. - NATRON_MEMORY_GOVERNOR_PRESSURE_MAX_SHRINK * std::min(1., status.pressure / 100.) );
+            pressureSamplesToSkip = NATRON_MEMORY_GOVERNOR_PRESSURE_WINDOW_MS / NATRON_MEMORY_GOVERNOR_PERIOD_MS;
+        } else {
+            --pressureSamplesToSkip;
+        }
+        newBudget = std::min(newBudget, pressureBudget);
+    } else {
+        pressureBudget = -1.;
+        pressureSamplesToSkip = 0;
+    }
+    newBudget = std::max(0., newBudget);
+
+    double budgetUnits = newBudget / (double)(1ULL << BUDGET_UNIT_SHIFT);
+    budget.fetchAndStoreRelease( budgetUnits >= (double)INT_MAX ? INT_MAX : (int)budgetUnits );
+
+    if (cachesSize > newBudget) {
+        appPTR->releaseCachesMemory( (std::size_t)(cachesSize - newBudget) );
+    }
+}
+
+void
+MemoryGovernorThread::run()
+{
+    for (;; ) {
+        {
+            QMutexLocker k(&_imp->lock);
+            if (_imp->mustQuit) {
+                return;
+            }
+        }
+
+        _imp->update();
+
+        QMutexLocker k(&_imp->lock);
+        if (!_imp->mustQuit && !_imp->updateRequested) {
+            _imp->cond.wait(&_imp->lock, NATRON_MEMORY_GOVERNOR_PERIOD_MS);
+        }
+        _imp->updateRequested = false;
+    }
+}
+
+MemoryGovernor::MemoryGovernor()
+    : _imp( new MemoryGovernorPrivate() )
+{
+}
+
+MemoryGovernor::~MemoryGovernor()
+{
+    quitThread();
+}
+
+void
+MemoryGovernor::start()
+{
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->mustQuit = false;
+    }
+    _imp->thread.start(QThread::LowPriority);
+}
+
+void
+MemoryGovernor::quitThread()
+{
+    if ( !_imp->thread.isRunning() ) {
+        return;
+    }
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->mustQuit = true;
+        _imp->cond.wakeOne();
+    }
+    _imp->thread.wait();
+}
+
+void
+MemoryGovernor::requestUpdate()
+{
+    QMutexLocker k(&_imp->lock);
+
+    _imp->updateRequested = true;
+    _imp->cond.wakeOne();
+}
+
+std::size_t
+MemoryGovernor::getMemoryBudget() const
+{
+    int budget = (int)_imp->budget;
+
+    if (budget == INT_MAX) {
+        return (std::size_t)-1;
+    }
+
+    return (std::size_t)budget << BUDGET_UNIT_SHIFT;
+}
+
+void
+MemoryGovernor::getMemoryStatus(MemoryStatus* status)
+{
+    status->totalRAM = getSystemTotalRAM_conditionnally();
+    status->availableRAM = std::min( (U64)getAmountFreePhysicalRAM(), status->totalRAM );
+    status->pressure = 0.;
+    status->isCGroupLimited = false;
+
+#if defined(__NATRON_LINUX__)
+    const CGroupInfo* cgroup = getCGroup();
+    U64 limit;
+    if ( cgroup->readLimit(&limit) && (limit < status->totalRAM) ) {
+        status->totalRAM = limit;
+        status->isCGroupLimited = true;
+        U64 usage;
+        if ( cgroup->readUsage(&usage) ) {
+            status->availableRAM = std::min(status->availableRAM, limit > usage ? limit - usage : 0);
+        } else {
+            status->availableRAM = std::min(status->availableRAM, limit);
+        }
+    }
+    double pressure;
+    if ( cgroup->readPressure(&pressure) ) {
+        status->pressure = pressure;
+    }
+#endif
+}
+
+U64
+MemoryGovernor::getTotalRAM()
+{
+    U64 totalRAM = getSystemTotalRAM_conditionnally();
+
+#if defined(__NATRON_LINUX__)
+    U64 limit;
+    if ( getCGroup()->readLimit(&limit) ) {
+        totalRAM = std::min(totalRAM, limit);
+    }
+#endif
+
+    return totalRAM;
+}
+
+NATRON_NAMESPACE_EXIT
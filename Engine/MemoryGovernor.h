@@ -0,0 +1,144 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_MEMORYGOVERNOR_H
+#define NATRON_ENGINE_MEMORYGOVERNOR_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+// Interval, in milliseconds, at which the governor samples the memory state of the system
+#define NATRON_MEMORY_GOVERNOR_PERIOD_MS 250
+
+// Memory pressure (percentage of time some tasks were stalled on memory over the last 10 seconds, see PSI) above which
+// the caches start shrinking even though the memory limit is not reached yet
+#define NATRON_MEMORY_GOVERNOR_PRESSURE_THRESHOLD 5.
+
+// Fraction of the caches released each period when the memory pressure reaches 100%. Lower pressures release proportionally less.
+#define NATRON_MEMORY_GOVERNOR_PRESSURE_MAX_SHRINK 0.5
+
+// Fraction of the budget by which the caches may exceed it before an allocation evicts entries itself instead of
+// leaving it to the governor
+#define NATRON_MEMORY_GOVERNOR_HARD_LIMIT_MARGIN 0.1
+
+NATRON_NAMESPACE_ENTER
+
+struct MemoryGovernorPrivate;
+
+/**
+ * @brief The memory state of the process, as seen by the memory governor.
+ **/
+struct MemoryStatus
+{
+    // The RAM the process may use: the physical RAM, or the memory limit of its cgroup if lower
+    U64 totalRAM;
+
+    // The RAM that can still be allocated before reaching totalRAM
+    U64 availableRAM;
+
+    // The "some avg10" memory pressure of the cgroup (or of the system) in percent, 0 if unknown
+    double pressure;
+
+    // True if totalRAM is the limit of a cgroup
+    bool isCGroupLimited;
+
+    MemoryStatus()
+        : totalRAM(0)
+        , availableRAM(0)
+        , pressure(0.)
+        , isCGroupLimited(false)
+    {
+    }
+};
+
+/**
+ * @brief Keeps the memory used by the caches within what the process may use without being swapped or killed.
+ * A background thread periodically reads the free physical RAM and, on Linux, the memory limit, usage and pressure
+ * (PSI) of the cgroup of the process (v2, or v1 as a fallback). This is what matters in containers, where the
+ * physical RAM of the host is irrelevant.
+ *
+ * From these it computes the number of bytes the caches may occupy, which is published so that the allocation path
+ * can read it without any system call (see getMemoryBudget()). When the caches are over budget, the governor evicts
+ * entries in batches from the node cache and the viewer cache, in proportion of their size.
+ *
+ * This class is MT-safe.
+ **/
+class MemoryGovernor
+{
+public:
+
+    MemoryGovernor();
+
+    ~MemoryGovernor();
+
+    /**
+     * @brief Starts the governor thread. The budget is unlimited until the first sample is taken.
+     **/
+    void start();
+
+    /**
+     * @brief Stops the governor thread and waits for it to return. Must be called before the caches are destroyed.
+     **/
+    void quitThread();
+
+    /**
+     * @brief Wakes the governor up so that it samples the memory state now instead of at the end of its period.
+     **/
+    void requestUpdate();
+
+    /**
+     * @brief Returns the number of bytes the caches may occupy in RAM, as computed by the last sample.
+     * This is a single atomic read and can be called on the allocation path.
+     **/
+    std::size_t getMemoryBudget() const;
+
+    /**
+     * @brief Reads the current memory state of the process.
+     **/
+    static void getMemoryStatus(MemoryStatus* status);
+
+    /**
+     * @brief Returns the RAM the process may use: the physical RAM (see getSystemTotalRAM_conditionnally()),
+     * or the memory limit of its cgroup if lower.
+     **/
+    static U64 getTotalRAM();
+
+private:
+
+    boost::scoped_ptr<MemoryGovernorPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_MEMORYGOVERNOR_H
@@ -57,13 +57,13 @@ QString printAsRAM(U64 bytes);
  * determined on this OS.
  */
 std::size_t getPeakRSS( );
+#endif // 0
 
 /**
  * Returns the current resident set size (physical memory use) measured
  * in bytes, or zero if the value cannot be determined on this OS.
  */
 std::size_t getCurrentRSS( );
-#endif // 0
 
 std::size_t getAmountFreePhysicalRAM();
 
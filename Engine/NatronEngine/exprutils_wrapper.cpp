@@ -226,6 +226,53 @@ static PyObject* Sbk_ExprUtilsFunc_cellnoise(PyObject* self, PyObject* pyArg)
         return 0;
 }
 
+static PyObject* Sbk_ExprUtilsFunc_cellnoiseArray(PyObject* self, PyObject* pyArg)
+{
+    PyObject* pyResult = 0;
+    int overloadId = -1;
+    PythonToCppFunc pythonToCpp;
+    SBK_UNUSED(pythonToCpp)
+
+    // Overloaded function decisor
+    // 0: cellnoiseArray(PyObject*)
+    if (true) {
+        overloadId = 0; // cellnoiseArray(PyObject*)
+    }
+
+    // Function signature not found.
+    if (overloadId == -1) goto Sbk_ExprUtilsFunc_cellnoiseArray_TypeError;
+
+    // Call function/method
+    {
+
+        if (!PyErr_Occurred()) {
+            // cellnoiseArray(PyObject*)
+            // Begin code injection
+
+            pyResult = ExprUtils::cellnoiseArray(pyArg);
+            if (!pyResult) {
+                return 0;
+            }
+            return pyResult;
+
+            // End of code injection
+
+
+        }
+    }
+
+    if (PyErr_Occurred() || !pyResult) {
+        Py_XDECREF(pyResult);
+        return 0;
+    }
+    return pyResult;
+
+    Sbk_ExprUtilsFunc_cellnoiseArray_TypeError:
+        const char* overloads[] = {"PyObject", 0};
+        Shiboken::setErrorAboutWrongArguments(pyArg, "NatronEngine.ExprUtils.cellnoiseArray", overloads);
+        return 0;
+}
+
 static PyObject* Sbk_ExprUtilsFunc_cfbm(PyObject* self, PyObject* args, PyObject* kwds)
 {
     PyObject* pyResult = 0;
@@ -961,6 +1008,116 @@ static PyObject* Sbk_ExprUtilsFunc_fbm4(PyObject* self, PyObject* args, PyObject
         return 0;
 }
 
+static PyObject* Sbk_ExprUtilsFunc_fbmArray(PyObject* self, PyObject* args, PyObject* kwds)
+{
+    PyObject* pyResult = 0;
+    int overloadId = -1;
+    PythonToCppFunc pythonToCpp[] = { 0, 0, 0, 0 };
+    SBK_UNUSED(pythonToCpp)
+    int numNamedArgs = (kwds ? PyDict_Size(kwds) : 0);
+    int numArgs = PyTuple_GET_SIZE(args);
+    PyObject* pyArgs[] = {0, 0, 0, 0};
+
+    // invalid argument lengths
+    if (numArgs + numNamedArgs > 4) {
+        PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.fbmArray(): too many arguments");
+        return 0;
+    } else if (numArgs < 1) {
+        PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.fbmArray(): not enough arguments");
+        return 0;
+    }
+
+    if (!PyArg_ParseTuple(args, "|OOOO:fbmArray", &(pyArgs[0]), &(pyArgs[1]), &(pyArgs[2]), &(pyArgs[3])))
+        return 0;
+
+
+    // Overloaded function decisor
+    // 0: fbmArray(PyObject*,int,double,double)
+    if (true) {
+        if (numArgs == 1) {
+            overloadId = 0; // fbmArray(PyObject*,int,double,double)
+        } else if ((pythonToCpp[1] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<int>(), (pyArgs[1])))) {
+            if (numArgs == 2) {
+                overloadId = 0; // fbmArray(PyObject*,int,double,double)
+            } else if ((pythonToCpp[2] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[2])))) {
+                if (numArgs == 3) {
+                    overloadId = 0; // fbmArray(PyObject*,int,double,double)
+                } else if ((pythonToCpp[3] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[3])))) {
+                    overloadId = 0; // fbmArray(PyObject*,int,double,double)
+                }
+            }
+        }
+    }
+
+    // Function signature not found.
+    if (overloadId == -1) goto Sbk_ExprUtilsFunc_fbmArray_TypeError;
+
+    // Call function/method
+    {
+        if (kwds) {
+            PyObject* value = PyDict_GetItemString(kwds, "octaves");
+            if (value && pyArgs[1]) {
+                PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.fbmArray(): got multiple values for keyword argument 'octaves'.");
+                return 0;
+            } else if (value) {
+                pyArgs[1] = value;
+                if (!(pythonToCpp[1] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<int>(), (pyArgs[1]))))
+                    goto Sbk_ExprUtilsFunc_fbmArray_TypeError;
+            }
+            value = PyDict_GetItemString(kwds, "lacunarity");
+            if (value && pyArgs[2]) {
+                PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.fbmArray(): got multiple values for keyword argument 'lacunarity'.");
+                return 0;
+            } else if (value) {
+                pyArgs[2] = value;
+                if (!(pythonToCpp[2] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[2]))))
+                    goto Sbk_ExprUtilsFunc_fbmArray_TypeError;
+            }
+            value = PyDict_GetItemString(kwds, "gain");
+            if (value && pyArgs[3]) {
+                PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.fbmArray(): got multiple values for keyword argument 'gain'.");
+                return 0;
+            } else if (value) {
+                pyArgs[3] = value;
+                if (!(pythonToCpp[3] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[3]))))
+                    goto Sbk_ExprUtilsFunc_fbmArray_TypeError;
+            }
+        }
+        int cppArg1 = 6;
+        if (pythonToCpp[1]) pythonToCpp[1](pyArgs[1], &cppArg1);
+        double cppArg2 = 2.;
+        if (pythonToCpp[2]) pythonToCpp[2](pyArgs[2], &cppArg2);
+        double cppArg3 = 0.5;
+        if (pythonToCpp[3]) pythonToCpp[3](pyArgs[3], &cppArg3);
+
+        if (!PyErr_Occurred()) {
+            // fbmArray(PyObject*,int,double,double)
+            // Begin code injection
+
+            pyResult = ExprUtils::fbmArray(pyArgs[1-1], cppArg1, cppArg2, cppArg3);
+            if (!pyResult) {
+                return 0;
+            }
+            return pyResult;
+
+            // End of code injection
+
+
+        }
+    }
+
+    if (PyErr_Occurred() || !pyResult) {
+        Py_XDECREF(pyResult);
+        return 0;
+    }
+    return pyResult;
+
+    Sbk_ExprUtilsFunc_fbmArray_TypeError:
+        const char* overloads[] = {"PyObject, int = 6, float = 2., float = 0.5", 0};
+        Shiboken::setErrorAboutWrongArguments(args, "NatronEngine.ExprUtils.fbmArray", overloads);
+        return 0;
+}
+
 static PyObject* Sbk_ExprUtilsFunc_gaussstep(PyObject* self, PyObject* args)
 {
     PyObject* pyResult = 0;
@@ -1264,6 +1421,53 @@ static PyObject* Sbk_ExprUtilsFunc_noise(PyObject* self, PyObject* pyArg)
         return 0;
 }
 
+static PyObject* Sbk_ExprUtilsFunc_noiseArray(PyObject* self, PyObject* pyArg)
+{
+    PyObject* pyResult = 0;
+    int overloadId = -1;
+    PythonToCppFunc pythonToCpp;
+    SBK_UNUSED(pythonToCpp)
+
+    // Overloaded function decisor
+    // 0: noiseArray(PyObject*)
+    if (true) {
+        overloadId = 0; // noiseArray(PyObject*)
+    }
+
+    // Function signature not found.
+    if (overloadId == -1) goto Sbk_ExprUtilsFunc_noiseArray_TypeError;
+
+    // Call function/method
+    {
+
+        if (!PyErr_Occurred()) {
+            // noiseArray(PyObject*)
+            // Begin code injection
+
+            pyResult = ExprUtils::noiseArray(pyArg);
+            if (!pyResult) {
+                return 0;
+            }
+            return pyResult;
+
+            // End of code injection
+
+
+        }
+    }
+
+    if (PyErr_Occurred() || !pyResult) {
+        Py_XDECREF(pyResult);
+        return 0;
+    }
+    return pyResult;
+
+    Sbk_ExprUtilsFunc_noiseArray_TypeError:
+        const char* overloads[] = {"PyObject", 0};
+        Shiboken::setErrorAboutWrongArguments(pyArg, "NatronEngine.ExprUtils.noiseArray", overloads);
+        return 0;
+}
+
 static PyObject* Sbk_ExprUtilsFunc_pnoise(PyObject* self, PyObject* args)
 {
     PyObject* pyResult = 0;
@@ -1701,6 +1905,116 @@ static PyObject* Sbk_ExprUtilsFunc_turbulence(PyObject* self, PyObject* args, Py
         return 0;
 }
 
+static PyObject* Sbk_ExprUtilsFunc_turbulenceArray(PyObject* self, PyObject* args, PyObject* kwds)
+{
+    PyObject* pyResult = 0;
+    int overloadId = -1;
+    PythonToCppFunc pythonToCpp[] = { 0, 0, 0, 0 };
+    SBK_UNUSED(pythonToCpp)
+    int numNamedArgs = (kwds ? PyDict_Size(kwds) : 0);
+    int numArgs = PyTuple_GET_SIZE(args);
+    PyObject* pyArgs[] = {0, 0, 0, 0};
+
+    // invalid argument lengths
+    if (numArgs + numNamedArgs > 4) {
+        PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.turbulenceArray(): too many arguments");
+        return 0;
+    } else if (numArgs < 1) {
+        PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.turbulenceArray(): not enough arguments");
+        return 0;
+    }
+
+    if (!PyArg_ParseTuple(args, "|OOOO:turbulenceArray", &(pyArgs[0]), &(pyArgs[1]), &(pyArgs[2]), &(pyArgs[3])))
+        return 0;
+
+
+    // Overloaded function decisor
+    // 0: turbulenceArray(PyObject*,int,double,double)
+    if (true) {
+        if (numArgs == 1) {
+            overloadId = 0; // turbulenceArray(PyObject*,int,double,double)
+        } else if ((pythonToCpp[1] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<int>(), (pyArgs[1])))) {
+            if (numArgs == 2) {
+                overloadId = 0; // turbulenceArray(PyObject*,int,double,double)
+            } else if ((pythonToCpp[2] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[2])))) {
+                if (numArgs == 3) {
+                    overloadId = 0; // turbulenceArray(PyObject*,int,double,double)
+                } else if ((pythonToCpp[3] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[3])))) {
+                    overloadId = 0; // turbulenceArray(PyObject*,int,double,double)
+                }
+            }
+        }
+    }
+
+    // Function signature not found.
+    if (overloadId == -1) goto Sbk_ExprUtilsFunc_turbulenceArray_TypeError;
+
+    // Call function/method
+    {
+        if (kwds) {
+            PyObject* value = PyDict_GetItemString(kwds, "octaves");
+            if (value && pyArgs[1]) {
+                PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.turbulenceArray(): got multiple values for keyword argument 'octaves'.");
+                return 0;
+            } else if (value) {
+                pyArgs[1] = value;
+                if (!(pythonToCpp[1] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<int>(), (pyArgs[1]))))
+                    goto Sbk_ExprUtilsFunc_turbulenceArray_TypeError;
+            }
+            value = PyDict_GetItemString(kwds, "lacunarity");
+            if (value && pyArgs[2]) {
+                PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.turbulenceArray(): got multiple values for keyword argument 'lacunarity'.");
+                return 0;
+            } else if (value) {
+                pyArgs[2] = value;
+                if (!(pythonToCpp[2] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[2]))))
+                    goto Sbk_ExprUtilsFunc_turbulenceArray_TypeError;
+            }
+            value = PyDict_GetItemString(kwds, "gain");
+            if (value && pyArgs[3]) {
+                PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.turbulenceArray(): got multiple values for keyword argument 'gain'.");
+                return 0;
+            } else if (value) {
+                pyArgs[3] = value;
+                if (!(pythonToCpp[3] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[3]))))
+                    goto Sbk_ExprUtilsFunc_turbulenceArray_TypeError;
+            }
+        }
+        int cppArg1 = 6;
+        if (pythonToCpp[1]) pythonToCpp[1](pyArgs[1], &cppArg1);
+        double cppArg2 = 2.;
+        if (pythonToCpp[2]) pythonToCpp[2](pyArgs[2], &cppArg2);
+        double cppArg3 = 0.5;
+        if (pythonToCpp[3]) pythonToCpp[3](pyArgs[3], &cppArg3);
+
+        if (!PyErr_Occurred()) {
+            // turbulenceArray(PyObject*,int,double,double)
+            // Begin code injection
+
+            pyResult = ExprUtils::turbulenceArray(pyArgs[1-1], cppArg1, cppArg2, cppArg3);
+            if (!pyResult) {
+                return 0;
+            }
+            return pyResult;
+
+            // End of code injection
+
+
+        }
+    }
+
+    if (PyErr_Occurred() || !pyResult) {
+        Py_XDECREF(pyResult);
+        return 0;
+    }
+    return pyResult;
+
+    Sbk_ExprUtilsFunc_turbulenceArray_TypeError:
+        const char* overloads[] = {"PyObject, int = 6, float = 2., float = 0.5", 0};
+        Shiboken::setErrorAboutWrongArguments(args, "NatronEngine.ExprUtils.turbulenceArray", overloads);
+        return 0;
+}
+
 static PyObject* Sbk_ExprUtilsFunc_vfbm(PyObject* self, PyObject* args, PyObject* kwds)
 {
     PyObject* pyResult = 0;
@@ -2198,6 +2512,7 @@ static PyMethodDef Sbk_ExprUtils_methods[] = {
     {"boxstep", (PyCFunction)Sbk_ExprUtilsFunc_boxstep, METH_VARARGS|METH_STATIC},
     {"ccellnoise", (PyCFunction)Sbk_ExprUtilsFunc_ccellnoise, METH_O|METH_STATIC},
     {"cellnoise", (PyCFunction)Sbk_ExprUtilsFunc_cellnoise, METH_O|METH_STATIC},
+    {"cellnoiseArray", (PyCFunction)Sbk_ExprUtilsFunc_cellnoiseArray, METH_O|METH_STATIC},
     {"cfbm", (PyCFunction)Sbk_ExprUtilsFunc_cfbm, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
     {"cfbm4", (PyCFunction)Sbk_ExprUtilsFunc_cfbm4, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
     {"cnoise", (PyCFunction)Sbk_ExprUtilsFunc_cnoise, METH_O|METH_STATIC},
@@ -2205,17 +2520,20 @@ static PyMethodDef Sbk_ExprUtils_methods[] = {
     {"cturbulence", (PyCFunction)Sbk_ExprUtilsFunc_cturbulence, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
     {"fbm", (PyCFunction)Sbk_ExprUtilsFunc_fbm, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
     {"fbm4", (PyCFunction)Sbk_ExprUtilsFunc_fbm4, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
+    {"fbmArray", (PyCFunction)Sbk_ExprUtilsFunc_fbmArray, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
     {"gaussstep", (PyCFunction)Sbk_ExprUtilsFunc_gaussstep, METH_VARARGS|METH_STATIC},
     {"hash", (PyCFunction)Sbk_ExprUtilsFunc_hash, METH_O|METH_STATIC},
     {"linearstep", (PyCFunction)Sbk_ExprUtilsFunc_linearstep, METH_VARARGS|METH_STATIC},
     {"mix", (PyCFunction)Sbk_ExprUtilsFunc_mix, METH_VARARGS|METH_STATIC},
     {"noise", (PyCFunction)Sbk_ExprUtilsFunc_noise, METH_O|METH_STATIC},
+    {"noiseArray", (PyCFunction)Sbk_ExprUtilsFunc_noiseArray, METH_O|METH_STATIC},
     {"pnoise", (PyCFunction)Sbk_ExprUtilsFunc_pnoise, METH_VARARGS|METH_STATIC},
     {"remap", (PyCFunction)Sbk_ExprUtilsFunc_remap, METH_VARARGS|METH_STATIC},
     {"smoothstep", (PyCFunction)Sbk_ExprUtilsFunc_smoothstep, METH_VARARGS|METH_STATIC},
     {"snoise", (PyCFunction)Sbk_ExprUtilsFunc_snoise, METH_O},
     {"snoise4", (PyCFunction)Sbk_ExprUtilsFunc_snoise4, METH_O|METH_STATIC},
     {"turbulence", (PyCFunction)Sbk_ExprUtilsFunc_turbulence, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
+    {"turbulenceArray", (PyCFunction)Sbk_ExprUtilsFunc_turbulenceArray, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
     {"vfbm", (PyCFunction)Sbk_ExprUtilsFunc_vfbm, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
     {"vfbm4", (PyCFunction)Sbk_ExprUtilsFunc_vfbm4, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
     {"vnoise", (PyCFunction)Sbk_ExprUtilsFunc_vnoise, METH_O|METH_STATIC},
@@ -965,6 +965,19 @@ Node::removeAllImagesFromCache(bool blocking)
     appPTR->removeAllCacheEntriesForHolder(this, blocking);
 }
 
+void
+Node::refreshCachePolicy()
+{
+    KnobChoicePtr priorityKnob = _imp->cachePriority.lock();
+    KnobIntPtr budgetKnob = _imp->cacheBudget.lock();
+
+    if (!priorityKnob || !budgetKnob) {
+        return;
+    }
+    std::size_t budget = (std::size_t)std::max(0, budgetKnob->getValue()) * 1024 * 1024;
+    appPTR->setCachePolicyForHolder( this, budget, (CachePriorityEnum)priorityKnob->getValue() );
+}
+
 void
 Node::doComputeHashOnMainThread()
 {
@@ -1020,6 +1033,7 @@ Node::loadKnobs(const NodeSerialization & serialization,
 
     setKnobsAge( serialization.getKnobsAge() );
 
+    refreshCachePolicy();
 
     _imp->effect->onKnobsLoaded();
 }
@@ -1759,6 +1773,42 @@ Node::createNodePage(const KnobPagePtr& settingsPage)
     _imp->forceCaching = fCaching;
     settingsPage->addKnob(fCaching);
 
+    KnobChoicePtr cachePriority = AppManager::createKnob<KnobChoice>(_imp->effect.get(), tr("Cache priority"), 1, false);
+    cachePriority->setName("cachePriority");
+    {
+        std::vector<ChoiceOption> entries;
+        entries.push_back( ChoiceOption("Normal", "", tr("The images of this node are evicted from the cache first if they are the cheapest to render again relative to their size.").toStdString() ) );
+        entries.push_back( ChoiceOption("High", "", tr("The images of this node are kept in the cache longer than the images of the nodes with a normal priority "
+                                                       "that were used about as recently.").toStdString() ) );
+        entries.push_back( ChoiceOption("Pinned", "", tr("The images of this node are never evicted from the cache to make room for other images, "
+                                                         "unless they exceed the cache budget of this node or the images of all pinned nodes fill "
+                                                         "half of the RAM portion of the cache.").toStdString() ) );
+        cachePriority->populateChoices(entries);
+    }
+    cachePriority->setDefaultValue( (int)eCachePriorityNormal );
+    cachePriority->setAnimationEnabled(false);
+    cachePriority->setAddNewLine(false);
+    cachePriority->setIsPersistent(true);
+    cachePriority->setEvaluateOnChange(false);
+    cachePriority->setHintToolTip( tr("Controls how the images rendered by this node are evicted from the cache when it is full.") );
+    _imp->cachePriority = cachePriority;
+    settingsPage->addKnob(cachePriority);
+
+    KnobIntPtr cacheBudget = AppManager::createKnob<KnobInt>(_imp->effect.get(), tr("Cache budget (MB)"), 1, false);
+    cacheBudget->setName("cacheBudget");
+    cacheBudget->setDefaultValue(0);
+    cacheBudget->setMinimum(0);
+    cacheBudget->setDisplayMinimum(0);
+    cacheBudget->setDisplayMaximum(4096);
+    cacheBudget->setAnimationEnabled(false);
+    cacheBudget->setIsPersistent(true);
+    cacheBudget->setEvaluateOnChange(false);
+    cacheBudget->setHintToolTip( tr("Maximum amount of RAM, in megabytes, the images rendered by this node may occupy in the cache. "
+                                    "When it is exceeded, the images of this node that are the cheapest to render again are evicted first. "
+                                    "0 means no limit other than the size of the cache.") );
+    _imp->cacheBudget = cacheBudget;
+    settingsPage->addKnob(cacheBudget);
+
     KnobBoolPtr previewEnabled = AppManager::createKnob<KnobBool>(_imp->effect.get(), tr("Preview"), 1, false);
     assert(previewEnabled);
     previewEnabled->setDefaultValue( makePreviewByDefault() );
@@ -2451,6 +2501,9 @@ Node::initializeKnobs(bool loadingSerialization)
 
     _imp->knobsInitialized = true;
 
+    // The parameters may have been given values from a preset or by the plug-in
+    refreshCachePolicy();
+
     Q_EMIT knobsInitialized();
 } // initializeKnobs
 
@@ -4946,6 +4999,8 @@ Node::onEffectKnobValueChanged(KnobI* what,
         }
     } else if ( what == _imp->hideInputs.lock().get() ) {
         Q_EMIT hideInputsKnobChanged( _imp->hideInputs.lock()->getValue() );
+    } else if ( ( what == _imp->cachePriority.lock().get() ) || ( what == _imp->cacheBudget.lock().get() ) ) {
+        refreshCachePolicy();
     } else if ( _imp->effect->isReader() && (what->getName() == kReadOIIOAvailableViewsKnobName) ) {
         refreshCreatedViews(what, false /*silent*/);
     } else if ( what == _imp->refreshInfoButton.lock().get() ||
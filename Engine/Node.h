@@ -1281,6 +1281,11 @@ public:
     void removeAllImagesFromCacheWithMatchingIDAndDifferentKey(U64 nodeHashKey);
     void removeAllImagesFromCache(bool blocking);
 
+    /**
+     * @brief Forwards the values of the "Cache priority" and "Cache budget" parameters to the caches
+     **/
+    void refreshCachePolicy();
+
     bool isDraftModeUsed() const;
     bool isInputRelatedDataDirty() const;
 
@@ -751,6 +751,7 @@ Node::doDestroyNodeInternalEnd(bool autoReconnect)
     ///Remove all images in the cache associated to this node
     ///This will not remove from the disk cache if the project is closing
     removeAllImagesFromCache(false);
+    appPTR->removeCachePolicyForHolder(this);
 
     AppInstancePtr app = getApp();
     if (app) {
@@ -768,6 +769,7 @@ Node::doDestroyNodeInternalEnd(bool autoReconnect)
 
     ///Kill the effect
     if (_imp->effect) {
+        _imp->effect->onEffectAboutToBeDestroyed();
         _imp->effect->clearPluginMemoryChunks();
     }
     _imp->effect.reset();
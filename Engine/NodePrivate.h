@@ -192,6 +192,8 @@ public:
         , refreshInfoButton()
         , useFullScaleImagesWhenRenderScaleUnsupported()
         , forceCaching()
+        , cachePriority()
+        , cacheBudget()
         , hideInputs()
         , beforeFrameRender()
         , beforeRender()
@@ -386,6 +388,8 @@ public:
     KnobButtonWPtr refreshInfoButton;
     KnobBoolWPtr useFullScaleImagesWhenRenderScaleUnsupported;
     KnobBoolWPtr forceCaching;
+    KnobChoiceWPtr cachePriority;
+    KnobIntWPtr cacheBudget;
     KnobBoolWPtr hideInputs;
     KnobStringWPtr beforeFrameRender;
     KnobStringWPtr beforeRender;
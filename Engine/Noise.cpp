@@ -19,10 +19,14 @@
 
 #include "Noise.h"
 
+#include <algorithm>
 #include <iostream>
 #ifdef SEEXPR_USE_SSE
 #include <smmintrin.h>
 #endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include <cmath>
 
 #ifndef  SEEXPR_USE_SSE
@@ -236,6 +240,204 @@ void FBM(const T* in, T* out, int octaves, T lacunarity, T gain) {
     }
 }
 
+//! Number of points evaluated together by the batch functions.
+//! The loops over the points of a block are independent so that they can be vectorized.
+#define NOISE_BLOCK_SIZE 16
+
+#ifdef __SSE2__
+//! Multiplies 4 unsigned 32-bit integers, keeping the low 32 bits (_mm_mullo_epi32 requires SSE4.1)
+inline __m128i mulLo32SSE2(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#endif
+
+//! hashReduceChar() of the lattice points of a block, 4 at a time with SSE2
+template <int d>
+void hashReduceCharBlock(const int index[d][NOISE_BLOCK_SIZE], unsigned char lookup[NOISE_BLOCK_SIZE]) {
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i M = _mm_set1_epi32(1664525), C = _mm_set1_epi32(1013904223);
+    for (; i + 4 <= NOISE_BLOCK_SIZE; i += 4) {
+        __m128i seed = _mm_setzero_si128();
+        for (int k = 0; k < d; k++) {
+            __m128i idx = _mm_loadu_si128((const __m128i*)&index[k][i]);
+            seed = _mm_add_epi32(_mm_add_epi32(mulLo32SSE2(seed, M), idx), C);
+        }
+        seed = _mm_xor_si128(seed, _mm_srli_epi32(seed, 11));
+        seed = _mm_xor_si128(seed, _mm_and_si128(_mm_slli_epi32(seed, 7), _mm_set1_epi32((int)0x9d2c5680U)));
+        seed = _mm_xor_si128(seed, _mm_and_si128(_mm_slli_epi32(seed, 15), _mm_set1_epi32((int)0xefc60000U)));
+        seed = _mm_xor_si128(seed, _mm_srli_epi32(seed, 18));
+        __m128i c = _mm_add_epi32(_mm_srli_epi32(_mm_and_si128(seed, _mm_set1_epi32(0xff0000)), 4), _mm_and_si128(seed, _mm_set1_epi32(0xff)));
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, c);
+        for (int j = 0; j < 4; j++) lookup[i + j] = (unsigned char)(lanes[j] & 0xff);
+    }
+#endif
+    for (; i < NOISE_BLOCK_SIZE; i++) {
+        int latticeIndex[d];
+        for (int k = 0; k < d; k++) latticeIndex[k] = index[k][i];
+        lookup[i] = hashReduceChar<d>(latticeIndex);
+    }
+}
+
+//! noiseHelper() of the points of a block. X[k][i] is the coordinate k of the point i.
+template <int d, class T, bool periodic>
+void noiseHelperBlock(const T X[d][NOISE_BLOCK_SIZE], const int* period, T result[NOISE_BLOCK_SIZE]) {
+    // find lattice index
+    T weights[2][d][NOISE_BLOCK_SIZE];  // lower and upper weights
+    int index[d][NOISE_BLOCK_SIZE];
+    for (int k = 0; k < d; k++) {
+        for (int i = 0; i < NOISE_BLOCK_SIZE; i++) {
+            // same as floorSSE() within the int range, that index is limited to anyway, but without a call to floor()
+            T f = (T)(int)X[k][i];
+            f -= (f > X[k][i]);
+            index[k][i] = (int)f;
+            if (periodic) {
+                index[k][i] %= period[k];
+                if (index[k][i] < 0) index[k][i] += period[k];
+            }
+            weights[0][k][i] = X[k][i] - f;
+            weights[1][k][i] = weights[0][k][i] - 1;  // dist to cell with index one above
+        }
+    }
+    // compute function values propagated from zero from each node
+    int num = 1 << d;
+    T vals[1 << d][NOISE_BLOCK_SIZE];
+    for (int dummy = 0; dummy < num; dummy++) {
+        int latticeIndex[d][NOISE_BLOCK_SIZE];
+        for (int k = 0; k < d; k++) {
+            int offset = ((dummy & (1 << k)) != 0);
+            for (int i = 0; i < NOISE_BLOCK_SIZE; i++) latticeIndex[k][i] = index[k][i] + offset;
+        }
+        // hash to get representative gradient vector
+        unsigned char lookup[NOISE_BLOCK_SIZE];
+        hashReduceCharBlock<d>(latticeIndex, lookup);
+        const T* weight[d];
+        for (int k = 0; k < d; k++) weight[k] = weights[((dummy & (1 << k)) != 0)][k];
+        for (int i = 0; i < NOISE_BLOCK_SIZE; i++) {
+            const double* grad = NOISE_TABLES<d>::g[lookup[i]];
+            T val = 0;
+            for (int k = 0; k < d; k++) val += grad[k] * weight[k][i];
+            vals[dummy][i] = val;
+        }
+    }
+    // compute linear interpolation coefficients
+    T alphas[d][NOISE_BLOCK_SIZE];
+    for (int k = 0; k < d; k++)
+        for (int i = 0; i < NOISE_BLOCK_SIZE; i++) alphas[k][i] = s_curve(weights[0][k][i]);
+    // perform multilinear interpolation (i.e. linear, bilinear, trilinear, quadralinear)
+    for (int newd = d - 1; newd >= 0; newd--) {
+        int newnum = 1 << newd;
+        int k = (d - newd - 1);
+        const T* alpha = alphas[k];
+        for (int dummy = 0; dummy < newnum; dummy++) {
+            int index = dummy * (1 << (d - newd));
+            int otherIndex = index + (1 << k);
+            T* val = vals[index];
+            const T* otherVal = vals[otherIndex];
+            for (int i = 0; i < NOISE_BLOCK_SIZE; i++) val[i] = (T(1) - alpha[i]) * val[i] + alpha[i] * otherVal[i];
+        }
+    }
+    // return reduced version
+    for (int i = 0; i < NOISE_BLOCK_SIZE; i++) result[i] = vals[0][i];
+}
+
+//! Noise() or PNoise() of the points of a block, out[k][i] is the value k of the point i
+template <int d_in, int d_out, class T, bool periodic>
+void noiseBlock(const T in[d_in][NOISE_BLOCK_SIZE], const int* period, T out[d_out][NOISE_BLOCK_SIZE]) {
+    T P[d_in][NOISE_BLOCK_SIZE];
+    for (int k = 0; k < d_in; k++)
+        for (int i = 0; i < NOISE_BLOCK_SIZE; i++) P[k][i] = in[k][i];
+
+    int o = 0;
+    while (1) {
+        noiseHelperBlock<d_in, T, periodic>(P, period, out[o]);
+        if (++o >= d_out) break;
+        // coverity[dead_error_begin]
+        for (int k = 0; k < d_out; k++)
+            for (int i = 0; i < NOISE_BLOCK_SIZE; i++) P[k][i] += (T)1000;
+    }
+}
+
+//! Loads the coordinates of up to NOISE_BLOCK_SIZE points, returns the number of points loaded.
+//! The remaining points of the block are set to 0: all the points of a block are always computed.
+template <int d, class T>
+int loadBlock(const T* in, int start, int count, T block[d][NOISE_BLOCK_SIZE]) {
+    int n = std::min(NOISE_BLOCK_SIZE, count - start);
+    for (int i = 0; i < NOISE_BLOCK_SIZE; i++)
+        for (int k = 0; k < d; k++) block[k][i] = i < n ? in[(start + i) * d + k] : 0;
+    return n;
+}
+
+//! Stores the values of the n first points of a block
+template <int d, class T>
+void storeBlock(const T block[d][NOISE_BLOCK_SIZE], int start, int n, T* out) {
+    for (int i = 0; i < n; i++)
+        for (int k = 0; k < d; k++) out[(start + i) * d + k] = block[k][i];
+}
+
+template <int d_in, int d_out, class T, bool periodic>
+void noiseBatchHelper(const T* in, const int* period, T* out, int count) {
+    for (int start = 0; start < count; start += NOISE_BLOCK_SIZE) {
+        T P[d_in][NOISE_BLOCK_SIZE];
+        T result[d_out][NOISE_BLOCK_SIZE];
+        int n = loadBlock<d_in>(in, start, count, P);
+        noiseBlock<d_in, d_out, T, periodic>(P, period, result);
+        storeBlock<d_out>(result, start, n, out);
+    }
+}
+
+template <int d_in, int d_out, class T>
+void NoiseBatch(const T* in, T* out, int count) {
+    noiseBatchHelper<d_in, d_out, T, false>(in, 0, out, count);
+}
+
+template <int d_in, int d_out, class T>
+void PNoiseBatch(const T* in, const int* period, T* out, int count) {
+    noiseBatchHelper<d_in, d_out, T, true>(in, period, out, count);
+}
+
+template <int d_in, int d_out, bool turbulence, class T>
+void FBMBatch(const T* in, T* out, int count, int octaves, T lacunarity, T gain) {
+    for (int start = 0; start < count; start += NOISE_BLOCK_SIZE) {
+        T P[d_in][NOISE_BLOCK_SIZE];
+        T result[d_out][NOISE_BLOCK_SIZE];
+        int n = loadBlock<d_in>(in, start, count, P);
+        for (int k = 0; k < d_out; k++)
+            for (int i = 0; i < NOISE_BLOCK_SIZE; i++) result[k][i] = 0;
+
+        T scale = 1;
+        int octave = 0;
+        while (1) {
+            T localResult[d_out][NOISE_BLOCK_SIZE];
+            noiseBlock<d_in, d_out, T, false>(P, 0, localResult);
+            for (int k = 0; k < d_out; k++) {
+                if (turbulence)
+                    for (int i = 0; i < NOISE_BLOCK_SIZE; i++) result[k][i] += fabs(localResult[k][i]) * scale;
+                else
+                    for (int i = 0; i < NOISE_BLOCK_SIZE; i++) result[k][i] += localResult[k][i] * scale;
+            }
+            if (++octave >= octaves) break;
+            scale *= gain;
+            for (int k = 0; k < d_in; k++) {
+                for (int i = 0; i < NOISE_BLOCK_SIZE; i++) {
+                    P[k][i] *= lacunarity;
+                    P[k][i] += (T)1234;
+                }
+            }
+        }
+        storeBlock<d_out>(result, start, n, out);
+    }
+}
+
+template <int d_in, int d_out, class T>
+void CellNoiseBatch(const T* in, T* out, int count) {
+    // Cellular noise does no interpolation: the hash is all there is to compute
+    for (int i = 0; i < count; i++) CellNoise<d_in, d_out>(in + i * d_in, out + i * d_out);
+}
+
 // Explicit instantiations
 template void CellNoise<3, 1, double>(const double*, double*);
 template void CellNoise<3, 3, double>(const double*, double*);
@@ -252,6 +454,18 @@ template void FBM<3, 3, false, double>(const double*, double*, int, double, doub
 template void FBM<3, 3, true, double>(const double*, double*, int, double, double);
 template void FBM<4, 1, false, double>(const double*, double*, int, double, double);
 template void FBM<4, 3, false, double>(const double*, double*, int, double, double);
+template void CellNoiseBatch<3, 1, double>(const double*, double*, int);
+template void NoiseBatch<1, 1, double>(const double*, double*, int);
+template void NoiseBatch<2, 1, double>(const double*, double*, int);
+template void NoiseBatch<3, 1, double>(const double*, double*, int);
+template void NoiseBatch<4, 1, double>(const double*, double*, int);
+template void NoiseBatch<3, 3, double>(const double*, double*, int);
+template void NoiseBatch<4, 3, double>(const double*, double*, int);
+template void PNoiseBatch<3, 1, double>(const double*, const int*, double*, int);
+template void FBMBatch<3, 1, false, double>(const double*, double*, int, int, double, double);
+template void FBMBatch<3, 1, true, double>(const double*, double*, int, int, double, double);
+template void FBMBatch<3, 3, false, double>(const double*, double*, int, int, double, double);
+template void FBMBatch<4, 1, false, double>(const double*, double*, int, int, double, double);
 NATRON_NAMESPACE_EXIT
 
 #ifdef MAINTEST
@@ -38,6 +38,22 @@ void FBM(const T* in, T* out, int octaves, T lacunarity, T gain);
 template <int d_in, int d_out, class T>
 void CellNoise(const T* in, T* out);
 
+//! Batch versions of the functions above: they evaluate count points at once and give the same results as calling the
+//! function on each point. in holds the d_in coordinates of each point one after the other (x0, y0, z0, x1, y1, ...),
+//! out receives the d_out values of each point in the same layout.
+//! Points are processed in blocks whose lattice hashing and interpolation are vectorized.
+template <int d_in, int d_out, class T>
+void NoiseBatch(const T* in, T* out, int count);
+
+template <int d_in, int d_out, class T>
+void PNoiseBatch(const T* in, const int* period, T* out, int count);
+
+template <int d_in, int d_out, bool turbulence, class T>
+void FBMBatch(const T* in, T* out, int count, int octaves, T lacunarity, T gain);
+
+template <int d_in, int d_out, class T>
+void CellNoiseBatch(const T* in, T* out, int count);
+
 NATRON_NAMESPACE_EXIT
 
 #endif // NATRON_ENGINE_NOISE_H
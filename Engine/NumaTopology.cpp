@@ -0,0 +1,411 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "NumaTopology.h"
+
+#include <algorithm> // min
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__NATRON_LINUX__)
+#include <pthread.h>
+#include <sched.h> // sched_getcpu, cpu_set_t
+#include <unistd.h> // syscall, sysconf
+#include <sys/syscall.h> // SYS_move_pages
+#endif
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+
+#include "Engine/ThreadStorage.h"
+
+NATRON_NAMESPACE_ENTER
+
+namespace {
+// The binding of a render thread, stored in its thread-local storage
+struct NumaThreadBinding
+{
+    // Value of the generation of the settings when the thread was last bound
+    int generation;
+
+    // Node the thread is pinned to, or -1
+    int node;
+
+#if defined(__NATRON_LINUX__)
+    // CPUs the thread was allowed to run on before it was pinned, restored when the NUMA mode is disabled
+    cpu_set_t originalAffinity;
+#endif
+
+    NumaThreadBinding()
+        : generation(-1)
+        , node(-1)
+    {
+#if defined(__NATRON_LINUX__)
+        CPU_ZERO(&originalAffinity);
+#endif
+    }
+};
+
+#if defined(__NATRON_LINUX__)
+// Parses a list of CPUs as found in /sys, e.g: "0-15,32-47"
+void
+parseCpuList(const std::string& str,
+             std::vector<int>* cpus)
+{
+    std::stringstream ss(str);
+    std::string range;
+
+    while ( std::getline(ss, range, ',') ) {
+        int first, last;
+        int n = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (n == 1) {
+            last = first;
+        } else if (n != 2) {
+            continue;
+        }
+        for (int i = first; i <= last; ++i) {
+            cpus->push_back(i);
+        }
+    }
+}
+#endif
+
+struct NumaTopologyPrivate
+{
+    // CPUs of each node
+    std::vector<std::vector<int> > nodesCpus;
+
+    // Node of each CPU
+    std::vector<int> cpuNode;
+
+    // Serializes changes of the mode
+    QMutex lock;
+
+    // 1 if the NUMA mode is enabled. Read without the lock since it is checked for each image allocated.
+    QAtomicInt enabled;
+
+    // Incremented each time the mode changes so that threads know they must be re-bound
+    QAtomicInt generation;
+
+    // Used to distribute threads on nodes
+    QAtomicInt nextNode;
+
+    ThreadStorage<NumaThreadBinding> tls;
+
+    NumaTopologyPrivate()
+        : nodesCpus()
+        , cpuNode()
+        , lock()
+        , enabled()
+        , generation()
+        , nextNode()
+        , tls()
+    {
+        detectTopology();
+    }
+
+    void detectTopology();
+
+    int getNumNodes() const
+    {
+        return nodesCpus.empty() ? 1 : (int)nodesCpus.size();
+    }
+};
+
+void
+NumaTopologyPrivate::detectTopology()
+{
+#if defined(__NATRON_LINUX__)
+    for (int node = 0;; ++node) {
+        std::stringstream ss;
+        ss << "/sys/devices/system/node/node" << node << "/cpulist";
+        std::ifstream file( ss.str().c_str() );
+        if (!file) {
+            break;
+        }
+        std::string line;
+        std::getline(file, line);
+        std::vector<int> cpus;
+        parseCpuList(line, &cpus);
+        nodesCpus.push_back(cpus);
+        for (std::vector<int>::const_iterator it = cpus.begin(); it != cpus.end(); ++it) {
+            if ( *it >= (int)cpuNode.size() ) {
+                cpuNode.resize(*it + 1, 0);
+            }
+            cpuNode[*it] = node;
+        }
+    }
+#endif
+}
+
+#if defined(__NATRON_LINUX__) && defined(SYS_move_pages)
+#define NATRON_NUMA_CAN_QUERY_PLACEMENT
+
+// Sets nodes to the node of each page, or to a negative error code for pages that are not placed yet.
+// Called through syscall() so that libnuma is not needed.
+bool
+queryPagesNodes(std::vector<void*>& pages,
+                std::vector<int>* nodes)
+{
+    nodes->resize( pages.size() );
+    if ( pages.empty() ) {
+        return true;
+    }
+
+    // Without target nodes, move_pages only reports where the pages are
+    return syscall(SYS_move_pages, 0, (unsigned long)pages.size(), &pages.front(), (const int*)0, &nodes->front(), 0) == 0;
+}
+
+std::size_t
+getPageSize()
+{
+    static const std::size_t pageSize = (std::size_t)sysconf(_SC_PAGESIZE);
+
+    return pageSize;
+}
+#endif
+
+// Number of pages looked at by getMemoryNode()
+#define NATRON_NUMA_PLACEMENT_SAMPLES 16
+
+// The topology is never destroyed: it may be used by threads outliving any static object.
+NumaTopologyPrivate*
+getTopology()
+{
+    static NumaTopologyPrivate* topology = new NumaTopologyPrivate;
+
+    return topology;
+}
+
+#if defined(__NATRON_LINUX__)
+// Restricts the calling thread to the given CPUs
+void
+setCurrentThreadAffinity(const std::vector<int>& cpus)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    for (std::vector<int>::const_iterator it = cpus.begin(); it != cpus.end(); ++it) {
+        CPU_SET(*it, &set);
+    }
+    // This may fail if the process is restricted to a subset of the CPUs (e.g: by a job scheduler), in which case the thread is left as is
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Saves the CPUs the calling thread may run on. All CPUs of the machine are saved if they cannot be retrieved.
+void
+getCurrentThreadAffinity(const std::vector<std::vector<int> >& nodesCpus,
+                         cpu_set_t* set)
+{
+    if (pthread_getaffinity_np(pthread_self(), sizeof(*set), set) == 0) {
+        return;
+    }
+    CPU_ZERO(set);
+    for (std::size_t i = 0; i < nodesCpus.size(); ++i) {
+        for (std::vector<int>::const_iterator it = nodesCpus[i].begin(); it != nodesCpus[i].end(); ++it) {
+            CPU_SET(*it, set);
+        }
+    }
+}
+#endif
+} // anon
+
+int
+NumaTopology::getNumNodes()
+{
+    return getTopology()->getNumNodes();
+}
+
+void
+NumaTopology::setEnabled(bool enabled)
+{
+    NumaTopologyPrivate* topology = getTopology();
+    QMutexLocker k(&topology->lock);
+
+    if ( ( (int)topology->enabled != 0 ) == enabled ) {
+        return;
+    }
+    topology->enabled.fetchAndStoreRelease(enabled ? 1 : 0);
+    topology->generation.fetchAndAddRelease(1);
+}
+
+bool
+NumaTopology::isEnabled()
+{
+    NumaTopologyPrivate* topology = getTopology();
+
+    return topology->getNumNodes() > 1 && (int)topology->enabled != 0;
+}
+
+void
+NumaTopology::bindCurrentThread()
+{
+    NumaTopologyPrivate* topology = getTopology();
+
+    if (topology->getNumNodes() < 2) {
+        return;
+    }
+    // Never pin the main thread, it must stay responsive
+    if ( qApp && ( QThread::currentThread() == qApp->thread() ) ) {
+        return;
+    }
+    NumaThreadBinding& binding = topology->tls.localData();
+    int generation = (int)topology->generation;
+    if (binding.generation == generation) {
+        return;
+    }
+    binding.generation = generation;
+
+    bool enabled = (int)topology->enabled != 0;
+#if defined(__NATRON_LINUX__)
+    if (enabled) {
+        int node = topology->nextNode.fetchAndAddRelaxed(1) % topology->getNumNodes();
+        if (node < 0) {
+            node += topology->getNumNodes();
+        }
+        if (binding.node == -1) {
+            getCurrentThreadAffinity(topology->nodesCpus, &binding.originalAffinity);
+        }
+        setCurrentThreadAffinity(topology->nodesCpus[node]);
+        binding.node = node;
+    } else if (binding.node != -1) {
+        pthread_setaffinity_np(pthread_self(), sizeof(binding.originalAffinity), &binding.originalAffinity);
+        binding.node = -1;
+    }
+#else
+    Q_UNUSED(enabled);
+#endif
+}
+
+int
+NumaTopology::getCurrentNode()
+{
+    if ( !isEnabled() ) {
+        return 0;
+    }
+    NumaTopologyPrivate* topology = getTopology();
+    const NumaThreadBinding& binding = topology->tls.localData();
+    if (binding.node != -1) {
+        return binding.node;
+    }
+#if defined(__NATRON_LINUX__)
+    int cpu = sched_getcpu();
+    if ( (cpu >= 0) && ( cpu < (int)topology->cpuNode.size() ) ) {
+        return topology->cpuNode[cpu];
+    }
+#endif
+
+    return 0;
+}
+
+int
+NumaTopology::getMemoryNode(const void* ptr,
+                            std::size_t size)
+{
+#ifdef NATRON_NUMA_CAN_QUERY_PLACEMENT
+    if ( !ptr || (size == 0) ) {
+        return -1;
+    }
+    const std::size_t pageSize = getPageSize();
+    const std::size_t first = (std::size_t)ptr / pageSize;
+    const std::size_t last = ( (std::size_t)ptr + size - 1 ) / pageSize;
+    const std::size_t nPages = last - first + 1;
+    const std::size_t nSamples = std::min( nPages, (std::size_t)NATRON_NUMA_PLACEMENT_SAMPLES );
+    std::vector<void*> pages(nSamples);
+    for (std::size_t i = 0; i < nSamples; ++i) {
+        pages[i] = (void*)( ( first + i * nPages / nSamples ) * pageSize );
+    }
+    std::vector<int> nodes;
+    if ( !queryPagesNodes(pages, &nodes) ) {
+        return -1;
+    }
+    std::map<int, int> counts;
+    int ret = -1;
+    int retCount = 0;
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i] < 0) {
+            continue;
+        }
+        int count = ++counts[nodes[i]];
+        if (count > retCount) {
+            ret = nodes[i];
+            retCount = count;
+        }
+    }
+
+    return ret;
+#else
+    Q_UNUSED(ptr);
+    Q_UNUSED(size);
+
+    return -1;
+#endif
+}
+
+void
+NumaTopology::getMemoryPlacement(const std::vector<std::pair<const void*, std::size_t> >& ranges,
+                                 NumaPlacementMap* placement)
+{
+#ifdef NATRON_NUMA_CAN_QUERY_PLACEMENT
+    const std::size_t pageSize = getPageSize();
+    std::vector<void*> pages;
+    std::vector<std::size_t> pagesBytes;
+
+    for (std::vector<std::pair<const void*, std::size_t> >::const_iterator it = ranges.begin(); it != ranges.end(); ++it) {
+        std::size_t begin = (std::size_t)it->first;
+        const std::size_t end = begin + it->second;
+        while (begin < end) {
+            std::size_t page = begin - begin % pageSize;
+            std::size_t bytes = std::min(end, page + pageSize) - begin;
+            // Consecutive ranges, such as the rows of an image, often share a page
+            if ( !pages.empty() && (pages.back() == (void*)page) ) {
+                pagesBytes.back() += bytes;
+            } else {
+                pages.push_back( (void*)page );
+                pagesBytes.push_back(bytes);
+            }
+            begin += bytes;
+        }
+    }
+    std::vector<int> nodes;
+    if ( !queryPagesNodes(pages, &nodes) ) {
+        return;
+    }
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i] >= 0) {
+            (*placement)[nodes[i]] += pagesBytes[i];
+        }
+    }
+#else
+    Q_UNUSED(ranges);
+    Q_UNUSED(placement);
+#endif
+}
+
+NATRON_NAMESPACE_EXIT
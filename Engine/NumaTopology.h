@@ -0,0 +1,112 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_NUMATOPOLOGY_H
+#define NATRON_ENGINE_NUMATOPOLOGY_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+// Number of bytes held by each NUMA node
+typedef std::map<int, U64> NumaPlacementMap;
+
+/**
+ * @brief Describes the NUMA nodes (typically the sockets) of the machine and binds render threads to them.
+ * On a multi-socket machine, memory is placed on the node of the thread that first touches it, and accessing
+ * memory of another node goes through the inter-socket link which has a much lower bandwidth.
+ *
+ * When the NUMA mode is enabled (see the "numaAwareRendering" setting), render threads are pinned to the
+ * nodes in turn so that each node gets a group of workers. Since the pages of an image land on the node of the
+ * thread that writes them first, the band of an image rendered by the workers of a node is mostly held by that node,
+ * whichever thread allocated the image. The actual placement of memory can be queried with getMemoryNode() and
+ * getMemoryPlacement().
+ *
+ * The topology is only detected on Linux: on other systems, and on machines with a single node, the NUMA mode
+ * has no effect.
+ *
+ * All functions are MT-safe.
+ **/
+class NumaTopology
+{
+public:
+
+    /**
+     * @brief Returns the number of NUMA nodes of the machine, 1 if it could not be determined.
+     **/
+    static int getNumNodes();
+
+    /**
+     * @brief Enables or disables the NUMA mode. Threads already bound are re-bound (or unbound) the next time
+     * they call bindCurrentThread().
+     **/
+    static void setEnabled(bool enabled);
+
+    /**
+     * @brief Returns true if the NUMA mode is enabled and the machine has more than one node.
+     **/
+    static bool isEnabled();
+
+    /**
+     * @brief Pins the calling thread to the CPUs of a node, picking nodes in a round-robin fashion, if the NUMA mode is enabled.
+     * If the NUMA mode was disabled since the thread was pinned, the CPUs the thread was allowed to run on before
+     * it was pinned are restored.
+     * This is cheap once the thread is bound and can be called at the start of each render task.
+     * The main thread is never pinned.
+     **/
+    static void bindCurrentThread();
+
+    /**
+     * @brief Returns the node of the calling thread, or 0 if the NUMA mode is disabled.
+     **/
+    static int getCurrentNode();
+
+    /**
+     * @brief Returns the node holding most of the memory of the given range, as placed by the kernel, by looking at a
+     * few of its pages. Returns -1 if none of these pages is placed yet (they will land on the node of the thread that
+     * first touches them) or if the placement cannot be queried, e.g: on systems other than Linux.
+     **/
+    static int getMemoryNode(const void* ptr, std::size_t size);
+
+    /**
+     * @brief Adds to placement the number of bytes of the given memory ranges held by each node, as placed by the kernel.
+     * Every page of the ranges is queried, pages that are not placed yet are not counted.
+     * Does nothing if the placement cannot be queried, e.g: on systems other than Linux.
+     **/
+    static void getMemoryPlacement(const std::vector<std::pair<const void*, std::size_t> >& ranges, NumaPlacementMap* placement);
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_NUMATOPOLOGY_H
@@ -1406,7 +1406,8 @@ OfxImageCommon::OfxImageCommon(OFX::Host::ImageEffect::ImageBase* ofxImageBase,
         // data ptr
         const RectI bounds = internalImage->getBounds();
         renderWindow.intersect(bounds, &pluginsSeenBounds);
-        const std::size_t srcRowSize = bounds.width() * nComps  * dataSizeOf;
+        // The image may be a view on the buffer of another image: take the row size of the buffer
+        const std::size_t srcRowSize = internalImage->getRowBytes();
 
         // row bytes
         ofxImageBase->setIntProperty(kOfxImagePropRowBytes, srcRowSize);
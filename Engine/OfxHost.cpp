@@ -35,17 +35,22 @@
 #include <algorithm> // transform, min, max
 #include <string>
 #include <cstring> // for std::memcpy, std::memset, std::strcmp
+#include <list>
+#include <map>
+#include <set>
+#include <sstream> // stringstream
+#include <vector>
 
 CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_OFF(uninitialized)
 CLANG_DIAG_OFF(deprecated-register) //'register' storage class specifier is deprecated
 #include <QtCore/QDateTime>
 #include <QtCore/QDir>
+#include <QtCore/QFileInfo>
 #include <QtCore/QMutex>
 #include <QtCore/QThreadPool>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDebug>
-#include <QtCore/QTemporaryFile>
 CLANG_DIAG_ON(deprecated-register)
 #ifdef OFX_SUPPORTS_MULTITHREAD
 #include <QtCore/QThread>
@@ -95,7 +100,10 @@ CLANG_DIAG_ON(unknown-pragmas)
 #include "Engine/AppInstance.h"
 #include "Engine/AppManager.h"
 #include "Engine/CreateNodeArgs.h"
+#include "Engine/FilePrefetcher.h"
+#include "Engine/Hash64.h"
 #include "Engine/KnobTypes.h"
+#include "Engine/KnobValuesSnapshot.h"
 #include "Engine/LibraryBinary.h"
 #include "Engine/MemoryInfo.h" // printAsRAM
 #include "Engine/Node.h"
@@ -772,6 +780,227 @@ getCacheFilePath()
     return ofxCacheFilePath;
 }
 
+///Return the directory where the description of each plug-in binary is cached, each in a file of its own
+static QString
+getBundlesCacheDirPath()
+{
+    QString cacheFilePath = getCacheFilePath();
+
+    return cacheFilePath.left(cacheFilePath.size() - 4) + QString::fromUtf8("_bundles");
+}
+
+#define NATRON_OFX_CACHE_VERSION NATRON_APPLICATION_NAME "OFXCachev1"
+
+// Depth at which plug-in bundles are searched for in each directory of the plug-in path
+#define NATRON_OFX_BUNDLES_SEARCH_DEPTH 8
+
+/**
+ * @brief Identifies a plug-in binary at a given state: if any of these changed, the binary must be described again.
+ **/
+struct OFXBinaryStamp
+{
+    qint64 size;
+    qint64 lastModified; // in seconds since epoch, as stored in the plug-in cache
+
+    bool operator==(const OFXBinaryStamp& other) const
+    {
+        return size == other.size && lastModified == other.lastModified;
+    }
+};
+
+// Indexed by the canonical path of the binaries
+typedef std::map<std::string, OFXBinaryStamp> OFXBinaryStamps;
+
+static const char*
+getOFXBinaryArchitectureDir()
+{
+#if defined(__NATRON_WIN32__)
+#  if defined(_WIN64)
+    return "Win64";
+#  else
+    return "Win32";
+#  endif
+#elif defined(__NATRON_OSX__)
+    return "MacOS";
+#elif defined(__NATRON_LINUX__)
+#  if defined(__x86_64__) || defined(__x86_64)
+    return "Linux-x86-64";
+#  else
+    return "Linux-x86";
+#  endif
+#else
+#  if defined(__x86_64__) || defined(__x86_64)
+    return "FreeBSD-x86-64";
+#  else
+    return "FreeBSD-x86";
+#  endif
+#endif
+}
+
+/**
+ * @brief Finds the plug-in binaries in the given directory and its sub-directories, the same way the plug-in cache does
+ **/
+static void
+findOFXBinaries(const QString& dirPath,
+                int depth,
+                OFXBinaryStamps* binaries)
+{
+    if (depth > NATRON_OFX_BUNDLES_SEARCH_DEPTH) {
+        return;
+    }
+    QDir dir(dirPath);
+    QStringList subDirs = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    const QString bundleExt = QString::fromUtf8(".ofx.bundle");
+    for (QStringList::const_iterator it = subDirs.begin(); it != subDirs.end(); ++it) {
+        QString subDirPath = dir.absoluteFilePath(*it);
+        if ( !it->endsWith(bundleExt) ) {
+            findOFXBinaries(subDirPath, depth + 1, binaries);
+            continue;
+        }
+        QString binaryPath = subDirPath + QString::fromUtf8("/Contents/") + QString::fromUtf8( getOFXBinaryArchitectureDir() ) +
+                             QLatin1Char('/') + it->left(it->size() - 7); // remove ".bundle"
+        QFileInfo binaryInfo(binaryPath);
+        if ( !binaryInfo.exists() ) {
+            continue;
+        }
+        OFXBinaryStamp stamp;
+        stamp.size = binaryInfo.size();
+        stamp.lastModified = binaryInfo.lastModified().toMSecsSinceEpoch() / 1000;
+        (*binaries)[binaryInfo.canonicalFilePath().toStdString()] = stamp;
+    }
+}
+
+/**
+ * @brief The description of a plug-in binary in the plug-in cache, i.e. a <bundle> element of its xml file
+ **/
+struct OFXBundleCacheEntry
+{
+    std::string xml;
+    std::string binaryPath;
+
+    // False if the size or modification date could not be read, in which case the plug-in cache checks them
+    bool hasStamp;
+    OFXBinaryStamp stamp;
+};
+
+static std::string
+unescapeXMLAttribute(const std::string& value)
+{
+    static const char* const entities[5][2] = {
+        { "&lt;", "<" }, { "&gt;", ">" }, { "&quot;", "\"" }, { "&apos;", "'" }, { "&amp;", "&" }
+    };
+    std::string ret;
+
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        bool replaced = false;
+        if (value[i] == '&') {
+            for (int e = 0; e < 5; ++e) {
+                std::size_t len = std::strlen(entities[e][0]);
+                if (value.compare(i, len, entities[e][0]) == 0) {
+                    ret += entities[e][1];
+                    i += len - 1;
+                    replaced = true;
+                    break;
+                }
+            }
+        }
+        if (!replaced) {
+            ret += value[i];
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Reads the attribute with the given name of the <binary> element of a cached bundle
+ **/
+static bool
+getBinaryXMLAttribute(const std::string& xml,
+                      const char* name,
+                      std::string* value)
+{
+    std::size_t binaryElement = xml.find("<binary ");
+
+    if (binaryElement == std::string::npos) {
+        return false;
+    }
+    // The leading space tells "path" from "bundle_path"
+    std::string pattern = std::string(" ") + name + "=\"";
+    std::size_t begin = xml.find(pattern, binaryElement);
+    if (begin == std::string::npos) {
+        return false;
+    }
+    begin += pattern.size();
+    std::size_t end = xml.find('"', begin);
+    if (end == std::string::npos) {
+        return false;
+    }
+    *value = unescapeXMLAttribute( xml.substr(begin, end - begin) );
+
+    return true;
+}
+
+static bool
+parseBundleCacheEntry(const std::string& xml,
+                      OFXBundleCacheEntry* entry)
+{
+    entry->xml = xml;
+    if ( !getBinaryXMLAttribute(xml, "path", &entry->binaryPath) || entry->binaryPath.empty() ) {
+        return false;
+    }
+    std::string size, lastModified;
+    entry->hasStamp = getBinaryXMLAttribute(xml, "size", &size) && getBinaryXMLAttribute(xml, "mtime", &lastModified);
+    if (entry->hasStamp) {
+        std::istringstream sizeStream(size), lastModifiedStream(lastModified);
+        entry->hasStamp = (sizeStream >> entry->stamp.size) && (lastModifiedStream >> entry->stamp.lastModified);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Splits the xml written by the plug-in cache in one <bundle> element per plug-in binary
+ **/
+static void
+splitPluginCache(const std::string& cacheXML,
+                 std::list<std::string>* bundles)
+{
+    std::istringstream ss(cacheXML);
+    std::string line;
+    std::string bundle;
+    bool inBundle = false;
+
+    while ( std::getline(ss, line) ) {
+        std::size_t first = line.find_first_not_of(" \t\r");
+        std::string element = (first == std::string::npos) ? std::string() : line.substr(first, line.find_last_not_of(" \t\r") + 1 - first);
+        if (element == "<bundle>") {
+            inBundle = true;
+            bundle.clear();
+        }
+        if (inBundle) {
+            bundle += line;
+            bundle += '\n';
+        }
+        if (element == "</bundle>") {
+            inBundle = false;
+            bundles->push_back(bundle);
+        }
+    }
+}
+
+static QString
+getBundleCacheFileName(const std::string& binaryPath)
+{
+    Hash64 hash;
+
+    for (std::size_t i = 0; i < binaryPath.size(); ++i) {
+        hash.append(binaryPath[i]);
+    }
+    hash.computeHash();
+
+    return QString::number(hash.value(), 16) + QString::fromUtf8(".xml");
+}
 
 static void
 getPluginShortcuts(const OFX::Host::ImageEffect::Descriptor& desc, std::list<PluginActionShortcut>* shortcuts)
@@ -868,7 +1097,7 @@ OfxHost::loadOFXPlugins(IOPluginsMap* readersMap,
     OFX::Host::PluginCache* pluginCache = OFX::Host::PluginCache::getPluginCache();
     assert(pluginCache);
     /// set the version label in the global cache
-    pluginCache->setCacheVersion(NATRON_APPLICATION_NAME "OFXCachev1");
+    pluginCache->setCacheVersion(NATRON_OFX_CACHE_VERSION);
 
     /// register the image effect cache with the global plugin cache
     _imp->imageEffectPluginCache->registerInCache( *pluginCache );
@@ -907,10 +1136,70 @@ OfxHost::loadOFXPlugins(IOPluginsMap* readersMap,
     // On OSX, it will be ~/Library/Caches/<organization>/<application>/OFXLoadCache/
     //on Linux ~/.cache/<organization>/<application>/OFXLoadCache/
     //on windows: C:\Users\<username>\App Data\Local\<organization>\<application>\Caches\OFXLoadCache
-    QString ofxCacheFilePath = getCacheFilePath();
-    qDebug() << "Load OFX Plugins: reading cache file" << ofxCacheFilePath;
+    qDebug() << "Load OFX Plugins: plugin path is" << pluginCache->getPluginPath();
 
+    // Find the binaries on the plug-in path, the same way the plug-in cache does when scanning.
+    OFXBinaryStamps binaries;
     {
+        const std::list<std::string>& pluginPath = pluginCache->getPluginPath();
+        for (std::list<std::string>::const_iterator it = pluginPath.begin(); it != pluginPath.end(); ++it) {
+            findOFXBinaries(QString::fromUtf8( it->c_str() ), 0, &binaries);
+        }
+    }
+
+    // Each binary is described in a file of its own: only the descriptions of the binaries which are still
+    // there with the same size and modification date are given to the plug-in cache, the others are removed.
+    QString bundlesCacheDirPath = getBundlesCacheDirPath();
+    qDebug() << "Load OFX Plugins: reading cache directory" << bundlesCacheDirPath;
+    std::set<std::string> cachedBinaries;
+    bool hasBundlesCache = QFileInfo(bundlesCacheDirPath).isDir();
+    if (hasBundlesCache) {
+        std::stringstream cacheXML;
+        cacheXML << "<cache version=\"" << NATRON_OFX_CACHE_VERSION << "\">\n";
+        QDir bundlesCacheDir(bundlesCacheDirPath);
+        QStringList bundleFiles = bundlesCacheDir.entryList(QStringList( QString::fromUtf8("*.xml") ), QDir::Files);
+        for (QStringList::const_iterator it = bundleFiles.begin(); it != bundleFiles.end(); ++it) {
+            QString bundleFilePath = bundlesCacheDir.absoluteFilePath(*it);
+            std::string xml;
+            {
+                FStreamsSupport::ifstream ifs;
+                FStreamsSupport::open( &ifs, bundleFilePath.toStdString() );
+                if (ifs) {
+                    std::stringstream ss;
+                    ss << ifs.rdbuf();
+                    xml = ss.str();
+                }
+            }
+            OFXBundleCacheEntry entry;
+            bool valid = parseBundleCacheEntry(xml, &entry);
+            if (valid) {
+                std::string canonicalPath = QFileInfo( QString::fromUtf8( entry.binaryPath.c_str() ) ).canonicalFilePath().toStdString();
+                OFXBinaryStamps::const_iterator found = binaries.find(canonicalPath);
+                valid = !canonicalPath.empty() &&
+                        ( found == binaries.end() || !entry.hasStamp || (found->second == entry.stamp) );
+                if (valid) {
+                    cachedBinaries.insert(canonicalPath);
+                }
+            }
+            if (valid) {
+                cacheXML << entry.xml;
+            } else {
+                QFile::remove(bundleFilePath);
+            }
+        }
+        cacheXML << "</cache>\n";
+        try {
+            pluginCache->readCache(cacheXML);
+            qDebug() << "Load OFX Plugins: reading cache directory... done!";
+        } catch (const std::exception& e) {
+            qDebug() << "Load OFX Plugins: reading cache directory... failed!";
+            appPTR->writeToErrorLog_mt_safe( QLatin1String("OpenFX"), QDateTime::currentDateTime(),
+                                             tr("Failure to read OpenFX plug-ins cache: %1").arg( QString::fromUtf8( e.what() ) ) );
+            cachedBinaries.clear();
+        }
+    } else {
+        // The cache written by previous versions in a single file
+        QString ofxCacheFilePath = getCacheFilePath();
         FStreamsSupport::ifstream ifs;
         FStreamsSupport::open( &ifs, ofxCacheFilePath.toStdString() );
         if (!ifs) {
@@ -926,19 +1215,33 @@ OfxHost::loadOFXPlugins(IOPluginsMap* readersMap,
             }
         }
     }
-    
-    qDebug() << "Load OFX Plugins: plugin path is" << pluginCache->getPluginPath();
+
+    // The binaries which are not described in the cache are loaded and described one after another on this
+    // thread: read them ahead in parallel so that their loading does not wait on the disk or the network.
+    {
+        std::vector<std::string> binariesToDescribe;
+        for (OFXBinaryStamps::const_iterator it = binaries.begin(); it != binaries.end(); ++it) {
+            if ( cachedBinaries.find(it->first) == cachedBinaries.end() ) {
+                binariesToDescribe.push_back(it->first);
+            }
+        }
+        if ( !binariesToDescribe.empty() ) {
+            qDebug() << "Load OFX Plugins: reading ahead" << binariesToDescribe.size() << "binaries";
+            appPTR->getFilePrefetcher()->prefetchFiles(binariesToDescribe, false);
+        }
+    }
+
     qDebug() << "Load OFX Plugins: scan plugins...";
     pluginCache->scanPluginFiles();
     qDebug() << "Load OFX Plugins: scan plugins... done!";
     _imp->loadingPluginID.clear(); // finished loading plugins
 
-    if ( pluginCache->dirty() ) {
+    if ( pluginCache->dirty() || !hasBundlesCache ) {
         // write the cache NOW (it won't change anyway)
-        qDebug() << "Load OFX Plugins: writing cache file" << ofxCacheFilePath;
+        qDebug() << "Load OFX Plugins: writing cache directory" << bundlesCacheDirPath;
         /// flush out the current cache
         writeOFXCache();
-        qDebug() << "Load OFX Plugins: writing cache file... done!";
+        qDebug() << "Load OFX Plugins: writing cache directory... done!";
     }
 
     /*Filling node name list and plugin grouping*/
@@ -946,7 +1249,6 @@ OfxHost::loadOFXPlugins(IOPluginsMap* readersMap,
     const PMap& ofxPlugins =
         _imp->imageEffectPluginCache->getPluginsByIDMajor();
 
-
     for (PMap::const_iterator it = ofxPlugins.begin();
          it != ofxPlugins.end(); ++it) {
         OFX::Host::ImageEffect::ImageEffectPlugin* p = it->second;
@@ -1087,30 +1389,65 @@ void
 OfxHost::writeOFXCache()
 {
     /// and write a new cache, long version with everything in there
-    QString ofxCachePath = getOFXCacheDirPath();
-    QDir().mkpath(ofxCachePath);
-    QString ofxCacheFilePath = getCacheFilePath();
+    QString bundlesCacheDirPath = getBundlesCacheDirPath();
+    QDir().mkpath(bundlesCacheDirPath);
+    QDir bundlesCacheDir(bundlesCacheDirPath);
 
-    QTemporaryFile tmpf;
-    tmpf.open();
-    QString tmpFileName = tmpf.fileName();
-    tmpf.remove();
-
-    FStreamsSupport::ofstream ofile;
-    FStreamsSupport::open( &ofile, tmpFileName.toStdString() );
-    if (!ofile) {
-        return;
-    }
     OFX::Host::PluginCache* pluginCache = OFX::Host::PluginCache::getPluginCache();
     assert(pluginCache);
-    pluginCache->writePluginCache(ofile);
+    std::stringstream cacheXML;
+    pluginCache->writePluginCache(cacheXML);
+
+    // Write each binary description in a file of its own, only if it changed
+    std::list<std::string> bundles;
+    splitPluginCache(cacheXML.str(), &bundles);
+    std::set<QString> bundleFiles;
+    for (std::list<std::string>::const_iterator it = bundles.begin(); it != bundles.end(); ++it) {
+        OFXBundleCacheEntry entry;
+        if ( !parseBundleCacheEntry(*it, &entry) ) {
+            continue;
+        }
+        QString bundleFileName = getBundleCacheFileName(entry.binaryPath);
+        bundleFiles.insert(bundleFileName);
+        QString bundleFilePath = bundlesCacheDir.absoluteFilePath(bundleFileName);
+        {
+            FStreamsSupport::ifstream ifs;
+            FStreamsSupport::open( &ifs, bundleFilePath.toStdString() );
+            if (ifs) {
+                std::stringstream ss;
+                ss << ifs.rdbuf();
+                if (ss.str() == *it) {
+                    continue;
+                }
+            }
+        }
+        // Write to a temporary file next to the cached one and rename it, so that a concurrent run never reads half a file
+        QString tmpFilePath = bundleFilePath + QString::fromUtf8(".tmp");
+        {
+            FStreamsSupport::ofstream ofile;
+            FStreamsSupport::open( &ofile, tmpFilePath.toStdString() );
+            if (!ofile) {
+                continue;
+            }
+            ofile << *it;
+        }
+        QFile::remove(bundleFilePath);
+        QFile::rename(tmpFilePath, bundleFilePath);
+    }
+
+    // Remove the descriptions of the binaries that are not in the plug-in cache anymore
+    QStringList existingFiles = bundlesCacheDir.entryList(QDir::Files);
+    for (QStringList::const_iterator it = existingFiles.begin(); it != existingFiles.end(); ++it) {
+        if ( bundleFiles.find(*it) == bundleFiles.end() ) {
+            QFile::remove( bundlesCacheDir.absoluteFilePath(*it) );
+        }
+    }
 
-    ofile.close();
-    if (QFile::exists(ofxCacheFilePath)) {
+    // The cache written by previous versions in a single file is superseded
+    QString ofxCacheFilePath = getCacheFilePath();
+    if ( QFile::exists(ofxCacheFilePath) ) {
         QFile::remove(ofxCacheFilePath);
     }
-    QFile::copy(tmpFileName, ofxCacheFilePath);
-    QFile::remove(tmpFileName);
 }
 
 void
@@ -1214,6 +1551,7 @@ threadFunctionWrapper(OfxThreadFunctionV1 func,
                       unsigned int threadIndex,
                       unsigned int threadMax,
                       QThread* spawnerThread,
+                      const KnobValuesSnapshotPtr& knobsSnapshot,
                       void *customArg)
 {
 #ifdef DEBUG
@@ -1226,8 +1564,10 @@ threadFunctionWrapper(OfxThreadFunctionV1 func,
     tls->threadIndexes.push_back( (int)threadIndex );
 
     QThread* spawnedThread = QThread::currentThread();
+    bool knobsSnapshotPushed = false;
     if (spawnedThread != spawnerThread) {
         appPTR->getAppTLS()->softCopy(spawnerThread, spawnedThread);
+        knobsSnapshotPushed = KnobValuesSnapshot::pushCurrentSnapshot(knobsSnapshot);
     }
 
     OfxStatus ret = kOfxStatOK;
@@ -1246,6 +1586,9 @@ threadFunctionWrapper(OfxThreadFunctionV1 func,
     ///reset back the index otherwise it could mess up the indexes if the same thread is re-used
     tls->threadIndexes.pop_back();
 
+    if (knobsSnapshotPushed) {
+        KnobValuesSnapshot::popCurrentSnapshot();
+    }
     if (spawnedThread != spawnerThread) {
         appPTR->getAppTLS()->cleanupTLSForThread();
     }
@@ -1262,6 +1605,7 @@ public:
               unsigned int threadIndex,
               unsigned int threadMax,
               QThread* spawnerThread,
+              const KnobValuesSnapshotPtr& knobsSnapshot,
               void *customArg,
               OfxStatus *stat)
         : QThread()
@@ -1270,6 +1614,7 @@ public:
         , _threadIndex(threadIndex)
         , _threadMax(threadMax)
         , _spawnerThread(spawnerThread)
+        , _knobsSnapshot(knobsSnapshot)
         , _customArg(customArg)
         , _stat(stat)
     {
@@ -1288,6 +1633,7 @@ public:
         tls->threadIndexes.push_back( (int)_threadIndex );
 
         appPTR->getAppTLS()->softCopy(_spawnerThread, this);
+        bool knobsSnapshotPushed = KnobValuesSnapshot::pushCurrentSnapshot(_knobsSnapshot);
 
         assert(*_stat == kOfxStatFailed);
         try {
@@ -1301,6 +1647,9 @@ public:
         ///reset back the index otherwise it could mess up the indexes if the same thread is re-used
         tls->threadIndexes.pop_back();
 
+        if (knobsSnapshotPushed) {
+            KnobValuesSnapshot::popCurrentSnapshot();
+        }
         appPTR->getAppTLS()->cleanupTLSForThread();
     }
 
@@ -1309,6 +1658,7 @@ private:
     unsigned int _threadIndex;
     unsigned int _threadMax;
     QThread* _spawnerThread;
+    KnobValuesSnapshotPtr _knobsSnapshot;
     void *_customArg;
     OfxStatus *_stat;
 };
@@ -1356,6 +1706,8 @@ OfxHost::multiThread(OfxThreadFunctionV1 func,
     }
 
     QThread* spawnerThread = QThread::currentThread();
+    // The spawned threads must read the parameters from the same snapshot as the render action that spawned them
+    KnobValuesSnapshotPtr knobsSnapshot = KnobValuesSnapshot::getCurrentSnapshot();
     bool useThreadPool = appPTR->getUseThreadPool();
 
     if (useThreadPool) {
@@ -1366,7 +1718,7 @@ OfxHost::multiThread(OfxThreadFunctionV1 func,
 
         /// DON'T set the maximum thread count, this is a global application setting, and see the documentation excerpt above
         //QThreadPool::globalInstance()->setMaxThreadCount(nThreads);
-        QFuture<OfxStatus> future = QtConcurrent::mapped( threadIndexes, boost::bind(threadFunctionWrapper, func, _1, nThreads, spawnerThread, customArg) );
+        QFuture<OfxStatus> future = QtConcurrent::mapped( threadIndexes, boost::bind(threadFunctionWrapper, func, _1, nThreads, spawnerThread, knobsSnapshot, customArg) );
         future.waitForFinished();
         ///DON'T reset back to the original value the maximum thread count
         //QThreadPool::globalInstance()->setMaxThreadCount(QThread::idealThreadCount());
@@ -1384,7 +1736,7 @@ OfxHost::multiThread(OfxThreadFunctionV1 func,
             // at most maxConcurrentThread should be running at the same time
             QVector<OfxThread*> threads(nThreads);
             for (unsigned int i = 0; i < nThreads; ++i) {
-                threads[i] = new OfxThread(func, i, nThreads, spawnerThread, customArg, &status[i]);
+                threads[i] = new OfxThread(func, i, nThreads, spawnerThread, knobsSnapshot, customArg, &status[i]);
             }
             unsigned int i = 0; // index of next thread to launch
             unsigned int running = 0; // number of running threads
@@ -60,6 +60,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/KnobFile.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/Log.h"
+#include "Engine/MemoryInfo.h" // printAsRAM, getCurrentRSS
 #include "Engine/Node.h"
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/OfxEffectInstance.h"
@@ -88,6 +89,9 @@ OutputEffectInstance::OutputEffectInstance(NodePtr node)
     , _outputEffectDataLock()
     , _renderSequenceRequests()
     , _engine()
+    , _renderStatsTotalsEnabled(false)
+    , _renderStatsTotals()
+    , _combinedRender()
 {
 }
 
@@ -96,6 +100,9 @@ OutputEffectInstance::OutputEffectInstance(const OutputEffectInstance& other)
 , _outputEffectDataLock()
 , _renderSequenceRequests()
 , _engine(other._engine)
+, _renderStatsTotalsEnabled(false)
+, _renderStatsTotals()
+, _combinedRender()
 {
 }
 
@@ -400,11 +407,9 @@ OutputEffectInstance::createRenderEngine()
     return new RenderEngine(thisShared);
 }
 
-void
-OutputEffectInstance::reportStats(int time,
-                                  ViewIdx view,
-                                  double wallTime,
-                                  const std::map<NodePtr, NodeRenderStats > & stats)
+std::string
+OutputEffectInstance::getRenderStatsFileName(int time,
+                                             ViewIdx view)
 {
     std::string filename;
     KnobIPtr fileKnob = getKnobByName(kOfxImageEffectFileParamName);
@@ -419,6 +424,128 @@ OutputEffectInstance::reportStats(int time,
         }
     }
 
+    return filename;
+}
+
+void
+OutputEffectInstance::reportStageTimings(int time,
+                                         ViewIdx view,
+                                         const RenderStageTimings& timings)
+{
+    std::string filename = getRenderStatsFileName(time, view);
+
+    if ( filename.empty() || timings.empty() ) {
+        return;
+    }
+
+    // Appended to the file written by reportStats()
+    FStreamsSupport::ofstream ofile;
+    FStreamsSupport::open(&ofile, filename, std::ios_base::out | std::ios_base::app);
+    if (!ofile) {
+        std::cout << tr("Failure to write render statistics file.").toStdString() << std::endl;
+
+        return;
+    }
+
+    ofile << "------------------------------- Render stages ------------------------------- " << std::endl;
+    for (RenderStageTimings::const_iterator it = timings.begin(); it != timings.end(); ++it) {
+        ofile << it->first << ": " << Timer::printAsTime(it->second, false).toStdString() << std::endl;
+    }
+}
+
+void
+OutputEffectInstance::reportNumaTraffic(int time,
+                                        ViewIdx view,
+                                        double wallTime,
+                                        const NumaTrafficMap& traffic)
+{
+    std::string filename = getRenderStatsFileName(time, view);
+
+    if ( filename.empty() || traffic.empty() ) {
+        return;
+    }
+
+    // Appended to the file written by reportStats()
+    FStreamsSupport::ofstream ofile;
+    FStreamsSupport::open(&ofile, filename, std::ios_base::out | std::ios_base::app);
+    if (!ofile) {
+        std::cout << tr("Failure to write render statistics file.").toStdString() << std::endl;
+
+        return;
+    }
+
+    ofile << "------------------------------- NUMA nodes ------------------------------- " << std::endl;
+    for (NumaTrafficMap::const_iterator it = traffic.begin(); it != traffic.end(); ++it) {
+        U64 total = it->second.localBytes + it->second.remoteBytes;
+        ofile << "Node " << it->first << ": " << printAsRAM(total).toStdString() << " written";
+        if (wallTime > 0) {
+            ofile << " (" << printAsRAM( (U64)(total / wallTime) ).toStdString() << "/s)";
+        }
+        ofile << ", " << printAsRAM(it->second.remoteBytes).toStdString() << " to memory of another node" << std::endl;
+    }
+}
+
+void
+OutputEffectInstance::setRenderStatsTotalsEnabled(bool enabled)
+{
+    QMutexLocker k(&_outputEffectDataLock);
+
+    _renderStatsTotalsEnabled = enabled;
+    if (enabled) {
+        _renderStatsTotals = RenderStatsTotals();
+    }
+}
+
+RenderStatsTotals
+OutputEffectInstance::getRenderStatsTotals() const
+{
+    QMutexLocker k(&_outputEffectDataLock);
+
+    return _renderStatsTotals;
+}
+
+void
+OutputEffectInstance::setCombinedRender(const CombinedRenderPtr& combinedRender)
+{
+    QMutexLocker k(&_outputEffectDataLock);
+
+    _combinedRender = combinedRender;
+}
+
+CombinedRenderPtr
+OutputEffectInstance::getCombinedRender() const
+{
+    QMutexLocker k(&_outputEffectDataLock);
+
+    return _combinedRender;
+}
+
+void
+OutputEffectInstance::reportStats(int time,
+                                  ViewIdx view,
+                                  double wallTime,
+                                  const std::map<NodePtr, NodeRenderStats > & stats)
+{
+    {
+        QMutexLocker k(&_outputEffectDataLock);
+        if (_renderStatsTotalsEnabled) {
+            ++_renderStatsTotals.nbFrames;
+            _renderStatsTotals.wallTime += wallTime;
+            _renderStatsTotals.peakRSS = std::max( _renderStatsTotals.peakRSS, getCurrentRSS() );
+            for (std::map<NodePtr, NodeRenderStats >::const_iterator it = stats.begin(); it != stats.end(); ++it) {
+                NodeRenderStatsTotals& totals = _renderStatsTotals.nodes[it->first->getScriptName_mt_safe()];
+                int nbCacheMisses, nbCacheHits, nbCacheHitButDownscaledImages;
+                it->second.getCacheAccessInfos(&nbCacheMisses, &nbCacheHits, &nbCacheHitButDownscaledImages);
+                totals.timeSpentRendering += it->second.getTotalTimeSpentRendering();
+                totals.nbCacheMisses += nbCacheMisses;
+                totals.nbCacheHits += nbCacheHits;
+                totals.nbCacheHitButDownscaledImages += nbCacheHitButDownscaledImages;
+            }
+        }
+    }
+
+    std::string filename = getRenderStatsFileName(time, view);
+
     //If there's no filename knob, do not write anything
     if ( filename.empty() ) {
         std::cout << tr("Cannot write render statistics file: "
@@ -506,6 +633,10 @@ OutputEffectInstance::reportStats(int time,
         ofile << "Nb cache hit: " << nbCacheMiss << std::endl;
         ofile << "Nb cache miss: " << nbCacheMiss << std::endl;
         ofile << "Nb cache hit requiring mipmap downscaling: " << nbCacheHitButDownscaled << std::endl;
+        int nbActionsCacheHits, nbActionsCacheMisses;
+        it->second.getActionsCacheAccessInfos(&nbActionsCacheHits, &nbActionsCacheMisses);
+        ofile << "Nb actions cache hit: " << nbActionsCacheHits << std::endl;
+        ofile << "Nb actions cache miss: " << nbActionsCacheMisses << std::endl;
 
         const std::set<std::string> & planes = it->second.getPlanesRendered();
         ofile << "Plane(s) rendered: ";
@@ -37,6 +37,7 @@
 #include <QtCore/QMutex>
 
 #include "Engine/EffectInstance.h"
+#include "Engine/RenderStats.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
 
@@ -69,6 +70,11 @@ private:
     std::list<RenderSequenceArgs> _renderSequenceRequests;
     RenderEnginePtr _engine;
 
+    // Protected by _outputEffectDataLock
+    bool _renderStatsTotalsEnabled;
+    RenderStatsTotals _renderStatsTotals;
+    CombinedRenderPtr _combinedRender;
+
 public:
 
     OutputEffectInstance(NodePtr node);
@@ -117,6 +123,34 @@ public:
     virtual void initializeData() OVERRIDE FINAL;
     virtual void reportStats(int time, ViewIdx view, double wallTime, const std::map<NodePtr, NodeRenderStats > & stats);
 
+    /**
+     * @brief Appends the time spent in each stage of the render of a frame to the statistics file written by reportStats()
+     **/
+    void reportStageTimings(int time, ViewIdx view, const RenderStageTimings& timings);
+
+    /**
+     * @brief Appends the image memory written by the threads of each NUMA node, and the resulting bandwidth over the frame,
+     * to the statistics file written by reportStats()
+     **/
+    void reportNumaTraffic(int time, ViewIdx view, double wallTime, const NumaTrafficMap& traffic);
+
+    /**
+     * @brief When enabled, the statistics reported for each frame rendered with render stats are also summed per node
+     * and can be retrieved with getRenderStatsTotals(). Enabling it resets the totals.
+     * This is used by the render benchmarks.
+     **/
+    void setRenderStatsTotalsEnabled(bool enabled);
+
+    RenderStatsTotals getRenderStatsTotals() const;
+
+    /**
+     * @brief Set the group of writers this writer renders with, or NULL to render it on its own.
+     * See CombinedRender.
+     **/
+    void setCombinedRender(const CombinedRenderPtr& combinedRender);
+
+    CombinedRenderPtr getCombinedRender() const;
+
 protected:
 
     void createWriterPath();
@@ -127,6 +161,10 @@ protected:
      * @brief Creates the engine that will control the output rendering
      **/
     virtual RenderEngine* createRenderEngine();
+
+private:
+
+    std::string getRenderStatsFileName(int time, ViewIdx view);
 };
 
 NATRON_NAMESPACE_EXIT
@@ -52,13 +52,17 @@
 #include "Engine/AbortableRenderInfo.h"
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
+#include "Engine/CombinedRender.h"
 #include "Engine/EffectInstance.h"
+#include "Engine/FilePrefetcher.h"
 #include "Engine/Image.h"
 #include "Engine/KnobFile.h"
 #include "Engine/Node.h"
+#include "Engine/NumaTopology.h"
 #include "Engine/OpenGLViewerI.h"
 #include "Engine/GenericSchedulerThreadWatcher.h"
 #include "Engine/Project.h"
+#include "Engine/ReadNode.h"
 #include "Engine/RenderStats.h"
 #include "Engine/RotoContext.h"
 #include "Engine/Settings.h"
@@ -243,6 +247,11 @@ struct OutputSchedulerThreadPrivate
     QMutex bufferedOutputMutex;
     int lastBufferedOutputSize;
 
+    // Read nodes upstream of the output effect, whose files are prefetched ahead of the render threads
+    QMutex upstreamReadersMutex;
+    std::list<EffectInstanceWPtr> upstreamReaders;
+    bool prefetchHistoryExpired;
+
 
     OutputSchedulerThreadPrivate(RenderEngine* engine,
                                  const OutputEffectInstancePtr& effect,
@@ -282,7 +291,111 @@ struct OutputSchedulerThreadPrivate
 #endif
         , bufferedOutputMutex()
         , lastBufferedOutputSize(0)
+        , upstreamReadersMutex()
+        , upstreamReaders()
+        , prefetchHistoryExpired(false)
+    {
+    }
+
+    void refreshUpstreamReaders()
     {
+        std::list<EffectInstanceWPtr> readers;
+        EffectInstancePtr effect = outputEffect.lock();
+
+        if (effect) {
+            std::set<EffectInstance*> visited;
+            std::list<EffectInstancePtr> toVisit;
+            toVisit.push_back(effect);
+            while ( !toVisit.empty() ) {
+                EffectInstancePtr e = toVisit.front();
+                toVisit.pop_front();
+                if ( !visited.insert( e.get() ).second ) {
+                    continue;
+                }
+                if ( dynamic_cast<ReadNode*>( e.get() ) ) {
+                    readers.push_back(e);
+                }
+                int nInputs = e->getNInputs();
+                for (int i = 0; i < nInputs; ++i) {
+                    EffectInstancePtr input = e->getInput(i);
+                    if (input) {
+                        toVisit.push_back(input);
+                    }
+                }
+            }
+        }
+
+        QMutexLocker k(&upstreamReadersMutex);
+        upstreamReaders = readers;
+        prefetchHistoryExpired = false;
+    }
+
+    /**
+     * @brief Prefetches the files of the sequences read upstream for the frames that the scheduler will push after the
+     * given frame, following the playback mode, so that they are hot by the time a render thread picks them.
+     **/
+    void prefetchUpstreamSequences(PlaybackModeEnum pMode,
+                                   int frame,
+                                   RenderDirectionEnum direction,
+                                   int firstFrame,
+                                   int lastFrame,
+                                   int frameStep)
+    {
+        int nFrames = appPTR->getCurrentSettings()->getSequenceReadAheadFrames();
+
+        if (nFrames <= 0) {
+            return;
+        }
+
+        std::vector<int> frames;
+        bool wraps = false;
+        {
+            int currentFrame = frame;
+            RenderDirectionEnum currentDirection = direction;
+            for (int i = 0; i < nFrames; ++i) {
+                int nextFrame;
+                RenderDirectionEnum nextDirection;
+                if ( !getNextFrameInSequence(pMode, currentDirection, currentFrame, firstFrame, lastFrame, std::max(frameStep, 1), &nextFrame, &nextDirection) ) {
+                    break;
+                }
+                if ( (nextDirection != currentDirection) ||
+                     ( (currentDirection == eRenderDirectionForward) ? (nextFrame < currentFrame) : (nextFrame > currentFrame) ) ) {
+                    wraps = true;
+                }
+                frames.push_back(nextFrame);
+                currentFrame = nextFrame;
+                currentDirection = nextDirection;
+            }
+        }
+        if ( frames.empty() ) {
+            return;
+        }
+
+        std::list<EffectInstanceWPtr> readers;
+        bool forgetPrefetchedFiles = false;
+        {
+            QMutexLocker k(&upstreamReadersMutex);
+            readers = upstreamReaders;
+
+            // When the frames ahead loop back, the files at the other end of the range were prefetched during the
+            // previous cycle and may have been evicted since: forget about them once per cycle so they get prefetched again
+            if (!wraps) {
+                prefetchHistoryExpired = false;
+            } else if (!prefetchHistoryExpired) {
+                prefetchHistoryExpired = true;
+                forgetPrefetchedFiles = true;
+            }
+        }
+        if (forgetPrefetchedFiles) {
+            appPTR->getFilePrefetcher()->forgetPrefetchedFiles();
+        }
+        for (std::list<EffectInstanceWPtr>::iterator it = readers.begin(); it != readers.end(); ++it) {
+            EffectInstancePtr reader = it->lock();
+            ReadNode* isReader = dynamic_cast<ReadNode*>( reader.get() );
+            if (isReader) {
+                isReader->prefetchSequenceFiles(frames);
+            }
+        }
     }
 
     void appendBufferedFrame(double time,
@@ -823,6 +936,9 @@ OutputSchedulerThread::pickFrameToRender(RenderThreadTask* thread,
 
     bool gotFrame = false;
     int frame = -1;
+    RenderDirectionEnum direction = eRenderDirectionForward;
+    int firstFrame = 0, lastFrame = 0;
+    int frameStep = 1;
     {
         QMutexLocker l(&_imp->framesToRenderMutex);
         while ( _imp->framesToRender.empty() && !thread->mustQuit() ) {
@@ -841,6 +957,14 @@ OutputSchedulerThread::pickFrameToRender(RenderThreadTask* thread,
             _imp->framesToRender.pop_front();
 
             gotFrame = true;
+
+            OutputSchedulerThreadStartArgsPtr runArgs = _imp->runArgs.lock();
+            if (runArgs) {
+                direction = runArgs->pushTimelineDirection;
+                firstFrame = runArgs->firstFrame;
+                lastFrame = runArgs->lastFrame;
+                frameStep = runArgs->frameStep;
+            }
         }
     }
 
@@ -864,6 +988,8 @@ OutputSchedulerThread::pickFrameToRender(RenderThreadTask* thread,
         *enableRenderStats = args->enableRenderStats;
         *viewsToRender = args->viewsToRender;
 
+        _imp->prefetchUpstreamSequences(_imp->engine->getPlaybackMode(), frame, direction, firstFrame, lastFrame, frameStep);
+
         return frame;
     }
 } // OutputSchedulerThread::pickFrameToRender
@@ -952,6 +1078,7 @@ OutputSchedulerThread::startTasks(int startingFrame)
         viewsToRender = _imp->livingRunArgs.viewsToRender;
     }
     PlaybackModeEnum pMode = _imp->engine->getPlaybackMode();
+    _imp->prefetchUpstreamSequences(pMode, startingFrame, direction, firstFrame, lastFrame, frameStep);
     if (firstFrame == lastFrame) {
         RenderThreadTask* task = createRunnable(startingFrame, useStats, viewsToRender);
         _imp->appendRunnable(task);
@@ -1054,6 +1181,10 @@ OutputSchedulerThread::startRender()
 
     aboutToStartRender();
 
+    // Playback may start from another frame than where it stopped: drop what was prefetched for the previous render
+    appPTR->getFilePrefetcher()->clear();
+    _imp->refreshUpstreamReaders();
+
     ///Notify everyone that the render is started
     _imp->engine->s_renderStarted(forward);
 
@@ -1161,6 +1292,9 @@ OutputSchedulerThread::stopRender()
 #endif
     _imp->waitForRenderThreadsToQuit();
 
+    ///Cancel the files still waiting to be prefetched for the frames that will not be rendered
+    appPTR->getFilePrefetcher()->clear();
+
     ///If the output effect is sequential (only WriteFFMPEG for now)
     EffectInstancePtr effect = _imp->outputEffect.lock();
     WriteNode* isWriteNode = dynamic_cast<WriteNode*>( effect.get() );
@@ -1569,6 +1703,8 @@ OutputSchedulerThread::notifyFrameRendered(int frame,
         std::map<NodePtr, NodeRenderStats > statResults = stats->getStats(&timeSpentForFrame);
         if ( !statResults.empty() ) {
             effect->reportStats(frame, viewIndex, timeSpentForFrame, statResults);
+            effect->reportStageTimings( frame, viewIndex, stats->getStageTimings() );
+            effect->reportNumaTraffic( frame, viewIndex, timeSpentForFrame, stats->getNumaTraffic() );
         }
     }
 
@@ -1619,6 +1755,10 @@ OutputSchedulerThread::notifyFrameRendered(int frame,
         }
         //renderingIsFinished = _imp->renderFinished;
     } else {
+        if (isLastView) {
+            QMutexLocker l(&_imp->renderFinishedMutex);
+            ++_imp->nFramesRendered;
+        }
         nbTotalFrames = std::floor( (double)(runArgs->lastFrame - runArgs->firstFrame + 1) / runArgs->frameStep );
         if (runArgs->processTimelineDirection == eRenderDirectionForward) {
             nbFramesRendered = (frame - runArgs->firstFrame) / runArgs->frameStep;
@@ -2066,6 +2206,9 @@ RenderThreadTask::run()
             break;
         }
 
+        // Parallel renders are spread over the NUMA nodes so that each node renders its own frames
+        NumaTopology::bindCurrentThread();
+
 #ifdef TRACE_SCHEDULER
         qDebug() << "Parallel Render Thread: Picking frame to render: " << time;
 #endif
@@ -2085,6 +2228,7 @@ RenderThreadTask::run()
     notifyIsRunning(false);
     _imp->scheduler->notifyThreadAboutToQuit(this);
 #else // NATRON_PLAYBACK_USES_THREAD_POOL
+    NumaTopology::bindCurrentThread();
     renderFrame(_imp->time, _imp->viewsToRender, _imp->useRenderStats);
     _imp->scheduler->notifyThreadAboutToQuit(this);
 #endif
@@ -2151,6 +2295,69 @@ DefaultScheduler::~DefaultScheduler()
 {
 }
 
+/**
+ * @brief Returns the effect that actually writes the frames: the embedded writer of a WriteNode or the output effect itself
+ **/
+static EffectInstancePtr
+getActiveWriterEffect(const OutputEffectInstancePtr& output)
+{
+    WriteNode* isWriteNode = dynamic_cast<WriteNode*>( output.get() );
+
+    if (isWriteNode) {
+        NodePtr embeddedWriter = isWriteNode->getEmbeddedWriter();
+        if (embeddedWriter) {
+            return embeddedWriter->getEffectInstance();
+        }
+    }
+
+    return output;
+}
+
+/**
+ * @brief Returns true if the writer must receive frames in order (e.g: a video encoder).
+ * In that case render threads only render the tree upstream of the writer and queue the resulting images,
+ * which are then encoded in order by the scheduler thread. The number of queued frames is bounded: render threads
+ * are not given new frames while the queue is full, see isBufferFull().
+ **/
+static bool
+mustEncodeInOrder(const EffectInstancePtr& writer)
+{
+    if ( !writer || !writer->isWriter() ) {
+        return false;
+    }
+    SequentialPreferenceEnum pref = writer->getSequentialPreference();
+
+    return pref == eSequentialPreferenceOnlySequential || pref == eSequentialPreferencePreferSequential;
+}
+
+/**
+ * @brief Notifies the group of a writer rendering together with other writers that a frame is done, whichever way renderFrame returns
+ **/
+class CombinedRenderFrameDoneNotifier
+{
+    CombinedRenderPtr _combinedRender;
+    const OutputEffectInstance* _writer;
+    int _time;
+
+public:
+
+    CombinedRenderFrameDoneNotifier(const CombinedRenderPtr& combinedRender,
+                                    const OutputEffectInstance* writer,
+                                    int time)
+        : _combinedRender(combinedRender)
+        , _writer(writer)
+        , _time(time)
+    {
+    }
+
+    ~CombinedRenderFrameDoneNotifier()
+    {
+        if (_combinedRender) {
+            _combinedRender->notifyFrameDone(_writer, _time);
+        }
+    }
+};
+
 class DefaultRenderFrameRunnable
     : public RenderThreadTask
 {
@@ -2196,6 +2403,18 @@ private:
             return;
         }
 
+        // When rendering together with other writers, do not get ahead of them: the images of the nodes we share
+        // must still be in the cache when they render the same frame
+        CombinedRenderPtr combinedRender = output->getCombinedRender();
+        CombinedRenderFrameDoneNotifier combinedRenderFrameDone(combinedRender, output.get(), time);
+        if (combinedRender) {
+            while ( !combinedRender->waitForFrame(output.get(), time, NATRON_COMBINED_RENDER_WAIT_TIMEOUT_MS) ) {
+                if ( output->isSequentialRenderBeingAborted() ) {
+                    return;
+                }
+            }
+        }
+
         AbortableThread* isAbortableThread = dynamic_cast<AbortableThread*>( QThread::currentThread() );
 
         ///Even if enableRenderStats is false, we at least profile the time spent rendering the frame when rendering with a Write node.
@@ -2267,6 +2486,18 @@ private:
             assert(activeInputToRender);
             NodePtr activeInputNode = activeInputToRender->getNode();
             U64 activeInputToRenderHash = isWriteNode ? isWriteNode->getHash() : activeInputToRender->getHash();
+
+            // If the writer encodes in order, only render its input here: the writer is rendered by the scheduler thread
+            const bool encodeInOrder = mustEncodeInOrder(activeInputToRender);
+            EffectInstancePtr effectToRender = activeInputToRender;
+            if (encodeInOrder) {
+                effectToRender = activeInputToRender->getInput(0);
+                if (!effectToRender) {
+                    _imp->scheduler->notifyRenderFailure("The writer is not connected");
+
+                    return;
+                }
+            }
             const double par = activeInputToRender->getAspectRatio(-1);
             const bool isRenderDueToRenderInteraction = false;
             const bool isSequentialRender = true;
@@ -2293,10 +2524,10 @@ private:
 
 
                 //Retrieve bitdepth only
-                imageDepth = activeInputToRender->getBitDepth(-1);
+                imageDepth = activeInputToRender->getBitDepth(encodeInOrder ? 0 : -1);
                 components.clear();
 
-                EffectInstance::ComponentsNeededMap::iterator foundOutput = neededComps.find(-1);
+                EffectInstance::ComponentsNeededMap::iterator foundOutput = neededComps.find(encodeInOrder ? 0 : -1);
                 if ( foundOutput != neededComps.end() ) {
                     for (std::list<ImagePlaneDesc>::const_iterator it2 = foundOutput->second.begin(); it2 != foundOutput->second.end(); ++it2) {
                         components.push_back(*it2);
@@ -2323,6 +2554,9 @@ private:
                                                          false,
                                                          false,
                                                          stats);
+                if (combinedRender) {
+                    frameRenderArgs.setCombinedRender(combinedRender);
+                }
 
                 {
                     FrameRequestMap request;
@@ -2349,8 +2583,11 @@ private:
                                                                                                                activeInputToRender.get(),
                                                                                                                eStorageModeRAM,
                                                                                                                time) );
+                if (encodeInOrder) {
+                    stats->beginStage(kRenderStageTreeRender);
+                }
                 EffectInstance::RenderRoIRetCode retCode;
-                retCode = activeInputToRender->renderRoI(*renderArgs, &planes);
+                retCode = effectToRender->renderRoI(*renderArgs, &planes);
                 if (retCode != EffectInstance::eRenderRoIRetCodeOk) {
                     if (retCode == EffectInstance::eRenderRoIRetCodeAborted) {
                         _imp->scheduler->notifyRenderFailure("Render aborted");
@@ -2362,13 +2599,22 @@ private:
                 }
 
                 ///If we need sequential rendering, pass the image to the output scheduler that will ensure the sequential ordering
-                /*if (!renderDirectly) {
-                    for (std::map<ImagePlaneDesc,ImagePtr>::iterator it = planes.begin(); it != planes.end(); ++it) {
-                        _imp->scheduler->appendToBuffer(time, viewsToRender[view], stats, boost::dynamic_pointer_cast<BufferableObject>(it->second));
+                if (encodeInOrder) {
+                    stats->endStage(kRenderStageTreeRender);
+                    if ( planes.empty() ) {
+                        _imp->scheduler->notifyRenderFailure("Error caught while rendering");
+
+                        return;
                     }
-                   } else {*/
-                _imp->scheduler->notifyFrameRendered(time, viewsToRender[view], viewsToRender, stats, eSchedulingPolicyFFA);
-                //}
+                    std::map<ImagePlaneDesc, ImagePtr>::iterator toEncode = components.empty() ? planes.end() : planes.find( components.front() );
+                    if ( toEncode == planes.end() ) {
+                        toEncode = planes.begin();
+                    }
+                    stats->beginStage(kRenderStageWriterQueue);
+                    _imp->scheduler->appendToBuffer( time, viewsToRender[view], stats, boost::dynamic_pointer_cast<BufferableObject>(toEncode->second) );
+                } else {
+                    _imp->scheduler->notifyFrameRendered(time, viewsToRender[view], viewsToRender, stats, eSchedulingPolicyFFA);
+                }
             }
         } catch (const std::exception& e) {
             _imp->scheduler->notifyRenderFailure( std::string("Error while rendering: ") + e.what() );
@@ -2411,8 +2657,9 @@ DefaultScheduler::processFrame(const BufferedFrames& frames)
 
     ///Writers render to scale 1 always
     RenderScale scale(1.);
-    OutputEffectInstancePtr effect = _effect.lock();
-    U64 hash = effect->getHash();
+    OutputEffectInstancePtr output = _effect.lock();
+    EffectInstancePtr effect = getActiveWriterEffect(output);
+    U64 hash = output->getHash();
     bool isProjectFormat;
     RectD rod;
     RectI roi;
@@ -2432,6 +2679,10 @@ DefaultScheduler::processFrame(const BufferedFrames& frames)
     const bool isSequentialRender = true;
 
     for (BufferedFrames::const_iterator it = frames.begin(); it != frames.end(); ++it) {
+        if (it->stats) {
+            it->stats->endStage(kRenderStageWriterQueue);
+            it->stats->beginStage(kRenderStageEncode);
+        }
         AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(true, 0);
 
         setAbortInfo(isRenderDueToRenderInteraction, abortInfo, effect);
@@ -2482,6 +2733,9 @@ DefaultScheduler::processFrame(const BufferedFrames& frames)
         } catch (const std::exception& e) {
             notifyRenderFailure( e.what() );
         }
+        if (it->stats) {
+            it->stats->endStage(kRenderStageEncode);
+        }
     }
 } // DefaultScheduler::processFrame
 
@@ -2534,12 +2788,11 @@ DefaultScheduler::handleRenderFailure(const std::string& errorMessage)
 SchedulingPolicyEnum
 DefaultScheduler::getSchedulingPolicy() const
 {
-    /*SequentialPreferenceEnum sequentiallity = _effect.lock()->getSequentialPreference();
-       if (sequentiallity == eSequentialPreferenceNotSequential) {*/
-    return eSchedulingPolicyFFA;
-    /*} else {
+    if ( mustEncodeInOrder( getActiveWriterEffect( _effect.lock() ) ) ) {
         return eSchedulingPolicyOrdered;
-       }*/
+    }
+
+    return eSchedulingPolicyFFA;
 }
 
 void
@@ -2571,6 +2824,11 @@ DefaultScheduler::aboutToStartRender()
         isWriter->onSequenceRenderStarted();
     }
 
+    CombinedRenderPtr combinedRender = effect->getCombinedRender();
+    if (combinedRender) {
+        combinedRender->notifyWriterStarted( effect.get() );
+    }
+
     std::string cb = effect->getNode()->getBeforeRenderCallback();
     if ( !cb.empty() ) {
         std::vector<std::string> args;
@@ -2628,6 +2886,13 @@ DefaultScheduler::onRenderStopped(bool aborted)
         appPTR->writeToOutputPipe(longText, QString::fromUtf8(kRenderingFinishedStringShort), true);
     }
 
+    // Do not hold back the other writers of the group anymore. The group is only used for this render.
+    CombinedRenderPtr combinedRender = effect->getCombinedRender();
+    if (combinedRender) {
+        combinedRender->notifyWriterFinished( effect.get() );
+        effect->setCombinedRender( CombinedRenderPtr() );
+    }
+
     effect->notifyRenderFinished();
 
     std::string cb = effect->getNode()->getAfterRenderCallback();
@@ -3359,6 +3624,19 @@ RenderEngine::getDesiredFPS() const
     return _imp->scheduler ? _imp->scheduler->getDesiredFPS() : 24;
 }
 
+RenderDirectionEnum
+RenderEngine::getPlaybackDirection() const
+{
+    RenderDirectionEnum direction = eRenderDirectionForward;
+
+    if (_imp->scheduler) {
+        std::vector<ViewIdx> views;
+        _imp->scheduler->getLastRunArgs(&direction, &views);
+    }
+
+    return direction;
+}
+
 void
 RenderEngine::notifyFrameProduced(const BufferableObjectPtrList& frames,
                                   const RenderStatsPtr& stats,
@@ -38,7 +38,9 @@
 #include "Engine/Node.h"
 #include "Engine/NodeGroup.h"
 #include "Engine/GPUContextPool.h"
+#include "Engine/KnobValuesSnapshot.h"
 #include "Engine/OSGLContext.h"
+#include "Engine/RenderStats.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/ViewIdx.h"
@@ -304,6 +306,47 @@ EffectInstance::treeRecurseFunctor(bool isRenderFunctor,
     return EffectInstance::eRenderRoIRetCodeOk;
 } // EffectInstance::treeRecurseFunctor
 
+/**
+ * @brief Moves the results of a request pass made at plan->time to the given time.
+ * This is only possible if the node only requested its inputs at the same time, which is the case of most
+ * non-temporal effects. Returns false otherwise.
+ **/
+static bool
+shiftRenderPlanToTime(double time,
+                      RenderPlanResults* plan)
+{
+    if (plan->time == time) {
+        return true;
+    }
+    FrameViewRequestGlobalData& data = plan->globalData;
+    if ( (data.identityInputNb != -1) && (data.inputIdentityTime != plan->time) ) {
+        return false;
+    }
+    for (FramesNeededMap::const_iterator it = data.frameViewsNeeded.begin(); it != data.frameViewsNeeded.end(); ++it) {
+        for (FrameRangesMap::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            for (std::vector<RangeD>::const_iterator it3 = it2->second.begin(); it3 != it2->second.end(); ++it3) {
+                if ( (it3->min != plan->time) || (it3->max != plan->time) ) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    if (data.identityInputNb != -1) {
+        data.inputIdentityTime = time;
+    }
+    for (FramesNeededMap::iterator it = data.frameViewsNeeded.begin(); it != data.frameViewsNeeded.end(); ++it) {
+        for (FrameRangesMap::iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            for (std::vector<RangeD>::iterator it3 = it2->second.begin(); it3 != it2->second.end(); ++it3) {
+                it3->min = it3->max = time;
+            }
+        }
+    }
+    plan->time = time;
+
+    return true;
+}
+
 StatusEnum
 EffectInstance::getInputsRoIsFunctor(bool useTransforms,
                                      double time,
@@ -340,6 +383,7 @@ EffectInstance::getInputsRoIsFunctor(bool useTransforms,
         NodeFrameRequestPtr tmp = boost::make_shared<NodeFrameRequest>();
         tmp->mappedScale.x = tmp->mappedScale.y = Image::getScaleFromMipMapLevel(mappedLevel);
         tmp->nodeHash = effect->getRenderHash();
+        tmp->timeInvariant = effect->isTimeInvariantForRequestPass(tmp->nodeHash);
 
         std::pair<FrameRequestMap::iterator, bool> ret = requests.insert( std::make_pair(node, tmp) );
         assert(ret.second);
@@ -367,52 +411,80 @@ EffectInstance::getInputsRoIsFunctor(bool useTransforms,
 
         fvRequest = &nodeRequest->frames[frameView];
 
+        /*
+           If the tree upstream is not animated, the results of a previous request pass at another time can be used
+           instead of calling the actions again, which is what happens during playback of a still composition.
+         */
+        RenderPlanResults plan;
+        bool planFound = false;
+        if ( nodeRequest->timeInvariant && effect->getRenderPlanResults(nodeRequest->nodeHash, view, mappedLevel, useTransforms, &plan) ) {
+            planFound = shiftRenderPlanToTime(time, &plan);
+            if (planFound) {
+                fvRequest->globalData = plan.globalData;
+            }
+        }
 
-        ///Check identity
-        fvRequest->globalData.identityInputNb = -1;
-        fvRequest->globalData.inputIdentityTime = 0.;
-        fvRequest->globalData.identityView = view;
+        if ( !planFound || (plan.identityWindow != canonicalRenderWindow) ) {
+            ///Check identity
+            fvRequest->globalData.identityInputNb = -1;
+            fvRequest->globalData.inputIdentityTime = 0.;
+            fvRequest->globalData.identityView = view;
 
 
-        RectI identityRegionPixel;
-        canonicalRenderWindow.toPixelEnclosing(mappedLevel, par, &identityRegionPixel);
+            RectI identityRegionPixel;
+            canonicalRenderWindow.toPixelEnclosing(mappedLevel, par, &identityRegionPixel);
 
-        if ( (view != 0) && (viewInvariance == eViewInvarianceAllViewsInvariant) ) {
-            fvRequest->globalData.isIdentity = true;
-            fvRequest->globalData.identityInputNb = -2;
-            fvRequest->globalData.inputIdentityTime = time;
-        } else {
-            try {
-                fvRequest->globalData.isIdentity = effect->isIdentity_public(true, nodeRequest->nodeHash, time, nodeRequest->mappedScale, identityRegionPixel, view, &fvRequest->globalData.inputIdentityTime, &fvRequest->globalData.identityView, &fvRequest->globalData.identityInputNb);
-            } catch (...) {
-                return eStatusFailed;
+            if ( (view != 0) && (viewInvariance == eViewInvarianceAllViewsInvariant) ) {
+                fvRequest->globalData.isIdentity = true;
+                fvRequest->globalData.identityInputNb = -2;
+                fvRequest->globalData.inputIdentityTime = time;
+            } else {
+                try {
+                    fvRequest->globalData.isIdentity = effect->isIdentity_public(true, nodeRequest->nodeHash, time, nodeRequest->mappedScale, identityRegionPixel, view, &fvRequest->globalData.inputIdentityTime, &fvRequest->globalData.identityView, &fvRequest->globalData.identityInputNb);
+                } catch (...) {
+                    return eStatusFailed;
+                }
             }
         }
 
-        /*
-           Do NOT call getRegionOfDefinition on the identity time, if the plug-in returns an identity time different from
-           this time, we expect that it handles getRegionOfDefinition itself correctly.
-         */
-        double rodTime = time; //fvRequest->globalData.isIdentity ? fvRequest->globalData.inputIdentityTime : time;
-        ViewIdx rodView = view; //fvRequest->globalData.isIdentity ? fvRequest->globalData.identityView : view;
-
-        ///Get the RoD
-        StatusEnum stat = effect->getRegionOfDefinition_public(nodeRequest->nodeHash, rodTime, nodeRequest->mappedScale, rodView, &fvRequest->globalData.rod, &fvRequest->globalData.isProjectFormat);
-        //If failed it should have failed earlier
-        if ( (stat == eStatusFailed) && !fvRequest->globalData.rod.isNull() ) {
-            return stat;
-        }
+        if (!planFound) {
+            /*
+               Do NOT call getRegionOfDefinition on the identity time, if the plug-in returns an identity time different from
+               this time, we expect that it handles getRegionOfDefinition itself correctly.
+             */
+            double rodTime = time; //fvRequest->globalData.isIdentity ? fvRequest->globalData.inputIdentityTime : time;
+            ViewIdx rodView = view; //fvRequest->globalData.isIdentity ? fvRequest->globalData.identityView : view;
+
+            ///Get the RoD
+            StatusEnum stat = effect->getRegionOfDefinition_public(nodeRequest->nodeHash, rodTime, nodeRequest->mappedScale, rodView, &fvRequest->globalData.rod, &fvRequest->globalData.isProjectFormat);
+            //If failed it should have failed earlier
+            if ( (stat == eStatusFailed) && !fvRequest->globalData.rod.isNull() ) {
+                return stat;
+            }
 
 
-        ///Concatenate transforms if needed
-        if (useTransforms) {
-            fvRequest->globalData.transforms = boost::make_shared<InputMatrixMap>();
+            ///Concatenate transforms if needed
+            if (useTransforms) {
+                fvRequest->globalData.transforms = boost::make_shared<InputMatrixMap>();
 #pragma message WARN("TODO: can set draftRender properly here?")
-            effect->tryConcatenateTransforms( time, /*draftRender=*/false, view, nodeRequest->mappedScale, fvRequest->globalData.transforms.get() );
+                effect->tryConcatenateTransforms( time, /*draftRender=*/false, view, nodeRequest->mappedScale, fvRequest->globalData.transforms.get() );
+            }
+
+            ///Get the frame/views needed for this frame/view
+            fvRequest->globalData.frameViewsNeeded = effect->getFramesNeeded_public(nodeRequest->nodeHash, time, view, mappedLevel);
         }
 
-        ///Get the frame/views needed for this frame/view
-        fvRequest->globalData.frameViewsNeeded = effect->getFramesNeeded_public(nodeRequest->nodeHash, time, view, mappedLevel);
+        if (nodeRequest->timeInvariant) {
+            if (!planFound) {
+                plan.view = view;
+                plan.mipMapLevel = mappedLevel;
+                plan.useTransforms = useTransforms;
+            }
+            plan.time = time;
+            plan.identityWindow = canonicalRenderWindow;
+            plan.globalData = fvRequest->globalData;
+            effect->setRenderPlanResults(nodeRequest->nodeHash, plan);
+        }
     } // if (foundFrameView != nodeRequest->frames.end()) {
 
     assert(fvRequest);
@@ -489,7 +561,19 @@ EffectInstance::getInputsRoIsFunctor(bool useTransforms,
 
     ///Compute the regions of interest in input for this RoI
     FrameViewPerRequestData fvPerRequestData;
-    effect->getRegionsOfInterest_public(time, nodeRequest->mappedScale, fvRequest->globalData.rod, canonicalRenderWindow, view, &fvPerRequestData.inputsRoi);
+    RenderPlanResults plan;
+    bool hasPlan = nodeRequest->timeInvariant && effect->getRenderPlanResults(nodeRequest->nodeHash, view, mappedLevel, useTransforms, &plan);
+    if ( hasPlan && plan.inputsRoiSet && (plan.roiRenderWindow == canonicalRenderWindow) && (plan.globalData.rod == fvRequest->globalData.rod) ) {
+        fvPerRequestData.inputsRoi = plan.inputsRoi;
+    } else {
+        effect->getRegionsOfInterest_public(time, nodeRequest->mappedScale, fvRequest->globalData.rod, canonicalRenderWindow, view, &fvPerRequestData.inputsRoi);
+        if (hasPlan) {
+            plan.roiRenderWindow = canonicalRenderWindow;
+            plan.inputsRoi = fvPerRequestData.inputsRoi;
+            plan.inputsRoiSet = true;
+            effect->setRenderPlanResults(nodeRequest->nodeHash, plan);
+        }
+    }
 
 
     ///Transform Rois and get the reroutes map
@@ -584,6 +668,16 @@ const FrameViewRequest*
 NodeFrameRequest::getFrameViewRequest(double time,
                                       ViewIdx view) const
 {
+    FrameViewPair frameView;
+    frameView.time = time;
+    frameView.view = view;
+
+    NodeFrameViewRequestData::const_iterator found = frames.find(frameView);
+    if ( found != frames.end() ) {
+        return &found->second;
+    }
+
+    // Requests made for all views
     for (NodeFrameViewRequestData::const_iterator it = frames.begin(); it != frames.end(); ++it) {
         if (it->first.time == time) {
             if ( (it->first.view == -1) || (it->first.view == view) ) {
@@ -700,6 +794,8 @@ ParallelRenderArgsSetter::ParallelRenderArgsSetter(double time,
                                                    bool draftMode,
                                                    const RenderStatsPtr& stats)
     :  argsMap()
+    , nodes()
+    , _knobsSnapshotPushed(false)
 {
     assert(treeRoot);
 
@@ -719,6 +815,9 @@ ParallelRenderArgsSetter::ParallelRenderArgsSetter(double time,
     FindDependenciesMap dependenciesMap;
     getAllUpstreamNodesRecursiveWithDependencies_internal(treeRoot, dependenciesMap);
 
+    // Analysis and paint strokes set values during the render: the snapshot would be out of date
+    bool doKnobsSnapshot = !isAnalysis && !activeRotoPaintNode && appPTR->getCurrentSettings()->isRenderParametersSnapshotEnabled();
+    std::vector<KnobHolder*> snapshotHolders;
 
     for (FindDependenciesMap::iterator it = dependenciesMap.begin(); it != dependenciesMap.end(); ++it) {
 
@@ -727,6 +826,9 @@ ParallelRenderArgsSetter::ParallelRenderArgsSetter(double time,
 
         EffectInstancePtr liveInstance = node->getEffectInstance();
         assert(liveInstance);
+        if (doKnobsSnapshot) {
+            snapshotHolders.push_back( liveInstance.get() );
+        }
         bool duringPaintStrokeCreation = activeRotoPaintNode && node->isDuringPaintStrokeCreation();
         RenderSafetyEnum safety = node->getCurrentRenderThreadSafety();
         PluginOpenGLRenderSupport glSupport = node->getCurrentOpenGLRenderSupport();
@@ -749,6 +851,9 @@ ParallelRenderArgsSetter::ParallelRenderArgsSetter(double time,
             (*it2)->getOutputs_mt_safe(outputs);
             int visitsCounter = (int)outputs.size();
 
+            if (doKnobsSnapshot) {
+                snapshotHolders.push_back( (*it2)->getEffectInstance().get() );
+            }
             (*it2)->getEffectInstance()->setParallelRenderArgsTLS(time, view, isRenderUserInteraction, isSequential, nodeHash, abortInfo, treeRoot, visitsCounter, NodeFrameRequestPtr(), glContext, textureIndex, timeline, isAnalysis, activeRotoPaintNode && (*it2)->isDuringPaintStrokeCreation(), NodesList(), (*it2)->getCurrentRenderThreadSafety(),  (*it2)->getCurrentOpenGLRenderSupport(),doNanHandling, draftMode, stats);
         }
 
@@ -766,6 +871,9 @@ ParallelRenderArgsSetter::ParallelRenderArgsSetter(double time,
                 RenderSafetyEnum childSafety = (*it2)->getCurrentRenderThreadSafety();
                 PluginOpenGLRenderSupport childGlSupport = (*it2)->getCurrentOpenGLRenderSupport();
                 childLiveInstance->setParallelRenderArgsTLS(time, view, isRenderUserInteraction, isSequential, nodeHash, abortInfo, treeRoot, 1, NodeFrameRequestPtr(), glContext, textureIndex, timeline, isAnalysis, false, NodesList(), childSafety, childGlSupport, doNanHandling, draftMode, stats);
+                if (doKnobsSnapshot) {
+                    snapshotHolders.push_back( childLiveInstance.get() );
+                }
             }
         }
 
@@ -775,6 +883,27 @@ ParallelRenderArgsSetter::ParallelRenderArgsSetter(double time,
              isGrp->setParallelRenderArgs(time, view, isRenderUserInteraction, isSequential, canAbort,  renderAge, treeRoot, request, textureIndex, timeline, activeRotoPaintNode, isAnalysis, draftMode,stats);
            }*/
     }
+
+    // Capture the parameters once all thread-local args are set, since values may depend on them through masters
+    if (doKnobsSnapshot) {
+        if (stats) {
+            stats->beginStage(kRenderStageKnobsSnapshot);
+        }
+        KnobValuesSnapshotPtr snapshot = boost::make_shared<KnobValuesSnapshot>(time, snapshotHolders);
+        _knobsSnapshotPushed = KnobValuesSnapshot::pushCurrentSnapshot(snapshot);
+
+        // Keep it in the frame args too, so that copies of the args made for other threads carry it
+        for (std::vector<KnobHolder*>::iterator it = snapshotHolders.begin(); it != snapshotHolders.end(); ++it) {
+            EffectInstance* effect = dynamic_cast<EffectInstance*>(*it);
+            ParallelRenderArgsPtr args = effect ? effect->getParallelRenderArgsTLS() : ParallelRenderArgsPtr();
+            if (args) {
+                args->knobsSnapshot = snapshot;
+            }
+        }
+        if (stats) {
+            stats->endStage(kRenderStageKnobsSnapshot);
+        }
+    }
 }
 
 void
@@ -816,8 +945,21 @@ ParallelRenderArgsSetter::updateNodesRequest(const FrameRequestMap& request)
     }
 }
 
+void
+ParallelRenderArgsSetter::setCombinedRender(const CombinedRenderPtr& combinedRender)
+{
+    for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        ParallelRenderArgsPtr args = (*it)->getEffectInstance()->getParallelRenderArgsTLS();
+        if (args) {
+            args->combinedRender = combinedRender;
+        }
+    }
+}
+
 ParallelRenderArgsSetter::ParallelRenderArgsSetter(const boost::shared_ptr<std::map<NodePtr, ParallelRenderArgsPtr> >& args)
     : argsMap(args)
+    , nodes()
+    , _knobsSnapshotPushed(false)
 {
     // Ensure this thread gets an OpenGL context for the render of the frame
     OSGLContextPtr glContext;
@@ -829,15 +971,24 @@ ParallelRenderArgsSetter::ParallelRenderArgsSetter(const boost::shared_ptr<std::
     }
 
     if (args) {
+        KnobValuesSnapshotPtr snapshot;
         for (std::map<NodePtr, ParallelRenderArgsPtr>::iterator it = argsMap->begin(); it != argsMap->end(); ++it) {
             it->second->openGLContext = glContext;
             it->first->getEffectInstance()->setParallelRenderArgsTLS(it->second);
+            if (!snapshot) {
+                snapshot = it->second->knobsSnapshot;
+            }
         }
+        _knobsSnapshotPushed = KnobValuesSnapshot::pushCurrentSnapshot(snapshot);
     }
 }
 
 ParallelRenderArgsSetter::~ParallelRenderArgsSetter()
 {
+    if (_knobsSnapshotPushed) {
+        KnobValuesSnapshot::popCurrentSnapshot();
+    }
+
     for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
         if ( !(*it) || !(*it)->getEffectInstance() ) {
             continue;
@@ -884,7 +1035,9 @@ ParallelRenderArgs::ParallelRenderArgs()
     , visitsCount(0)
     , rotoPaintNodes()
     , stats()
+    , combinedRender()
     , openGLContext()
+    , knobsSnapshot()
     , textureIndex(0)
     , currentThreadSafety(eRenderSafetyInstanceSafe)
     , currentOpenglSupport(ePluginOpenGLRenderSupportNone)
@@ -35,6 +35,7 @@
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
+#include <boost/unordered_map.hpp>
 #endif
 
 #include "Global/GlobalDefines.h"
@@ -118,9 +119,16 @@ public:
     ///Various stats local to the render of a frame
     RenderStatsPtr stats;
 
+    ///If the frame is rendered for a writer rendering together with other writers, the group of writers
+    CombinedRenderPtr combinedRender;
+
     ///The OpenGL context to use for the render of this frame
     OSGLContextWPtr openGLContext;
 
+    ///The parameters values captured when the render of this frame started, if any. This is what threads
+    ///that inherit these args must activate to read the same values as the thread that started the render.
+    KnobValuesSnapshotPtr knobsSnapshot;
+
     ///The texture index of the viewer being rendered, only useful for abortable renders
     int textureIndex;
 
@@ -218,8 +226,6 @@ struct FrameView_compare_less
         } else {
             if (lhs.view < rhs.view) {
                 return true;
-            } else if (lhs.view > rhs.view) {
-                return true;
             } else {
                 return false;
             }
@@ -229,6 +235,43 @@ struct FrameView_compare_less
 
 typedef std::map<FrameViewPair, FrameViewRequest, FrameView_compare_less> NodeFrameViewRequestData;
 
+/**
+ * @brief The results of the request pass for a node at a given frame/view, kept in the actions cache of the node.
+ * When neither the node nor the tree upstream is animated or frame varying, they are reused for other frames
+ * instead of calling the actions again, see EffectInstance::getInputsRoIsFunctor.
+ **/
+struct RenderPlanResults
+{
+    ViewIdx view;
+    unsigned int mipMapLevel;
+    bool useTransforms;
+
+    ///The time at which the results were computed: frames needed and identity times are relative to it
+    double time;
+
+    ///The render window with which isIdentity was called
+    RectD identityWindow;
+    FrameViewRequestGlobalData globalData;
+
+    ///The regions of interest in input for the last render window
+    RectD roiRenderWindow;
+    RoIMap inputsRoi;
+    bool inputsRoiSet;
+
+    RenderPlanResults()
+        : view(0)
+        , mipMapLevel(0)
+        , useTransforms(false)
+        , time(0)
+        , identityWindow()
+        , globalData()
+        , roiRenderWindow()
+        , inputsRoi()
+        , inputsRoiSet(false)
+    {
+    }
+};
+
 class NodeFrameRequest
 {
 public:
@@ -238,12 +281,15 @@ public:
     U64 nodeHash;
     RenderScale mappedScale;
 
+    ///True if neither the node nor the tree upstream is animated or frame varying, set on first request
+    bool timeInvariant;
+
     bool getFrameViewCanonicalRoI(double time, ViewIdx view, RectD* roi) const;
 
     const FrameViewRequest* getFrameViewRequest(double time, ViewIdx view) const;
 };
 
-typedef std::map<NodePtr, NodeFrameRequestPtr> FrameRequestMap;
+typedef boost::unordered_map<NodePtr, NodeFrameRequestPtr> FrameRequestMap;
 
 
 class ParallelRenderArgsSetter
@@ -251,6 +297,9 @@ class ParallelRenderArgsSetter
     boost::shared_ptr<std::map<NodePtr, ParallelRenderArgsPtr> > argsMap;
     NodesList nodes;
 
+    ///True if a KnobValuesSnapshot was activated on this thread for the render
+    bool _knobsSnapshotPushed;
+
 protected:
 
     OSGLContextWPtr _openGLContext;
@@ -281,6 +330,11 @@ public:
 
     void updateNodesRequest(const FrameRequestMap& request);
 
+    /**
+     * @brief Set the group of writers the frame is rendered for on the nodes of the tree, see CombinedRender
+     **/
+    void setCombinedRender(const CombinedRenderPtr& combinedRender);
+
     virtual ~ParallelRenderArgsSetter();
 };
 
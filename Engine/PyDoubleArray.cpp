@@ -0,0 +1,130 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "PyDoubleArray.h"
+
+#include <cassert>
+#include <cstring>
+
+NATRON_NAMESPACE_ENTER
+NATRON_PYTHON_NAMESPACE_ENTER
+
+static bool
+isNativeDoubleFormat(const char* format)
+{
+    if (!format) {
+        // No format means unsigned bytes
+        return false;
+    }
+    if ( (format[0] == '@') || (format[0] == '=') ) {
+        ++format;
+    }
+
+    return std::strcmp(format, "d") == 0;
+}
+
+PyDoubleArray::PyDoubleArray()
+    : _view()
+    , _hasView(false)
+    , _values()
+    , _data(0)
+    , _size(0)
+{
+}
+
+PyDoubleArray::~PyDoubleArray()
+{
+    if (_hasView) {
+        PyBuffer_Release(&_view);
+    }
+}
+
+bool
+PyDoubleArray::read(PyObject* obj,
+                    const char* argName)
+{
+    assert(!_hasView && !_data);
+    if ( PyObject_CheckBuffer(obj) ) {
+        if (PyObject_GetBuffer(obj, &_view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) == 0) {
+            _hasView = true;
+            // Multi-dimensional buffers are read flattened
+            if ( ( _view.itemsize == (Py_ssize_t)sizeof(double) ) && isNativeDoubleFormat(_view.format) ) {
+                _data = (const double*)_view.buf;
+                _size = _view.len / _view.itemsize;
+
+                return true;
+            }
+            // Other formats (float32, integers...) are converted item by item below
+            PyBuffer_Release(&_view);
+            _hasView = false;
+        } else {
+            PyErr_Clear();
+        }
+    }
+
+    PyObject* seq = PySequence_Fast(obj, "");
+    if (!seq) {
+        PyErr_Format(PyExc_TypeError, "%s must be a buffer of doubles or a sequence of numbers", argName);
+
+        return false;
+    }
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    _values.resize(n);
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        _values[i] = PyFloat_AsDouble( PySequence_Fast_GET_ITEM(seq, i) );
+        if ( (_values[i] == -1.) && PyErr_Occurred() ) {
+            Py_DECREF(seq);
+
+            return false;
+        }
+    }
+    Py_DECREF(seq);
+    _data = _values.empty() ? 0 : &_values.front();
+    _size = n;
+
+    return true;
+}
+
+PyObject*
+PyDoubleArray::createArray(const std::vector<double>& values)
+{
+    PyObject* arrayModule = PyImport_ImportModule("array");
+
+    if (!arrayModule) {
+        return 0;
+    }
+    PyObject* bytes = PyBytes_FromStringAndSize(values.empty() ? 0 : (const char*)&values.front(), values.size() * sizeof(double));
+    PyObject* ret = 0;
+    if (bytes) {
+        ret = PyObject_CallMethod(arrayModule, (char*)"array", (char*)"sO", "d", bytes);
+        Py_DECREF(bytes);
+    }
+    Py_DECREF(arrayModule);
+
+    return ret;
+}
+
+NATRON_PYTHON_NAMESPACE_EXIT
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,91 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_PYDOUBLEARRAY_H
+#define NATRON_ENGINE_PYDOUBLEARRAY_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+
+NATRON_NAMESPACE_ENTER;
+NATRON_PYTHON_NAMESPACE_ENTER;
+
+/**
+ * @brief Reads the doubles of a Python object passed to the Python API. If the object exports a C-contiguous buffer of
+ * native doubles (array.array('d'), a float64 numpy array...), the buffer is used in place, otherwise the object is read
+ * with the sequence protocol and its items are converted to float.
+ * The GIL must be held while this object lives.
+ **/
+class PyDoubleArray
+{
+    Py_buffer _view;
+    bool _hasView;
+    std::vector<double> _values;
+    const double* _data;
+    Py_ssize_t _size;
+
+public:
+
+    PyDoubleArray();
+
+    ~PyDoubleArray();
+
+    /**
+     * @brief Reads the given object. Returns false and sets a Python exception if it cannot be read as doubles,
+     * argName is the name of the argument used in the error message.
+     **/
+    bool read(PyObject* obj, const char* argName);
+
+    Py_ssize_t size() const
+    {
+        return _size;
+    }
+
+    const double* data() const
+    {
+        return _data;
+    }
+
+    double operator[](Py_ssize_t i) const
+    {
+        return _data[i];
+    }
+
+    /**
+     * @brief Returns a new reference to an array.array('d') holding the given values, or NULL with a Python exception set.
+     **/
+    static PyObject* createArray(const std::vector<double>& values);
+
+private:
+    // noncopyable
+    PyDoubleArray(const PyDoubleArray&);
+    void operator=(const PyDoubleArray&);
+};
+
+NATRON_PYTHON_NAMESPACE_EXIT;
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_PYDOUBLEARRAY_H
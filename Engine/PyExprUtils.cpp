@@ -26,11 +26,14 @@
 
 #include "PyExprUtils.h"
 
+#include <algorithm>
+#include <climits>
 #include <cmath>
 #include <boost/cstdint.hpp>
 
 #include "Global/GlobalDefines.h"
 #include "Engine/Noise.h"
+#include "Engine/PyDoubleArray.h"
 
 using boost::uint32_t;
 
@@ -379,5 +382,101 @@ ExprUtils::pnoise(const Double3DTuple& p, const Double3DTuple& period)
 
 }
 
+// Reads the 3D points of the batch functions, returns false with a Python exception set on error
+static bool
+readPoints(PyObject* points,
+           PyDoubleArray* coords,
+           int* count)
+{
+    if ( !coords->read(points, "points") ) {
+        return false;
+    }
+    if (coords->size() % 3 != 0) {
+        PyErr_SetString(PyExc_ValueError, "points must hold 3 coordinates per point.");
+
+        return false;
+    }
+    if (coords->size() / 3 > INT_MAX) {
+        PyErr_SetString(PyExc_OverflowError, "too many points.");
+
+        return false;
+    }
+    *count = (int)(coords->size() / 3);
+
+    return true;
+}
+
+PyObject*
+ExprUtils::noiseArray(PyObject* points)
+{
+    PyDoubleArray coords;
+    int count;
+    if ( !readPoints(points, &coords, &count) ) {
+        return 0;
+    }
+    std::vector<double> result(count);
+    if (count > 0) {
+        NoiseBatch<3, 1>(coords.data(), &result[0], count);
+    }
+
+    return PyDoubleArray::createArray(result);
+}
+
+static PyObject*
+fbmArrayHelper(PyObject* points,
+               bool turbulence,
+               int octaves,
+               double lacunarity,
+               double gain)
+{
+    PyDoubleArray coords;
+    int count;
+    if ( !readPoints(points, &coords, &count) ) {
+        return 0;
+    }
+    octaves = std::min(std::max(octaves, 1), 8);
+    std::vector<double> result(count);
+    if (count > 0) {
+        if (turbulence) {
+            FBMBatch<3, 1, true>(coords.data(), &result[0], count, octaves, lacunarity, gain);
+        } else {
+            FBMBatch<3, 1, false>(coords.data(), &result[0], count, octaves, lacunarity, gain);
+        }
+        for (int i = 0; i < count; ++i) {
+            result[i] = .5 * result[i] + .5;
+        }
+    }
+
+    return PyDoubleArray::createArray(result);
+}
+
+PyObject*
+ExprUtils::fbmArray(PyObject* points, int octaves, double lacunarity, double gain)
+{
+    return fbmArrayHelper(points, false, octaves, lacunarity, gain);
+}
+
+PyObject*
+ExprUtils::turbulenceArray(PyObject* points, int octaves, double lacunarity, double gain)
+{
+    return fbmArrayHelper(points, true, octaves, lacunarity, gain);
+}
+
+PyObject*
+ExprUtils::cellnoiseArray(PyObject* points)
+{
+    PyDoubleArray coords;
+    int count;
+    if ( !readPoints(points, &coords, &count) ) {
+        return 0;
+    }
+    std::vector<double> result(count);
+    if (count > 0) {
+        CellNoiseBatch<3, 1>(coords.data(), &result[0], count);
+    }
+
+    return PyDoubleArray::createArray(result);
+}
+
 NATRON_PYTHON_NAMESPACE_EXIT
 NATRON_NAMESPACE_EXIT
@@ -120,6 +120,14 @@ public:
 
     // periodic noise
     static double pnoise(const Double3DTuple& p, const Double3DTuple& period);
+
+    // Batch versions of noise, fbm, turbulence and cellnoise: points is a flat sequence or buffer of doubles holding
+    // the 3D points one after the other (x0, y0, z0, x1, y1, z1, ...). They return an array.array('d') with the value of
+    // each point, identical to what the per-point function returns, without converting each point to a Python tuple.
+    static PyObject* noiseArray(PyObject* points);
+    static PyObject* fbmArray(PyObject* points, int octaves = 6, double lacunarity = 2., double gain = 0.5);
+    static PyObject* turbulenceArray(PyObject* points, int octaves = 6, double lacunarity = 2., double gain = 0.5);
+    static PyObject* cellnoiseArray(PyObject* points);
 };
 
 NATRON_PYTHON_NAMESPACE_EXIT;
@@ -26,17 +26,23 @@
 #include "PyNode.h"
 
 #include <cassert>
+#include <cstring>
 #include <stdexcept>
 
+#include "Engine/AbortableRenderInfo.h"
+#include "Engine/AppManager.h"
+#include "Engine/Image.h"
 #include "Engine/Node.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/KnobFile.h"
 #include "Engine/AppInstance.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/NodeGroup.h"
+#include "Engine/ParallelRenderArgs.h"
 #include "Engine/PyRoto.h"
 #include "Engine/PyTracker.h"
 #include "Engine/TimeLine.h"
+#include "Engine/TLSHolder.h"
 #include "Engine/Hash64.h"
 
 NATRON_NAMESPACE_ENTER
@@ -977,6 +983,214 @@ Effect::getRegionOfDefinition(double time,
     return rod;
 }
 
+namespace {
+/**
+ * @brief The Python object exporting the pixels of a rendered image with the buffer protocol, without copy. It holds a
+ * reference to the image so that its memory is not released by the cache, but no lock: the pixel buffer of an image is
+ * only reallocated by Image::ensureBounds() to grow its bounds, which never happens to an image rendered over the whole
+ * region of definition of its node.
+ **/
+struct ImageBufferObject
+{
+    PyObject_HEAD
+    ImagePtr* image;
+    const unsigned char* data;
+    Py_ssize_t shape[3];
+    Py_ssize_t strides[3];
+};
+
+static void
+imageBufferDealloc(PyObject* self)
+{
+    ImageBufferObject* obj = (ImageBufferObject*)self;
+
+    delete obj->image;
+    PyObject_Del(self);
+}
+
+static int
+imageBufferGetBuffer(PyObject* self,
+                     Py_buffer* view,
+                     int flags)
+{
+    ImageBufferObject* obj = (ImageBufferObject*)self;
+
+    if ( (flags & PyBUF_WRITABLE) == PyBUF_WRITABLE ) {
+        PyErr_SetString(PyExc_BufferError, "NatronEngine.ImageBuffer is read-only");
+        view->obj = 0;
+
+        return -1;
+    }
+    const Py_ssize_t len = obj->shape[0] * obj->shape[1] * obj->shape[2] * (Py_ssize_t)sizeof(float);
+    const bool isContiguous = obj->strides[0] == obj->shape[1] * obj->strides[1];
+    if ( !isContiguous && ( (flags & PyBUF_STRIDES) != PyBUF_STRIDES ) ) {
+        PyErr_SetString(PyExc_BufferError, "NatronEngine.ImageBuffer is not contiguous");
+        view->obj = 0;
+
+        return -1;
+    }
+    view->obj = self;
+    Py_INCREF(self);
+    view->buf = (void*)obj->data;
+    view->len = len;
+    view->readonly = 1;
+    view->itemsize = sizeof(float);
+    view->format = ( (flags & PyBUF_FORMAT) == PyBUF_FORMAT ) ? (char*)"f" : 0;
+    if ( (flags & PyBUF_ND) == PyBUF_ND ) {
+        view->ndim = 3;
+        view->shape = obj->shape;
+    } else {
+        view->ndim = 1;
+        view->shape = 0;
+    }
+    view->strides = ( (flags & PyBUF_STRIDES) == PyBUF_STRIDES ) ? obj->strides : 0;
+    view->suboffsets = 0;
+    view->internal = 0;
+
+    return 0;
+}
+
+static PyTypeObject*
+getImageBufferType()
+{
+    static PyTypeObject type;
+    static PyBufferProcs bufferProcs;
+    static bool initialized = false;
+
+    // Called with the GIL held
+    if (initialized) {
+        return &type;
+    }
+    PyTypeObject emptyType = { PyVarObject_HEAD_INIT(NULL, 0) };
+    type = emptyType;
+    std::memset( &bufferProcs, 0, sizeof(bufferProcs) );
+    bufferProcs.bf_getbuffer = imageBufferGetBuffer;
+    type.tp_name = "NatronEngine.ImageBuffer";
+    type.tp_basicsize = sizeof(ImageBufferObject);
+    type.tp_dealloc = imageBufferDealloc;
+    type.tp_as_buffer = &bufferProcs;
+#if PY_MAJOR_VERSION >= 3
+    type.tp_flags = Py_TPFLAGS_DEFAULT;
+#else
+    type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
+    type.tp_doc = "Read-only pixels of an image rendered by Effect.renderPlane()";
+    if (PyType_Ready(&type) < 0) {
+        return 0;
+    }
+    initialized = true;
+
+    return &type;
+}
+} // anon namespace
+
+PyObject*
+Effect::renderPlane(double time,
+                    const ImageLayer& layer,
+                    int view) const
+{
+    NodePtr node = getInternalNode();
+
+    if ( !node || !node->getEffectInstance() ) {
+        PyErr_SetString(PyExc_RuntimeError, "renderPlane: the node no longer exists");
+
+        return 0;
+    }
+    EffectInstancePtr effect = node->getEffectInstance();
+    RectD rod = getRegionOfDefinition(time, view);
+    RectI roi;
+    rod.toPixelEnclosing( 0, effect->getAspectRatio(-1), &roi );
+    if ( roi.isNull() ) {
+        PyErr_SetString(PyExc_ValueError, "renderPlane: the region of definition of the node is empty");
+
+        return 0;
+    }
+
+    std::list<ImagePlaneDesc> components;
+    components.push_back( layer.getInternalComps() );
+
+    std::map<ImagePlaneDesc, ImagePtr> planes;
+    EffectInstance::RenderRoIRetCode stat;
+    {
+        AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(false, 0);
+        // This node is the root of the render and the caller of renderRoI(): as in analysis, its output is kept in the cache
+        ParallelRenderArgsSetter frameRenderArgs( time,
+                                                  ViewIdx(view),
+                                                  false, //isRenderUserInteraction
+                                                  false, //isSequential
+                                                  abortInfo, //abort info
+                                                  node, //tree root
+                                                  0, //texture index
+                                                  node->getApp()->getTimeLine().get(),
+                                                  NodePtr(),
+                                                  true, //isAnalysis
+                                                  false, //draftMode
+                                                  RenderStatsPtr() );
+        EffectInstance::RenderRoIArgs args( time,
+                                            RenderScale(1.),
+                                            0, //mipmaplevel
+                                            ViewIdx(view),
+                                            false,
+                                            roi,
+                                            rod,
+                                            components,
+                                            eImageBitDepthFloat,
+                                            false,
+                                            effect.get(),
+                                            eStorageModeRAM,
+                                            time );
+        stat = effect->renderRoI(args, &planes);
+    }
+    appPTR->getAppTLS()->cleanupTLSForThread();
+
+    if ( (stat != EffectInstance::eRenderRoIRetCodeOk) || planes.empty() ) {
+        PyErr_SetString(PyExc_RuntimeError, "renderPlane: the render failed");
+
+        return 0;
+    }
+    std::map<ImagePlaneDesc, ImagePtr>::const_iterator found = planes.find( layer.getInternalComps() );
+    const ImagePtr& image = found != planes.end() ? found->second : planes.begin()->second;
+    if ( !image || (image->getBitDepth() != eImageBitDepthFloat) || (image->getStorageMode() != eStorageModeRAM) ) {
+        PyErr_SetString(PyExc_RuntimeError, "renderPlane: the render did not produce a 32-bit floating point image");
+
+        return 0;
+    }
+    RectI bufferRect;
+    if ( !roi.intersect(image->getBounds(), &bufferRect) ) {
+        PyErr_SetString(PyExc_RuntimeError, "renderPlane: the render produced an empty image");
+
+        return 0;
+    }
+
+    PyTypeObject* type = getImageBufferType();
+    if (!type) {
+        return 0;
+    }
+    ImageBufferObject* obj = PyObject_New(ImageBufferObject, type);
+    if (!obj) {
+        return 0;
+    }
+    const Py_ssize_t nComps = (Py_ssize_t)image->getComponentsCount();
+    obj->image = new ImagePtr(image);
+    {
+        // The read access is only needed to get the address of the pixels, it is released before returning
+        Image::ReadAccess access( image.get() );
+        obj->data = access.pixelAt(bufferRect.x1, bufferRect.y1);
+    }
+    obj->shape[0] = bufferRect.height();
+    obj->shape[1] = bufferRect.width();
+    obj->shape[2] = nComps;
+    obj->strides[0] = (Py_ssize_t)image->getRowBytes();
+    obj->strides[1] = nComps * (Py_ssize_t)sizeof(float);
+    obj->strides[2] = sizeof(float);
+
+    // The memoryview holds the only reference to the exporter
+    PyObject* ret = PyMemoryView_FromObject( (PyObject*)obj );
+    Py_DECREF(obj);
+
+    return ret;
+} // Effect::renderPlane
+
 void
 Effect::setSubGraphEditable(bool editable)
 {
@@ -372,6 +372,15 @@ public:
 
     RectD getRegionOfDefinition(double time, int /* Python API: do not use ViewIdx */ view) const;
 
+    /**
+     * @brief Renders the given layer of this node at full scale over its whole region of definition and returns a new
+     * reference to a read-only memoryview of the pixels, or NULL with a Python exception set on failure.
+     * The memoryview is backed by the image in the cache, without copy: it has the shape (height, width, channels) of 32-bit
+     * floats, rows go from the bottom to the top of the image. It can be wrapped with numpy.asarray().
+     * The image is kept alive, but not locked, until the memoryview is released.
+     **/
+    PyObject* renderPlane(double time, const ImageLayer& layer, int /* Python API: do not use ViewIdx */ view = 0) const;
+
     static Param* createParamWrapperForKnob(const KnobIPtr& knob);
 
     void setSubGraphEditable(bool editable);
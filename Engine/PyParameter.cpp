@@ -26,13 +26,22 @@
 #include "PyParameter.h"
 
 #include <cassert>
+#include <cmath>
 #include <stdexcept>
+#include <vector>
+
+#if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+#include <boost/math/special_functions/fpclassify.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+#endif
 
 #include "Engine/EffectInstance.h"
 #include "Engine/Node.h"
 #include "Engine/AppInstance.h"
 #include "Engine/KnobSerialization.h"
 #include "Engine/Curve.h"
+#include "Engine/PyDoubleArray.h"
 #include "Engine/ViewIdx.h"
 
 NATRON_NAMESPACE_ENTER
@@ -581,6 +590,131 @@ AnimatedParam::setInterpolationAtTime(double time,
     return knob->setInterpolationAtTime(eCurveChangeReasonInternal, ViewSpec::current(), dimension, time, interpolation, &newKey);
 }
 
+bool
+AnimatedParam::setKeys(PyObject* times,
+                       PyObject* values,
+                       int dimension)
+{
+    KnobIPtr knob = getInternalKnob();
+
+    if (!knob) {
+        PyErr_SetString(PyExc_RuntimeError, "setKeys: the parameter no longer exists");
+
+        return false;
+    }
+    if ( (dimension < 0) || ( dimension >= knob->getDimension() ) ) {
+        PyErr_SetString(PyExc_IndexError, "setKeys: invalid dimension");
+
+        return false;
+    }
+    if ( !knob->canAnimate() || dynamic_cast<KnobStringBase*>( knob.get() ) ) {
+        PyErr_SetString(PyExc_TypeError, "setKeys: the parameter cannot be animated with numerical keyframes");
+
+        return false;
+    }
+    CurvePtr curve = knob->getCurve(ViewSpec::current(), dimension, true);
+    if (!curve) {
+        PyErr_SetString(PyExc_TypeError, "setKeys: the parameter has no animation curve");
+
+        return false;
+    }
+
+    PyDoubleArray timesArray, valuesArray;
+    if ( !timesArray.read(times, "times") || !valuesArray.read(values, "values") ) {
+        return false;
+    }
+    if ( timesArray.size() != valuesArray.size() ) {
+        PyErr_SetString(PyExc_ValueError, "setKeys: times and values must have the same length");
+
+        return false;
+    }
+
+    // Same conversion as addKeyFrame() for the integer, boolean and choice parameters
+    const bool isInt = curve->areKeyFramesValuesClampedToIntegers() || dynamic_cast<KnobChoice*>( knob.get() );
+    const bool isBool = curve->areKeyFramesValuesClampedToBooleans();
+    KeyframeTypeEnum interpolation = (isInt || isBool) ? eKeyframeTypeConstant : eKeyframeTypeSmooth;
+
+    KeyFrameSet keys = curve->getKeyFrames_mt_safe();
+    for (Py_ssize_t i = 0; i < timesArray.size(); ++i) {
+        double time = timesArray[i];
+        double value = valuesArray[i];
+        if ( (boost::math::isnan)(time) || (boost::math::isinf)(time) || (boost::math::isnan)(value) || (boost::math::isinf)(value) ) {
+            PyErr_Format(PyExc_ValueError, "setKeys: the keyframe at index %d is not finite", (int)i);
+
+            return false;
+        }
+        if (isBool) {
+            value = value != 0. ? 1. : 0.;
+        } else if (isInt) {
+            value = std::floor(value + 0.5);
+        }
+        KeyFrame k(time, value, 0., 0., interpolation);
+        std::pair<KeyFrameSet::iterator, bool> ret = keys.insert(k);
+        if (!ret.second) {
+            // Replace the existing keyframe at this time
+            keys.erase(ret.first);
+            keys.insert(k);
+        }
+    }
+
+    // Update the whole curve at once: the derivatives are computed once and the parameter is refreshed once
+    Curve newCurve(*curve);
+    newCurve.setKeyframes(keys, true);
+    knob->cloneCurve(ViewSpec::current(), dimension, newCurve);
+
+    return true;
+}
+
+PyObject*
+AnimatedParam::getKeys(int dimension) const
+{
+    KnobIPtr knob = getInternalKnob();
+
+    if (!knob) {
+        PyErr_SetString(PyExc_RuntimeError, "getKeys: the parameter no longer exists");
+
+        return 0;
+    }
+    if ( (dimension < 0) || ( dimension >= knob->getDimension() ) ) {
+        PyErr_SetString(PyExc_IndexError, "getKeys: invalid dimension");
+
+        return 0;
+    }
+    std::vector<double> times, values;
+    CurvePtr curve = knob->getCurve(ViewSpec::current(), dimension);
+    if (curve) {
+        KeyFrameSet keys = curve->getKeyFrames_mt_safe();
+        times.reserve( keys.size() );
+        values.reserve( keys.size() );
+        for (KeyFrameSet::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+            times.push_back( it->getTime() );
+            values.push_back( it->getValue() );
+        }
+    }
+
+    PyObject* timesObj = PyDoubleArray::createArray(times);
+    if (!timesObj) {
+        return 0;
+    }
+    PyObject* valuesObj = PyDoubleArray::createArray(values);
+    if (!valuesObj) {
+        Py_DECREF(timesObj);
+
+        return 0;
+    }
+    PyObject* ret = PyTuple_New(2);
+    if (!ret) {
+        Py_DECREF(timesObj);
+        Py_DECREF(valuesObj);
+
+        return 0;
+    }
+    PyTuple_SET_ITEM(ret, 0, timesObj);
+    PyTuple_SET_ITEM(ret, 1, valuesObj);
+
+    return ret;
+}
+
 void
 Param::_addAsDependencyOf(int fromExprDimension,
                           Param* param,
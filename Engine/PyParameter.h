@@ -270,6 +270,22 @@ public:
     QString getExpression(int dimension, bool* hasRetVariable) const;
 
     bool setInterpolationAtTime(double time, NATRON_NAMESPACE::KeyframeTypeEnum interpolation, int dimension = 0);
+
+    /**
+     * @brief Sets all the keyframes given in the times and values sequences on the given dimension at once, replacing any
+     * existing keyframe at the same times. times and values may be any object exporting a C-contiguous buffer of doubles
+     * (array.array('d'), a float64 numpy array...), which is read without conversion, or any sequence of numbers.
+     * The parameter is refreshed once for all keyframes.
+     * Returns false and sets a Python exception on failure.
+     **/
+    bool setKeys(PyObject* times, PyObject* values, int dimension = 0);
+
+    /**
+     * @brief Returns a new reference to a tuple (times, values) of 2 array.array('d') holding all the keyframes of the
+     * given dimension, sorted by time. They can be wrapped without copy with numpy.frombuffer().
+     * Returns NULL and sets a Python exception on failure.
+     **/
+    PyObject* getKeys(int dimension = 0) const;
 };
 
 /**
@@ -0,0 +1,429 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RamBufferPool.h"
+
+#include <cassert>
+#include <cstdlib> // malloc, free, posix_memalign
+#include <map>
+#include <new> // bad_alloc
+#include <set>
+#include <vector>
+
+#if defined(__NATRON_LINUX__)
+#include <sys/mman.h> // madvise
+#endif
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include <QtCore/QMutex>
+
+#include "Engine/NumaTopology.h"
+#include "Engine/ThreadStorage.h"
+
+NATRON_NAMESPACE_ENTER
+
+namespace {
+// Idle blocks, by block size and NUMA node holding their memory (-1 if it was never touched, 0 if the NUMA mode is
+// disabled). Largest blocks come last.
+typedef std::pair<std::size_t, int> BlockClass;
+typedef std::map<BlockClass, std::vector<void*> > FreeLists;
+
+// Removes an idle block of the given class from the lists, returns NULL if there is none
+void*
+popBlock(FreeLists& lists,
+         const BlockClass& blockClass)
+{
+    FreeLists::iterator found = lists.find(blockClass);
+
+    if ( ( found == lists.end() ) || found->second.empty() ) {
+        return 0;
+    }
+    void* ptr = found->second.back();
+    found->second.pop_back();
+
+    return ptr;
+}
+
+void*
+allocateBlock(std::size_t size)
+{
+#if defined(__NATRON_LINUX__) && defined(MADV_HUGEPAGE)
+    if (size >= NATRON_RAMBUFFER_POOL_HUGE_PAGE_SIZE) {
+        // Align the block so that the kernel can back it with transparent huge pages: an 8K float image
+        // then takes a few hundred page faults instead of more than a hundred thousand.
+        void* ptr = 0;
+        if (posix_memalign(&ptr, NATRON_RAMBUFFER_POOL_HUGE_PAGE_SIZE, size) != 0) {
+            return 0;
+        }
+        // This is only a hint, it fails if transparent huge pages are disabled
+        madvise(ptr, size, MADV_HUGEPAGE);
+
+        return ptr;
+    }
+#endif
+
+    return malloc(size);
+}
+
+// Removes the largest blocks from the lists until at most maxBytes remain, and appends them to toFree.
+// Returns the number of bytes removed.
+std::size_t
+popLargestBlocks(FreeLists& lists,
+                 std::size_t bytes,
+                 std::size_t maxBytes,
+                 std::vector<void*>* toFree)
+{
+    std::size_t removed = 0;
+
+    while ( (bytes - removed > maxBytes) && !lists.empty() ) {
+        FreeLists::iterator last = lists.end();
+        --last;
+        if ( last->second.empty() ) {
+            lists.erase(last);
+            continue;
+        }
+        toFree->push_back( last->second.back() );
+        last->second.pop_back();
+        removed += last->first.first;
+    }
+
+    return removed;
+}
+
+void
+freeBlocks(const std::vector<void*>& blocks)
+{
+    for (std::vector<void*>::const_iterator it = blocks.begin(); it != blocks.end(); ++it) {
+        free(*it);
+    }
+}
+
+struct ThreadCache;
+typedef boost::shared_ptr<ThreadCache> ThreadCachePtr;
+
+struct RamBufferPoolPrivate
+{
+    // Protects all fields below except the thread storage
+    QMutex lock;
+
+    // Idle blocks shared by all threads
+    FreeLists freeLists;
+    std::size_t idleBytes;
+    std::size_t maxIdleBytes;
+
+    // The cache of each thread that allocated through the pool
+    std::set<ThreadCache*> threadCaches;
+
+    // Bytes in use accounted by threads that have exited
+    boost::int64_t retiredInUseBytes;
+
+    ThreadStorage<ThreadCachePtr> tls;
+
+    RamBufferPoolPrivate()
+        : lock()
+        , freeLists()
+        , idleBytes(0)
+        , maxIdleBytes(NATRON_RAMBUFFER_POOL_DEFAULT_MAX_IDLE_BYTES)
+        , threadCaches()
+        , retiredInUseBytes(0)
+        , tls()
+    {
+    }
+
+    ThreadCache* getThreadCache();
+
+    std::size_t getIdleBytes_locked() const;
+};
+
+// The pool is never destroyed: blocks may be freed by threads (and thread-local data) outliving any static object.
+RamBufferPoolPrivate*
+getPool()
+{
+    static RamBufferPoolPrivate* pool = new RamBufferPoolPrivate;
+
+    return pool;
+}
+
+/**
+ * @brief The blocks kept by a thread. Its lock is only ever contended when another thread trims the pool.
+ **/
+struct ThreadCache
+{
+    // Protects all fields below
+    QMutex lock;
+    FreeLists freeLists;
+    std::size_t idleBytes;
+
+    // Bytes allocated minus bytes freed by this thread. A block may be freed by another thread than the one
+    // that allocated it, so this may be negative.
+    boost::int64_t inUseBytes;
+
+    ThreadCache()
+        : lock()
+        , freeLists()
+        , idleBytes(0)
+        , inUseBytes(0)
+    {
+    }
+
+    ~ThreadCache()
+    {
+        // The thread is exiting: hand its blocks over to the other threads
+        RamBufferPoolPrivate* pool = getPool();
+        std::vector<void*> toFree;
+        {
+            QMutexLocker k(&pool->lock);
+            pool->threadCaches.erase(this);
+            pool->retiredInUseBytes += inUseBytes;
+            for (FreeLists::iterator it = freeLists.begin(); it != freeLists.end(); ++it) {
+                for (std::vector<void*>::iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+                    if (pool->idleBytes + it->first.first > pool->maxIdleBytes) {
+                        toFree.push_back(*it2);
+                    } else {
+                        pool->freeLists[it->first].push_back(*it2);
+                        pool->idleBytes += it->first.first;
+                    }
+                }
+            }
+        }
+        freeBlocks(toFree);
+    }
+};
+
+ThreadCache*
+RamBufferPoolPrivate::getThreadCache()
+{
+    ThreadCachePtr& cache = tls.localData();
+
+    if (!cache) {
+        cache.reset(new ThreadCache);
+        QMutexLocker k(&lock);
+        threadCaches.insert( cache.get() );
+    }
+
+    return cache.get();
+}
+
+std::size_t
+RamBufferPoolPrivate::getIdleBytes_locked() const
+{
+    std::size_t ret = idleBytes;
+
+    for (std::set<ThreadCache*>::const_iterator it = threadCaches.begin(); it != threadCaches.end(); ++it) {
+        QMutexLocker k(&(*it)->lock);
+        ret += (*it)->idleBytes;
+    }
+
+    return ret;
+}
+} // anon
+
+std::size_t
+RamBufferPool::getBlockSize(std::size_t size)
+{
+    if (size < NATRON_RAMBUFFER_POOL_MIN_BLOCK_SIZE) {
+        return size;
+    }
+    // Find the power of two such that octave <= size < 2 * octave and round size up to a multiple of octave / N
+    std::size_t octave = NATRON_RAMBUFFER_POOL_MIN_BLOCK_SIZE;
+    while (octave <= size / 2) {
+        octave *= 2;
+    }
+    std::size_t step = octave / NATRON_RAMBUFFER_POOL_CLASSES_PER_OCTAVE;
+
+    return ( (size + step - 1) / step ) * step;
+}
+
+void*
+RamBufferPool::allocate(std::size_t size,
+                        std::size_t* allocatedSize,
+                        int numaNode)
+{
+    assert(allocatedSize);
+    if (size < NATRON_RAMBUFFER_POOL_MIN_BLOCK_SIZE) {
+        void* ptr = malloc(size);
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        *allocatedSize = size;
+
+        return ptr;
+    }
+
+    const std::size_t blockSize = getBlockSize(size);
+    // In NUMA mode, the memory of blocks that were never touched lands on the node of the thread that touches it first
+    const BlockClass blockClasses[2] = { BlockClass(blockSize, numaNode), BlockClass(blockSize, -1) };
+    const int nBlockClasses = NumaTopology::isEnabled() ? 2 : 1;
+    RamBufferPoolPrivate* pool = getPool();
+    ThreadCache* cache = pool->getThreadCache();
+    void* ptr = 0;
+    {
+        QMutexLocker k(&cache->lock);
+        cache->inUseBytes += blockSize;
+        for (int i = 0; i < nBlockClasses && !ptr; ++i) {
+            ptr = popBlock(cache->freeLists, blockClasses[i]);
+        }
+        if (ptr) {
+            cache->idleBytes -= blockSize;
+        }
+    }
+    if (!ptr) {
+        QMutexLocker k(&pool->lock);
+        for (int i = 0; i < nBlockClasses && !ptr; ++i) {
+            ptr = popBlock(pool->freeLists, blockClasses[i]);
+        }
+        if (ptr) {
+            pool->idleBytes -= blockSize;
+        }
+    }
+    if (!ptr) {
+        ptr = allocateBlock(blockSize);
+        if (!ptr) {
+            // Give all idle memory back to the system and try again before giving up
+            purge();
+            ptr = allocateBlock(blockSize);
+        }
+        if (!ptr) {
+            QMutexLocker k(&cache->lock);
+            cache->inUseBytes -= blockSize;
+            throw std::bad_alloc();
+        }
+    }
+    *allocatedSize = blockSize;
+
+    return ptr;
+} // RamBufferPool::allocate
+
+void
+RamBufferPool::deallocate(void* ptr,
+                          std::size_t allocatedSize)
+{
+    if (!ptr) {
+        return;
+    }
+    if (allocatedSize < NATRON_RAMBUFFER_POOL_MIN_BLOCK_SIZE) {
+        free(ptr);
+
+        return;
+    }
+    assert( getBlockSize(allocatedSize) == allocatedSize );
+    // The pages of the block land on the node of the thread that touched them first, which may not be the thread that
+    // allocated the block: ask the kernel where they are
+    const BlockClass blockClass( allocatedSize, NumaTopology::isEnabled() ? NumaTopology::getMemoryNode(ptr, allocatedSize) : 0 );
+
+    RamBufferPoolPrivate* pool = getPool();
+    ThreadCache* cache = pool->getThreadCache();
+    {
+        QMutexLocker k(&cache->lock);
+        cache->inUseBytes -= allocatedSize;
+        if (cache->idleBytes + allocatedSize <= NATRON_RAMBUFFER_POOL_THREAD_CACHE_MAX_BYTES) {
+            std::vector<void*>& blocks = cache->freeLists[blockClass];
+            if (blocks.size() < NATRON_RAMBUFFER_POOL_THREAD_CACHE_BLOCKS_PER_CLASS) {
+                blocks.push_back(ptr);
+                cache->idleBytes += allocatedSize;
+
+                return;
+            }
+        }
+    }
+    {
+        QMutexLocker k(&pool->lock);
+        if (pool->idleBytes + allocatedSize <= pool->maxIdleBytes) {
+            pool->freeLists[blockClass].push_back(ptr);
+            pool->idleBytes += allocatedSize;
+
+            return;
+        }
+    }
+    free(ptr);
+} // RamBufferPool::deallocate
+
+std::size_t
+RamBufferPool::getIdleBytes()
+{
+    RamBufferPoolPrivate* pool = getPool();
+    QMutexLocker k(&pool->lock);
+
+    return pool->getIdleBytes_locked();
+}
+
+std::size_t
+RamBufferPool::getInUseBytes()
+{
+    RamBufferPoolPrivate* pool = getPool();
+    QMutexLocker k(&pool->lock);
+    boost::int64_t ret = pool->retiredInUseBytes;
+
+    for (std::set<ThreadCache*>::const_iterator it = pool->threadCaches.begin(); it != pool->threadCaches.end(); ++it) {
+        QMutexLocker k2(&(*it)->lock);
+        ret += (*it)->inUseBytes;
+    }
+
+    return ret < 0 ? 0 : (std::size_t)ret;
+}
+
+void
+RamBufferPool::trim(std::size_t maxIdleBytes)
+{
+    RamBufferPoolPrivate* pool = getPool();
+    std::vector<void*> toFree;
+    {
+        QMutexLocker k(&pool->lock);
+        std::size_t totalIdle = pool->getIdleBytes_locked();
+        if (totalIdle <= maxIdleBytes) {
+            return;
+        }
+        // Release the shared blocks first, then the blocks kept by each thread
+        std::size_t removed = popLargestBlocks(pool->freeLists, totalIdle, maxIdleBytes, &toFree);
+        pool->idleBytes -= removed;
+        totalIdle -= removed;
+        for (std::set<ThreadCache*>::const_iterator it = pool->threadCaches.begin(); it != pool->threadCaches.end() && totalIdle > maxIdleBytes; ++it) {
+            QMutexLocker k2(&(*it)->lock);
+            std::size_t threadMax = totalIdle - maxIdleBytes >= (*it)->idleBytes ? 0 : (*it)->idleBytes - (totalIdle - maxIdleBytes);
+            removed = popLargestBlocks( (*it)->freeLists, (*it)->idleBytes, threadMax, &toFree );
+            (*it)->idleBytes -= removed;
+            totalIdle -= removed;
+        }
+    }
+    // Do not hold the lock while returning memory to the system
+    freeBlocks(toFree);
+}
+
+void
+RamBufferPool::setMaximumIdleBytes(std::size_t maxIdleBytes)
+{
+    {
+        RamBufferPoolPrivate* pool = getPool();
+        QMutexLocker k(&pool->lock);
+        pool->maxIdleBytes = maxIdleBytes;
+    }
+    trim(maxIdleBytes);
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,125 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_RAMBUFFERPOOL_H
+#define NATRON_ENGINE_RAMBUFFERPOOL_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+
+#include "Engine/EngineFwd.h"
+
+// Blocks smaller than this are not worth pooling: they are served by malloc directly.
+#define NATRON_RAMBUFFER_POOL_MIN_BLOCK_SIZE (64 * 1024)
+
+// Number of size classes per power of two. With 8 classes a block wastes at most 12.5% of its size.
+#define NATRON_RAMBUFFER_POOL_CLASSES_PER_OCTAVE 8
+
+// Blocks of at least this size are aligned on huge page boundaries and advised to be backed by transparent huge pages (Linux only).
+#define NATRON_RAMBUFFER_POOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// Maximum number of bytes a thread keeps for itself. Larger blocks always go to the shared free lists.
+#define NATRON_RAMBUFFER_POOL_THREAD_CACHE_MAX_BYTES (64 * 1024 * 1024)
+
+// Maximum number of idle blocks a thread keeps for a given size class
+#define NATRON_RAMBUFFER_POOL_THREAD_CACHE_BLOCKS_PER_CLASS 2
+
+// Default upper bound of the memory kept idle by the pool. The caches trim the pool further when they need room.
+#define NATRON_RAMBUFFER_POOL_DEFAULT_MAX_IDLE_BYTES (1024ULL * 1024ULL * 1024ULL)
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A recycling allocator for the memory of image buffers (RamBuffer).
+ * Images are allocated and discarded at a very high rate during renders (one per tile, per node and per frame)
+ * and most of them have the same few sizes. Instead of returning them to the system, freed blocks are kept by
+ * size class and handed back to the next allocation of the same class, which avoids the cost of malloc/free and,
+ * more importantly, of the page faults taken when touching freshly mapped memory.
+ *
+ * Each thread keeps a few blocks for itself so that a render thread reallocating the same tile sizes does not
+ * contend with other threads. The remaining idle blocks are shared by all threads.
+ *
+ * Idle blocks are accounted toward the memory budget of the caches: the caches call trim() to release them before
+ * evicting any entry, and they are released when the system runs low on RAM.
+ *
+ * All functions are MT-safe.
+ **/
+class RamBufferPool
+{
+public:
+
+    /**
+     * @brief Returns a block of at least the given size, in bytes, and sets allocatedSize to the actual size of the block,
+     * which must be passed back to deallocate(). Throws std::bad_alloc on failure.
+     * In NUMA mode, idle blocks are only reused if their memory is held by the given NUMA node (see NumaTopology::getCurrentNode())
+     * or if it was never touched.
+     **/
+    static void* allocate(std::size_t size, std::size_t* allocatedSize, int numaNode = 0);
+
+    /**
+     * @brief Gives back a block previously returned by allocate(). It is kept for reuse, unless the pool already holds
+     * too much idle memory. In NUMA mode, the block is filed under the node that actually holds its memory.
+     **/
+    static void deallocate(void* ptr, std::size_t allocatedSize);
+
+    /**
+     * @brief Returns the size of the block that allocate() would return for the given size.
+     **/
+    static std::size_t getBlockSize(std::size_t size);
+
+    /**
+     * @brief Returns the number of bytes held by idle blocks, including the blocks kept by each thread.
+     **/
+    static std::size_t getIdleBytes();
+
+    /**
+     * @brief Returns the number of bytes of the blocks currently handed out by the pool.
+     **/
+    static std::size_t getInUseBytes();
+
+    /**
+     * @brief Releases idle blocks to the system, largest first, until at most maxIdleBytes remain idle.
+     **/
+    static void trim(std::size_t maxIdleBytes);
+
+    /**
+     * @brief Releases all idle blocks to the system.
+     **/
+    static void purge()
+    {
+        trim(0);
+    }
+
+    /**
+     * @brief Set the maximum number of bytes kept idle by the pool. Blocks that are freed beyond this limit are
+     * returned to the system immediately.
+     **/
+    static void setMaximumIdleBytes(std::size_t maxIdleBytes);
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_RAMBUFFERPOOL_H
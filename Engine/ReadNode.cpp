@@ -26,6 +26,8 @@
 #include "ReadNode.h"
 
 #include <sstream> // stringstream
+#include <cmath> // floor
+#include <climits> // INT_MIN, INT_MAX
 
 #include "Global/QtCompat.h"
 
@@ -61,6 +63,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/AppManager.h"
 #include "Engine/Node.h"
 #include "Engine/CreateNodeArgs.h"
+#include "Engine/FilePrefetcher.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/KnobFile.h"
 #include "Engine/Project.h"
@@ -1351,6 +1354,124 @@ ReadNode::getFrameRange(double *first,
     }
 }
 
+/**
+ * @brief Maps a frame of the sequence that is outside of [firstFrame, lastFrame] according to the given before/after
+ * mode of the reader. Returns false if the reader does not read a file for that frame (black or error modes).
+ **/
+static bool
+getSequenceFrameForMode(const std::string& mode,
+                        int frame,
+                        int firstFrame,
+                        int lastFrame,
+                        int* sequenceFrame)
+{
+    const int range = lastFrame - firstFrame + 1;
+
+    if ( boost::iequals(mode, "hold") ) {
+        *sequenceFrame = frame < firstFrame ? firstFrame : lastFrame;
+
+        return true;
+    } else if ( boost::iequals(mode, "loop") ) {
+        int offset = (frame - firstFrame) % range;
+        if (offset < 0) {
+            offset += range;
+        }
+        *sequenceFrame = firstFrame + offset;
+
+        return true;
+    } else if ( boost::iequals(mode, "bounce") ) {
+        if (range == 1) {
+            *sequenceFrame = firstFrame;
+
+            return true;
+        }
+        const int period = 2 * (range - 1);
+        int offset = (frame - firstFrame) % period;
+        if (offset < 0) {
+            offset += period;
+        }
+        *sequenceFrame = offset < range ? firstFrame + offset : lastFrame - (offset - (range - 1));
+
+        return true;
+    }
+
+    return false;
+}
+
+void
+ReadNode::prefetchSequenceFiles(const std::vector<int>& frames)
+{
+    NodePtr p = getEmbeddedReader();
+    KnobFilePtr fileKnob = _imp->inputFileKnob.lock();
+
+    if ( !p || !fileKnob || frames.empty() ) {
+        return;
+    }
+
+    // The decoder reads the file of frame (time - timeOffset) within the original frame range of the sequence, frames
+    // outside of that range being handled by the before/after modes
+    int timeOffset = 0;
+    int firstFrame = INT_MIN;
+    int lastFrame = INT_MAX;
+    std::string beforeMode, afterMode;
+    {
+        KnobIntPtr knob = boost::dynamic_pointer_cast<KnobInt>( p->getKnobByName(kParamTimeOffset) );
+        if (knob) {
+            timeOffset = knob->getValue();
+        }
+        knob = boost::dynamic_pointer_cast<KnobInt>( p->getKnobByName(kParamFirstFrame) );
+        if (knob) {
+            firstFrame = knob->getValue();
+        }
+        knob = boost::dynamic_pointer_cast<KnobInt>( p->getKnobByName(kParamLastFrame) );
+        if (knob) {
+            lastFrame = knob->getValue();
+        }
+        KnobChoicePtr choice = boost::dynamic_pointer_cast<KnobChoice>( p->getKnobByName(kParamBefore) );
+        if (choice) {
+            beforeMode = choice->getActiveEntry().id;
+        }
+        choice = boost::dynamic_pointer_cast<KnobChoice>( p->getKnobByName(kParamAfter) );
+        if (choice) {
+            afterMode = choice->getActiveEntry().id;
+        }
+    }
+    if (lastFrame < firstFrame) {
+        return;
+    }
+
+    // Not a sequence, e.g: a video file
+    if ( (firstFrame == INT_MIN) || (lastFrame == INT_MAX) ||
+         ( fileKnob->getFileName(firstFrame, ViewIdx(0)) == fileKnob->getFileName(lastFrame, ViewIdx(0)) ) ) {
+        return;
+    }
+
+    std::vector<std::string> files;
+    std::string previousFile;
+    for (std::vector<int>::const_iterator it = frames.begin(); it != frames.end(); ++it) {
+        int frame = *it - timeOffset;
+        if (frame < firstFrame) {
+            if ( !getSequenceFrameForMode(beforeMode, frame, firstFrame, lastFrame, &frame) ) {
+                continue;
+            }
+        } else if (frame > lastFrame) {
+            if ( !getSequenceFrameForMode(afterMode, frame, firstFrame, lastFrame, &frame) ) {
+                continue;
+            }
+        }
+        std::string file = fileKnob->getFileName(frame, ViewIdx(0));
+        if ( file.empty() || (file == previousFile) ) {
+            continue;
+        }
+        previousFile = file;
+        getApp()->getProject()->canonicalizePath(file);
+        files.push_back(file);
+    }
+    if ( !files.empty() ) {
+        appPTR->getFilePrefetcher()->prefetchFiles( files, appPTR->getCurrentSettings()->isSequenceReadAheadFullReadEnabled() );
+    }
+} // ReadNode::prefetchSequenceFiles
+
 void
 ReadNode::getComponentsNeededAndProduced(double time,
                                          ViewIdx view,
@@ -113,6 +113,14 @@ public:
     virtual void onEffectCreated(bool mayCreateFileDialog,
                                  const CreateNodeArgs& defaultParamValues) OVERRIDE FINAL;
 
+    /**
+     * @brief Asks the FilePrefetcher to fetch the files read for the given timeline frames, in order, so that the decoder
+     * finds them in the page cache. Frames outside of the sequence range are mapped the way the reader does it, according
+     * to its before/after modes (hold, loop or bounce), or skipped if the reader produces no file for them.
+     * Does nothing if the node does not read an image sequence.
+     **/
+    void prefetchSequenceFiles(const std::vector<int>& frames);
+
 private:
 
     virtual StatusEnum getPreferredMetadata(NodeMetadata& metadata) OVERRIDE FINAL;
@@ -31,6 +31,7 @@
 
 #include <QtCore/QMutex>
 
+#include "Engine/EffectInstance.h"
 #include "Engine/Node.h"
 #include "Engine/Timer.h"
 #include "Engine/RectI.h"
@@ -66,6 +67,10 @@ struct NodeRenderStatsPrivate
     int nbCacheHit;
     int nbCacheHitButDownscaledImages;
 
+    //Lookups in the actions cache (RoD, identity, frames needed...) of the node while the frame was rendered
+    int nbActionsCacheHits;
+    int nbActionsCacheMisses;
+
     //Is tile support enabled for this render
     bool tileSupportEnabled;
 
@@ -89,6 +94,8 @@ struct NodeRenderStatsPrivate
         , nbCacheMisses(0)
         , nbCacheHit(0)
         , nbCacheHitButDownscaledImages(0)
+        , nbActionsCacheHits(0)
+        , nbActionsCacheMisses(0)
         , tileSupportEnabled(false)
         , renderScaleSupportEnabled(false)
         , channelsEnabled()
@@ -128,6 +135,8 @@ NodeRenderStats::operator=(const NodeRenderStats& other)
     _imp->nbCacheMisses = other._imp->nbCacheMisses;
     _imp->nbCacheHit = other._imp->nbCacheHit;
     _imp->nbCacheHitButDownscaledImages = other._imp->nbCacheHitButDownscaledImages;
+    _imp->nbActionsCacheHits = other._imp->nbActionsCacheHits;
+    _imp->nbActionsCacheMisses = other._imp->nbActionsCacheMisses;
     _imp->tileSupportEnabled = other._imp->tileSupportEnabled;
     _imp->renderScaleSupportEnabled = other._imp->renderScaleSupportEnabled;
     for (int i = 0; i < 4; ++i) {
@@ -254,6 +263,22 @@ NodeRenderStats::getCacheAccessInfos(int* nbCacheMisses,
     *nbCacheHitButDownscaledImages = _imp->nbCacheHitButDownscaledImages;
 }
 
+void
+NodeRenderStats::setActionsCacheAccessInfos(int nbHits,
+                                            int nbMisses)
+{
+    _imp->nbActionsCacheHits = nbHits;
+    _imp->nbActionsCacheMisses = nbMisses;
+}
+
+void
+NodeRenderStats::getActionsCacheAccessInfos(int* nbHits,
+                                            int* nbMisses) const
+{
+    *nbHits = _imp->nbActionsCacheHits;
+    *nbMisses = _imp->nbActionsCacheMisses;
+}
+
 void
 NodeRenderStats::setTilesSupported(bool tilesSupported)
 {
@@ -315,12 +340,27 @@ struct RenderStatsPrivate
     typedef std::map<NodeWPtr, NodeRenderStats > NodeInfosMap;
     NodeInfosMap nodeInfos;
 
+    // Counters of the actions cache of each node when it was first seen during the frame. The actions caches are
+    // read far too often to report each lookup: the stats are the difference with the counters at the end of the frame.
+    typedef std::map<NodeWPtr, std::pair<unsigned int, unsigned int> > ActionsCacheCountersMap;
+    ActionsCacheCountersMap actionsCacheCountersAtStart;
+
+    // Time, relative to the start of the frame, at which each stage currently running began
+    std::map<std::string, double> stagesStartTime;
+    RenderStageTimings stageTimings;
+
+    NumaTrafficMap numaTraffic;
+
 
     RenderStatsPrivate()
         : lock()
         , totalTimeSpentForFrameTimer()
         , doNodesProfiling(false)
         , nodeInfos()
+        , actionsCacheCountersAtStart()
+        , stagesStartTime()
+        , stageTimings()
+        , numaTraffic()
     {
     }
 
@@ -348,6 +388,12 @@ struct RenderStatsPrivate
         std::pair<NodeInfosMap::iterator, bool> ret = nodeInfos.insert( std::make_pair( node, NodeRenderStats() ) );
         assert(ret.second);
 
+        EffectInstancePtr effect = node->getEffectInstance();
+        if (effect) {
+            std::pair<unsigned int, unsigned int>& counters = actionsCacheCountersAtStart[node];
+            effect->getActionsCacheAccessCounts(&counters.first, &counters.second);
+        }
+
         return ret.first->second;
     }
 };
@@ -444,8 +490,16 @@ RenderStats::getStats(double *totalTimeSpent) const
 
     for (RenderStatsPrivate::NodeInfosMap::const_iterator it = _imp->nodeInfos.begin(); it != _imp->nodeInfos.end(); ++it) {
         NodePtr node = it->first.lock();
-        if (node) {
-            ret.insert( std::make_pair(node, it->second) );
+        if (!node) {
+            continue;
+        }
+        NodeRenderStats& stats = ret.insert( std::make_pair(node, it->second) ).first->second;
+        EffectInstancePtr effect = node->getEffectInstance();
+        RenderStatsPrivate::ActionsCacheCountersMap::const_iterator start = _imp->actionsCacheCountersAtStart.find(it->first);
+        if ( effect && ( start != _imp->actionsCacheCountersAtStart.end() ) ) {
+            unsigned int hits, misses;
+            effect->getActionsCacheAccessCounts(&hits, &misses);
+            stats.setActionsCacheAccessInfos( (int)(hits - start->second.first), (int)(misses - start->second.second) );
         }
     }
 
@@ -454,4 +508,65 @@ RenderStats::getStats(double *totalTimeSpent) const
     return ret;
 }
 
+void
+RenderStats::beginStage(const std::string& stage)
+{
+    QMutexLocker k(&_imp->lock);
+
+    _imp->stagesStartTime[stage] = _imp->totalTimeSpentForFrameTimer.getTimeSinceCreation();
+}
+
+void
+RenderStats::endStage(const std::string& stage)
+{
+    QMutexLocker k(&_imp->lock);
+    std::map<std::string, double>::iterator found = _imp->stagesStartTime.find(stage);
+
+    if ( found == _imp->stagesStartTime.end() ) {
+        return;
+    }
+    double timeSpent = _imp->totalTimeSpentForFrameTimer.getTimeSinceCreation() - found->second;
+    _imp->stagesStartTime.erase(found);
+
+    for (RenderStageTimings::iterator it = _imp->stageTimings.begin(); it != _imp->stageTimings.end(); ++it) {
+        if (it->first == stage) {
+            it->second += timeSpent;
+
+            return;
+        }
+    }
+    _imp->stageTimings.push_back( std::make_pair(stage, timeSpent) );
+}
+
+RenderStageTimings
+RenderStats::getStageTimings() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return _imp->stageTimings;
+}
+
+void
+RenderStats::addNumaTraffic(int threadNode,
+                            int memoryNode,
+                            U64 bytes)
+{
+    QMutexLocker k(&_imp->lock);
+    NumaNodeTraffic& traffic = _imp->numaTraffic[threadNode];
+
+    if (memoryNode == threadNode) {
+        traffic.localBytes += bytes;
+    } else {
+        traffic.remoteBytes += bytes;
+    }
+}
+
+NumaTrafficMap
+RenderStats::getNumaTraffic() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return _imp->numaTraffic;
+}
+
 NATRON_NAMESPACE_EXIT
@@ -28,6 +28,7 @@
 
 #include "Global/Macros.h"
 
+#include <cstddef>
 #include <list>
 #include <map>
 #include <set>
@@ -46,8 +47,86 @@
 #include "Engine/RectD.h"
 #include "Engine/EngineFwd.h"
 
+// Stages of the render of a frame by a Write node whose encoder must receive frames in order
+#define kRenderStageTreeRender "Tree render"
+#define kRenderStageWriterQueue "Waiting in writer queue"
+#define kRenderStageEncode "Encoding"
+
+// Capture of the parameters values when the render of a frame starts, see KnobValuesSnapshot
+#define kRenderStageKnobsSnapshot "Parameters snapshot"
+
 NATRON_NAMESPACE_ENTER
 
+/**
+ * @brief Time spent in each stage of the render of a frame, in the order stages were entered
+ **/
+typedef std::list<std::pair<std::string, double> > RenderStageTimings;
+
+/**
+ * @brief Bytes of image memory written by the render threads running on a NUMA node, split by whether the memory
+ * of the images was on the same node (local) or on another node (remote, going through the inter-socket link).
+ **/
+struct NumaNodeTraffic
+{
+    U64 localBytes;
+    U64 remoteBytes;
+
+    NumaNodeTraffic()
+        : localBytes(0)
+        , remoteBytes(0)
+    {
+    }
+};
+
+/**
+ * @brief The traffic of each NUMA node, indexed by node
+ **/
+typedef std::map<int, NumaNodeTraffic> NumaTrafficMap;
+
+/**
+ * @brief Statistics of a node summed over all the frames of a render
+ **/
+struct NodeRenderStatsTotals
+{
+    double timeSpentRendering;
+    int nbCacheMisses;
+    int nbCacheHits;
+    int nbCacheHitButDownscaledImages;
+
+    NodeRenderStatsTotals()
+        : timeSpentRendering(0)
+        , nbCacheMisses(0)
+        , nbCacheHits(0)
+        , nbCacheHitButDownscaledImages(0)
+    {
+    }
+};
+
+/**
+ * @brief Statistics of all the frames rendered by a Write node, see OutputEffectInstance::setRenderStatsTotalsEnabled()
+ **/
+struct RenderStatsTotals
+{
+    int nbFrames;
+
+    // Sum of the wall clock time spent for each frame
+    double wallTime;
+
+    // Largest resident memory of the process, sampled at the end of each frame
+    std::size_t peakRSS;
+
+    // Indexed by the script name of the node
+    std::map<std::string, NodeRenderStatsTotals> nodes;
+
+    RenderStatsTotals()
+        : nbFrames(0)
+        , wallTime(0)
+        , peakRSS(0)
+        , nodes()
+    {
+    }
+};
+
 /**
  * @brief Holds render infos for one frame for one node. Not MT-safe: MT-safety is handled by RenderStats.
  **/
@@ -88,6 +167,10 @@ public:
     void addCacheAccessInfo(bool isCacheMiss, bool hasDownscaled);
     void getCacheAccessInfos(int* nbCacheMisses, int* nbCacheHits, int* nbCacheHitButDownscaledImages) const;
 
+    void setActionsCacheAccessInfos(int nbHits, int nbMisses);
+
+    void getActionsCacheAccessInfos(int* nbHits, int* nbMisses) const;
+
     void setTilesSupported(bool tilesSupported);
     bool isTilesSupportEnabled() const;
 
@@ -145,6 +228,23 @@ public:
 
     std::map<NodePtr, NodeRenderStats > getStats(double *totalTimeSpent) const;
 
+    /**
+     * @brief Marks the beginning and the end of a stage of the render of the frame. The stages may be executed by different threads.
+     * Stage timings are recorded even if in-depth profiling is disabled.
+     **/
+    void beginStage(const std::string& stage);
+    void endStage(const std::string& stage);
+
+    RenderStageTimings getStageTimings() const;
+
+    /**
+     * @brief Accounts bytes of an image held by memoryNode, as placed by the kernel, written by a thread running on threadNode.
+     * This is only recorded when the NUMA mode is enabled, see NumaTopology.
+     **/
+    void addNumaTraffic(int threadNode, int memoryNode, U64 bytes);
+
+    NumaTrafficMap getNumaTraffic() const;
+
 private:
 
     boost::scoped_ptr<RenderStatsPrivate> _imp;
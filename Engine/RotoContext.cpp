@@ -3338,14 +3338,14 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
 
     bezier->evaluateFeatherPointsAtTime_DeCasteljau(false, time, mipmapLevel,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
-                                                    50,
+                                                    -1,
 #else
                                                     1,
 #endif
                                                     true, &featherPolygon, &featherPolyBBox);
     bezier->evaluateAtTime_DeCasteljau(false, time, mipmapLevel,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
-                                       50,
+                                       -1,
 #else
                                        1,
 #endif
@@ -57,6 +57,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Global/GlobalDefines.h"
 
 #include "Engine/AppManager.h"
+#include "Engine/Bezier.h"
 #include "Engine/BezierCP.h"
 #include "Engine/Curve.h"
 #include "Engine/EffectInstance.h"
@@ -64,6 +65,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/KnobTypes.h"
 #include "Engine/MergingEnum.h"
 #include "Engine/Node.h"
+#include "Engine/RectD.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoPaint.h"
 #include "Engine/Transform.h"
@@ -397,11 +399,36 @@ struct RotoTriangles
     std::list<Point> vertices;
 };
 
+/**
+ * @brief A polyline approximating either the control points or the feather points of a Bezier, along with its bounding box.
+ * The shapeHash identifies the position of the points, the transform and the evaluation parameters it was computed with.
+ **/
+struct BezierFlattening
+{
+    U64 shapeHash;
+    std::list<std::list<ParametricPoint> > segments;
+    RectD bbox;
+
+    BezierFlattening()
+        : shapeHash(0)
+        , segments()
+        , bbox()
+    {
+        bbox.setupInfinity();
+    }
+};
+
+typedef boost::shared_ptr<const BezierFlattening> BezierFlatteningConstPtr;
+
 struct BezierPrivate
 {
     BezierCPs points; //< the control points of the curve
     BezierCPs featherPoints; //< the feather points, the number of feather points must equal the number of cp.
 
+    // Most recently evaluated polylines, most recent first. Shared by the overlay and the render.
+    mutable QMutex flatteningCacheMutex;
+    mutable std::list<BezierFlatteningConstPtr> flatteningCache;
+
     //updated whenever the Bezier is edited, this is used to determine if a point lies inside the bezier or not
     //it has a value for each keyframe
     mutable std::map<double, bool> isClockwiseOriented;
@@ -417,6 +444,8 @@ struct BezierPrivate
     BezierPrivate(bool isOpenBezier)
         : points()
         , featherPoints()
+        , flatteningCacheMutex()
+        , flatteningCache()
         , isClockwiseOriented()
         , isClockwiseOrientedStatic(false)
         , guiIsClockwiseOriented()
@@ -436,6 +465,33 @@ struct BezierPrivate
         mustCopyGui = copy;
     }
 
+    BezierFlatteningConstPtr getFlattening(U64 shapeHash) const
+    {
+        QMutexLocker k(&flatteningCacheMutex);
+
+        for (std::list<BezierFlatteningConstPtr>::iterator it = flatteningCache.begin(); it != flatteningCache.end(); ++it) {
+            if ( (*it)->shapeHash == shapeHash ) {
+                BezierFlatteningConstPtr ret = *it;
+                flatteningCache.erase(it);
+                flatteningCache.push_front(ret);
+
+                return ret;
+            }
+        }
+
+        return BezierFlatteningConstPtr();
+    }
+
+    void insertFlattening(const BezierFlatteningConstPtr& flattening) const
+    {
+        QMutexLocker k(&flatteningCacheMutex);
+
+        flatteningCache.push_front(flattening);
+        while ( (int)flatteningCache.size() > NATRON_BEZIER_FLATTENING_CACHE_SIZE ) {
+            flatteningCache.pop_back();
+        }
+    }
+
     bool hasKeyframeAtTime(bool useGuiCurves,
                            double time) const
     {
@@ -1288,6 +1344,35 @@ struct RotoStrokeItemPrivate
     mutable QMutex strokeDotPatternsMutex;
     std::vector<cairo_pattern_t*> strokeDotPatterns;
 
+    /**
+     * @brief The dabs of the segment of a stroke between 2 keyframes, evaluated at a mipmap level.
+     * A segment is evaluated again only if one of its keyframes changed: when a point is appended to a stroke,
+     * only the tangent of the previous keyframe changes, so all the segments before the last 2 are kept.
+     **/
+    struct EvaluatedStrokeSegment
+    {
+        KeyFrame x1, x2, y1, y2, p1, p2;
+        std::list<std::pair<Point, double> > points;
+
+        // Bounding box of the points in canonical coordinates, not padded by the brush size
+        RectD bbox;
+
+        // Maximum pressure over the segment
+        double pressure;
+    };
+
+    struct EvaluatedStroke
+    {
+        Transform::Matrix3x3 transform;
+        std::vector<EvaluatedStrokeSegment> segments;
+    };
+
+    // The evaluated strokes, indexed by the x curve of the stroke and the mipmap level
+    typedef std::map<std::pair<const Curve*, unsigned int>, EvaluatedStroke> EvaluatedStrokesMap;
+
+    QMutex evaluatedStrokesMutex;
+    EvaluatedStrokesMap evaluatedStrokes;
+
     RotoStrokeItemPrivate(RotoStrokeType type)
         : type(type)
         , finished(false)
@@ -1298,12 +1383,29 @@ struct RotoStrokeItemPrivate
         , wholeStrokeBboxWhilePainting()
         , strokeDotPatternsMutex()
         , strokeDotPatterns()
+        , evaluatedStrokesMutex()
+        , evaluatedStrokes()
     {
         bbox.x1 = std::numeric_limits<double>::infinity();
         bbox.x2 = -std::numeric_limits<double>::infinity();
         bbox.y1 = std::numeric_limits<double>::infinity();
         bbox.y2 = -std::numeric_limits<double>::infinity();
     }
+
+    /**
+     * @brief Same as evaluateStrokeInternal() for a stroke of at least 2 keyframes, but only the segments
+     * that changed since the last evaluation at this mipmap level are evaluated.
+     **/
+    void evaluateStrokeCached(const Curve* xCurve,
+                              const KeyFrameSet& xSet,
+                              const KeyFrameSet& ySet,
+                              const KeyFrameSet& pSet,
+                              const Transform::Matrix3x3& transform,
+                              unsigned int mipMapLevel,
+                              double halfBrushSize,
+                              bool pressureAffectsSize,
+                              std::list<std::pair<Point, double> >* points,
+                              RectD* bbox);
 };
 
 struct RotoContextPrivate
@@ -44,6 +44,7 @@
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/RotoPoint.h"
 #include "Engine/RotoUndoCommand.h"
+#include "Engine/RotoPaintCompositor.h"
 #include "Engine/RotoPaintInteract.h"
 #include "Engine/TimeLine.h"
 #include "Engine/Transform.h"
@@ -1511,42 +1512,71 @@ RotoPaint::render(const RenderActionArgs& args)
                 throw std::logic_error("RotoPaint::render(): getThreadLocalRotoPaintTreeNodes() failed");
             }
         }
-        NodePtr bottomMerge = roto->getRotoPaintBottomMergeNode();
-        RenderingFlagSetter flagIsRendering( bottomMerge );
+
+        // Solid strokes on top of the stack are composited directly instead of rendering their Roto and Merge nodes.
+        // While a stroke is being painted, the tree is used because it only renders the new portion of the stroke.
+        bool canComposite = !getNode()->isDuringPaintStrokeCreation();
+        for (std::list<std::pair<ImagePlaneDesc, ImagePtr> >::const_iterator plane = args.outputPlanes.begin();
+             plane != args.outputPlanes.end(); ++plane) {
+            if ( ( plane->first != ImagePlaneDesc::getRGBAComponents() ) || (plane->second->getBitDepth() != eImageBitDepthFloat) ) {
+                canComposite = false;
+            }
+        }
+        std::list<RotoDrawableItemPtr> compositedItems;
+        NodePtr bottomMerge;
+        if (canComposite) {
+            RotoDrawableItemPtr lastTreeItem = RotoPaintCompositor::splitCompositableItems(items, &compositedItems);
+            if (lastTreeItem) {
+                if ( roto->isRotoPaintTreeConcatenatable() ) {
+                    // The merge nodes of the items are not connected to each other in a concatenated tree
+                    compositedItems.clear();
+                    bottomMerge = roto->getRotoPaintBottomMergeNode();
+                } else {
+                    bottomMerge = lastTreeItem->getMergeNode();
+                }
+            }
+        } else {
+            bottomMerge = roto->getRotoPaintBottomMergeNode();
+        }
+
+        boost::scoped_ptr<RenderingFlagSetter> flagIsRendering;
         std::bitset<4> copyChannels;
         for (int i = 0; i < 4; ++i) {
             copyChannels[i] = _imp->enabledKnobs[i].lock()->getValue();
         }
 
         unsigned int mipMapLevel = Image::getLevelFromScale(args.mappedScale.x);
-        RenderRoIArgs rotoPaintArgs(args.time,
-                                    args.mappedScale,
-                                    mipMapLevel,
-                                    args.view,
-                                    args.byPassCache,
-                                    args.roi,
-                                    RectD(),
-                                    neededComps,
-                                    bgDepth,
-                                    false,
-                                    this,
-                                    eStorageModeRAM /*returnOpenGLtex*/,
-                                    args.time);
         std::map<ImagePlaneDesc, ImagePtr> rotoPaintImages;
-        RenderRoIRetCode code = bottomMerge->getEffectInstance()->renderRoI(rotoPaintArgs, &rotoPaintImages);
-        if (code == eRenderRoIRetCodeFailed) {
-            return eStatusFailed;
-        } else if (code == eRenderRoIRetCodeAborted) {
-            return eStatusOK;
-        } else if ( rotoPaintImages.empty() ) {
-            for (std::list<std::pair<ImagePlaneDesc, ImagePtr> >::const_iterator plane = args.outputPlanes.begin();
-                 plane != args.outputPlanes.end(); ++plane) {
-                plane->second->fillZero(args.roi);
-            }
+        if (bottomMerge) {
+            flagIsRendering.reset( new RenderingFlagSetter(bottomMerge) );
+            RenderRoIArgs rotoPaintArgs(args.time,
+                                        args.mappedScale,
+                                        mipMapLevel,
+                                        args.view,
+                                        args.byPassCache,
+                                        args.roi,
+                                        RectD(),
+                                        neededComps,
+                                        bgDepth,
+                                        false,
+                                        this,
+                                        eStorageModeRAM /*returnOpenGLtex*/,
+                                        args.time);
+            RenderRoIRetCode code = bottomMerge->getEffectInstance()->renderRoI(rotoPaintArgs, &rotoPaintImages);
+            if (code == eRenderRoIRetCodeFailed) {
+                return eStatusFailed;
+            } else if (code == eRenderRoIRetCodeAborted) {
+                return eStatusOK;
+            } else if ( rotoPaintImages.empty() && compositedItems.empty() ) {
+                for (std::list<std::pair<ImagePlaneDesc, ImagePtr> >::const_iterator plane = args.outputPlanes.begin();
+                     plane != args.outputPlanes.end(); ++plane) {
+                    plane->second->fillZero(args.roi);
+                }
 
-            return eStatusOK;
+                return eStatusOK;
+            }
+            assert( rotoPaintImages.empty() || rotoPaintImages.size() == args.outputPlanes.size() );
         }
-        assert( rotoPaintImages.size() == args.outputPlanes.size() );
 
         RectI bgImgRoI;
         ImagePtr bgImg;
@@ -1555,10 +1585,14 @@ RotoPaint::render(const RenderActionArgs& args)
 
         for (std::list<std::pair<ImagePlaneDesc, ImagePtr> >::const_iterator plane = args.outputPlanes.begin();
              plane != args.outputPlanes.end(); ++plane) {
-            std::map<ImagePlaneDesc, ImagePtr>::iterator rotoImagesIt = rotoPaintImages.find(plane->first);
-            assert( rotoImagesIt != rotoPaintImages.end() );
-            if ( rotoImagesIt == rotoPaintImages.end() ) {
-                continue;
+            ImagePtr treeImage;
+            if ( !rotoPaintImages.empty() ) {
+                std::map<ImagePlaneDesc, ImagePtr>::iterator rotoImagesIt = rotoPaintImages.find(plane->first);
+                assert( rotoImagesIt != rotoPaintImages.end() );
+                if ( rotoImagesIt == rotoPaintImages.end() ) {
+                    continue;
+                }
+                treeImage = rotoImagesIt->second;
             }
             if (!bgImg) {
                 if (!triedGetImage) {
@@ -1566,7 +1600,7 @@ RotoPaint::render(const RenderActionArgs& args)
                     triedGetImage = true;
                 }
             }
-            if ( !rotoImagesIt->second->getBounds().contains(args.roi) ) {
+            if ( !treeImage || !treeImage->getBounds().contains(args.roi) ) {
                 // We first fill with the bg image because the bounds of the image produced by the last merge of the rotopaint tree
                 // might not be equal to the bounds of the image produced by the rotopaint. This is because the RoD of the rotopaint is the
                 // union of all the mask strokes bounds, whereas all nodes inside the rotopaint tree don't take the mask RoD into account.
@@ -1617,7 +1651,7 @@ RotoPaint::render(const RenderActionArgs& args)
                         RectI intersection;
                         if (args.roi.intersect(bgImg->getBounds(), &intersection)) {
                             bgImg->convertToFormat( intersection,
-                                                getApp()->getDefaultColorSpaceForBitDepth( rotoImagesIt->second->getBitDepth() ),
+                                                getApp()->getDefaultColorSpaceForBitDepth( bgImg->getBitDepth() ),
                                                 getApp()->getDefaultColorSpaceForBitDepth( plane->second->getBitDepth() ), 3
                                                 , false, false, plane->second.get() );
                         }
@@ -1630,13 +1664,18 @@ RotoPaint::render(const RenderActionArgs& args)
             }
 
 
-            if ( rotoImagesIt->second->getComponents() != plane->second->getComponents() ) {
-                rotoImagesIt->second->convertToFormat( args.roi,
-                                                       getApp()->getDefaultColorSpaceForBitDepth( rotoImagesIt->second->getBitDepth() ),
-                                                       getApp()->getDefaultColorSpaceForBitDepth( plane->second->getBitDepth() ), 3
-                                                       , false, false, plane->second.get() );
-            } else {
-                plane->second->pasteFrom(*(rotoImagesIt->second), args.roi, false);
+            if (treeImage) {
+                if ( treeImage->getComponents() != plane->second->getComponents() ) {
+                    treeImage->convertToFormat( args.roi,
+                                                getApp()->getDefaultColorSpaceForBitDepth( treeImage->getBitDepth() ),
+                                                getApp()->getDefaultColorSpaceForBitDepth( plane->second->getBitDepth() ), 3
+                                                , false, false, plane->second.get() );
+                } else {
+                    plane->second->pasteFrom(*treeImage, args.roi, false);
+                }
+            }
+            if ( !compositedItems.empty() ) {
+                _imp->compositor->composite(compositedItems, args.time, args.view, mipMapLevel, args.roi, plane->second.get());
             }
             plane->second->copyUnProcessedChannels(args.roi, outputPremult, bgImg ? bgImg->getPremultiplication() : eImagePremultiplicationOpaque, copyChannels, bgImg, false);
             if ( premultiply && ( plane->second->getComponents() == ImagePlaneDesc::getRGBAComponents() ) ) {
@@ -1663,6 +1702,7 @@ RotoPaint::clearLastRenderedImage()
             (*it)->clearLastRenderedImage();
         }
     }
+    _imp->compositor->clear();
 }
 
 void
@@ -1749,7 +1789,7 @@ RotoPaint::drawOverlay(double time,
                 std::list<ParametricPoint > points;
                 isBezier->evaluateAtTime_DeCasteljau(true, time, 0,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
-                                                     100,
+                                                     -1,
 #else
                                                      1,
 #endif
@@ -1783,7 +1823,7 @@ RotoPaint::drawOverlay(double time,
                     ///Draw feather only if visible (button is toggled in the user interface)
                     isBezier->evaluateFeatherPointsAtTime_DeCasteljau(true, time, 0,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
-                                                                      100,
+                                                                      -1,
 #else
                                                                       1,
 #endif
@@ -0,0 +1,449 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RotoPaintCompositor.h"
+
+#include <algorithm> // equal
+#include <map>
+#include <vector>
+#include <cassert>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#endif
+
+#include <QtCore/QMutex>
+
+#include "Engine/AppManager.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Hash64.h"
+#include "Engine/Image.h"
+#include "Engine/ImageKey.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/MergingEnum.h"
+#include "Engine/Node.h"
+#include "Engine/RotoContext.h"
+#include "Engine/RotoDrawableItem.h"
+#include "Engine/RotoStrokeItem.h"
+
+NATRON_NAMESPACE_ENTER
+
+// Maximum number of composites remembered for each time, view and mipmap level, i.e: for different RoIs
+#define NATRON_ROTOPAINT_COMPOSITES_PER_FRAME 16
+
+// Maximum number of times, views and mipmap levels for which composites are remembered
+#define NATRON_ROTOPAINT_COMPOSITED_FRAMES 64
+
+// An item composited in an image of the compositor, along with the hash of its merge node which changes
+// whenever a parameter of the item changes
+typedef std::vector<std::pair<const RotoDrawableItem*, U64> > CompositedItems;
+
+/**
+ * @brief An image of the cache holding items composited together over a region
+ **/
+struct Composite
+{
+    CompositedItems items;
+    RectI region;
+
+    // The image is owned by the cache which may evict it
+    ImageWPtr image;
+};
+
+struct CompositeFrameKey
+{
+    double time;
+    int view;
+    unsigned int mipMapLevel;
+
+    bool operator<(const CompositeFrameKey& other) const
+    {
+        if (time != other.time) {
+            return time < other.time;
+        }
+        if (view != other.view) {
+            return view < other.view;
+        }
+
+        return mipMapLevel < other.mipMapLevel;
+    }
+};
+
+// Composites of a frame, most recently used first
+typedef std::list<Composite> FrameComposites;
+
+struct RotoPaintCompositorPrivate
+{
+    const EffectInstance* effect;
+
+    // Protects cacheID
+    mutable QMutex cacheIDLock;
+    mutable std::string cacheID;
+
+    // Protects all fields below
+    QMutex lock;
+
+    std::map<CompositeFrameKey, FrameComposites> composites;
+
+    // The frames in the order they were last used, most recent first
+    std::list<CompositeFrameKey> framesOrder;
+
+    RotoPaintCompositorPrivate(const EffectInstance* effect)
+        : effect(effect)
+        , cacheIDLock()
+        , cacheID()
+        , lock()
+        , composites()
+        , framesOrder()
+    {
+    }
+
+    /**
+     * @brief Returns an image containing the given items composited together over region, reusing a previous image
+     * of the same frame if it covers region and its items are a prefix of the given ones.
+     **/
+    ImagePtr getCompositedItems(const RotoPaintCompositor* holder,
+                                const std::list<RotoDrawableItemPtr>& items,
+                                const CompositedItems& itemsWithHash,
+                                double time,
+                                ViewIdx view,
+                                unsigned int mipMapLevel,
+                                const RectI& region);
+
+    void touchFrame(const CompositeFrameKey& key);
+};
+
+RotoPaintCompositor::RotoPaintCompositor(const EffectInstance* effect)
+    : CacheEntryHolder()
+    , _imp( new RotoPaintCompositorPrivate(effect) )
+{
+}
+
+RotoPaintCompositor::~RotoPaintCompositor()
+{
+    bool hasCacheID;
+    {
+        QMutexLocker k(&_imp->cacheIDLock);
+        hasCacheID = !_imp->cacheID.empty();
+    }
+    if ( hasCacheID && appPTR ) {
+        appPTR->removeAllCacheEntriesForHolder(this, true);
+    }
+}
+
+std::string
+RotoPaintCompositor::getCacheID() const
+{
+    QMutexLocker k(&_imp->cacheIDLock);
+
+    // The node may be gone when the composites are removed from the cache
+    if ( _imp->cacheID.empty() ) {
+        NodePtr node = _imp->effect->getNode();
+        if (node) {
+            _imp->cacheID = node->getCacheID() + ".RotoPaintCompositor";
+        }
+    }
+
+    return _imp->cacheID;
+}
+
+bool
+RotoPaintCompositor::isItemCompositable(const RotoDrawableItemPtr& item)
+{
+    RotoStrokeItem* isStroke = dynamic_cast<RotoStrokeItem*>( item.get() );
+
+    if ( !isStroke || (isStroke->getBrushType() != eRotoStrokeTypeSolid) ) {
+        return false;
+    }
+    if ( (MergingFunctionEnum)item->getCompositingOperator() != eMergeOver ) {
+        return false;
+    }
+#ifdef NATRON_ROTO_INVERTIBLE
+    // An inverted stroke covers the whole RoD of the RotoPaint input, leave it to the tree
+    KnobBoolPtr invertKnob = item->getInvertedKnob();
+    if ( invertKnob && ( invertKnob->getValue() || invertKnob->isAnimated(0) ) ) {
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+RotoDrawableItemPtr
+RotoPaintCompositor::splitCompositableItems(const std::list<RotoDrawableItemPtr>& items,
+                                            std::list<RotoDrawableItemPtr>* compositableItems)
+{
+    for (std::list<RotoDrawableItemPtr>::const_reverse_iterator it = items.rbegin(); it != items.rend(); ++it) {
+        if ( !isItemCompositable(*it) ) {
+            return *it;
+        }
+        compositableItems->push_front(*it);
+    }
+
+    return RotoDrawableItemPtr();
+}
+
+/**
+ * @brief Blends the premultiplied RGBA pixels of src over the ones of dst in the given rectangle
+ * which must be contained in the bounds of both images.
+ **/
+static void
+blendOver(const Image::ReadAccess& srcAcc,
+          Image::WriteAccess& dstAcc,
+          const RectI& rect)
+{
+    for (int y = rect.y1; y < rect.y2; ++y) {
+        const float* srcPix = (const float*)srcAcc.pixelAt(rect.x1, y);
+        float* dstPix = (float*)dstAcc.pixelAt(rect.x1, y);
+        assert(srcPix && dstPix);
+        for (int x = rect.x1; x < rect.x2; ++x, srcPix += 4, dstPix += 4) {
+            const float a = srcPix[3];
+            if (a <= 0.f) {
+                continue;
+            }
+            const float oneMinusA = 1.f - a;
+            dstPix[0] = srcPix[0] + dstPix[0] * oneMinusA;
+            dstPix[1] = srcPix[1] + dstPix[1] * oneMinusA;
+            dstPix[2] = srcPix[2] + dstPix[2] * oneMinusA;
+            dstPix[3] = a + dstPix[3] * oneMinusA;
+        }
+    }
+}
+
+void
+RotoPaintCompositorPrivate::touchFrame(const CompositeFrameKey& key)
+{
+    for (std::list<CompositeFrameKey>::iterator it = framesOrder.begin(); it != framesOrder.end(); ++it) {
+        if ( !(*it < key) && !(key < *it) ) {
+            framesOrder.erase(it);
+            break;
+        }
+    }
+    framesOrder.push_front(key);
+    while ( (int)framesOrder.size() > NATRON_ROTOPAINT_COMPOSITED_FRAMES ) {
+        composites.erase( framesOrder.back() );
+        framesOrder.pop_back();
+    }
+}
+
+ImagePtr
+RotoPaintCompositorPrivate::getCompositedItems(const RotoPaintCompositor* holder,
+                                               const std::list<RotoDrawableItemPtr>& items,
+                                               const CompositedItems& itemsWithHash,
+                                               double time,
+                                               ViewIdx view,
+                                               unsigned int mipMapLevel,
+                                               const RectI& region)
+{
+    QMutexLocker k(&lock);
+    CompositeFrameKey frameKey;
+
+    frameKey.time = time;
+    frameKey.view = view;
+    frameKey.mipMapLevel = mipMapLevel;
+    touchFrame(frameKey);
+    FrameComposites& frameComposites = composites[frameKey];
+
+    // Find the composite covering the region with the most items that can be kept
+    ImagePtr previous;
+    CompositedItems previousItems;
+    RectI compositeRegion = region;
+    for (FrameComposites::iterator it = frameComposites.begin(); it != frameComposites.end();) {
+        ImagePtr image = it->image.lock();
+        if (!image) {
+            // Evicted from the cache
+            it = frameComposites.erase(it);
+            continue;
+        }
+        if ( it->region.contains(region) && ( it->items.size() <= itemsWithHash.size() ) &&
+             std::equal( it->items.begin(), it->items.end(), itemsWithHash.begin() ) &&
+             ( !previous || ( it->items.size() > previousItems.size() ) ) ) {
+            previous = image;
+            previousItems = it->items;
+            compositeRegion = it->region;
+        }
+        ++it;
+    }
+    if ( previous && ( previousItems.size() == itemsWithHash.size() ) ) {
+        return previous;
+    }
+    std::size_t nKept = previous ? previousItems.size() : 0;
+
+    // Render the masks of the items that were not composited yet. This goes through the cache, so masks
+    // of items that did not change are not rendered again.
+    std::vector<ImagePtr> masks;
+    RectI bounds;
+    bool boundsSet = false;
+    if (previous) {
+        bounds = previous->getBounds();
+        boundsSet = true;
+    }
+    {
+        std::size_t i = 0;
+        for (std::list<RotoDrawableItemPtr>::const_iterator it = items.begin(); it != items.end(); ++it, ++i) {
+            if (i < nKept) {
+                continue;
+            }
+            ImagePtr mask = (*it)->renderMaskFromStroke(ImagePlaneDesc::getRGBAComponents(), time, view, eImageBitDepthFloat, mipMapLevel, RectD());
+            RectI maskRegion;
+            if ( !mask || !mask->getBounds().intersect(compositeRegion, &maskRegion) ) {
+                continue;
+            }
+            if (!boundsSet) {
+                bounds = maskRegion;
+                boundsSet = true;
+            } else {
+                bounds.merge(maskRegion);
+            }
+            masks.push_back(mask);
+        }
+    }
+    if (!boundsSet) {
+        return ImagePtr();
+    }
+
+    // The composite is an entry of the cache so that it is accounted for in its size. Its key identifies the items
+    // and the region: the previous composite is never modified in place since other threads may still be reading it.
+    U64 compositeHash;
+    {
+        Hash64 hash;
+        for (CompositedItems::const_iterator it = itemsWithHash.begin(); it != itemsWithHash.end(); ++it) {
+            hash.append( (U64)(std::size_t)it->first );
+            hash.append(it->second);
+        }
+        hash.append(compositeRegion.x1);
+        hash.append(compositeRegion.y1);
+        hash.append(compositeRegion.x2);
+        hash.append(compositeRegion.y2);
+        hash.append(mipMapLevel);
+        hash.computeHash();
+        compositeHash = hash.value();
+    }
+    ImageKey key(holder, compositeHash, /*frameVaryingOrAnimated=*/ true, time, view, /*pixelAspect=*/ 1., /*draftMode=*/ false, /*fullScaleWithDownscaleInputs=*/ false);
+    RectD rod;
+    bounds.toCanonical_noClipping(mipMapLevel, 1., &rod);
+    ImageParamsPtr params = Image::makeParams(rod, bounds, 1., mipMapLevel, false, ImagePlaneDesc::getRGBAComponents(),
+                                              eImageBitDepthFloat, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone);
+    ImagePtr composited;
+    bool cached = appPTR->getImageOrCreate(key, params, &composited);
+    if (!composited) {
+        return ImagePtr();
+    }
+    if ( !cached || !composited->getBounds().contains(bounds) ) {
+        composited->allocateMemory();
+        composited->fillZero(bounds);
+        if (previous) {
+            composited->pasteFrom( *previous, previous->getBounds(), false );
+        }
+
+        // Blend all new masks in a single pass over the rows so that each row of the composite stays in cache
+        // while the strokes crossing it are drawn
+        Image::WriteAccess dstAcc = composited->getWriteRights();
+        std::vector<Image::ReadAccessPtr> masksAcc( masks.size() );
+        for (std::size_t i = 0; i < masks.size(); ++i) {
+            masksAcc[i] = boost::make_shared<Image::ReadAccess>( masks[i].get() );
+        }
+        for (int y = bounds.y1; y < bounds.y2; ++y) {
+            for (std::size_t i = 0; i < masks.size(); ++i) {
+                RectI maskRegion;
+                masks[i]->getBounds().intersect(bounds, &maskRegion);
+                if ( (y < maskRegion.y1) || (y >= maskRegion.y2) ) {
+                    continue;
+                }
+                blendOver( *masksAcc[i], dstAcc, RectI(maskRegion.x1, y, maskRegion.x2, y + 1) );
+            }
+        }
+    }
+
+    Composite composite;
+    composite.items = itemsWithHash;
+    composite.region = compositeRegion;
+    composite.image = composited;
+    frameComposites.push_front(composite);
+    while ( (int)frameComposites.size() > NATRON_ROTOPAINT_COMPOSITES_PER_FRAME ) {
+        frameComposites.pop_back();
+    }
+
+    return composited;
+} // RotoPaintCompositorPrivate::getCompositedItems
+
+void
+RotoPaintCompositor::composite(const std::list<RotoDrawableItemPtr>& items,
+                               double time,
+                               ViewIdx view,
+                               unsigned int mipMapLevel,
+                               const RectI& roi,
+                               Image* dst)
+{
+    assert( dst->getComponents() == ImagePlaneDesc::getRGBAComponents() && dst->getBitDepth() == eImageBitDepthFloat );
+
+    std::list<RotoDrawableItemPtr> activeItems;
+    CompositedItems itemsWithHash;
+    for (std::list<RotoDrawableItemPtr>::const_iterator it = items.begin(); it != items.end(); ++it) {
+        if ( !(*it)->isActivated(time) ) {
+            continue;
+        }
+        NodePtr mergeNode = (*it)->getMergeNode();
+        if (!mergeNode) {
+            continue;
+        }
+        activeItems.push_back(*it);
+        itemsWithHash.push_back( std::make_pair( it->get(), mergeNode->getEffectInstance()->getRenderHash() ) );
+    }
+    if ( activeItems.empty() ) {
+        return;
+    }
+
+    RectI region;
+    if ( !roi.intersect(dst->getBounds(), &region) ) {
+        return;
+    }
+    ImagePtr composited = _imp->getCompositedItems(this, activeItems, itemsWithHash, time, view, mipMapLevel, region);
+    if (!composited) {
+        return;
+    }
+
+    RectI rect;
+    if ( !region.intersect(composited->getBounds(), &rect) ) {
+        return;
+    }
+    Image::ReadAccess srcAcc = composited->getReadRights();
+    Image::WriteAccess dstAcc = dst->getWriteRights();
+    blendOver(srcAcc, dstAcc, rect);
+}
+
+void
+RotoPaintCompositor::clear()
+{
+    {
+        QMutexLocker k(&_imp->lock);
+
+        _imp->composites.clear();
+        _imp->framesOrder.clear();
+    }
+    appPTR->removeAllCacheEntriesForHolder(this, false);
+}
+
+NATRON_NAMESPACE_EXIT
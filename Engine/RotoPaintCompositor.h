@@ -0,0 +1,105 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_ROTOPAINTCOMPOSITOR_H
+#define NATRON_ENGINE_ROTOPAINTCOMPOSITOR_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Engine/CacheEntryHolder.h"
+#include "Engine/RectI.h"
+#include "Engine/ViewIdx.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+struct RotoPaintCompositorPrivate;
+
+/**
+ * @brief Composites solid paint strokes of a RotoPaint node directly, without going through the Roto and Merge nodes
+ * that each stroke owns in the RotoPaint tree.
+ * The mask of each stroke is rendered with the same code as the one used by the Roto node of the stroke, then all masks
+ * are blended with the Over operator in a single pass over the rows of the image.
+ * Since Over is associative, the strokes are first composited together over the RoI on a transparent image which does
+ * not depend on the background. These images are kept in the cache, for each time, view, mipmap level and RoI, so that
+ * when strokes are appended to the stack only the new strokes are drawn.
+ *
+ * This class is MT-safe.
+ **/
+class RotoPaintCompositor
+    : public CacheEntryHolder
+{
+public:
+
+    explicit RotoPaintCompositor(const EffectInstance* effect);
+
+    virtual ~RotoPaintCompositor();
+
+    virtual std::string getCacheID() const OVERRIDE FINAL;
+
+    /**
+     * @brief Returns true if the given item can be rendered by the compositor: this is a solid stroke
+     * merged with the Over operator that is not inverted.
+     **/
+    static bool isItemCompositable(const RotoDrawableItemPtr& item);
+
+    /**
+     * @brief Given all items of a RotoPaint in render order, returns in compositableItems the longest run of
+     * compositable items at the end of the list (i.e: on top of the others).
+     * Returns the last item that must be rendered by the RotoPaint tree, or NULL if all items are compositable.
+     **/
+    static RotoDrawableItemPtr splitCompositableItems(const std::list<RotoDrawableItemPtr>& items,
+                                                      std::list<RotoDrawableItemPtr>* compositableItems);
+
+    /**
+     * @brief Composites the given items (in render order) over the portion roi of the RGBA 32-bit float image dst.
+     * Items that are not activated at the given time are skipped.
+     **/
+    void composite(const std::list<RotoDrawableItemPtr>& items,
+                   double time,
+                   ViewIdx view,
+                   unsigned int mipMapLevel,
+                   const RectI& roi,
+                   Image* dst);
+
+    /**
+     * @brief Removes the composited strokes from the cache
+     **/
+    void clear();
+
+private:
+
+    boost::scoped_ptr<RotoPaintCompositorPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_ROTOPAINTCOMPOSITOR_H
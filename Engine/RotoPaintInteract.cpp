@@ -52,6 +52,7 @@ RotoPaintPrivate::RotoPaintPrivate(RotoPaint* publicInterface,
     , premultKnob()
     , enabledKnobs()
 , ui( RotoPaintInteract::create(this) )
+    , compositor( new RotoPaintCompositor(publicInterface) )
 {
 }
 
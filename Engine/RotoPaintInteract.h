@@ -34,6 +34,7 @@
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/scoped_ptr.hpp>
 #endif
 
 #include <ofxNatron.h>
@@ -41,6 +42,7 @@
 #include "Engine/EngineFwd.h"
 #include "Engine/BezierCP.h"
 #include "Engine/Bezier.h"
+#include "Engine/RotoPaintCompositor.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -400,6 +402,9 @@ struct RotoPaintPrivate
     KnobBoolWPtr enabledKnobs[4];
     RotoPaintInteractPtr ui;
 
+    // Renders the solid strokes on top of the stack without going through the RotoPaint tree
+    boost::scoped_ptr<RotoPaintCompositor> compositor;
+
     RotoPaintPrivate(RotoPaint* publicInterface,
                      bool isPaintByDefault);
 };
@@ -124,6 +124,83 @@ RotoStrokeItem::getBrushType() const
     return _imp->type;
 }
 
+/**
+ * @brief Evaluates the dabs of the segment of a stroke between 2 keyframes and returns the maximum pressure over the segment.
+ * The points are in pixel coordinates at the given mipmap level, whereas bbox is updated in canonical coordinates.
+ **/
+static double
+evaluateStrokeSegment(const KeyFrame& xKey,
+                      const KeyFrame& xNext,
+                      const KeyFrame& yKey,
+                      const KeyFrame& yNext,
+                      const KeyFrame& pKey,
+                      const KeyFrame& pNext,
+                      const Transform::Matrix3x3& transform,
+                      unsigned int mipMapLevel,
+                      std::list<std::pair<Point, double> >* points,
+                      RectD* bbox)
+{
+    int pot = 1 << mipMapLevel;
+    double x1 = xKey.getValue();
+    double y1 = yKey.getValue();
+    double z1 = 1.;
+    double press1 = pKey.getValue();
+    double x2 = xNext.getValue();
+    double y2 = yNext.getValue();
+    double z2 = 1;
+    double press2 = pNext.getValue();
+    double dt = ( xNext.getTime() - xKey.getTime() );
+    double x1pr = x1 + dt * xKey.getRightDerivative() / 3.;
+    double y1pr = y1 + dt * yKey.getRightDerivative() / 3.;
+    double z1pr = 1.;
+    double press1pr = press1 + dt * pKey.getRightDerivative() / 3.;
+    double x2pl = x2 - dt * xNext.getLeftDerivative() / 3.;
+    double y2pl = y2 - dt * yNext.getLeftDerivative() / 3.;
+    double z2pl = 1;
+    double press2pl = press2 - dt * pNext.getLeftDerivative() / 3.;
+    Transform::matApply(transform, &x1, &y1, &z1);
+    Transform::matApply(transform, &x1pr, &y1pr, &z1pr);
+    Transform::matApply(transform, &x2pl, &y2pl, &z2pl);
+    Transform::matApply(transform, &x2, &y2, &z2);
+
+    /*
+     * Approximate the necessary number of line segments, using http://antigrain.com/research/adaptive_bezier/
+     */
+    double dx1, dy1, dx2, dy2, dx3, dy3;
+    dx1 = x1pr - x1;
+    dy1 = y1pr - y1;
+    dx2 = x2pl - x1pr;
+    dy2 = y2pl - y1pr;
+    dx3 = x2 - x2pl;
+    dy3 = y2 - y2pl;
+    double length = std::sqrt(dx1 * dx1 + dy1 * dy1) +
+                    std::sqrt(dx2 * dx2 + dy2 * dy2) +
+                    std::sqrt(dx3 * dx3 + dy3 * dy3);
+    double nbPointsPerSegment = (int)std::max(length * 0.25, 2.);
+    double incr = 1. / (double)(nbPointsPerSegment - 1);
+
+    for (int i = 0; i < nbPointsPerSegment; ++i) {
+        double t = incr * i;
+        Point p;
+        p.x = Bezier::bezierEval(x1, x1pr, x2pl, x2, t);
+        p.y = Bezier::bezierEval(y1, y1pr, y2pl, y2, t);
+
+        if (bbox) {
+            bbox->x1 = std::min(p.x, bbox->x1);
+            bbox->x2 = std::max(p.x, bbox->x2);
+            bbox->y1 = std::min(p.y, bbox->y1);
+            bbox->y2 = std::max(p.y, bbox->y2);
+        }
+
+        double pi = Bezier::bezierEval(press1, press1pr, press2pl, press2, t);
+        p.x /= pot;
+        p.y /= pot;
+        points->push_back( std::make_pair(p, pi) );
+    }
+
+    return std::max(press1, press2);
+} // evaluateStrokeSegment
+
 static void
 evaluateStrokeInternal(const KeyFrameSet& xCurve,
                        const KeyFrameSet& yCurve,
@@ -200,65 +277,8 @@ evaluateStrokeInternal(const KeyFrameSet& xCurve,
          ++xIt, ++yIt, ++pIt, ++xNext, ++yNext, ++pNext) {
         assert( xIt != xCurve.end() && yIt != yCurve.end() && pIt != pCurve.end() );
 
-        double x1 = xIt->getValue();
-        double y1 = yIt->getValue();
-        double z1 = 1.;
-        double press1 = pIt->getValue();
-        double x2 = xNext->getValue();
-        double y2 = yNext->getValue();
-        double z2 = 1;
-        double press2 = pNext->getValue();
-        double dt = ( xNext->getTime() - xIt->getTime() );
-        double x1pr = x1 + dt * xIt->getRightDerivative() / 3.;
-        double y1pr = y1 + dt * yIt->getRightDerivative() / 3.;
-        double z1pr = 1.;
-        double press1pr = press1 + dt * pIt->getRightDerivative() / 3.;
-        double x2pl = x2 - dt * xNext->getLeftDerivative() / 3.;
-        double y2pl = y2 - dt * yNext->getLeftDerivative() / 3.;
-        double z2pl = 1;
-        double press2pl = press2 - dt * pNext->getLeftDerivative() / 3.;
-        Transform::matApply(transform, &x1, &y1, &z1);
-        Transform::matApply(transform, &x1pr, &y1pr, &z1pr);
-        Transform::matApply(transform, &x2pl, &y2pl, &z2pl);
-        Transform::matApply(transform, &x2, &y2, &z2);
-
-        /*
-         * Approximate the necessary number of line segments, using http://antigrain.com/research/adaptive_bezier/
-         */
-        double dx1, dy1, dx2, dy2, dx3, dy3;
-        dx1 = x1pr - x1;
-        dy1 = y1pr - y1;
-        dx2 = x2pl - x1pr;
-        dy2 = y2pl - y1pr;
-        dx3 = x2 - x2pl;
-        dy3 = y2 - y2pl;
-        double length = std::sqrt(dx1 * dx1 + dy1 * dy1) +
-                        std::sqrt(dx2 * dx2 + dy2 * dy2) +
-                        std::sqrt(dx3 * dx3 + dy3 * dy3);
-        double nbPointsPerSegment = (int)std::max(length * 0.25, 2.);
-        double incr = 1. / (double)(nbPointsPerSegment - 1);
-
-        pressure = std::max(pressure, pressureAffectsSize ? std::max(press1, press2) : 1.);
-
-
-        for (int i = 0; i < nbPointsPerSegment; ++i) {
-            double t = incr * i;
-            Point p;
-            p.x = Bezier::bezierEval(x1, x1pr, x2pl, x2, t);
-            p.y = Bezier::bezierEval(y1, y1pr, y2pl, y2, t);
-
-            if (bbox) {
-                bbox->x1 = std::min(p.x, bbox->x1);
-                bbox->x2 = std::max(p.x, bbox->x2);
-                bbox->y1 = std::min(p.y, bbox->y1);
-                bbox->y2 = std::max(p.y, bbox->y2);
-            }
-
-            double pi = Bezier::bezierEval(press1, press1pr, press2pl, press2, t);
-            p.x /= pot;
-            p.y /= pot;
-            points->push_back( std::make_pair(p, pi) );
-        }
+        double segmentPressure = evaluateStrokeSegment(*xIt, *xNext, *yIt, *yNext, *pIt, *pNext, transform, mipMapLevel, points, bbox);
+        pressure = std::max(pressure, pressureAffectsSize ? segmentPressure : 1.);
     } // for (; xNext != xCurve.end() ;++xNext, ++yNext, ++pNext) {
     if (bbox) {
         double padding = std::max(0.5, halfBrushSize) * pressure;
@@ -435,19 +455,23 @@ RotoStrokeItem::appendPoint(bool newStroke,
         }
 #endif
 
+        // Use CatmullRom interpolation, which means that the tangent may be modified by the next point on the curve.
+        // In a previous version, the previous keyframe was set to Free so its tangents don't get overwritten, but this caused oscillations.
+        // The interpolation is set before inserting the keyframe: setting it afterwards looks the keyframe up by index,
+        // which made the cost of each sample grow with the length of the stroke.
         bool addKeyFrameOk; // did we add a new keyframe (normally yes, but just in case)
-        int ki; // index of the new keyframe (normally nk, but just in case)
         {
             KeyFrame k;
             k.setTime(t);
             k.setValue(p.pos().x);
+            k.setInterpolation(eKeyframeTypeCatmullRom);
             addKeyFrameOk = stroke->xCurve->addKeyFrame(k);
-            ki = ( addKeyFrameOk ? nk : (nk - 1) );
         }
         {
             KeyFrame k;
             k.setTime(t);
             k.setValue(p.pos().y);
+            k.setInterpolation(eKeyframeTypeCatmullRom);
             bool aok = stroke->yCurve->addKeyFrame(k);
             assert(aok == addKeyFrameOk);
             if (aok != addKeyFrameOk) {
@@ -459,17 +483,13 @@ RotoStrokeItem::appendPoint(bool newStroke,
             KeyFrame k;
             k.setTime(t);
             k.setValue( p.pressure() );
+            k.setInterpolation(eKeyframeTypeCatmullRom);
             bool aok = stroke->pressureCurve->addKeyFrame(k);
             assert(aok == addKeyFrameOk);
             if (aok != addKeyFrameOk) {
                 throw std::logic_error("RotoStrokeItem::appendPoint");
             }
         }
-        // Use CatmullRom interpolation, which means that the tangent may be modified by the next point on the curve.
-        // In a previous version, the previous keyframe was set to Free so its tangents don't get overwritten, but this caused oscillations.
-        stroke->xCurve->setKeyFrameInterpolation(eKeyframeTypeCatmullRom, ki);
-        stroke->yCurve->setKeyFrameInterpolation(eKeyframeTypeCatmullRom, ki);
-        stroke->pressureCurve->setKeyFrameInterpolation(eKeyframeTypeCatmullRom, ki);
     } // QMutexLocker k(&itemMutex);
 
 
@@ -920,7 +940,11 @@ RotoStrokeItem::evaluateStroke(unsigned int mipMapLevel,
         std::list<std::pair<Point, double> > points;
         RectD strokeBbox;
 
-        evaluateStrokeInternal(xSet, ySet, pSet, transform, mipMapLevel, brushSize, pressureAffectsSize, &points, &strokeBbox);
+        if (xSet.size() < 2) {
+            evaluateStrokeInternal(xSet, ySet, pSet, transform, mipMapLevel, brushSize, pressureAffectsSize, &points, &strokeBbox);
+        } else {
+            _imp->evaluateStrokeCached(it->xCurve.get(), xSet, ySet, pSet, transform, mipMapLevel, brushSize, pressureAffectsSize, &points, &strokeBbox);
+        }
         if (bbox) {
             if (bboxSet) {
                 bbox->merge(strokeBbox);
@@ -931,7 +955,103 @@ RotoStrokeItem::evaluateStroke(unsigned int mipMapLevel,
         }
         strokes->push_back(points);
     }
+
+    // Forget the strokes that were removed
+    QMutexLocker k(&itemMutex);
+    QMutexLocker k2(&_imp->evaluatedStrokesMutex);
+    for (RotoStrokeItemPrivate::EvaluatedStrokesMap::iterator it = _imp->evaluatedStrokes.begin(); it != _imp->evaluatedStrokes.end();) {
+        bool found = false;
+        for (std::vector<RotoStrokeItemPrivate::StrokeCurves>::const_iterator it2 = _imp->strokes.begin(); it2 != _imp->strokes.end(); ++it2) {
+            if (it2->xCurve.get() == it->first.first) {
+                found = true;
+                break;
+            }
+        }
+        if (found) {
+            ++it;
+        } else {
+            _imp->evaluatedStrokes.erase(it++);
+        }
+    }
+} // RotoStrokeItem::evaluateStroke
+
+static bool
+isSameTransform(const Transform::Matrix3x3& m1,
+                const Transform::Matrix3x3& m2)
+{
+    return m1.a == m2.a && m1.b == m2.b && m1.c == m2.c &&
+           m1.d == m2.d && m1.e == m2.e && m1.f == m2.f &&
+           m1.g == m2.g && m1.h == m2.h && m1.i == m2.i;
 }
 
+void
+RotoStrokeItemPrivate::evaluateStrokeCached(const Curve* xCurve,
+                                            const KeyFrameSet& xSet,
+                                            const KeyFrameSet& ySet,
+                                            const KeyFrameSet& pSet,
+                                            const Transform::Matrix3x3& transform,
+                                            unsigned int mipMapLevel,
+                                            double halfBrushSize,
+                                            bool pressureAffectsSize,
+                                            std::list<std::pair<Point, double> >* points,
+                                            RectD* bbox)
+{
+    assert( xSet.size() >= 2 && xSet.size() == ySet.size() && xSet.size() == pSet.size() );
+
+    //Increment the half brush size so that the stroke is enclosed in the RoD
+    halfBrushSize += 1.;
+    bbox->setupInfinity();
+
+    QMutexLocker k(&evaluatedStrokesMutex);
+    EvaluatedStroke& stroke = evaluatedStrokes[std::make_pair(xCurve, mipMapLevel)];
+    if ( !isSameTransform(stroke.transform, transform) ) {
+        stroke.transform = transform;
+        stroke.segments.clear();
+    }
+    stroke.segments.resize(xSet.size() - 1);
+
+    KeyFrameSet::const_iterator xIt = xSet.begin();
+    KeyFrameSet::const_iterator yIt = ySet.begin();
+    KeyFrameSet::const_iterator pIt = pSet.begin();
+    KeyFrameSet::const_iterator xNext = xIt;
+    KeyFrameSet::const_iterator yNext = yIt;
+    KeyFrameSet::const_iterator pNext = pIt;
+    ++xNext;
+    ++yNext;
+    ++pNext;
+
+    double pressure = 0;
+    for (std::size_t i = 0; xNext != xSet.end(); ++i, ++xIt, ++yIt, ++pIt, ++xNext, ++yNext, ++pNext) {
+        EvaluatedStrokeSegment& segment = stroke.segments[i];
+        if ( segment.points.empty() ||
+             (segment.x1 != *xIt) || (segment.x2 != *xNext) ||
+             (segment.y1 != *yIt) || (segment.y2 != *yNext) ||
+             (segment.p1 != *pIt) || (segment.p2 != *pNext) ) {
+            segment.x1 = *xIt;
+            segment.x2 = *xNext;
+            segment.y1 = *yIt;
+            segment.y2 = *yNext;
+            segment.p1 = *pIt;
+            segment.p2 = *pNext;
+            segment.points.clear();
+            segment.bbox.setupInfinity();
+            segment.pressure = evaluateStrokeSegment(*xIt, *xNext, *yIt, *yNext, *pIt, *pNext, transform, mipMapLevel, &segment.points, &segment.bbox);
+        }
+
+        points->insert( points->end(), segment.points.begin(), segment.points.end() );
+        bbox->x1 = std::min(segment.bbox.x1, bbox->x1);
+        bbox->x2 = std::max(segment.bbox.x2, bbox->x2);
+        bbox->y1 = std::min(segment.bbox.y1, bbox->y1);
+        bbox->y2 = std::max(segment.bbox.y2, bbox->y2);
+        pressure = std::max(pressure, pressureAffectsSize ? segment.pressure : 1.);
+    }
+
+    double padding = std::max(0.5, halfBrushSize) * pressure;
+    bbox->x1 -= padding;
+    bbox->x2 += padding;
+    bbox->y1 -= padding;
+    bbox->y2 += padding;
+} // RotoStrokeItemPrivate::evaluateStrokeCached
+
 NATRON_NAMESPACE_EXIT
 
@@ -47,8 +47,11 @@
 #include "Engine/KnobFile.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/LibraryBinary.h"
+#include "Engine/MemoryGovernor.h"
+#include "Engine/MemoryFile.h"
 #include "Engine/MemoryInfo.h" // getSystemTotalRAM, isApplication32Bits, printAsRAM
 #include "Engine/Node.h"
+#include "Engine/NumaTopology.h"
 #include "Engine/OSGLContext.h"
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/Plugin.h"
@@ -327,6 +330,16 @@ Settings::initializeKnobsThreading()
     _nThreadsPerEffect->disableSlider();
     _threadingPage->addKnob(_nThreadsPerEffect);
 
+    _numaAwareRendering = AppManager::createKnob<KnobBool>( this, tr("NUMA-aware rendering") );
+    _numaAwareRendering->setName("numaAwareRendering");
+    _numaAwareRendering->setHintToolTip( tr("On machines with several processor sockets (NUMA nodes), each socket accesses its own memory "
+                                            "much faster than the memory of the other sockets. When checked, render threads are pinned to the sockets "
+                                            "in turn, images are allocated in the memory of the socket of the thread that renders them and "
+                                            "each socket renders in priority its own part of the images. "
+                                            "This has no effect on machines with a single NUMA node. "
+                                            "Number of NUMA nodes detected on this machine: %1.").arg( NumaTopology::getNumNodes() ) );
+    _threadingPage->addKnob(_numaAwareRendering);
+
     _renderInSeparateProcess = AppManager::createKnob<KnobBool>( this, tr("Render in a separate process") );
     _renderInSeparateProcess->setName("renderNewProcess");
     _renderInSeparateProcess->setHintToolTip( tr("If true, %1 will render frames to disk in "
@@ -338,6 +351,32 @@ Settings::initializeKnobsThreading()
                                       "other prior tasks are done.") );
     _queueRenders->setName("queueRenders");
     _threadingPage->addKnob(_queueRenders);
+
+    _combinedWritersRender = AppManager::createKnob<KnobBool>( this, tr("Render writers together") );
+    _combinedWritersRender->setName("combinedWritersRender");
+    _combinedWritersRender->setHintToolTip( tr("When checked and several Write nodes are rendered at once, they render the same frames "
+                                               "at the same time and the part of the graph they have in common is computed only once per frame "
+                                               "instead of once per Write node. The Write nodes are then started together, even if "
+                                               "\"Append new renders to queue\" is checked. "
+                                               "This has no effect when rendering in a separate process.") );
+    _threadingPage->addKnob(_combinedWritersRender);
+
+    _sequenceReadAhead = AppManager::createKnob<KnobInt>( this, tr("Image sequence read-ahead (frames)") );
+    _sequenceReadAhead->setName("sequenceReadAhead");
+    _sequenceReadAhead->setHintToolTip( tr("When playing or rendering, the files of the image sequences read by Read nodes "
+                                           "are fetched from the disk this many frames ahead of the renderer, in the playback direction, "
+                                           "so that decoders find them in memory. This is especially useful when reading from a network share. "
+                                           "0 disables read-ahead.") );
+    _sequenceReadAhead->setMinimum(0);
+    _sequenceReadAhead->disableSlider();
+    _threadingPage->addKnob(_sequenceReadAhead);
+
+    _sequenceReadAheadFullRead = AppManager::createKnob<KnobBool>( this, tr("Read-ahead reads files fully") );
+    _sequenceReadAheadFullRead->setName("sequenceReadAheadFullRead");
+    _sequenceReadAheadFullRead->setHintToolTip( tr("When checked, files are read entirely ahead of the renderer instead of only "
+                                                   "hinting the operating system. Use this if the file system ignores read-ahead hints, "
+                                                   "which is the case of some network file systems.") );
+    _threadingPage->addKnob(_sequenceReadAheadFullRead);
 } // Settings::initializeKnobsThreading
 
 void
@@ -379,6 +418,14 @@ Settings::initializeKnobsRendering()
                                                                "transformations.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
     _activateTransformConcatenationSupport->setName("transformCatSupport");
     _renderingPage->addKnob(_activateTransformConcatenationSupport);
+
+    _renderParametersSnapshot = AppManager::createKnob<KnobBool>( this, tr("Snapshot parameters for each frame render") );
+    _renderParametersSnapshot->setHintToolTip( tr("When checked, the values of the parameters of all the nodes of the tree are copied "
+                                                  "when the render of a frame starts, and render threads read them from this copy "
+                                                  "without locking the parameters. This reduces contention when rendering with many threads, "
+                                                  "at the cost of capturing all values of the tree for each frame.") );
+    _renderParametersSnapshot->setName("renderParamsSnapshot");
+    _renderingPage->addKnob(_renderParametersSnapshot);
 }
 
 void
@@ -1274,6 +1321,21 @@ Settings::initializeKnobsCaching()
     _maxDiskCacheNodeGB->setHintToolTip( tr("The maximum size that may be used by the DiskCache node on disk (in GiB)") );
     _cachingTab->addKnob(_maxDiskCacheNodeGB);
 
+    _diskCacheReadMode = AppManager::createKnob<KnobChoice>( this, tr("Disk cache read mode") );
+    _diskCacheReadMode->setName("diskCacheReadMode");
+    {
+        std::vector<ChoiceOption> entries;
+        entries.push_back( ChoiceOption("Default", "", tr("Let the system read the cached images from disk as they are accessed.").toStdString() ) );
+        entries.push_back( ChoiceOption("Read-ahead", "", tr("Read each cached image from disk at once when it is accessed, and during playback start "
+                                                             "reading the frames ahead of the current one in the background.").toStdString() ) );
+        entries.push_back( ChoiceOption("Read-ahead with huge pages", "", tr("Same as Read-ahead, and ask the system to map the cache files with "
+                                                                             "huge pages where it supports it.").toStdString() ) );
+        _diskCacheReadMode->populateChoices(entries);
+    }
+    _diskCacheReadMode->setHintToolTip( tr("Controls how the images of the playback cache and the DiskCache node are read back from disk. "
+                                           "Reading ahead is what allows a disk cache on a fast drive to play back in real time.") );
+    _cachingTab->addKnob(_diskCacheReadMode);
+
 
     _diskCachePath = AppManager::createKnob<KnobPath>( this, tr("Disk cache path") );
     _diskCachePath->setName("diskCachePath");
@@ -1426,7 +1488,7 @@ void
 Settings::setCachingLabels()
 {
     int maxTotalRam = _maxRAMPercent->getValue();
-    U64 systemTotalRam = getSystemTotalRAM();
+    U64 systemTotalRam = MemoryGovernor::getTotalRAM();
     U64 maxRAM = (U64)( ( (double)maxTotalRam / 100. ) * systemTotalRam );
 
     _maxRAMLabel->setValue( printAsRAM(maxRAM).toStdString() );
@@ -1457,14 +1519,19 @@ Settings::setDefaultValues()
 #endif
     _useThreadPool->setDefaultValue(true);
     _nThreadsPerEffect->setDefaultValue(0);
+    _numaAwareRendering->setDefaultValue(false);
     _renderInSeparateProcess->setDefaultValue(false, 0);
     _queueRenders->setDefaultValue(false);
+    _combinedWritersRender->setDefaultValue(true);
+    _sequenceReadAhead->setDefaultValue(8);
+    _sequenceReadAheadFullRead->setDefaultValue(false);
 
     // General/Rendering
     _convertNaNValues->setDefaultValue(true);
     _pluginUseImageCopyForSource->setDefaultValue(false);
     _activateRGBSupport->setDefaultValue(true);
     _activateTransformConcatenationSupport->setDefaultValue(true);
+    _renderParametersSnapshot->setDefaultValue(false);
 
     // General/GPU rendering
     //_openglRendererString
@@ -1514,6 +1581,7 @@ Settings::setDefaultValues()
     _unreachableRAMPercent->setDefaultValue(5);
     _maxViewerDiskCacheGB->setDefaultValue(5, 0);
     _maxDiskCacheNodeGB->setDefaultValue(10, 0);
+    _diskCacheReadMode->setDefaultValue(0);
     //_diskCachePath
     setCachingLabels();
 
@@ -2134,6 +2202,7 @@ Settings::restoreSettings(bool useDefault)
         appPTR->setNThreadsPerEffect( getNumberOfThreadsPerEffect() );
         appPTR->setNThreadsToRender( getNumberOfThreads() );
         appPTR->setUseThreadPool( _useThreadPool->getValue() );
+        NumaTopology::setEnabled( _numaAwareRendering->getValue() );
         appPTR->setPluginsUseInputImageCopyToRender( _pluginUseImageCopyForSource->getValue() );
     } catch (std::logic_error&) {
         // ignore
@@ -2261,6 +2330,10 @@ Settings::onKnobValueChanged(KnobI* k,
         if (!_restoringSettings) {
             appPTR->setApplicationsCachesMaximumDiskSpace( getMaximumDiskCacheNodeSize() );
         }
+    } else if ( k == _diskCacheReadMode.get() ) {
+        if (!_restoringSettings) {
+            appPTR->setApplicationsCachesFileMappingFlags( getDiskCacheFileMappingFlags() );
+        }
     } else if ( k == _maxRAMPercent.get() ) {
         if (!_restoringSettings) {
             appPTR->setApplicationsCachesMaximumMemoryPercent( getRamMaximumPercent() );
@@ -2285,6 +2358,8 @@ Settings::onKnobValueChanged(KnobI* k,
         }
     } else if ( k == _nThreadsPerEffect.get() ) {
         appPTR->setNThreadsPerEffect( getNumberOfThreadsPerEffect() );
+    } else if ( k == _numaAwareRendering.get() ) {
+        NumaTopology::setEnabled( _numaAwareRendering->getValue() );
     } else if ( k == _ocioConfigKnob.get() ) {
         if (_ocioConfigKnob->getActiveEntry().id == NATRON_CUSTOM_OCIO_CONFIG_NAME) {
             _customOcioConfigFile->setAllDimensionsEnabled(true);
@@ -2508,6 +2583,22 @@ Settings::getMaximumDiskCacheNodeSize() const
     return (U64)( _maxDiskCacheNodeGB->getValue() ) * 1024 * 1024 * 1024;
 }
 
+int
+Settings::getDiskCacheFileMappingFlags() const
+{
+    int mode = _diskCacheReadMode->getValue();
+
+    if (mode == 0) {
+        return MemoryFile::eMappingFlagsNone;
+    }
+    int flags = MemoryFile::eMappingFlagsPopulate | MemoryFile::eMappingFlagsSequential;
+    if (mode == 2) {
+        flags |= MemoryFile::eMappingFlagsHugePages;
+    }
+
+    return flags;
+}
+
 ///////////////////////////////////////////////////
 
 double
@@ -3186,6 +3277,12 @@ Settings::isTransformConcatenationEnabled() const
     return _activateTransformConcatenationSupport->getValue();
 }
 
+bool
+Settings::isRenderParametersSnapshotEnabled() const
+{
+    return _renderParametersSnapshot->getValue();
+}
+
 bool
 Settings::useGlobalThreadPool() const
 {
@@ -3805,6 +3902,30 @@ Settings::isRenderQueuingEnabled() const
     return _queueRenders->getValue();
 }
 
+bool
+Settings::isCombinedWritersRenderEnabled() const
+{
+    return _combinedWritersRender->getValue();
+}
+
+int
+Settings::getSequenceReadAheadFrames() const
+{
+    return _sequenceReadAhead->getValue();
+}
+
+bool
+Settings::isSequenceReadAheadFullReadEnabled() const
+{
+    return _sequenceReadAheadFullRead->getValue();
+}
+
+bool
+Settings::isNumaAwareRenderingEnabled() const
+{
+    return _numaAwareRendering->getValue();
+}
+
 bool
 Settings::isFileDialogEnabledForNewWriters() const
 {
@@ -111,6 +111,11 @@ public:
 
     U64 getMaximumDiskCacheNodeSize() const;
 
+    /**
+     * @brief Returns the hints used to map the disk cache files, a combination of MemoryFile::MappingFlagsEnum
+     **/
+    int getDiskCacheFileMappingFlags() const;
+
     double getUnreachableRamPercent() const;
 
     bool getColorPickerLinear() const;
@@ -171,6 +176,14 @@ public:
 
     void setRenderQueuingEnabled(bool enabled);
 
+    bool isCombinedWritersRenderEnabled() const;
+
+    int getSequenceReadAheadFrames() const;
+
+    bool isSequenceReadAheadFullReadEnabled() const;
+
+    bool isNumaAwareRenderingEnabled() const;
+
     void restoreDefault();
 
     int getMaximumUndoRedoNodeGraph() const;
@@ -259,6 +272,8 @@ public:
 
     bool isTransformConcatenationEnabled() const;
 
+    bool isRenderParametersSnapshotEnabled() const;
+
     bool useInputAForMergeAutoConnect() const;
 
     /**
@@ -439,8 +454,12 @@ private:
     KnobIntPtr _numberOfParallelRenders;
     KnobBoolPtr _useThreadPool;
     KnobIntPtr _nThreadsPerEffect;
+    KnobBoolPtr _numaAwareRendering;
     KnobBoolPtr _renderInSeparateProcess;
     KnobBoolPtr _queueRenders;
+    KnobBoolPtr _combinedWritersRender;
+    KnobIntPtr _sequenceReadAhead;
+    KnobBoolPtr _sequenceReadAheadFullRead;
 
     // General/Rendering
     KnobPagePtr _renderingPage;
@@ -448,6 +467,7 @@ private:
     KnobBoolPtr _pluginUseImageCopyForSource;
     KnobBoolPtr _activateRGBSupport;
     KnobBoolPtr _activateTransformConcatenationSupport;
+    KnobBoolPtr _renderParametersSnapshot;
 
     // General/GPU rendering
     KnobPagePtr _gpuPage;
@@ -519,6 +539,7 @@ private:
     ///The total disk space allowed for all Natron's caches
     KnobIntPtr _maxViewerDiskCacheGB;
     KnobIntPtr _maxDiskCacheNodeGB;
+    KnobChoicePtr _diskCacheReadMode;
     KnobPathPtr _diskCachePath;
     KnobButtonPtr _wipeDiskCache;
 
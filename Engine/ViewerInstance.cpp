@@ -80,6 +80,7 @@ CLANG_DIAG_ON(deprecated)
 #endif
 
 #define NATRON_TIME_ELASPED_BEFORE_PROGRESS_REPORT 4. //!< do not display the progress report if estimated total time is less than this (in seconds)
+#define NATRON_VIEWER_CACHE_PREFETCH_FRAMES 4 //!< during playback, the tiles of the frame this far ahead are read from the disk cache in the background
 
 NATRON_NAMESPACE_ENTER
 
@@ -1077,8 +1078,34 @@ ViewerInstance::getViewerRoIAndTexture(const RectD& rod,
     // Texture rect contains the pixel coordinates in the image to be rendered
 
     if (useCache) {
+        // During playback, start reading the tiles of an upcoming frame from the disk cache. The frames in between
+        // were already requested by the previous frames of the playback.
+        SequenceTime prefetchTime = outArgs->params->time;
+        if (outArgs->params->isSequential) {
+            prefetchTime += getRenderEngine()->getPlaybackDirection() == eRenderDirectionForward ? NATRON_VIEWER_CACHE_PREFETCH_FRAMES : -NATRON_VIEWER_CACHE_PREFETCH_FRAMES;
+        }
+
         FrameEntryLocker entryLocker(_imp.get());
         for (std::list<UpdateViewerParams::CachedTile>::iterator it = outArgs->params->tiles.begin(); it != outArgs->params->tiles.end(); ++it) {
+            if (prefetchTime != outArgs->params->time) {
+                FrameKey prefetchKey(getNode().get(),
+                                     prefetchTime,
+                                     viewerHash,
+                                     outArgs->params->gain,
+                                     outArgs->params->gamma,
+                                     outArgs->params->lut,
+                                     (int)outArgs->params->depth,
+                                     outArgs->channels,
+                                     outArgs->params->view,
+                                     it->rect,
+                                     mipmapLevel,
+                                     inputToRenderName,
+                                     outArgs->params->layer,
+                                     outArgs->params->alphaLayer.getPlaneID() + outArgs->params->alphaChannelName,
+                                     outArgs->params->depth == eImageBitDepthFloat,
+                                     isDraftMode);
+                appPTR->prefetchTexture(prefetchKey);
+            }
             FrameKey key(getNode().get(),
                          outArgs->params->time,
                          viewerHash,
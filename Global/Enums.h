@@ -534,6 +534,14 @@ enum RenderSafetyEnum
     eRenderSafetyFullySafeFrame = 3,
 };
 
+// Priority of the entries of a node in the cache, see Cache::setHolderPolicy()
+enum CachePriorityEnum
+{
+    eCachePriorityNormal = 0, // evicted first if cheap to recompute relative to their size
+    eCachePriorityHigh, // evicted after the entries of normal priority among the least recently used ones
+    eCachePriorityPinned, // never evicted, except to respect the budget of the node or when pinned entries fill too much of the cache
+};
+
 enum PenType
 {
     ePenTypeLMB,
@@ -35,6 +35,7 @@
 #include <QtCore/QDebug>
 
 #include "Engine/Bezier.h"
+#include "Engine/Hash64.h"
 #include "Engine/Knob.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/RotoContext.h" // Bezier
@@ -59,6 +60,13 @@ CurveGui::CurveGui(CurveWidget *curveWidget,
     , _thickness(thickness)
     , _visible(false)
     , _selected(false)
+    , _polylineValid(false)
+    , _polylineHash(0)
+    , _polylinePixelWidth(0)
+    , _polylinePixelHeight(0)
+    , _polylineXMin(0)
+    , _polylineXMax(0)
+    , _polylineVertices()
 {
     // always running in the main thread
     assert( qApp && qApp->thread() == QThread::currentThread() );
@@ -76,6 +84,7 @@ CurveGui::nextPointForSegment(const double x, // < in curve coordinates
                               const bool isPeriodic,
                               const double parametricXMin,
                               const double parametricXMax,
+                              const double xEndWidgetCoords,
                               KeyFrameSet::const_iterator* lastUpperIt,
                               double* x2WidgetCoords,
                               KeyFrame* x1Key,
@@ -95,7 +104,7 @@ CurveGui::nextPointForSegment(const double x, // < in curve coordinates
         *isx1Key = true;
         return;
     } else if (!isPeriodic && x >= keys.rbegin()->getTime()) {
-        *x2WidgetCoords = _curveWidget->width() - 1;
+        *x2WidgetCoords = xEndWidgetCoords;
         return;
     }
 
@@ -188,7 +197,7 @@ CurveGui::nextPointForSegment(const double x, // < in curve coordinates
     double normalizeTimeRange = tnext - tprev;
     if (normalizeTimeRange == 0) {
         // Only 1 keyframe, draw a horizontal line
-        *x2WidgetCoords = _curveWidget->width() - 1;
+        *x2WidgetCoords = xEndWidgetCoords;
         return;
     }
     assert(normalizeTimeRange > 0.);
@@ -279,6 +288,9 @@ drawLineStrip(const std::vector<float>& vertices,
                 glVertex2f(vertices[i - 2], vertices[i - 1] + 100000);
             } else if (previousWasTooBelow) {
                 glVertex2f(vertices[i - 2], vertices[i - 1] - 100000);
+            } else {
+                // The previous point is out of the widget horizontally
+                glVertex2f(vertices[i - 2], vertices[i - 1]);
             }
         }
         glVertex2f(vertices[i], vertices[i + 1]);
@@ -287,6 +299,132 @@ drawLineStrip(const std::vector<float>& vertices,
     glEnd();
 }
 
+void
+CurveGui::computePolyline(const KeyFrameSet& keyframes,
+                          bool isPeriodic,
+                          const std::pair<double, double>& parametricRange,
+                          double xStartWidgetCoords,
+                          double xEndWidgetCoords,
+                          std::vector<float>* vertices)
+{
+    assert( !keyframes.empty() );
+    double x1 = xStartWidgetCoords;
+    double x2;
+    bool isX1AKey = false;
+    KeyFrame x1Key;
+    KeyFrameSet::const_iterator lastUpperIt = keyframes.end();
+
+    while (x1 < xEndWidgetCoords) {
+        double x, y;
+        if (!isX1AKey) {
+            x = _curveWidget->toZoomCoordinates(x1, 0).x();
+            y = evaluate(false, x);
+        } else {
+            x = x1Key.getTime();
+            y = x1Key.getValue();
+        }
+
+        vertices->push_back( (float)x );
+        vertices->push_back( (float)y );
+        nextPointForSegment(x, keyframes, isPeriodic, parametricRange.first, parametricRange.second, xEndWidgetCoords, &lastUpperIt, &x2, &x1Key, &isX1AKey);
+        x1 = x2;
+    }
+    //also add the last point
+    {
+        double x = _curveWidget->toZoomCoordinates(x1, 0).x();
+        double y = evaluate(false, x);
+        vertices->push_back( (float)x );
+        vertices->push_back( (float)y );
+    }
+}
+
+/**
+ * @brief Keeps at most 4 vertices per pixel column of the given polyline: the first, the lowest, the highest and the
+ * last vertex of the column, in their original order. The x coordinates of the polyline must be increasing.
+ **/
+static void
+decimatePolyline(const std::vector<float>& vertices,
+                 double xOrigin,
+                 double pixelWidth,
+                 std::vector<float>* decimated)
+{
+    decimated->clear();
+    if (pixelWidth <= 0.) {
+        *decimated = vertices;
+
+        return;
+    }
+    const int nVertices = (int)vertices.size() / 2;
+    int i = 0;
+    while (i < nVertices) {
+        const double column = std::floor( (vertices[2 * i] - xOrigin) / pixelWidth );
+        int first = i, minI = i, maxI = i, last = i;
+        for (++i; i < nVertices && std::floor( (vertices[2 * i] - xOrigin) / pixelWidth ) == column; ++i) {
+            if (vertices[2 * i + 1] < vertices[2 * minI + 1]) {
+                minI = i;
+            }
+            if (vertices[2 * i + 1] > vertices[2 * maxI + 1]) {
+                maxI = i;
+            }
+            last = i;
+        }
+        const int indices[4] = { first, std::min(minI, maxI), std::max(minI, maxI), last };
+        int prevIndex = -1;
+        for (int j = 0; j < 4; ++j) {
+            if (indices[j] != prevIndex) {
+                decimated->push_back(vertices[2 * indices[j]]);
+                decimated->push_back(vertices[2 * indices[j] + 1]);
+                prevIndex = indices[j];
+            }
+        }
+    }
+}
+
+void
+CurveGui::refreshPolylineCache(const KeyFrameSet& keyframes,
+                               bool isPeriodic,
+                               const std::pair<double, double>& parametricRange)
+{
+    Hash64 hash;
+
+    for (KeyFrameSet::const_iterator it = keyframes.begin(); it != keyframes.end(); ++it) {
+        hash.append( it->getTime() );
+        hash.append( it->getValue() );
+        hash.append( it->getLeftDerivative() );
+        hash.append( it->getRightDerivative() );
+        hash.append( (int)it->getInterpolation() );
+    }
+    hash.append(isPeriodic);
+    hash.append(parametricRange.first);
+    hash.append(parametricRange.second);
+    hash.computeHash();
+
+    const double widgetWidth = _curveWidget->width();
+    const QPointF origin = _curveWidget->toZoomCoordinates(0, 0);
+    const QPointF unit = _curveWidget->toZoomCoordinates(1, 1);
+    const double pixelWidth = unit.x() - origin.x();
+    const double pixelHeight = origin.y() - unit.y();
+    const double xMin = origin.x();
+    const double xMax = _curveWidget->toZoomCoordinates(widgetWidth - 1, 0).x();
+
+    if ( _polylineValid && (_polylineHash == hash.value()) && (_polylinePixelWidth == pixelWidth) && (_polylinePixelHeight == pixelHeight) &&
+         (xMin >= _polylineXMin) && (xMax <= _polylineXMax) ) {
+        return;
+    }
+
+    // Compute the polyline over 3 times the width of the widget so that it does not need to be computed again while panning
+    std::vector<float> vertices;
+    computePolyline(keyframes, isPeriodic, parametricRange, -widgetWidth, 2 * widgetWidth - 1, &vertices);
+
+    _polylineXMin = _curveWidget->toZoomCoordinates(-widgetWidth, 0).x();
+    _polylineXMax = _curveWidget->toZoomCoordinates(2 * widgetWidth - 1, 0).x();
+    decimatePolyline(vertices, _polylineXMin, pixelWidth, &_polylineVertices);
+    _polylineHash = hash.value();
+    _polylinePixelWidth = pixelWidth;
+    _polylinePixelHeight = pixelHeight;
+    _polylineValid = true;
+}
+
 void
 CurveGui::drawCurve(int curveIndex,
                     int curvesCount)
@@ -302,7 +440,6 @@ CurveGui::drawCurve(int curveIndex,
 
     std::vector<float> vertices, exprVertices;
     double x1 = 0;
-    double x2;
     const double widgetWidth = _curveWidget->width();
     KeyFrameSet keyframes;
     BezierCPCurveGui* isBezier = dynamic_cast<BezierCPCurveGui*>(this);
@@ -338,35 +475,20 @@ CurveGui::drawCurve(int curveIndex,
         isPeriodic = getInternalCurve()->isCurvePeriodic();
         parametricRange = getInternalCurve()->getXRange();
     }
+    // Points to the vertices of the curve to draw
+    const std::vector<float>* curveVertices = &vertices;
     if ( !keyframes.empty() ) {
         try {
-            bool isX1AKey = false;
-            KeyFrame x1Key;
-            KeyFrameSet::const_iterator lastUpperIt = keyframes.end();
-
-            while ( x1 < (widgetWidth - 1) ) {
-                double x, y;
-                if (!isX1AKey) {
-                    x = _curveWidget->toZoomCoordinates(x1, 0).x();
-                    y = evaluate(false, x);
-                } else {
-                    x = x1Key.getTime();
-                    y = x1Key.getValue();
-                }
-
-                vertices.push_back( (float)x );
-                vertices.push_back( (float)y );
-                nextPointForSegment(x, keyframes, isPeriodic, parametricRange.first, parametricRange.second,  &lastUpperIt, &x2, &x1Key, &isX1AKey);
-                x1 = x2;
-            }
-            //also add the last point
-            {
-                double x = _curveWidget->toZoomCoordinates(x1, 0).x();
-                double y = evaluate(false, x);
-                vertices.push_back( (float)x );
-                vertices.push_back( (float)y );
+            if (isBezier) {
+                // Bezier curves have few keyframes, the polyline is cheap to compute
+                computePolyline(keyframes, isPeriodic, parametricRange, x1, widgetWidth - 1, &vertices);
+            } else {
+                refreshPolylineCache(keyframes, isPeriodic, parametricRange);
+                curveVertices = &_polylineVertices;
             }
         } catch (...) {
+            _polylineValid = false;
+            curveVertices = &vertices;
         }
     }
 
@@ -416,7 +538,7 @@ CurveGui::drawCurve(int curveIndex,
             glLineStipple(2, 0xAAAA);
             glEnable(GL_LINE_STIPPLE);
         }
-        drawLineStrip(vertices, btmLeft, topRight);
+        drawLineStrip(*curveVertices, btmLeft, topRight);
         if (hasDrawnExpr) {
             glDisable(GL_LINE_STIPPLE);
         }
@@ -458,15 +580,20 @@ CurveGui::drawCurve(int curveIndex,
 
         //bool isCurveSelected = foundCurveSelected != selectedKeyFrames.end();
 
-        for (KeyFrameSet::const_iterator k = keyframes.begin(); k != keyframes.end(); ++k) {
+        // Unselected keyframes are drawn in a single batch. When zoomed out, keyframes that fall on the same pixel are drawn once.
+        std::vector<float> keyVertices;
+        int prevKeyPixelX = INT_MIN;
+        int prevKeyPixelY = INT_MIN;
+
+        // Keyframes are sorted by time, only visit the visible ones
+        for (KeyFrameSet::const_iterator k = keyframes.lower_bound( KeyFrame(btmLeft.x(), 0.) );
+             k != keyframes.end() && k->getTime() <= topRight.x(); ++k) {
             const KeyFrame & key = (*k);
 
-            if ( ( key.getTime() < btmLeft.x() ) || ( key.getTime() > topRight.x() ) || ( key.getValue() < btmLeft.y() ) || ( key.getValue() > topRight.y() ) ) {
+            if ( ( key.getValue() < btmLeft.y() ) || ( key.getValue() > topRight.y() ) ) {
                 continue;
             }
 
-            glColor4f( _color.redF(), _color.greenF(), _color.blueF(), _color.alphaF() );
-
             //if the key is selected change its color to white
             KeyPtr isSelected;
             if ( foundCurveSelected != selectedKeyFrames.end() ) {
@@ -474,12 +601,26 @@ CurveGui::drawCurve(int curveIndex,
                      it2 != foundCurveSelected->second.end(); ++it2) {
                     if ( ( (*it2)->key.getTime() == key.getTime() ) && ( (*it2)->curve.get() == this ) ) {
                         isSelected = *it2;
-                        glColor4f(1.f, 1.f, 1.f, 1.f);
                         break;
                     }
                 }
             }
 
+            if (!isSelected) {
+                QPointF keyWidgetPos = _curveWidget->toWidgetCoordinates( key.getTime(), key.getValue() );
+                int keyPixelX = (int)std::floor( keyWidgetPos.x() );
+                int keyPixelY = (int)std::floor( keyWidgetPos.y() );
+                if ( (keyPixelX != prevKeyPixelX) || (keyPixelY != prevKeyPixelY) ) {
+                    keyVertices.push_back( (float)key.getTime() );
+                    keyVertices.push_back( (float)key.getValue() );
+                    prevKeyPixelX = keyPixelX;
+                    prevKeyPixelY = keyPixelY;
+                }
+                continue;
+            }
+
+            glColor4f(1.f, 1.f, 1.f, 1.f);
+
             double x = key.getTime();
             double y = key.getValue();
             glBegin(GL_POINTS);
@@ -543,6 +684,16 @@ CurveGui::drawCurve(int curveIndex,
                 glEnd();
             } // if ( !isBezier && ( isSelected != selectedKeyFrames.end() ) && (key.getInterpolation() != eKeyframeTypeConstant) ) {
         } // for (KeyFrameSet::const_iterator k = keyframes.begin(); k != keyframes.end(); ++k) {
+
+        if ( !keyVertices.empty() ) {
+            glColor4f( _color.redF(), _color.greenF(), _color.blueF(), _color.alphaF() );
+            glBegin(GL_POINTS);
+            for (std::size_t i = 0; i < keyVertices.size(); i += 2) {
+                glVertex2f(keyVertices[i], keyVertices[i + 1]);
+            }
+            glEnd();
+            glCheckErrorIgnoreOSXBug();
+        }
     } // GLProtectAttrib(GL_HINT_BIT | GL_ENABLE_BIT | GL_LINE_BIT | GL_COLOR_BUFFER_BIT | GL_POINT_BIT | GL_CURRENT_BIT);
 
     glCheckError();
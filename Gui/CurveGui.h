@@ -28,6 +28,9 @@
 
 #include "Global/Macros.h"
 
+#include <utility>
+#include <vector>
+
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
@@ -142,11 +145,30 @@ private:
                              const bool isPeriodic,
                              const double parametricXMin,
                              const double parametricXMax,
+                             const double xEndWidgetCoords,
                              KeyFrameSet::const_iterator* lastUpperIt,
                              double* x2,
                              KeyFrame* key,
                              bool* isKey );
 
+    /**
+     * @brief Samples the curve between the given widget x coordinates. The vertices are in curve coordinates.
+     **/
+    void computePolyline(const KeyFrameSet& keyframes,
+                         bool isPeriodic,
+                         const std::pair<double, double>& parametricRange,
+                         double xStartWidgetCoords,
+                         double xEndWidgetCoords,
+                         std::vector<float>* vertices);
+
+    /**
+     * @brief Computes the decimated polyline of the curve if the keyframes, the zoom factor or the visible range
+     * changed since it was last computed.
+     **/
+    void refreshPolylineCache(const KeyFrameSet& keyframes,
+                              bool isPeriodic,
+                              const std::pair<double, double>& parametricRange);
+
 protected:
 
     CurvePtr _internalCurve; ///ptr to the internal curve
@@ -159,6 +181,13 @@ private:
     int _thickness; /// its thickness
     bool _visible; /// should we draw this curve ?
     bool _selected; /// is this curve selected
+
+    ///The polyline of the curve, cached between repaints
+    bool _polylineValid;
+    U64 _polylineHash; /// hash of the keyframes the polyline was computed from
+    double _polylinePixelWidth, _polylinePixelHeight; /// size of a pixel in curve coordinates
+    double _polylineXMin, _polylineXMax; /// range covered by the polyline
+    std::vector<float> _polylineVertices;
 };
 
 typedef std::list<CurveGuiPtr> Curves;
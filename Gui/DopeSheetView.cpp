@@ -26,6 +26,7 @@
 #include "DopeSheetView.h"
 
 #include <algorithm> // min, max
+#include <cmath>
 #include <limits>
 #include <stdexcept>
 
@@ -119,6 +120,76 @@ running_in_main_thread_and_context(const QGLWidget *glWidget)
     running_in_main_context(glWidget);
 }
 
+/**
+ * @brief A keyframe to draw in a row of the dope sheet
+ **/
+struct KeyframeGlyph
+{
+    int texture;
+    bool selected;
+    RectD rect;
+};
+
+/**
+ * @brief Gathers the keyframes to draw, sorted by texture so that each texture is drawn in a single batch.
+ * The keyframes of a row must be appended in increasing time order: when zoomed out, keyframes that fall
+ * in the same pixel column are only drawn once, a selected keyframe taking precedence.
+ **/
+class KeyframeGlyphBatches
+{
+public:
+
+    KeyframeGlyphBatches()
+        : _batches(KF_TEXTURES_COUNT)
+        , _hasPending(false)
+        , _pendingColumn(0)
+        , _pending()
+    {
+    }
+
+    void beginRow()
+    {
+        flush();
+    }
+
+    void append(int column,
+                const KeyframeGlyph& glyph)
+    {
+        if ( _hasPending && (column == _pendingColumn) ) {
+            if (glyph.selected && !_pending.selected) {
+                _pending = glyph;
+            }
+
+            return;
+        }
+        flush();
+        _hasPending = true;
+        _pendingColumn = column;
+        _pending = glyph;
+    }
+
+    void flush()
+    {
+        if (_hasPending) {
+            assert(_pending.texture >= 0 && _pending.texture < KF_TEXTURES_COUNT);
+            _batches[_pending.texture].push_back(_pending);
+            _hasPending = false;
+        }
+    }
+
+    const std::vector<KeyframeGlyph>& getBatch(int texture) const
+    {
+        return _batches[texture];
+    }
+
+private:
+
+    std::vector<std::vector<KeyframeGlyph> > _batches;
+    bool _hasPending;
+    int _pendingColumn;
+    KeyframeGlyph _pending;
+};
+
 NATRON_NAMESPACE_ANONYMOUS_EXIT
 
 
@@ -217,11 +288,12 @@ public:
     void drawRange(const DSNodePtr &dsNode) const;
     void drawKeyframes(const DSNodePtr &dsNode) const;
 
-    void drawTexturedKeyframe(DopeSheetViewPrivate::KeyframeTexture textureType,
-                              bool drawTime,
-                              double time,
-                              const QColor& textColor,
-                              const RectD &rect) const;
+    bool isRowInViewport(QTreeWidgetItem* item) const;
+
+    void drawKeyframeGlyphs(KeyframeGlyphBatches& batches,
+                            bool drawSelectedTime,
+                            double time,
+                            const QColor& textColor) const;
 
     void drawGroupOverlay(const DSNodePtr &dsNode, const DSNodePtr &group) const;
 
@@ -1272,6 +1344,9 @@ DopeSheetViewPrivate::drawKeyframes(const DSNodePtr &dsNode) const
         int hasSingleKfTimeSelected = model->getSelectionModel()->hasSingleKeyFrameTimeSelected(&kfTimeSelected);
         std::map<double, bool> nodeKeytimes;
         std::map<DSKnob *, std::map<double, bool> > knobsKeytimes;
+        KeyframeGlyphBatches batches;
+        const double left = zoomContext.left();
+        const double right = zoomContext.right();
 
         for (DSTreeItemKnobMap::const_iterator it = knobItems.begin();
              it != knobItems.end();
@@ -1290,66 +1365,52 @@ DopeSheetViewPrivate::drawKeyframes(const DSNodePtr &dsNode) const
                 continue;
             }
 
+            // Draw keyframes in the knob dim row only if it's visible
+            bool drawInDimRow = hierarchyView->itemIsVisibleFromOutside(knobTreeItem) && isRowInViewport(knobTreeItem);
+            double rowCenterYWidget = hierarchyView->visualItemRect(knobTreeItem).center().y();
+
+            DSKnobPtr rootDSKnob = model->mapNameItemToDSKnob( knobTreeItem->parent() );
+            std::map<double, bool>* knobTimes = rootDSKnob ? &knobsKeytimes[rootDSKnob.get()] : 0;
+
             KeyFrameSet keyframes = dsKnob->getKnobGui()->getCurve(ViewIdx(0), dim)->getKeyFrames_mt_safe();
 
-            for (KeyFrameSet::const_iterator kIt = keyframes.begin();
-                 kIt != keyframes.end();
+            batches.beginRow();
+
+            // Clip keyframes horizontally, keyframes are sorted by time
+            for (KeyFrameSet::const_iterator kIt = keyframes.lower_bound( KeyFrame(left, 0.) );
+                 kIt != keyframes.end() && kIt->getTime() <= right;
                  ++kIt) {
-                KeyFrame kf = (*kIt);
+                const KeyFrame& kf = (*kIt);
                 double keyTime = kf.getTime();
-
-                // Clip keyframes horizontally //TODO Clip vertically too
-                if ( ( keyTime < zoomContext.left() ) || ( keyTime > zoomContext.right() ) ) {
-                    continue;
-                }
-
-                double rowCenterYWidget = hierarchyView->visualItemRect( dsKnob->getTreeItem() ).center().y();
-                RectD zoomKfRect = getKeyFrameBoundingRectZoomCoords(keyTime, rowCenterYWidget);
                 bool kfSelected = model->getSelectionModel()->keyframeIsSelected(dsKnob, kf);
 
-                // Draw keyframe in the knob dim row only if it's visible
-                bool drawInDimRow = hierarchyView->itemIsVisibleFromOutside(knobTreeItem);
-
                 if (drawInDimRow) {
-                    DopeSheetViewPrivate::KeyframeTexture texType = kfTextureFromKeyframeType( kf.getInterpolation(),
-                                                                                               kfSelected || selectionRect.intersects(zoomKfRect) );
+                    RectD zoomKfRect = getKeyFrameBoundingRectZoomCoords(keyTime, rowCenterYWidget);
+                    bool drawSelected = kfSelected || selectionRect.intersects(zoomKfRect);
+                    DopeSheetViewPrivate::KeyframeTexture texType = kfTextureFromKeyframeType(kf.getInterpolation(), drawSelected);
 
                     if (texType != DopeSheetViewPrivate::kfTextureNone) {
-                        drawTexturedKeyframe(texType, hasSingleKfTimeSelected && kfSelected,
-                                             kfTimeSelected, selectionColor, zoomKfRect);
+                        KeyframeGlyph glyph;
+                        glyph.texture = texType;
+                        glyph.selected = kfSelected;
+                        glyph.rect = zoomKfRect;
+                        batches.append( (int)std::floor( zoomContext.toWidgetCoordinates(keyTime, 0).x() ), glyph );
                     }
                 }
 
                 // Fill the knob times map
-                {
-                    DSKnobPtr rootDSKnob = model->mapNameItemToDSKnob( knobTreeItem->parent() );
-                    if (rootDSKnob) {
-                        assert(rootDSKnob);
-                        const std::map<double, bool>& map = knobsKeytimes[rootDSKnob.get()];
-                        bool knobTimeExists = ( map.find(keyTime) != map.end() );
-
-                        if (!knobTimeExists) {
-                            knobsKeytimes[rootDSKnob.get()][keyTime] = kfSelected;
-                        } else {
-                            bool knobTimeIsSelected = knobsKeytimes[rootDSKnob.get()][keyTime];
-
-                            if (!knobTimeIsSelected && kfSelected) {
-                                knobsKeytimes[rootDSKnob.get()][keyTime] = true;
-                            }
-                        }
+                if (knobTimes) {
+                    std::pair<std::map<double, bool>::iterator, bool> ret = knobTimes->insert( std::make_pair(keyTime, kfSelected) );
+                    if (!ret.second && kfSelected) {
+                        ret.first->second = true;
                     }
                 }
 
                 // Fill the node times map
-                bool nodeTimeExists = ( nodeKeytimes.find(keyTime) != nodeKeytimes.end() );
-
-                if (!nodeTimeExists) {
-                    nodeKeytimes[keyTime] = kfSelected;
-                } else {
-                    bool nodeTimeIsSelected = nodeKeytimes[keyTime];
-
-                    if (!nodeTimeIsSelected && kfSelected) {
-                        nodeKeytimes[keyTime] = true;
+                {
+                    std::pair<std::map<double, bool>::iterator, bool> ret = nodeKeytimes.insert( std::make_pair(keyTime, kfSelected) );
+                    if (!ret.second && kfSelected) {
+                        ret.first->second = true;
                     }
                 }
             }
@@ -1360,86 +1421,110 @@ DopeSheetViewPrivate::drawKeyframes(const DSNodePtr &dsNode) const
              it != knobsKeytimes.end();
              ++it) {
             QTreeWidgetItem *knobRootItem = (*it).first->getTreeItem();
-            std::map<double, bool> knobTimes = (*it).second;
 
-            for (std::map<double, bool>::const_iterator mIt = knobTimes.begin();
-                 mIt != knobTimes.end();
+            if ( !hierarchyView->itemIsVisibleFromOutside(knobRootItem) || !isRowInViewport(knobRootItem) ) {
+                continue;
+            }
+            double newCenterY = hierarchyView->visualItemRect(knobRootItem).center().y();
+
+            batches.beginRow();
+            for (std::map<double, bool>::const_iterator mIt = (*it).second.begin();
+                 mIt != (*it).second.end();
                  ++mIt) {
-                double time = (*mIt).first;
-                bool drawSelected = (*mIt).second;
-                bool drawInKnobRootRow = hierarchyView->itemIsVisibleFromOutside(knobRootItem);
-
-                if (drawInKnobRootRow) {
-                    double newCenterY = hierarchyView->visualItemRect(knobRootItem).center().y();
-                    RectD zoomKfRect = getKeyFrameBoundingRectZoomCoords(time, newCenterY);
-                    DopeSheetViewPrivate::KeyframeTexture textureType = (drawSelected)
-                                                                        ? DopeSheetViewPrivate::kfTextureMasterSelected
-                                                                        : DopeSheetViewPrivate::kfTextureMaster;
-
-                    drawTexturedKeyframe(textureType, hasSingleKfTimeSelected && drawSelected,
-                                         kfTimeSelected, selectionColor, zoomKfRect);
-                }
+                KeyframeGlyph glyph;
+                glyph.texture = (mIt->second) ? DopeSheetViewPrivate::kfTextureMasterSelected : DopeSheetViewPrivate::kfTextureMaster;
+                glyph.selected = mIt->second;
+                glyph.rect = getKeyFrameBoundingRectZoomCoords(mIt->first, newCenterY);
+                batches.append( (int)std::floor( zoomContext.toWidgetCoordinates(mIt->first, 0).x() ), glyph );
             }
         }
 
         // Draw master keys in node section
-        for (std::map<double, bool>::const_iterator it = nodeKeytimes.begin();
-             it != nodeKeytimes.end();
-             ++it) {
-            double time = (*it).first;
-            bool drawSelected = (*it).second;
-            QTreeWidgetItem *nodeItem = dsNode->getTreeItem();
-            bool drawInNodeRow = hierarchyView->itemIsVisibleFromOutside(nodeItem);
-
-            if (drawInNodeRow) {
-                double newCenterY = hierarchyView->visualItemRect(nodeItem).center().y();
-                RectD zoomKfRect = getKeyFrameBoundingRectZoomCoords(time, newCenterY);
-                DopeSheetViewPrivate::KeyframeTexture textureType = (drawSelected)
-                                                                    ? DopeSheetViewPrivate::kfTextureMasterSelected
-                                                                    : DopeSheetViewPrivate::kfTextureMaster;
-
-                drawTexturedKeyframe(textureType, hasSingleKfTimeSelected && drawSelected,
-                                     kfTimeSelected, selectionColor, zoomKfRect);
+        QTreeWidgetItem *nodeItem = dsNode->getTreeItem();
+        if ( hierarchyView->itemIsVisibleFromOutside(nodeItem) && isRowInViewport(nodeItem) ) {
+            double newCenterY = hierarchyView->visualItemRect(nodeItem).center().y();
+
+            batches.beginRow();
+            for (std::map<double, bool>::const_iterator it = nodeKeytimes.begin();
+                 it != nodeKeytimes.end();
+                 ++it) {
+                KeyframeGlyph glyph;
+                glyph.texture = (it->second) ? DopeSheetViewPrivate::kfTextureMasterSelected : DopeSheetViewPrivate::kfTextureMaster;
+                glyph.selected = it->second;
+                glyph.rect = getKeyFrameBoundingRectZoomCoords(it->first, newCenterY);
+                batches.append( (int)std::floor( zoomContext.toWidgetCoordinates(it->first, 0).x() ), glyph );
             }
         }
+
+        drawKeyframeGlyphs(batches, hasSingleKfTimeSelected, kfTimeSelected, selectionColor);
     }
 } // DopeSheetViewPrivate::drawKeyframes
 
+bool
+DopeSheetViewPrivate::isRowInViewport(QTreeWidgetItem* item) const
+{
+    QRect rowRect = hierarchyView->visualItemRect(item);
+
+    return (rowRect.bottom() + KF_PIXMAP_SIZE >= 0) && (rowRect.top() - KF_PIXMAP_SIZE <= q_ptr->height() );
+}
+
 void
-DopeSheetViewPrivate::drawTexturedKeyframe(DopeSheetViewPrivate::KeyframeTexture textureType,
-                                           bool drawTime,
-                                           double time,
-                                           const QColor& textColor,
-                                           const RectD &rect) const
+DopeSheetViewPrivate::drawKeyframeGlyphs(KeyframeGlyphBatches& batches,
+                                         bool drawSelectedTime,
+                                         double time,
+                                         const QColor& textColor) const
 {
-    GLProtectAttrib a(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_TRANSFORM_BIT);
-    GLProtectMatrix pr(GL_MODELVIEW);
+    batches.flush();
 
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, kfTexturesIDs[textureType]);
+    {
+        GLProtectAttrib a(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_TRANSFORM_BIT);
+        GLProtectMatrix pr(GL_MODELVIEW);
 
-    glBegin(GL_POLYGON);
-    glTexCoord2f(0.0f, 1.0f);
-    glVertex2f( rect.left(), rect.top() );
-    glTexCoord2f(0.0f, 0.0f);
-    glVertex2f( rect.left(), rect.bottom() );
-    glTexCoord2f(1.0f, 0.0f);
-    glVertex2f( rect.right(), rect.bottom() );
-    glTexCoord2f(1.0f, 1.0f);
-    glVertex2f( rect.right(), rect.top() );
-    glEnd();
+        glEnable(GL_TEXTURE_2D);
 
-    glColor4f(1, 1, 1, 1);
-    glBindTexture(GL_TEXTURE_2D, 0);
+        for (int i = 0; i < KF_TEXTURES_COUNT; ++i) {
+            const std::vector<KeyframeGlyph>& batch = batches.getBatch(i);
+            if ( batch.empty() ) {
+                continue;
+            }
+            glBindTexture(GL_TEXTURE_2D, kfTexturesIDs[i]);
+            glBegin(GL_QUADS);
+            for (std::vector<KeyframeGlyph>::const_iterator it = batch.begin(); it != batch.end(); ++it) {
+                const RectD& rect = it->rect;
+                glTexCoord2f(0.0f, 1.0f);
+                glVertex2f( rect.left(), rect.top() );
+                glTexCoord2f(0.0f, 0.0f);
+                glVertex2f( rect.left(), rect.bottom() );
+                glTexCoord2f(1.0f, 0.0f);
+                glVertex2f( rect.right(), rect.bottom() );
+                glTexCoord2f(1.0f, 1.0f);
+                glVertex2f( rect.right(), rect.top() );
+            }
+            glEnd();
+        }
 
-    glDisable(GL_TEXTURE_2D);
+        glColor4f(1, 1, 1, 1);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glDisable(GL_TEXTURE_2D);
+    }
+
+    if (!drawSelectedTime) {
+        return;
+    }
 
-    if (drawTime) {
-        QString text = QString::number(time);
-        QPointF p = zoomContext.toWidgetCoordinates( rect.right(), rect.bottom() );
-        p.rx() += 3;
-        p = zoomContext.toZoomCoordinates( p.x(), p.y() );
-        renderText(p.x(), p.y(), text, textColor, *font);
+    QString text = QString::number(time);
+    for (int i = 0; i < KF_TEXTURES_COUNT; ++i) {
+        const std::vector<KeyframeGlyph>& batch = batches.getBatch(i);
+        for (std::vector<KeyframeGlyph>::const_iterator it = batch.begin(); it != batch.end(); ++it) {
+            if (!it->selected) {
+                continue;
+            }
+            QPointF p = zoomContext.toWidgetCoordinates( it->rect.right(), it->rect.bottom() );
+            p.rx() += 3;
+            p = zoomContext.toZoomCoordinates( p.x(), p.y() );
+            renderText(p.x(), p.y(), text, textColor, *font);
+        }
     }
 }
 
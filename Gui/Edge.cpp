@@ -117,6 +117,13 @@ struct EdgePrivate
     }
 
     void initLabel();
+
+    NodeGraph* getGraph() const;
+
+    /**
+     * @brief Tells the graph that the line changed so that its spatial index of the edges is refreshed
+     **/
+    void notifyGeometryChanged();
 };
 
 Edge::Edge(int inputNb_,
@@ -160,6 +167,28 @@ EdgePrivate::initLabel()
     }
 }
 
+NodeGraph*
+EdgePrivate::getGraph() const
+{
+    NodeGuiPtr node = dest.lock();
+
+    if (!node) {
+        node = source.lock();
+    }
+
+    return node ? node->getDagGui() : 0;
+}
+
+void
+EdgePrivate::notifyGeometryChanged()
+{
+    NodeGraph* graph = getGraph();
+
+    if (graph) {
+        graph->invalidateEdgesSpatialIndex();
+    }
+}
+
 Edge::Edge(const NodeGuiPtr & src,
            QGraphicsItem *parent)
     : QGraphicsLineItem(parent)
@@ -176,6 +205,8 @@ Edge::Edge(const NodeGuiPtr & src,
 
 Edge::~Edge()
 {
+    _imp->notifyGeometryChanged();
+
     NodeGuiPtr dst = _imp->dest.lock();
 
     if (dst) {
@@ -435,6 +466,8 @@ Edge::initLine()
         return;
     }
 
+    _imp->notifyGeometryChanged();
+
     double sc = scale();
     QRectF sourceBBOX = source ? mapFromItem( source.get(), source->boundingRect() ).boundingRect() : QRectF(0, 0, 1, 1);
     QRectF destBBOX = dest ? mapFromItem( dest.get(), dest->boundingRect() ).boundingRect()  : QRectF(0, 0, 1, 1);
@@ -680,6 +713,7 @@ void
 Edge::dragSource(const QPointF & src)
 {
     setLine( QLineF(line().p1(), src) );
+    _imp->notifyGeometryChanged();
 
     double a = std::acos( line().dx() / std::max( EDGE_LENGTH_MIN, line().length() ) );
     if (line().dy() < 0) {
@@ -706,6 +740,7 @@ void
 Edge::dragDest(const QPointF & dst)
 {
     setLine( QLineF( dst, line().p2() ) );
+    _imp->notifyGeometryChanged();
 
     double a = std::acos( line().dx() / std::max( EDGE_LENGTH_MIN, line().length() ) );
     if (line().dy() < 0) {
@@ -744,6 +779,26 @@ Edge::isNearbyBendPoint(const QPointF & scenePoint)
     return false;
 }
 
+bool
+Edge::canBeBatched(QColor* color) const
+{
+    if ( !isVisible() || _imp->useSelected || _imp->useHighlight || _imp->paintWithDash || _imp->paintBendPoint ) {
+        return false;
+    }
+    if (color) {
+        if (_imp->useRenderingColor) {
+            *color = _imp->renderingColor;
+        } else {
+            *color = _imp->defaultColor;
+            if (_imp->optional) {
+                color->setAlphaF(0.4);
+            }
+        }
+    }
+
+    return true;
+}
+
 void
 Edge::paint(QPainter *painter,
             const QStyleOptionGraphicsItem * /*options*/,
@@ -763,6 +818,12 @@ Edge::paint(QPainter *painter,
         }
     }
 
+    ///When zoomed out, plain edges are drawn all at once by the edges batch of the graph
+    NodeGraph* graph = _imp->getGraph();
+    if ( graph && graph->isLowLevelOfDetail() && canBeBatched(NULL) ) {
+        return;
+    }
+
     if (_imp->paintWithDash) {
         QVector<qreal> dashStyle;
         qreal space = 4;
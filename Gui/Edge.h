@@ -125,6 +125,13 @@ public:
 
     bool computeVisibility(bool hovered) const;
 
+    /**
+     * @brief Returns true if the edge is drawn as a plain line, without arrow head, by the edges batch of the graph
+     * when the graph is zoomed out. In that case color is set to the color of the line.
+     * Selected, highlighted, dashed edges and edges showing their bend point are always drawn individually.
+     **/
+    bool canBeBatched(QColor* color) const;
+
 private:
 
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *options, QWidget *parent = 0) OVERRIDE FINAL;
@@ -166,6 +166,7 @@ SOURCES += \
     NodeGraphPrivate.cpp \
     NodeGraphPrivate10.cpp \
     NodeGraphRectItem.cpp \
+    NodeGraphSpatialIndex.cpp \
     NodeGraphTextItem.cpp \
     NodeGraphUndoRedo.cpp \
     NodeGui.cpp \
@@ -305,6 +306,7 @@ HEADERS += \
     NodeGraph.h \
     NodeGraphPrivate.h \
     NodeGraphRectItem.h \
+    NodeGraphSpatialIndex.h \
     NodeGraphTextItem.h \
     NodeGraphUndoRedo.h \
     NodeGui.h \
@@ -125,6 +125,10 @@ NodeGraph::NodeGraph(Gui* gui,
     _imp->_nodeRoot = new NodeGraphTextItem(this, _imp->_root, false);
     scene->addItem(_imp->_root);
 
+    ///Same depth as the edges, below the nodes
+    _imp->edgesBatch = new EdgesBatchItem(_imp.get(), _imp->_nodeRoot);
+    _imp->edgesBatch->setZValue(15);
+
     _imp->_navigator = new Navigator(0);
     scene->addItem(_imp->_navigator);
     _imp->_navigator->setFlag(QGraphicsItem::ItemIgnoresTransformations);
@@ -225,6 +229,28 @@ NodeGraph::isDoingNavigatorRender() const
     return _imp->isDoingPreviewRender;
 }
 
+bool
+NodeGraph::isLowLevelOfDetail() const
+{
+    return _imp->lowLevelOfDetail;
+}
+
+void
+NodeGraph::onNodeGeometryChanged(NodeGui* node)
+{
+    // Nodes which are not yet (or no longer) in the graph are not indexed
+    if ( _imp->nodesIndex.contains(node) ) {
+        _imp->nodesIndex.insert( node, NodeGraphPrivate::getNodeSceneRect(node) );
+    }
+    _imp->edgesIndexDirty = true;
+}
+
+void
+NodeGraph::invalidateEdgesSpatialIndex()
+{
+    _imp->edgesIndexDirty = true;
+}
+
 const std::list<NodeGuiPtr> &
 NodeGraph::getSelectedNodes() const
 {
@@ -261,6 +287,9 @@ NodeGraph::onNodesCleared()
         _imp->_nodes.clear();
         _imp->_nodesTrash.clear();
     }
+    _imp->nodesIndex.clear();
+    _imp->edgesIndex.clear();
+    _imp->edgesIndexDirty = true;
 
     _imp->_selection.clear();
     _imp->_magnifiedNode.reset();
@@ -286,6 +315,8 @@ NodeGraph::paintEvent(QPaintEvent* e)
         return;
     }
 
+    _imp->refreshLevelOfDetail();
+
     NodeCollectionPtr collection = getGroup();
     NodeGroup* isGroup = dynamic_cast<NodeGroup*>( collection.get() );
     bool isGroupEditable = true;
@@ -414,6 +445,9 @@ NodeGraph::createNodeGUI(const NodePtr & node,
         QMutexLocker l(&_imp->_nodesMutex);
         _imp->_nodes.push_back(node_ui);
     }
+    _imp->nodesIndex.insert( node_ui.get(), NodeGraphPrivate::getNodeSceneRect( node_ui.get() ) );
+    _imp->edgesIndexDirty = true;
+    node_ui->setLowLevelOfDetail(_imp->lowLevelOfDetail);
 
     //NodeGroup* parentIsGroup = dynamic_cast<NodeGroup*>(node->getGroup().get());;
     const std::list<NodePtr>& nodesBeingCreated = getGui()->getApp()->getNodesBeingCreated();
@@ -174,6 +174,22 @@ public:
 
     bool isDoingNavigatorRender() const;
 
+    /**
+     * @brief Returns true when the graph is zoomed out below NATRON_NODEGRAPH_LOD_ZOOM_THRESHOLD. Nodes are then drawn as
+     * simplified glyphs, without text, icons nor previews, and plain edges are drawn all at once by a single item.
+     **/
+    bool isLowLevelOfDetail() const;
+
+    /**
+     * @brief Must be called when the node moved or was resized so that the spatial index of the graph stays up to date.
+     **/
+    void onNodeGeometryChanged(NodeGui* node);
+
+    /**
+     * @brief Marks the spatial index of the edges as out of date: it is rebuilt the next time it is queried.
+     **/
+    void invalidateEdgesSpatialIndex();
+
 public Q_SLOTS:
 
     void deleteSelection();
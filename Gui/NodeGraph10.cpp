@@ -27,6 +27,7 @@
 #include "NodeGraphPrivate.h"
 
 #include <stdexcept>
+#include <vector>
 
 GCC_DIAG_UNUSED_PRIVATE_FIELD_OFF
 CLANG_DIAG_OFF(deprecated)
@@ -34,6 +35,7 @@ CLANG_DIAG_OFF(uninitialized)
 #include <QMouseEvent>
 #include <QtCore/QString>
 #include <QAction>
+#include <QPainterPath>
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 GCC_DIAG_UNUSED_PRIVATE_FIELD_ON
@@ -54,53 +56,56 @@ GCC_DIAG_UNUSED_PRIVATE_FIELD_ON
 #include "Global/QtCompat.h"
 
 NATRON_NAMESPACE_ENTER
-static NodeGui*
-isNodeGuiChild(QGraphicsItem* item)
+/**
+ * @brief Returns true if the item or one of its visible children intersects the given path, in scene coordinates,
+ * using the same test as QGraphicsView::items(). Text items are skipped if ignoreText is true.
+ **/
+static bool
+itemCollidesWithScenePath(QGraphicsItem* item,
+                          const QPainterPath& scenePath,
+                          bool ignoreText)
 {
-    NodeGui* n = dynamic_cast<NodeGui*>(item);
-
-    if (n) {
-        return n;
+    if ( !item->isVisible() ) {
+        return false;
     }
-    if (!item) {
-        return 0;
+    bool isText = item->type() == QGraphicsTextItem::Type || item->type() == QGraphicsSimpleTextItem::Type;
+    if ( ( !ignoreText || !isText ) && item->collidesWithPath(item->mapFromScene(scenePath), Qt::IntersectsItemShape) ) {
+        return true;
     }
-    QGraphicsItem* parent = item->parentItem();
-    if (parent) {
-        return isNodeGuiChild(parent);
-    } else {
-        return 0;
+    QList<QGraphicsItem*> children = item->childItems();
+    for (QList<QGraphicsItem*>::const_iterator it = children.begin(); it != children.end(); ++it) {
+        if ( itemCollidesWithScenePath(*it, scenePath, ignoreText) ) {
+            return true;
+        }
     }
+
+    return false;
 }
 
-static Edge*
-isEdgeChild(QGraphicsItem* item)
+static QPainterPath
+viewportRectToScenePath(const QGraphicsView* view,
+                        const QRect& rect)
 {
-    Edge* n = dynamic_cast<Edge*>(item);
+    QPainterPath path;
 
-    if (n) {
-        return n;
-    }
-    if (!item) {
-        return 0;
-    }
-    QGraphicsItem* parent = item->parentItem();
-    if (parent) {
-        return isEdgeChild(parent);
-    } else {
-        return 0;
-    }
+    path.addPolygon( view->mapToScene(rect) );
+    path.closeSubpath();
+
+    return path;
 }
 
 void
 NodeGraph::getNodesWithinViewportRect(const QRect& rect,
                                       std::set<NodeGui*>* nodes) const
 {
-    QList<QGraphicsItem*> selectedItems = items(rect, Qt::IntersectsItemShape);
-    for (QList<QGraphicsItem*>::Iterator it = selectedItems.begin(); it != selectedItems.end(); ++it) {
-        NodeGui* n = isNodeGuiChild(*it);
-        if (n) {
-            nodes->insert(n);
+    // Only test the nodes found in the spatial index instead of all the items of the scene
+    const QPainterPath scenePath = viewportRectToScenePath(this, rect);
+    std::vector<NodeGui*> candidates;
+
+    _imp->getNodesWithinSceneRect(scenePath.boundingRect(), &candidates);
+    for (std::vector<NodeGui*>::const_iterator it = candidates.begin(); it != candidates.end(); ++it) {
+        if ( itemCollidesWithScenePath(*it, scenePath, false) ) {
+            nodes->insert(*it);
         }
     }
 }
@@ -114,17 +119,15 @@ NodeGraph::hasItemNearbyMouse(const QPoint& mousePosViewport,
     *node = 0;
     *edge = 0;
     // if mouse is exactly on node, select it
-    QList<QGraphicsItem*> selectedItems = items(mousePosViewport);
+    const QPainterPath mousePath = viewportRectToScenePath( this, QRect(mousePosViewport.x(), mousePosViewport.y(), 1, 1) );
+    std::vector<NodeGui*> candidateNodes;
+    _imp->getNodesWithinSceneRect(mousePath.boundingRect(), &candidateNodes);
     std::set<NodeGui*> nodes;
-    for (QList<QGraphicsItem*>::Iterator it = selectedItems.begin(); it != selectedItems.end(); ++it) {
+    for (std::vector<NodeGui*>::const_iterator it = candidateNodes.begin(); it != candidateNodes.end(); ++it) {
         // do not select text that may go beyond the Node box
         // see https://github.com/MrKepzie/Natron/issues/1604
-        if ((*it)->type() == QGraphicsTextItem::Type || (*it)->type() == QGraphicsSimpleTextItem::Type) {
-            continue;
-        }
-        NodeGui* n = isNodeGuiChild(*it);
-        if (n) {
-            nodes.insert(n);
+        if ( itemCollidesWithScenePath(*it, mousePath, true) ) {
+            nodes.insert(*it);
         }
     }
     // use a tolerance for edges
@@ -133,17 +136,18 @@ NodeGraph::hasItemNearbyMouse(const QPoint& mousePosViewport,
                         mousePosViewport.y() - tolerance / 2.,
                         tolerance,
                         tolerance);
-    selectedItems = items(toleranceRect, Qt::IntersectsItemShape);
+    const QPainterPath tolerancePath = viewportRectToScenePath(this, toleranceRect);
+    std::vector<Edge*> candidateEdges;
+    _imp->getEdgesWithinSceneRect(tolerancePath.boundingRect(), &candidateEdges);
+    // The hint edges do not belong to any node
+    candidateEdges.push_back(_imp->_hintInputEdge);
+    candidateEdges.push_back(_imp->_hintOutputEdge);
     std::set<Edge*> edges;
-    for (QList<QGraphicsItem*>::Iterator it = selectedItems.begin(); it != selectedItems.end(); ++it) {
-        // do not select text, which is decorative only
+    for (std::vector<Edge*>::const_iterator it = candidateEdges.begin(); it != candidateEdges.end(); ++it) {
+        // do not select the label, which is decorative only
         // see https://github.com/MrKepzie/Natron/issues/1604
-        if ((*it)->type() == QGraphicsTextItem::Type || (*it)->type() == QGraphicsSimpleTextItem::Type) {
-            continue;
-        }
-        Edge* isEdge = isEdgeChild(*it);
-        if (isEdge) {
-            edges.insert(isEdge);
+        if ( (*it)->isVisible() && (*it)->scene() && (*it)->collidesWithPath( (*it)->mapFromScene(tolerancePath), Qt::IntersectsItemShape ) ) {
+            edges.insert(*it);
         }
     }
 
@@ -192,6 +192,8 @@ NodeGraph::moveToTrash(NodeGui* node)
             break;
         }
     }
+    _imp->nodesIndex.remove(node);
+    _imp->edgesIndexDirty = true;
 }
 
 void
@@ -203,9 +205,11 @@ NodeGraph::restoreFromTrash(NodeGui* node)
         if ( (*it).get() == node ) {
             _imp->_nodes.push_back(*it);
             _imp->_nodesTrash.erase(it);
+            _imp->nodesIndex.insert( node, NodeGraphPrivate::getNodeSceneRect(node) );
             break;
         }
     }
+    _imp->edgesIndexDirty = true;
 }
 
 // grabbed from QDirModelPrivate::size() in qtbase/src/widgets/itemviews/qdirmodel.cpp
@@ -397,6 +397,8 @@ NodeGraph::deleteNodePermanantly(const NodeGuiPtr& n)
             _imp->_nodes.erase(it);
         }
     }
+    _imp->nodesIndex.remove( n.get() );
+    _imp->edgesIndexDirty = true;
 
     NodesGuiList::iterator found = std::find(_imp->_selection.begin(), _imp->_selection.end(), n);
     if ( found != _imp->_selection.end() ) {
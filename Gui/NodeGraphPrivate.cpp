@@ -26,8 +26,16 @@
 #include "NodeGraphPrivate.h"
 #include "NodeGraph.h"
 
+#include <map>
 #include <stdexcept>
 
+CLANG_DIAG_OFF(deprecated)
+CLANG_DIAG_OFF(uninitialized)
+#include <QtCore/QVector>
+#include <QtCore/QLineF>
+CLANG_DIAG_ON(deprecated)
+CLANG_DIAG_ON(uninitialized)
+
 #include "Engine/Node.h"
 #include "Engine/NodeGroup.h"
 #include "Engine/NodeSerialization.h"
@@ -94,10 +102,71 @@ NodeGraphPrivate::NodeGraphPrivate(NodeGraph* p,
     , lastSelectedViewer(0)
     , isDoingPreviewRender(false)
     , autoScrollTimer()
+    , refreshRenderStateTimer()
+    , nodesIndex()
+    , edgesIndex()
+    , edgesIndexDirty(true)
+    , lowLevelOfDetail(false)
+    , edgesBatch(NULL)
 {
     appPTR->getIcon(NATRON_PIXMAP_LOCKED, &unlockIcon);
 }
 
+EdgesBatchItem::EdgesBatchItem(NodeGraphPrivate* graph,
+                               QGraphicsItem* parent)
+    : QGraphicsItem(parent)
+    , _graph(graph)
+{
+    // We need the exposed rect to only draw the edges that need to be
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+    setAcceptedMouseButtons(Qt::NoButton);
+}
+
+EdgesBatchItem::~EdgesBatchItem()
+{
+}
+
+QRectF
+EdgesBatchItem::boundingRect() const
+{
+    // The edges may be anywhere in the scene
+    return QRectF(-NATRON_SCENE_MAX, -NATRON_SCENE_MAX, 2 * NATRON_SCENE_MAX, 2 * NATRON_SCENE_MAX);
+}
+
+void
+EdgesBatchItem::paint(QPainter *painter,
+                      const QStyleOptionGraphicsItem *option,
+                      QWidget * /*widget*/)
+{
+    if ( !_graph->lowLevelOfDetail || _graph->isDoingPreviewRender ) {
+        return;
+    }
+
+    std::vector<Edge*> edges;
+    _graph->getEdgesWithinSceneRect(mapRectToScene(option->exposedRect), &edges);
+
+    typedef std::map<QRgb, QVector<QLineF> > LinesPerColorMap;
+    LinesPerColorMap lines;
+    QColor color;
+    for (std::vector<Edge*>::const_iterator it = edges.begin(); it != edges.end(); ++it) {
+        if ( !(*it)->canBeBatched(&color) ) {
+            continue;
+        }
+        const QLineF l = (*it)->line();
+        lines[color.rgba()].push_back( QLineF( mapFromItem( *it, l.p1() ), mapFromItem( *it, l.p2() ) ) );
+    }
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing, false);
+    painter->setBrush(Qt::NoBrush);
+    for (LinesPerColorMap::const_iterator it = lines.begin(); it != lines.end(); ++it) {
+        // A cosmetic pen: at this zoom level edges are thinner than a pixel anyway
+        painter->setPen( QPen(QColor::fromRgba(it->first), 0) );
+        painter->drawLines(it->second);
+    }
+    painter->restore();
+} // EdgesBatchItem::paint
+
 QPoint
 NodeGraphPrivate::getPyPlugUnlockPos() const
 {
@@ -222,4 +291,80 @@ NodeGraphPrivate::copyNodesInternal(const NodesGuiList& selection,
     }
 }
 
+QRectF
+NodeGraphPrivate::getNodeSceneRect(NodeGui* node)
+{
+    // Include the children (label, indicators...) which may extend outside of the node bounding box
+    return node->mapRectToScene( node->boundingRect() | node->childrenBoundingRect() );
+}
+
+void
+NodeGraphPrivate::getNodesWithinSceneRect(const QRectF& sceneRect,
+                                          std::vector<NodeGui*>* nodes) const
+{
+    std::vector<QGraphicsItem*> items;
+
+    nodesIndex.query(sceneRect, &items);
+    nodes->reserve( nodes->size() + items.size() );
+    for (std::vector<QGraphicsItem*>::const_iterator it = items.begin(); it != items.end(); ++it) {
+        nodes->push_back( static_cast<NodeGui*>(*it) );
+    }
+}
+
+void
+NodeGraphPrivate::rebuildEdgesIndexIfNeeded()
+{
+    if (!edgesIndexDirty) {
+        return;
+    }
+    edgesIndex.clear();
+    for (NodesGuiList::const_iterator it = _nodes.begin(); it != _nodes.end(); ++it) {
+        const std::vector<Edge*>& inputs = (*it)->getInputsArrows();
+        for (std::vector<Edge*>::const_iterator it2 = inputs.begin(); it2 != inputs.end(); ++it2) {
+            // The shape of an edge is larger than its line so that it is easier to click
+            edgesIndex.insert( *it2, (*it2)->mapRectToScene( (*it2)->boundingRect() | (*it2)->shape().boundingRect() ) );
+        }
+        Edge* output = (*it)->getOutputArrow();
+        if (output) {
+            edgesIndex.insert( output, output->mapRectToScene( output->boundingRect() | output->shape().boundingRect() ) );
+        }
+    }
+    edgesIndexDirty = false;
+}
+
+void
+NodeGraphPrivate::getEdgesWithinSceneRect(const QRectF& sceneRect,
+                                          std::vector<Edge*>* edges)
+{
+    rebuildEdgesIndexIfNeeded();
+
+    std::vector<QGraphicsItem*> items;
+    edgesIndex.query(sceneRect, &items);
+    edges->reserve( edges->size() + items.size() );
+    for (std::vector<QGraphicsItem*>::const_iterator it = items.begin(); it != items.end(); ++it) {
+        // Edges of deactivated nodes are removed from the scene
+        if ( (*it)->scene() && (*it)->isVisible() ) {
+            edges->push_back( static_cast<Edge*>(*it) );
+        }
+    }
+}
+
+void
+NodeGraphPrivate::refreshLevelOfDetail()
+{
+    double zoomFactor = _publicInterface->transform().mapRect( QRectF(0, 0, 1, 1) ).width();
+    bool low = zoomFactor < NATRON_NODEGRAPH_LOD_ZOOM_THRESHOLD;
+
+    if (low == lowLevelOfDetail) {
+        return;
+    }
+    lowLevelOfDetail = low;
+    for (NodesGuiList::iterator it = _nodes.begin(); it != _nodes.end(); ++it) {
+        (*it)->setLowLevelOfDetail(low);
+    }
+    for (NodesGuiList::iterator it = _nodesTrash.begin(); it != _nodesTrash.end(); ++it) {
+        (*it)->setLowLevelOfDetail(low);
+    }
+}
+
 NATRON_NAMESPACE_EXIT
@@ -33,6 +33,7 @@
 #include <map>
 #include <utility>
 #include <string>
+#include <vector>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/weak_ptr.hpp>
@@ -53,6 +54,7 @@ CLANG_DIAG_OFF(uninitialized)
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
+#include "Gui/NodeGraphSpatialIndex.h"
 #include "Gui/NodeGraphUndoRedo.h" // NodeGuiPtr
 #include "Gui/GuiFwd.h"
 
@@ -69,6 +71,10 @@ CLANG_DIAG_ON(uninitialized)
 #define NATRON_SCENE_MAX 1e6
 #define NATRON_SCENE_MIN 0
 
+///Below this zoom factor, nodes are drawn without their text, icons and previews and plain edges are batched.
+///At this zoom the label of a node is only a few pixels high and cannot be read anyway.
+#define NATRON_NODEGRAPH_LOD_ZOOM_THRESHOLD 0.4
+
 NATRON_NAMESPACE_ENTER
 
 enum EventStateEnum
@@ -156,6 +162,29 @@ public:
 };
 
 
+class NodeGraphPrivate;
+
+/**
+ * @brief When the graph is zoomed out, draws all the edges that can be drawn as plain lines (see Edge::canBeBatched)
+ * with one drawLines() call per color. Only the edges intersecting the exposed area, found through the spatial index
+ * of the graph, are drawn.
+ **/
+class EdgesBatchItem
+    : public QGraphicsItem
+{
+    NodeGraphPrivate* _graph;
+
+public:
+
+    EdgesBatchItem(NodeGraphPrivate* graph,
+                   QGraphicsItem* parent);
+
+    virtual ~EdgesBatchItem();
+
+    virtual QRectF boundingRect() const OVERRIDE FINAL;
+    virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) OVERRIDE FINAL;
+};
+
 class NodeGraphPrivate
 {
 public:
@@ -213,6 +242,18 @@ public:
     QTimer autoScrollTimer;
     QTimer refreshRenderStateTimer;
 
+    ///Spatial index of the active nodes, updated each time a node moves
+    NodeGraphSpatialIndex nodesIndex;
+
+    ///Spatial index of the edges of the active nodes. Edges move whenever one of their nodes moves so
+    ///this one is rebuilt lazily, when queried after having been invalidated.
+    NodeGraphSpatialIndex edgesIndex;
+    bool edgesIndexDirty;
+
+    ///True when the zoom factor is below NATRON_NODEGRAPH_LOD_ZOOM_THRESHOLD
+    bool lowLevelOfDetail;
+    EdgesBatchItem* edgesBatch;
+
 
     NodeGraphPrivate(NodeGraph* p,
                      const NodeCollectionPtr& group);
@@ -261,6 +302,25 @@ public:
     void toggleSelectedNodesEnabled();
 
     void getNodeSet(const NodesGuiList& nodeList, std::set<NodeGuiPtr>& nodeSet);
+
+    /**
+     * @brief Returns the active nodes whose bounding rectangle, children included, intersects the given rectangle
+     **/
+    void getNodesWithinSceneRect(const QRectF& sceneRect, std::vector<NodeGui*>* nodes) const;
+
+    /**
+     * @brief Returns the edges of the active nodes whose bounding rectangle intersects the given rectangle
+     **/
+    void getEdgesWithinSceneRect(const QRectF& sceneRect, std::vector<Edge*>* edges);
+
+    void rebuildEdgesIndexIfNeeded();
+
+    static QRectF getNodeSceneRect(NodeGui* node);
+
+    /**
+     * @brief Switches the nodes to simplified glyphs if the zoom factor crossed NATRON_NODEGRAPH_LOD_ZOOM_THRESHOLD
+     **/
+    void refreshLevelOfDetail();
 };
 
 NATRON_NAMESPACE_EXIT
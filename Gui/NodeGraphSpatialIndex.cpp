@@ -0,0 +1,275 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "NodeGraphSpatialIndex.h"
+
+#include <algorithm> // min, max
+#include <cassert>
+#include <cmath>
+#include <map>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/unordered_map.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+// Cell coordinates are clamped to this range so that they fit in 32 bits
+#define NATRON_NODEGRAPH_SPATIAL_INDEX_MAX_CELL_COORD (1 << 30)
+
+NATRON_NAMESPACE_ENTER
+
+namespace {
+struct IndexEntry
+{
+    QGraphicsItem* item;
+
+    // Normalized rectangle of the item, in scene coordinates
+    QRectF rect;
+
+    // Range of cells covered by the rectangle, inclusive
+    int x1, y1, x2, y2;
+
+    // True if the item covers too many cells to be stored in the grid
+    bool oversized;
+};
+
+typedef std::map<QGraphicsItem*, IndexEntry> IndexEntriesMap;
+typedef std::vector<const IndexEntry*> IndexCell;
+typedef boost::unordered_map<U64, IndexCell> IndexCellsMap;
+
+inline bool
+rectanglesIntersect(const QRectF& a,
+                    const QRectF& b)
+{
+    // Unlike QRectF::intersects, accept rectangles with a null width or height
+    return a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+inline U64
+cellKey(int x,
+        int y)
+{
+    return ( (U64)(U32)x << 32 ) | (U64)(U32)y;
+}
+} // anon
+
+struct NodeGraphSpatialIndexPrivate
+{
+    double cellSize;
+    IndexEntriesMap entries;
+    IndexCellsMap cells;
+    std::vector<const IndexEntry*> oversized;
+
+    NodeGraphSpatialIndexPrivate(double cellSize)
+        : cellSize(cellSize)
+        , entries()
+        , cells()
+        , oversized()
+    {
+        assert(cellSize > 0);
+    }
+
+    int cellCoord(double v) const
+    {
+        double c = std::floor(v / cellSize);
+
+        c = std::max( c, (double)-NATRON_NODEGRAPH_SPATIAL_INDEX_MAX_CELL_COORD );
+        c = std::min( c, (double)NATRON_NODEGRAPH_SPATIAL_INDEX_MAX_CELL_COORD );
+
+        return (int)c;
+    }
+
+    void addToCells(const IndexEntry* entry);
+
+    void removeFromCells(const IndexEntry* entry);
+};
+
+void
+NodeGraphSpatialIndexPrivate::addToCells(const IndexEntry* entry)
+{
+    if (entry->oversized) {
+        oversized.push_back(entry);
+
+        return;
+    }
+    for (int y = entry->y1; y <= entry->y2; ++y) {
+        for (int x = entry->x1; x <= entry->x2; ++x) {
+            cells[cellKey(x, y)].push_back(entry);
+        }
+    }
+}
+
+void
+NodeGraphSpatialIndexPrivate::removeFromCells(const IndexEntry* entry)
+{
+    if (entry->oversized) {
+        std::vector<const IndexEntry*>::iterator found = std::find(oversized.begin(), oversized.end(), entry);
+        if ( found != oversized.end() ) {
+            oversized.erase(found);
+        }
+
+        return;
+    }
+    for (int y = entry->y1; y <= entry->y2; ++y) {
+        for (int x = entry->x1; x <= entry->x2; ++x) {
+            IndexCellsMap::iterator foundCell = cells.find( cellKey(x, y) );
+            if ( foundCell == cells.end() ) {
+                continue;
+            }
+            IndexCell& cell = foundCell->second;
+            IndexCell::iterator found = std::find(cell.begin(), cell.end(), entry);
+            if ( found != cell.end() ) {
+                // Order within a cell does not matter
+                *found = cell.back();
+                cell.pop_back();
+            }
+            if ( cell.empty() ) {
+                cells.erase(foundCell);
+            }
+        }
+    }
+}
+
+NodeGraphSpatialIndex::NodeGraphSpatialIndex(double cellSize)
+    : _imp( new NodeGraphSpatialIndexPrivate(cellSize) )
+{
+}
+
+NodeGraphSpatialIndex::~NodeGraphSpatialIndex()
+{
+}
+
+void
+NodeGraphSpatialIndex::insert(QGraphicsItem* item,
+                              const QRectF& sceneRect)
+{
+    assert(item);
+    IndexEntriesMap::iterator found = _imp->entries.find(item);
+    if ( found != _imp->entries.end() ) {
+        _imp->removeFromCells(&found->second);
+    } else {
+        IndexEntry e;
+        e.item = item;
+        found = _imp->entries.insert( std::make_pair(item, e) ).first;
+    }
+
+    IndexEntry& entry = found->second;
+    entry.rect = sceneRect.normalized();
+    entry.x1 = _imp->cellCoord( entry.rect.left() );
+    entry.y1 = _imp->cellCoord( entry.rect.top() );
+    entry.x2 = _imp->cellCoord( entry.rect.right() );
+    entry.y2 = _imp->cellCoord( entry.rect.bottom() );
+    double nCells = ( (double)entry.x2 - entry.x1 + 1. ) * ( (double)entry.y2 - entry.y1 + 1. );
+    entry.oversized = nCells > NATRON_NODEGRAPH_SPATIAL_INDEX_MAX_CELLS_PER_ITEM;
+    _imp->addToCells(&entry);
+}
+
+void
+NodeGraphSpatialIndex::remove(QGraphicsItem* item)
+{
+    IndexEntriesMap::iterator found = _imp->entries.find(item);
+
+    if ( found == _imp->entries.end() ) {
+        return;
+    }
+    _imp->removeFromCells(&found->second);
+    _imp->entries.erase(found);
+}
+
+bool
+NodeGraphSpatialIndex::contains(QGraphicsItem* item) const
+{
+    return _imp->entries.find(item) != _imp->entries.end();
+}
+
+void
+NodeGraphSpatialIndex::clear()
+{
+    _imp->cells.clear();
+    _imp->oversized.clear();
+    _imp->entries.clear();
+}
+
+std::size_t
+NodeGraphSpatialIndex::size() const
+{
+    return _imp->entries.size();
+}
+
+void
+NodeGraphSpatialIndex::query(const QRectF& sceneRect,
+                             std::vector<QGraphicsItem*>* items) const
+{
+    assert(items);
+    if ( _imp->entries.empty() ) {
+        return;
+    }
+    const QRectF rect = sceneRect.normalized();
+    const int x1 = _imp->cellCoord( rect.left() );
+    const int y1 = _imp->cellCoord( rect.top() );
+    const int x2 = _imp->cellCoord( rect.right() );
+    const int y2 = _imp->cellCoord( rect.bottom() );
+    double nCells = ( (double)x2 - x1 + 1. ) * ( (double)y2 - y1 + 1. );
+
+    if ( nCells > (double)_imp->entries.size() ) {
+        // The query covers more cells than there are items (e.g: the whole graph is visible): scan the items instead
+        for (IndexEntriesMap::const_iterator it = _imp->entries.begin(); it != _imp->entries.end(); ++it) {
+            if ( rectanglesIntersect(it->second.rect, rect) ) {
+                items->push_back(it->first);
+            }
+        }
+
+        return;
+    }
+
+    for (std::vector<const IndexEntry*>::const_iterator it = _imp->oversized.begin(); it != _imp->oversized.end(); ++it) {
+        if ( rectanglesIntersect( (*it)->rect, rect ) ) {
+            items->push_back( (*it)->item );
+        }
+    }
+
+    for (int y = y1; y <= y2; ++y) {
+        for (int x = x1; x <= x2; ++x) {
+            IndexCellsMap::const_iterator foundCell = _imp->cells.find( cellKey(x, y) );
+            if ( foundCell == _imp->cells.end() ) {
+                continue;
+            }
+            const IndexCell& cell = foundCell->second;
+            for (IndexCell::const_iterator it = cell.begin(); it != cell.end(); ++it) {
+                const IndexEntry* entry = *it;
+                // An item covering several cells is only reported from the first cell that both it and the query cover
+                if ( ( x != std::max(entry->x1, x1) ) || ( y != std::max(entry->y1, y1) ) ) {
+                    continue;
+                }
+                if ( rectanglesIntersect(entry->rect, rect) ) {
+                    items->push_back(entry->item);
+                }
+            }
+        }
+    }
+} // NodeGraphSpatialIndex::query
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,103 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Gui_NodeGraphSpatialIndex_h
+#define Gui_NodeGraphSpatialIndex_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+CLANG_DIAG_OFF(deprecated)
+CLANG_DIAG_OFF(uninitialized)
+#include <QtCore/QRectF>
+CLANG_DIAG_ON(deprecated)
+CLANG_DIAG_ON(uninitialized)
+
+#include "Gui/GuiFwd.h"
+
+// Size, in scene coordinates, of a cell of the grid. A default node is roughly 80x30 so a cell holds a few nodes.
+#define NATRON_NODEGRAPH_SPATIAL_INDEX_CELL_SIZE 256.
+
+// Items covering more cells than this (unconnected edges, large backdrops) are not stored in the grid
+// but in a separate list which is tested against every query.
+#define NATRON_NODEGRAPH_SPATIAL_INDEX_MAX_CELLS_PER_ITEM 64
+
+class QGraphicsItem;
+
+NATRON_NAMESPACE_ENTER
+
+struct NodeGraphSpatialIndexPrivate;
+
+/**
+ * @brief A uniform grid over the scene of the NodeGraph, mapping scene rectangles to the items they contain.
+ * The QGraphicsScene of the NodeGraph does not index its items (it would have to rebuild its BSP tree each time a node
+ * is dragged) so that finding the items under the mouse or within the viewport is linear in the number of items
+ * (and all their children). This index answers these queries in a time proportional to the number of items in the
+ * queried area and can be updated in constant time when an item moves.
+ * The index only stores the rectangles it is given: it never dereferences the items.
+ **/
+class NodeGraphSpatialIndex
+{
+public:
+
+    NodeGraphSpatialIndex(double cellSize = NATRON_NODEGRAPH_SPATIAL_INDEX_CELL_SIZE);
+
+    ~NodeGraphSpatialIndex();
+
+    /**
+     * @brief Inserts the item with the given bounding rectangle, in scene coordinates.
+     * If the item is already in the index, its rectangle is updated.
+     **/
+    void insert(QGraphicsItem* item, const QRectF& sceneRect);
+
+    void remove(QGraphicsItem* item);
+
+    bool contains(QGraphicsItem* item) const;
+
+    void clear();
+
+    std::size_t size() const;
+
+    /**
+     * @brief Appends to items all items whose rectangle intersects the given rectangle, in scene coordinates.
+     * Each item is reported once. Rectangles touching only by their border are considered to intersect, so that
+     * horizontal and vertical lines (which have an empty area) can be found.
+     **/
+    void query(const QRectF& sceneRect, std::vector<QGraphicsItem*>* items) const;
+
+private:
+
+    boost::scoped_ptr<NodeGraphSpatialIndexPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Gui_NodeGraphSpatialIndex_h
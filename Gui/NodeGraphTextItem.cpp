@@ -70,7 +70,7 @@ NodeGraphTextItem::paint(QPainter *painter,
     bool isTooSmall = false;
 
     if (!_alwaysDrawText) {
-        if ( _graph->isDoingNavigatorRender() ) {
+        if ( _graph->isDoingNavigatorRender() || _graph->isLowLevelOfDetail() ) {
             isTooSmall = true;
         } else {
             QFontMetrics fm( font() );
@@ -114,7 +114,7 @@ NodeGraphSimpleTextItem::paint(QPainter *painter,
     bool isTooSmall = false;
 
     if (!_alwaysDrawText) {
-        if ( _graph->isDoingNavigatorRender() ) {
+        if ( _graph->isDoingNavigatorRender() || _graph->isLowLevelOfDetail() ) {
             isTooSmall = true;
         } else {
             QFontMetrics fm( font() );
@@ -146,7 +146,7 @@ NodeGraphPixmapItem::paint(QPainter *painter,
                            const QStyleOptionGraphicsItem *option,
                            QWidget *widget)
 {
-    if ( _graph->isDoingNavigatorRender() ) {
+    if ( _graph->isDoingNavigatorRender() || _graph->isLowLevelOfDetail() ) {
         return;
     }
     QRect br = _graph->mapFromScene( mapToScene( boundingRect() ).boundingRect() ).boundingRect();
@@ -1011,6 +1011,8 @@ NodeGui::refreshPositionEnd(double x,
 {
     setPos(x, y);
     if (_graph) {
+        _graph->onNodeGeometryChanged(this);
+
         QRectF bbox = mapRectToScene( boundingRect() );
         const NodesGuiList & allNodes = _graph->getAllActiveNodes();
 
@@ -2932,6 +2934,9 @@ void
 NodeGui::setScale_natron(double scale)
 {
     setScale(scale);
+    if (_graph) {
+        _graph->onNodeGeometryChanged(this);
+    }
     for (InputEdges::iterator it = _inputEdges.begin(); it != _inputEdges.end(); ++it) {
         (*it)->setScale(scale);
     }
@@ -3437,6 +3442,16 @@ NodeGui::setPosition(double x,
     refreshPosition(x, y, true);
 }
 
+void
+NodeGui::setLowLevelOfDetail(bool lowLevelOfDetail)
+{
+    // The other decorations (icons, preview, input labels) skip their paint() on their own, but the label
+    // is also hidden so that it does not extend the area of the node under the mouse.
+    if (_nameItem) {
+        _nameItem->setVisible(!lowLevelOfDetail);
+    }
+}
+
 void
 NodeGui::getPosition(double *x,
                      double* y) const
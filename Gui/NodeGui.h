@@ -302,6 +302,9 @@ public:
     ///same as setScale() but also scales the arrows
     void setScale_natron(double scale);
 
+    ///Called by the NodeGraph when the zoom crosses NATRON_NODEGRAPH_LOD_ZOOM_THRESHOLD
+    void setLowLevelOfDetail(bool lowLevelOfDetail);
+
     void removeHighlightOnAllEdges();
 
     QColor getCurrentColor() const;
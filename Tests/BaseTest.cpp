@@ -50,8 +50,10 @@ CLANG_DIAG_ON(unknown-pragmas)
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
 #include "Engine/KnobTypes.h"
+#include "Engine/KnobValuesSnapshot.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Plugin.h"
+#include "Engine/Settings.h"
 #include "Engine/Curve.h"
 #include "Engine/CLArgs.h"
 #include "Engine/ViewIdx.h"
@@ -281,6 +283,60 @@ TEST_F(BaseTest, GenerateDot)
     QFile::remove(filePath);
 }
 
+///Render a frame large enough to be split between several threads with the parameters snapshot enabled:
+///every thread helping the render must activate the snapshot of the frame, not only the thread that started it.
+TEST_F(BaseTest, KnobsSnapshotOnRenderThreads)
+{
+    KnobBool* snapshotEnabled = dynamic_cast<KnobBool*>( appPTR->getCurrentSettings()->getKnobByName("renderParamsSnapshot").get() );
+    ASSERT_TRUE(snapshotEnabled);
+    snapshotEnabled->setValue(true);
+    appPTR->setNumberOfThreads(4);
+
+    NodePtr generator = createNode(_generatorPluginID);
+    NodePtr writer = createNode(_writeOIIOPluginID);
+    ASSERT_TRUE( bool(generator) && bool(writer) );
+
+    KnobInt* frameRange = dynamic_cast<KnobInt*>( generator->getApp()->getProject()->getKnobByName("frameRange").get() );
+    ASSERT_TRUE(frameRange);
+    frameRange->setValue(1, ViewSpec::all(), 0);
+    frameRange->setValue(1, ViewSpec::all(), 1);
+
+    Format f(0, 0, 2000, 2000, "snapshot", 1.);
+    generator->getApp()->getProject()->setOrAddProjectFormat(f);
+
+    QString filePath = appPTR->getApplicationBinaryPath() + QString::fromUtf8("/test_knobs_snapshot.jpg");
+    writer->setOutputFilesForWriter( filePath.toStdString() );
+    connectNodes(generator, writer, 0, true);
+
+    KnobValuesSnapshotStats before;
+    KnobValuesSnapshot::getStatistics(&before);
+
+    std::list<AppInstance::RenderWork> works;
+    AppInstance::RenderWork w;
+    w.writer = dynamic_cast<OutputEffectInstance*>( writer->getEffectInstance().get() );
+    assert(w.writer);
+    w.firstFrame = INT_MIN;
+    w.lastFrame = INT_MAX;
+    w.frameStep = INT_MIN;
+    w.useRenderStats = false;
+    works.push_back(w);
+    getApp()->startWritersRendering(false, works);
+
+    KnobValuesSnapshotStats after;
+    KnobValuesSnapshot::getStatistics(&after);
+    snapshotEnabled->setValue(false);
+
+    EXPECT_TRUE( QFile::exists(filePath) );
+    QFile::remove(filePath);
+
+    EXPECT_GT(after.nSnapshots, before.nSnapshots);
+    EXPECT_GT(after.nHits, before.nHits);
+    if (QThread::idealThreadCount() > 1) {
+        // At least one thread other than the one that made the snapshot used it
+        EXPECT_GT(after.nActivations - before.nActivations, after.nSnapshots - before.nSnapshots);
+    }
+}
+
 TEST_F(BaseTest, SetValues)
 {
     NodePtr generator = createNode(_generatorPluginID);
@@ -0,0 +1,265 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __NATRON_UNIX__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include <gtest/gtest.h>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#endif
+
+#include <QtCore/QDir>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include "Engine/AppManager.h"
+#include "Engine/Cache.h"
+#include "Engine/FrameEntry.h"
+#include "Engine/FrameKey.h"
+#include "Engine/FrameParams.h"
+#include "Engine/ImageLocker.h"
+#include "Engine/MemoryFile.h"
+#include "Engine/TextureRect.h"
+#include "Engine/Timer.h"
+
+/*
+ * Disk cache playback benchmark: fills a tiled Cache<FrameEntry>, set up like the viewer cache, with frames made of
+ * viewer tiles, then plays them back the way the viewer does (prefetching the tiles of the frame
+ * NATRON_VIEWER_CACHE_PREFETCH_FRAMES ahead, then reading the tiles of the current frame) with each of the
+ * "Disk cache read mode" settings, and reports the frame rate reached.
+ *
+ * The benchmark only runs when NATRON_DISK_CACHE_BENCHMARK_DIR is set, e.g:
+ *
+ * NATRON_DISK_CACHE_BENCHMARK_DIR=/mnt/nvme/scratch ./Tests --gtest_filter=DiskCacheBenchmark.*
+ *
+ * Environment variables:
+ * - NATRON_DISK_CACHE_BENCHMARK_DIR: directory on the drive to benchmark, used as the disk cache location during the benchmark.
+ * - NATRON_DISK_CACHE_BENCHMARK_FRAMES: number of frames to play back, 48 by default.
+ * - NATRON_DISK_CACHE_BENCHMARK_FRAME_MB: size of a frame in MiB, i.e. its number of 256x256 RGBA float tiles, 32 by default.
+ * - NATRON_DISK_CACHE_BENCHMARK_FPS: if set, the benchmark fails if the read-ahead mode is slower than this frame rate.
+ *
+ * Before each playback the tiles are evicted from memory and from the system file cache, so that they are read from the drive.
+ */
+
+#define kDiskCacheBenchmarkEnvDir "NATRON_DISK_CACHE_BENCHMARK_DIR"
+#define kDiskCacheBenchmarkEnvFrames "NATRON_DISK_CACHE_BENCHMARK_FRAMES"
+#define kDiskCacheBenchmarkEnvFrameSize "NATRON_DISK_CACHE_BENCHMARK_FRAME_MB"
+#define kDiskCacheBenchmarkEnvFps "NATRON_DISK_CACHE_BENCHMARK_FPS"
+
+// Same as NATRON_VIEWER_CACHE_PREFETCH_FRAMES
+#define kDiskCacheBenchmarkPrefetchFrames 4
+
+// Viewer tiles of 256x256 pixels, RGBA float
+#define kDiskCacheBenchmarkTileSize 256
+
+NATRON_NAMESPACE_USING
+
+namespace {
+double
+getEnvDouble(const char* name,
+             double defaultValue)
+{
+    const char* value = std::getenv(name);
+
+    if (!value) {
+        return defaultValue;
+    }
+    char* end = 0;
+    double ret = std::strtod(value, &end);
+
+    return (end == value) ? defaultValue : ret;
+}
+
+FrameKey
+makeTileKey(int frame,
+            int tile)
+{
+    TextureRect rect(tile * kDiskCacheBenchmarkTileSize, 0, (tile + 1) * kDiskCacheBenchmarkTileSize, kDiskCacheBenchmarkTileSize, kDiskCacheBenchmarkTileSize, 1.);
+
+    return FrameKey(0, frame, 0, 1., 1., 0, (int)eImageBitDepthFloat, 0, ViewIdx(0), rect, 0, "DiskCacheBenchmark",
+                    ImagePlaneDesc::getRGBAComponents(), std::string(), true, false);
+}
+
+/**
+ * @brief Drops the pages of the tile from memory once it is written to the drive, so that reading it goes to the drive.
+ **/
+void
+evictTile(const FrameEntryPtr& entry,
+          std::size_t tileBytes)
+{
+#if defined(__NATRON_UNIX__) && defined(MADV_DONTNEED)
+    ::msync(entry->data(), tileBytes, MS_SYNC);
+    ::madvise(entry->data(), tileBytes, MADV_DONTNEED);
+#else
+    Q_UNUSED(entry);
+    Q_UNUSED(tileBytes);
+#endif
+}
+
+void
+evictFromFileCache(const QString& dirPath)
+{
+#if defined(__NATRON_UNIX__) && defined(POSIX_FADV_DONTNEED)
+    QDir dir(dirPath);
+    QStringList files = dir.entryList(QDir::Files);
+    for (int i = 0; i < files.size(); ++i) {
+        int fd = ::open(dir.absoluteFilePath(files[i]).toStdString().c_str(), O_RDONLY);
+        if (fd != -1) {
+            ::fdatasync(fd);
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+    }
+#else
+    Q_UNUSED(dirPath);
+#endif
+}
+
+/**
+ * @brief Fills a new tiled cache mapped with the given flags, then reads all the frames in order, as the viewer does
+ * during playback, and returns the frame rate reached.
+ **/
+double
+playback(int mode,
+         int mappingFlags,
+         int nFrames,
+         int nTilesPerFrame)
+{
+    const std::size_t tileBytes = kDiskCacheBenchmarkTileSize * kDiskCacheBenchmarkTileSize * 4 * sizeof(float);
+    std::stringstream name;
+
+    name << "DiskCacheBenchmark" << mode;
+    boost::shared_ptr<Cache<FrameEntry> > cache = boost::make_shared<Cache<FrameEntry> >(name.str(), NATRON_CACHE_VERSION, (U64)nFrames * nTilesPerFrame * tileBytes * 2, 0.);
+    cache->setTiled(true, tileBytes);
+    cache->setFileMappingFlags(mappingFlags);
+    const QString cachePath = cache->getCachePath();
+    QDir().mkpath(cachePath);
+
+    // Write the frames
+    RectI tileBounds(0, 0, kDiskCacheBenchmarkTileSize, kDiskCacheBenchmarkTileSize);
+    for (int i = 0; i < nFrames; ++i) {
+        for (int t = 0; t < nTilesPerFrame; ++t) {
+            FrameParamsPtr params( new FrameParams(tileBounds, (int)eImageBitDepthFloat, tileBounds, ImagePtr() ) );
+            FrameEntryLocker locker(0);
+            FrameEntryPtr entry;
+            cache->getOrCreate(makeTileKey(i, t), params, &locker, &entry);
+            EXPECT_TRUE(entry);
+            if (!entry) {
+                return 0.;
+            }
+            entry->allocateMemory();
+            for (std::size_t j = 0; j < tileBytes; j += 4096) {
+                entry->data()[j] = (U8)(i + t + j);
+            }
+            evictTile(entry, tileBytes);
+        }
+    }
+    evictFromFileCache(cachePath);
+
+    // The texture the frames are uploaded to
+    std::vector<U8> texture(nTilesPerFrame * tileBytes);
+    TimeLapse timer;
+    for (int i = 0; i < nFrames; ++i) {
+        if (i + kDiskCacheBenchmarkPrefetchFrames < nFrames) {
+            for (int t = 0; t < nTilesPerFrame; ++t) {
+                cache->prefetch( makeTileKey(i + kDiskCacheBenchmarkPrefetchFrames, t) );
+            }
+        }
+        for (int t = 0; t < nTilesPerFrame; ++t) {
+            std::list<FrameEntryPtr> entries;
+            EXPECT_TRUE( cache->get(makeTileKey(i, t), &entries) );
+            if ( !entries.empty() ) {
+                std::memcpy( &texture[t * tileBytes], entries.front()->data(), tileBytes );
+            }
+        }
+    }
+    double elapsed = timer.getTimeSinceCreation();
+
+    cache->clear();
+    cache->waitForDeleterThread();
+    cache.reset();
+    QDir cacheDir(cachePath);
+    QStringList files = cacheDir.entryList(QDir::Files);
+    for (int i = 0; i < files.size(); ++i) {
+        cacheDir.remove(files[i]);
+    }
+    QDir().rmdir(cachePath);
+
+    return elapsed > 0 ? nFrames / elapsed : 0.;
+}
+} // anon namespace
+
+TEST(DiskCacheBenchmark, Playback) {
+    const char* dir = std::getenv(kDiskCacheBenchmarkEnvDir);
+
+    if (!dir) {
+        std::cout << "Skipping the disk cache benchmark: " kDiskCacheBenchmarkEnvDir " is not set" << std::endl;
+
+        return;
+    }
+    const int nFrames = std::max(1, (int)getEnvDouble(kDiskCacheBenchmarkEnvFrames, 48));
+    const int nTilesPerFrame = std::max(1, (int)getEnvDouble(kDiskCacheBenchmarkEnvFrameSize, 32) );
+
+    // The caches are created in the disk cache location
+    QByteArray oldLocation = qgetenv(NATRON_DISK_CACHE_PATH_ENV_VAR);
+    qputenv( NATRON_DISK_CACHE_PATH_ENV_VAR, QByteArray(dir) );
+    appPTR->refreshDiskCacheLocation();
+
+    const int modes[3] = {
+        MemoryFile::eMappingFlagsNone,
+        MemoryFile::eMappingFlagsPopulate | MemoryFile::eMappingFlagsSequential,
+        MemoryFile::eMappingFlagsPopulate | MemoryFile::eMappingFlagsSequential | MemoryFile::eMappingFlagsHugePages
+    };
+    const char* modeNames[3] = { "Default", "Read-ahead", "Read-ahead with huge pages" };
+    double fps[3];
+    for (int i = 0; i < 3; ++i) {
+        fps[i] = playback(i, modes[i], nFrames, nTilesPerFrame);
+        std::cout << modeNames[i] << ": " << fps[i] << " fps (" << fps[i] * nTilesPerFrame << " MiB/s)" << std::endl;
+    }
+
+    qputenv(NATRON_DISK_CACHE_PATH_ENV_VAR, oldLocation);
+    appPTR->refreshDiskCacheLocation();
+
+    double minFps = getEnvDouble(kDiskCacheBenchmarkEnvFps, 0);
+    if (minFps > 0) {
+        EXPECT_GE(fps[1], minFps);
+    }
+}
@@ -0,0 +1,101 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+#include <boost/shared_ptr.hpp>
+#include "Engine/LRUHashTable.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+struct TestEntry
+{
+    double cost;
+    bool pinned;
+
+    TestEntry(double cost,
+              bool pinned = false)
+        : cost(cost)
+        , pinned(pinned)
+    {
+    }
+};
+
+typedef boost::shared_ptr<TestEntry> TestEntryPtr;
+typedef BoostLRUHashTable<U64, TestEntryPtr> TestTable;
+
+struct TestScore
+{
+    bool operator()(const TestEntryPtr& entry,
+                    double* score) const
+    {
+        if (entry->pinned) {
+            return false;
+        }
+        *score = entry->cost;
+
+        return true;
+    }
+};
+} // anon namespace
+
+TEST(LRUHashTable, ScoredEvictTakesCheapestInWindow) {
+    TestTable table;
+
+    // In least recently used order
+    table.insert( 1, TestEntryPtr( new TestEntry(5.) ) );
+    table.insert( 2, TestEntryPtr( new TestEntry(1.) ) );
+    table.insert( 3, TestEntryPtr( new TestEntry(3.) ) );
+    table.insert( 4, TestEntryPtr( new TestEntry(0.5) ) );
+
+    // Only the 3 least recently used entries are candidates
+    std::pair<U64, TestEntryPtr> evicted = table.evict(TestScore(), 3);
+    ASSERT_TRUE(evicted.second);
+    EXPECT_EQ( (U64)2, evicted.first );
+
+    evicted = table.evict(TestScore(), 16);
+    ASSERT_TRUE(evicted.second);
+    EXPECT_EQ( (U64)4, evicted.first );
+    EXPECT_EQ( 2u, table.size() );
+}
+
+TEST(LRUHashTable, ScoredEvictSkipsPinnedAndUsedEntries) {
+    TestTable table;
+    TestEntryPtr used( new TestEntry(0.) );
+
+    table.insert( 1, TestEntryPtr( new TestEntry(0., true) ) );
+    table.insert(2, used);
+    table.insert( 3, TestEntryPtr( new TestEntry(2.) ) );
+
+    std::pair<U64, TestEntryPtr> evicted = table.evict(TestScore(), 1);
+    ASSERT_TRUE(evicted.second);
+    EXPECT_EQ( (U64)3, evicted.first );
+
+    evicted = table.evict(TestScore(), 16);
+    EXPECT_FALSE(evicted.second);
+    EXPECT_EQ( 2u, table.size() );
+}
@@ -0,0 +1,325 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include <gtest/gtest.h>
+
+CLANG_DIAG_OFF(deprecated)
+CLANG_DIAG_OFF(uninitialized)
+#include <QtCore/QVector>
+#include <QtCore/QLineF>
+#include <QGraphicsRectItem>
+#include <QGraphicsLineItem>
+#include <QImage>
+#include <QPainter>
+CLANG_DIAG_ON(deprecated)
+CLANG_DIAG_ON(uninitialized)
+
+#include "Engine/Timer.h"
+
+#include "Gui/NodeGraphSpatialIndex.h"
+
+NATRON_NAMESPACE_USING
+
+typedef boost::shared_ptr<QGraphicsRectItem> RectItemPtr;
+typedef boost::shared_ptr<QGraphicsLineItem> LineItemPtr;
+
+static QRectF
+randomRect(double maxPos,
+           double maxSize)
+{
+    // coverity[dont_call]
+    double x = ( (double)rand() / RAND_MAX ) * maxPos;
+    // coverity[dont_call]
+    double y = ( (double)rand() / RAND_MAX ) * maxPos;
+    // coverity[dont_call]
+    double w = ( (double)rand() / RAND_MAX ) * maxSize;
+    // coverity[dont_call]
+    double h = ( (double)rand() / RAND_MAX ) * maxSize;
+
+    return QRectF(x, y, w, h);
+}
+
+static bool
+rectanglesIntersect(const QRectF& a,
+                    const QRectF& b)
+{
+    return a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+static void
+bruteForceQuery(const std::vector<RectItemPtr>& items,
+                const QRectF& rect,
+                std::vector<QGraphicsItem*>* result)
+{
+    for (std::vector<RectItemPtr>::const_iterator it = items.begin(); it != items.end(); ++it) {
+        if ( (*it)->isVisible() && rectanglesIntersect( (*it)->rect(), rect ) ) {
+            result->push_back( it->get() );
+        }
+    }
+}
+
+TEST(NodeGraphSpatialIndex,
+     QueryMatchesBruteForce)
+{
+    srand(2000);
+
+    NodeGraphSpatialIndex index;
+    std::vector<RectItemPtr> items;
+    for (int i = 0; i < 2000; ++i) {
+        // A few items are much larger than a cell, like backdrops and unconnected edges
+        RectItemPtr item( new QGraphicsRectItem( randomRect( 20000, (i % 100 == 0) ? 10000 : 150 ) ) );
+        items.push_back(item);
+        index.insert( item.get(), item->rect() );
+    }
+    ASSERT_EQ( items.size(), index.size() );
+
+    for (int pass = 0; pass < 3; ++pass) {
+        for (int i = 0; i < 200; ++i) {
+            QRectF query = randomRect( 20000, (i % 10 == 0) ? 20000 : 2000 );
+            std::vector<QGraphicsItem*> expected, found;
+            bruteForceQuery(items, query, &expected);
+            index.query(query, &found);
+            std::sort( expected.begin(), expected.end() );
+            std::sort( found.begin(), found.end() );
+            // Each item must be reported exactly once
+            ASSERT_TRUE( std::adjacent_find( found.begin(), found.end() ) == found.end() );
+            ASSERT_TRUE( expected == found );
+        }
+
+        if (pass == 0) {
+            // Move some items around
+            for (std::size_t i = 0; i < items.size(); i += 3) {
+                items[i]->setRect( randomRect(20000, 150) );
+                index.insert( items[i].get(), items[i]->rect() );
+            }
+            ASSERT_EQ( items.size(), index.size() );
+        } else if (pass == 1) {
+            // Remove some items: they are hidden so that the brute force query skips them
+            for (std::size_t i = 0; i < items.size(); i += 2) {
+                items[i]->setVisible(false);
+                index.remove( items[i].get() );
+                ASSERT_FALSE( index.contains( items[i].get() ) );
+            }
+            ASSERT_EQ( items.size() / 2, index.size() );
+        }
+    }
+
+    index.clear();
+    std::vector<QGraphicsItem*> found;
+    index.query(QRectF(0, 0, 20000, 20000), &found);
+    ASSERT_TRUE( found.empty() );
+}
+
+TEST(NodeGraphSpatialIndex,
+     DegenerateRectangles)
+{
+    NodeGraphSpatialIndex index;
+    // A vertical edge has an empty bounding rectangle but must still be found
+    QGraphicsLineItem vertical( QLineF(100, 0, 100, 1000) );
+    QGraphicsLineItem horizontal( QLineF(0, 50, 1000, 50) );
+
+    index.insert( &vertical, QRectF( vertical.line().p1(), vertical.line().p2() ) );
+    index.insert( &horizontal, QRectF( horizontal.line().p1(), horizontal.line().p2() ) );
+
+    std::vector<QGraphicsItem*> found;
+    index.query(QRectF(90, 500, 20, 20), &found);
+    ASSERT_EQ(1, (int)found.size());
+    ASSERT_EQ(&vertical, found[0]);
+
+    found.clear();
+    index.query(QRectF(500, 40, 20, 20), &found);
+    ASSERT_EQ(1, (int)found.size());
+    ASSERT_EQ(&horizontal, found[0]);
+
+    // Negative coordinates
+    found.clear();
+    index.insert( &vertical, QRectF(-1000, -1000, 10, 10) );
+    index.query(QRectF(-995, -995, 1, 1), &found);
+    ASSERT_EQ(1, (int)found.size());
+    ASSERT_EQ(&vertical, found[0]);
+}
+
+/*
+ * Panning benchmark: draws a synthetic graph of 5000 nodes while panning, with and without the spatial index,
+ * and reports the time spent per frame.
+ *
+ * The benchmark only runs when NATRON_NODEGRAPH_BENCHMARK is set, e.g:
+ *
+ * NATRON_NODEGRAPH_BENCHMARK=1 ./Tests --gtest_filter=NodeGraphSpatialIndex.PanningBenchmark
+ */
+
+#define kNodeGraphBenchmarkEnv "NATRON_NODEGRAPH_BENCHMARK"
+
+namespace {
+/**
+ * @brief A synthetic graph laid out like a large template comp: rows of nodes, each one connected
+ * to one or two nodes of the row above.
+ **/
+struct SyntheticGraph
+{
+    std::vector<RectItemPtr> nodes;
+    std::vector<LineItemPtr> edges;
+    NodeGraphSpatialIndex nodesIndex;
+    NodeGraphSpatialIndex edgesIndex;
+    QRectF bounds;
+
+    SyntheticGraph(int nNodes,
+                   int nColumns)
+    {
+        srand(2000);
+        for (int i = 0; i < nNodes; ++i) {
+            int row = i / nColumns;
+            int col = i % nColumns;
+            RectItemPtr node( new QGraphicsRectItem(col * 150., row * 100., 100., 40.) );
+            nodes.push_back(node);
+            nodesIndex.insert( node.get(), node->rect() );
+            bounds |= node->rect();
+            if (row == 0) {
+                continue;
+            }
+            // coverity[dont_call]
+            int nInputs = 1 + rand() % 2;
+            for (int j = 0; j < nInputs; ++j) {
+                // coverity[dont_call]
+                int inputCol = std::max( 0, std::min(nColumns - 1, col - 2 + rand() % 5) );
+                const QRectF& inputRect = nodes[(row - 1) * nColumns + inputCol]->rect();
+                LineItemPtr edge( new QGraphicsLineItem( QLineF( node->rect().center(), inputRect.center() ) ) );
+                edges.push_back(edge);
+                edgesIndex.insert( edge.get(), QRectF( edge->line().p1(), edge->line().p2() ).normalized() );
+            }
+        }
+    }
+};
+
+/**
+ * @brief Pans a view of the given size (in pixels) over the graph at the given zoom and returns the average time
+ * to draw a frame, in milliseconds. If useIndex is true, only the visible nodes and edges are drawn and edges
+ * are drawn with one call, as the NodeGraph does. Otherwise every item is drawn one by one.
+ **/
+double
+panGraph(SyntheticGraph& graph,
+         double zoom,
+         int nFrames,
+         bool useIndex,
+         std::vector<int>* nDrawnPerFrame)
+{
+    const int viewWidth = 1600;
+    const int viewHeight = 900;
+    QImage image(viewWidth, viewHeight, QImage::Format_ARGB32_Premultiplied);
+    const QRectF viewRect(0, 0, viewWidth / zoom, viewHeight / zoom);
+    const QPointF panStep( viewRect.width() / 20., viewRect.height() / 30. );
+    QPointF origin = graph.bounds.topLeft();
+    std::vector<QGraphicsItem*> visibleItems;
+    QVector<QLineF> lines;
+
+    TimeLapse timer;
+    for (int frame = 0; frame < nFrames; ++frame) {
+        const QRectF visible = viewRect.translated(origin);
+        image.fill(0);
+        QPainter p(&image);
+        p.scale(zoom, zoom);
+        p.translate( -visible.topLeft() );
+        p.setBrush( QColor(128, 128, 128) );
+        int nDrawn = 0;
+        if (useIndex) {
+            visibleItems.clear();
+            graph.nodesIndex.query(visible, &visibleItems);
+            for (std::vector<QGraphicsItem*>::const_iterator it = visibleItems.begin(); it != visibleItems.end(); ++it) {
+                p.drawRect( static_cast<QGraphicsRectItem*>(*it)->rect() );
+            }
+            nDrawn += (int)visibleItems.size();
+            visibleItems.clear();
+            graph.edgesIndex.query(visible, &visibleItems);
+            lines.clear();
+            for (std::vector<QGraphicsItem*>::const_iterator it = visibleItems.begin(); it != visibleItems.end(); ++it) {
+                lines.push_back( static_cast<QGraphicsLineItem*>(*it)->line() );
+            }
+            p.setPen( QPen(Qt::black, 0) );
+            p.drawLines(lines);
+            nDrawn += (int)visibleItems.size();
+        } else {
+            for (std::vector<RectItemPtr>::const_iterator it = graph.nodes.begin(); it != graph.nodes.end(); ++it) {
+                p.drawRect( (*it)->rect() );
+            }
+            p.setPen( QPen(Qt::black, 2) );
+            for (std::vector<LineItemPtr>::const_iterator it = graph.edges.begin(); it != graph.edges.end(); ++it) {
+                p.drawLine( (*it)->line() );
+            }
+            nDrawn = (int)( graph.nodes.size() + graph.edges.size() );
+        }
+        p.end();
+        if (nDrawnPerFrame) {
+            nDrawnPerFrame->push_back(nDrawn);
+        }
+
+        // Pan diagonally, wrapping around the graph
+        origin += panStep;
+        if ( origin.x() > graph.bounds.right() ) {
+            origin.setX( graph.bounds.left() );
+        }
+        if ( origin.y() > graph.bounds.bottom() ) {
+            origin.setY( graph.bounds.top() );
+        }
+    }
+
+    return timer.getTimeElapsedReset() * 1000. / nFrames;
+} // panGraph
+} // anon
+
+TEST(NodeGraphSpatialIndex,
+     PanningBenchmark)
+{
+    if ( !std::getenv(kNodeGraphBenchmarkEnv) ) {
+        std::cout << "Skipping the node graph panning benchmark: " kNodeGraphBenchmarkEnv " is not set" << std::endl;
+
+        return;
+    }
+
+    SyntheticGraph graph(5000, 50);
+    const int nFrames = 100;
+    const double zooms[2] = { 1., 0.3 };
+
+    for (int i = 0; i < 2; ++i) {
+        std::vector<int> nDrawn;
+        double indexedMs = panGraph(graph, zooms[i], nFrames, true, &nDrawn);
+        double bruteForceMs = panGraph(graph, zooms[i], nFrames, false, NULL);
+        int maxDrawn = *std::max_element( nDrawn.begin(), nDrawn.end() );
+        std::cout << "Panning " << graph.nodes.size() << " nodes and " << graph.edges.size() << " edges at zoom " << zooms[i]
+                  << ": " << indexedMs << " ms/frame with the spatial index (at most " << maxDrawn << " items drawn), "
+                  << bruteForceMs << " ms/frame drawing all items" << std::endl;
+        ASSERT_LT( maxDrawn, (int)( graph.nodes.size() + graph.edges.size() ) );
+    }
+}
@@ -0,0 +1,119 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstdlib>
+#include <vector>
+#include <gtest/gtest.h>
+#include "Engine/Noise.h"
+
+NATRON_NAMESPACE_USING
+
+// Points with negative, integer and large coordinates, and a count that is not a multiple of the batch block size
+static std::vector<double>
+randomPoints(int count,
+             int dim)
+{
+    std::vector<double> points(count * dim);
+    srand(2020);
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        points[i] = (rand() / (double)RAND_MAX - 0.5) * 200.;
+        if (i % 7 == 0) {
+            points[i] = (int)points[i];
+        }
+    }
+
+    return points;
+}
+
+TEST(Noise, NoiseBatch) {
+    const int count = 1001;
+    std::vector<double> p = randomPoints(count, 3);
+    std::vector<double> batch(count * 3);
+
+    NoiseBatch<3, 1>(&p[0], &batch[0], count);
+    for (int i = 0; i < count; ++i) {
+        double ref;
+        Noise<3, 1>(&p[i * 3], &ref);
+        EXPECT_EQ(ref, batch[i]);
+    }
+
+    NoiseBatch<3, 3>(&p[0], &batch[0], count);
+    for (int i = 0; i < count; ++i) {
+        double ref[3];
+        Noise<3, 3>(&p[i * 3], ref);
+        for (int c = 0; c < 3; ++c) {
+            EXPECT_EQ(ref[c], batch[i * 3 + c]);
+        }
+    }
+}
+
+TEST(Noise, PNoiseBatch) {
+    const int count = 257;
+    std::vector<double> p = randomPoints(count, 3);
+    std::vector<double> batch(count);
+    const int period[3] = {3, 5, 16};
+
+    PNoiseBatch<3, 1>(&p[0], period, &batch[0], count);
+    for (int i = 0; i < count; ++i) {
+        double ref;
+        PNoise<3, 1>(&p[i * 3], period, &ref);
+        EXPECT_EQ(ref, batch[i]);
+    }
+}
+
+TEST(Noise, FBMBatch) {
+    const int count = 333;
+    std::vector<double> p = randomPoints(count, 3);
+    std::vector<double> batch(count);
+
+    FBMBatch<3, 1, false>(&p[0], &batch[0], count, 6, 2., 0.5);
+    for (int i = 0; i < count; ++i) {
+        double ref;
+        FBM<3, 1, false>(&p[i * 3], &ref, 6, 2., 0.5);
+        EXPECT_EQ(ref, batch[i]);
+    }
+
+    FBMBatch<3, 1, true>(&p[0], &batch[0], count, 4, 2.5, 0.4);
+    for (int i = 0; i < count; ++i) {
+        double ref;
+        FBM<3, 1, true>(&p[i * 3], &ref, 4, 2.5, 0.4);
+        EXPECT_EQ(ref, batch[i]);
+    }
+}
+
+TEST(Noise, CellNoiseBatch) {
+    const int count = 100;
+    std::vector<double> p = randomPoints(count, 3);
+    std::vector<double> batch(count);
+
+    CellNoiseBatch<3, 1>(&p[0], &batch[0], count);
+    for (int i = 0; i < count; ++i) {
+        double ref;
+        CellNoise<3, 1>(&p[i * 3], &ref);
+        EXPECT_EQ(ref, batch[i]);
+    }
+}
@@ -0,0 +1,592 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QStringList>
+
+#include "BaseTest.h"
+
+#include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
+#include "Engine/MemoryInfo.h"
+#include "Engine/OutputEffectInstance.h"
+#include "Engine/Project.h"
+#include "Engine/RenderStats.h"
+#include "Engine/Timer.h"
+
+/*
+ * Render benchmark: renders reference projects headlessly and compares the time spent by each node
+ * against a baseline, to catch performance regressions of the engine.
+ *
+ * The benchmark only runs when NATRON_BENCHMARK_PROJECTS is set, e.g:
+ *
+ * NATRON_BENCHMARK_PROJECTS=/path/to/projects NATRON_BENCHMARK_BASELINE=/path/to/baseline.json \
+ *     ./Tests --gtest_filter=RenderBenchmark.*
+ *
+ * Environment variables:
+ * - NATRON_BENCHMARK_PROJECTS: directory containing the .ntp projects to render. All the Write nodes of each project
+ *   render the frame range set in the project. The projects should write to a scratch directory.
+ * - NATRON_BENCHMARK_FRAMES: optional "first-last" frame range to render instead of the range of the Write nodes.
+ * - NATRON_BENCHMARK_OUTPUT: file where the results are written as JSON, "RenderBenchmark.json" by default.
+ *   To create or update a baseline, copy this file.
+ * - NATRON_BENCHMARK_BASELINE: optional results of a previous run to compare against.
+ * - NATRON_BENCHMARK_TOLERANCE: allowed relative slowdown of a project or node, 0.15 (15%) by default.
+ * - NATRON_BENCHMARK_MEMORY_TOLERANCE: allowed relative increase of the peak memory, 0.15 (15%) by default.
+ * - NATRON_BENCHMARK_MIN_TIME: timings below this duration, in seconds, are too noisy to be compared, 0.05 by default.
+ *
+ * Each project is rendered with empty caches. Note that the peak memory is the resident memory of the whole test process.
+ */
+
+#define kBenchmarkEnvProjects "NATRON_BENCHMARK_PROJECTS"
+#define kBenchmarkEnvFrames "NATRON_BENCHMARK_FRAMES"
+#define kBenchmarkEnvOutput "NATRON_BENCHMARK_OUTPUT"
+#define kBenchmarkEnvBaseline "NATRON_BENCHMARK_BASELINE"
+#define kBenchmarkEnvTolerance "NATRON_BENCHMARK_TOLERANCE"
+#define kBenchmarkEnvMemoryTolerance "NATRON_BENCHMARK_MEMORY_TOLERANCE"
+#define kBenchmarkEnvMinTime "NATRON_BENCHMARK_MIN_TIME"
+
+#define kBenchmarkDefaultOutput "RenderBenchmark.json"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+struct ProjectResults
+{
+    std::string name;
+
+    // Time to render all frames of all Write nodes, as seen by the caller
+    double renderTime;
+
+    // Sum of the statistics of all Write nodes of the project
+    RenderStatsTotals totals;
+
+    ProjectResults()
+        : name()
+        , renderTime(0)
+        , totals()
+    {
+    }
+};
+
+double
+getEnvDouble(const char* name,
+             double defaultValue)
+{
+    const char* value = std::getenv(name);
+
+    if (!value) {
+        return defaultValue;
+    }
+    char* end = 0;
+    double ret = std::strtod(value, &end);
+
+    return (end == value) ? defaultValue : ret;
+}
+
+/**
+ * @brief A minimal JSON reader, sufficient to read back the files written by writeResults()
+ **/
+struct JsonValue
+{
+    enum TypeEnum
+    {
+        eTypeNull = 0,
+        eTypeBool,
+        eTypeNumber,
+        eTypeString,
+        eTypeArray,
+        eTypeObject
+    };
+
+    TypeEnum type;
+    double number;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::map<std::string, JsonValue> object;
+
+    JsonValue()
+        : type(eTypeNull)
+        , number(0)
+        , string()
+        , array()
+        , object()
+    {
+    }
+
+    const JsonValue* get(const std::string& key) const
+    {
+        std::map<std::string, JsonValue>::const_iterator found = object.find(key);
+
+        return found == object.end() ? 0 : &found->second;
+    }
+
+    double getNumber(const std::string& key) const
+    {
+        const JsonValue* v = get(key);
+
+        return (v && v->type == eTypeNumber) ? v->number : 0.;
+    }
+};
+
+class JsonReader
+{
+public:
+
+    JsonReader(const std::string& text)
+        : _text(text)
+        , _pos(0)
+    {
+    }
+
+    bool parse(JsonValue* value)
+    {
+        if ( !parseValue(value) ) {
+            return false;
+        }
+        skipSpaces();
+
+        return _pos == _text.size();
+    }
+
+private:
+
+    void skipSpaces()
+    {
+        while ( _pos < _text.size() && std::isspace( (unsigned char)_text[_pos] ) ) {
+            ++_pos;
+        }
+    }
+
+    bool consume(char c)
+    {
+        skipSpaces();
+        if ( (_pos < _text.size()) && (_text[_pos] == c) ) {
+            ++_pos;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    bool consumeWord(const char* word)
+    {
+        std::size_t len = std::string(word).size();
+
+        if (_text.compare(_pos, len, word) != 0) {
+            return false;
+        }
+        _pos += len;
+
+        return true;
+    }
+
+    bool parseString(std::string* str)
+    {
+        if ( !consume('"') ) {
+            return false;
+        }
+        while (_pos < _text.size()) {
+            char c = _text[_pos++];
+            if (c == '"') {
+                return true;
+            } else if (c != '\\') {
+                str->push_back(c);
+            } else if ( _pos < _text.size() ) {
+                c = _text[_pos++];
+                switch (c) {
+                case 'n':
+                    str->push_back('\n');
+                    break;
+                case 't':
+                    str->push_back('\t');
+                    break;
+                case 'r':
+                    str->push_back('\r');
+                    break;
+                case 'b':
+                    str->push_back('\b');
+                    break;
+                case 'f':
+                    str->push_back('\f');
+                    break;
+                case 'u':
+                    // Node names are ASCII, unicode escapes are not decoded
+                    _pos = std::min(_pos + 4, _text.size());
+                    str->push_back('?');
+                    break;
+                default:
+                    str->push_back(c);
+                    break;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    bool parseValue(JsonValue* value)
+    {
+        skipSpaces();
+        if ( _pos >= _text.size() ) {
+            return false;
+        }
+        char c = _text[_pos];
+        if (c == '{') {
+            ++_pos;
+            value->type = JsonValue::eTypeObject;
+            if ( consume('}') ) {
+                return true;
+            }
+            do {
+                std::string key;
+                if ( !parseString(&key) || !consume(':') || !parseValue(&value->object[key]) ) {
+                    return false;
+                }
+            } while ( consume(',') );
+
+            return consume('}');
+        } else if (c == '[') {
+            ++_pos;
+            value->type = JsonValue::eTypeArray;
+            if ( consume(']') ) {
+                return true;
+            }
+            do {
+                value->array.push_back( JsonValue() );
+                if ( !parseValue(&value->array.back()) ) {
+                    return false;
+                }
+            } while ( consume(',') );
+
+            return consume(']');
+        } else if (c == '"') {
+            value->type = JsonValue::eTypeString;
+
+            return parseString(&value->string);
+        } else if ( consumeWord("true") ) {
+            value->type = JsonValue::eTypeBool;
+            value->number = 1.;
+
+            return true;
+        } else if ( consumeWord("false") ) {
+            value->type = JsonValue::eTypeBool;
+
+            return true;
+        } else if ( consumeWord("null") ) {
+            return true;
+        }
+
+        const char* start = _text.c_str() + _pos;
+        char* end = 0;
+        value->type = JsonValue::eTypeNumber;
+        value->number = std::strtod(start, &end);
+        if (end == start) {
+            return false;
+        }
+        _pos += end - start;
+
+        return true;
+    } // parseValue
+
+    const std::string& _text;
+    std::size_t _pos;
+};
+
+std::string
+escapeJsonString(const std::string& str)
+{
+    std::string ret;
+
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        char c = str[i];
+        if ( (c == '"') || (c == '\\') ) {
+            ret.push_back('\\');
+            ret.push_back(c);
+        } else if ( (unsigned char)c < 0x20 ) {
+            char buf[8];
+            std::sprintf(buf, "\\u%04x", (int)c);
+            ret.append(buf);
+        } else {
+            ret.push_back(c);
+        }
+    }
+
+    return ret;
+}
+
+bool
+writeResults(const std::string& filename,
+             const std::vector<ProjectResults>& results)
+{
+    std::ofstream ofile( filename.c_str() );
+
+    if (!ofile) {
+        return false;
+    }
+    ofile.precision(6);
+    ofile << "{" << std::endl;
+    ofile << "  \"natronVersion\": \"" << NATRON_VERSION_STRING << "\"," << std::endl;
+    ofile << "  \"projects\": {" << std::endl;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const ProjectResults& p = results[i];
+        ofile << "    \"" << escapeJsonString(p.name) << "\": {" << std::endl;
+        ofile << "      \"frames\": " << p.totals.nbFrames << "," << std::endl;
+        ofile << "      \"renderTime\": " << p.renderTime << "," << std::endl;
+        ofile << "      \"frameTime\": " << p.totals.wallTime << "," << std::endl;
+        ofile << "      \"peakRSS\": " << p.totals.peakRSS << "," << std::endl;
+        ofile << "      \"nodes\": {";
+        for (std::map<std::string, NodeRenderStatsTotals>::const_iterator it = p.totals.nodes.begin(); it != p.totals.nodes.end(); ++it) {
+            ofile << (it == p.totals.nodes.begin() ? "" : ",") << std::endl;
+            ofile << "        \"" << escapeJsonString(it->first) << "\": { "
+                  << "\"time\": " << it->second.timeSpentRendering << ", "
+                  << "\"cacheHits\": " << it->second.nbCacheHits << ", "
+                  << "\"cacheMisses\": " << it->second.nbCacheMisses << ", "
+                  << "\"cacheHitsDownscaled\": " << it->second.nbCacheHitButDownscaledImages << " }";
+        }
+        ofile << std::endl << "      }" << std::endl;
+        ofile << "    }" << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    ofile << "  }" << std::endl;
+    ofile << "}" << std::endl;
+
+    return bool(ofile);
+}
+
+bool
+readBaseline(const std::string& filename,
+             JsonValue* baseline)
+{
+    std::ifstream ifile( filename.c_str() );
+
+    if (!ifile) {
+        return false;
+    }
+    std::stringstream ss;
+    ss << ifile.rdbuf();
+    std::string text = ss.str();
+    JsonReader reader(text);
+
+    return reader.parse(baseline) && baseline->get("projects");
+}
+
+/**
+ * @brief Returns true and describes the regression in report if current is more than tolerance above baseline.
+ **/
+bool
+isRegression(const std::string& what,
+             double baseline,
+             double current,
+             double tolerance,
+             double minValue,
+             std::stringstream& report)
+{
+    if ( (current < minValue) || ( current <= baseline * (1. + tolerance) ) ) {
+        return false;
+    }
+    report << "  " << what << ": " << current << " (baseline: " << baseline << ", +"
+           << (baseline > 0 ? (current / baseline - 1.) * 100. : 100.) << "%)" << std::endl;
+
+    return true;
+}
+
+/**
+ * @brief Compares the results against the baseline and returns the number of regressions, which are described in report.
+ * Projects and nodes absent from the baseline are ignored.
+ **/
+int
+compareWithBaseline(const std::vector<ProjectResults>& results,
+                    const JsonValue& baseline,
+                    std::stringstream& report)
+{
+    const double tolerance = getEnvDouble(kBenchmarkEnvTolerance, 0.15);
+    const double memoryTolerance = getEnvDouble(kBenchmarkEnvMemoryTolerance, 0.15);
+    const double minTime = getEnvDouble(kBenchmarkEnvMinTime, 0.05);
+    const JsonValue* projects = baseline.get("projects");
+    int nRegressions = 0;
+
+    for (std::vector<ProjectResults>::const_iterator it = results.begin(); it != results.end(); ++it) {
+        const JsonValue* ref = projects->get(it->name);
+        if (!ref) {
+            report << it->name << ": not in the baseline" << std::endl;
+            continue;
+        }
+        if ( (int)ref->getNumber("frames") != it->totals.nbFrames ) {
+            // Timings are not comparable
+            report << it->name << ": " << it->totals.nbFrames << " frames rendered but the baseline has " << ref->getNumber("frames") << std::endl;
+            ++nRegressions;
+            continue;
+        }
+        std::stringstream projectReport;
+        int nProjectRegressions = 0;
+        nProjectRegressions += isRegression("render time (s)", ref->getNumber("renderTime"), it->renderTime, tolerance, minTime, projectReport);
+        nProjectRegressions += isRegression("peak memory (bytes)", ref->getNumber("peakRSS"), (double)it->totals.peakRSS, memoryTolerance, 0., projectReport);
+
+        const JsonValue* refNodes = ref->get("nodes");
+        for (std::map<std::string, NodeRenderStatsTotals>::const_iterator it2 = it->totals.nodes.begin(); it2 != it->totals.nodes.end(); ++it2) {
+            const JsonValue* refNode = refNodes ? refNodes->get(it2->first) : 0;
+            if (!refNode) {
+                continue;
+            }
+            nProjectRegressions += isRegression(it2->first + " time (s)", refNode->getNumber("time"), it2->second.timeSpentRendering,
+                                                tolerance, minTime, projectReport);
+            // Fewer cache hits means the same images are rendered several times
+            int refHits = (int)refNode->getNumber("cacheHits");
+            if ( it2->second.nbCacheHits < refHits * (1. - tolerance) ) {
+                projectReport << "  " << it2->first << " cache hits: " << it2->second.nbCacheHits << " (baseline: " << refHits << ")" << std::endl;
+                ++nProjectRegressions;
+            }
+        }
+        if (nProjectRegressions) {
+            report << it->name << ":" << std::endl << projectReport.str();
+            nRegressions += nProjectRegressions;
+        }
+    }
+
+    return nRegressions;
+} // compareWithBaseline
+} // anon
+
+class RenderBenchmark
+    : public BaseTest
+{
+protected:
+
+    /**
+     * @brief Loads the project and renders all its Write nodes with render statistics enabled
+     **/
+    void renderProject(const QString& filePath,
+                       int firstFrame,
+                       int lastFrame,
+                       ProjectResults* results)
+    {
+        // Start each project with empty caches so that results do not depend on the order of the projects
+        appPTR->clearAllCaches();
+
+        AppInstancePtr app = getApp()->loadProject( filePath.toStdString() );
+        ASSERT_TRUE( bool(app) ) << "Failed to load " << filePath.toStdString();
+
+        std::list<OutputEffectInstance*> writers;
+        app->getProject()->getWriters(&writers);
+        ASSERT_FALSE( writers.empty() ) << filePath.toStdString() << " has no Write node";
+
+        std::list<AppInstance::RenderWork> works;
+        for (std::list<OutputEffectInstance*>::const_iterator it = writers.begin(); it != writers.end(); ++it) {
+            (*it)->setRenderStatsTotalsEnabled(true);
+            works.push_back( AppInstance::RenderWork(*it, firstFrame, lastFrame, INT_MIN, true) );
+        }
+
+        TimeLapse timer;
+        app->startWritersRendering(true, works);
+        results->renderTime = timer.getTimeElapsedReset();
+
+        for (std::list<OutputEffectInstance*>::const_iterator it = writers.begin(); it != writers.end(); ++it) {
+            RenderStatsTotals totals = (*it)->getRenderStatsTotals();
+            (*it)->setRenderStatsTotalsEnabled(false);
+            results->totals.nbFrames += totals.nbFrames;
+            results->totals.wallTime += totals.wallTime;
+            results->totals.peakRSS = std::max(results->totals.peakRSS, totals.peakRSS);
+            for (std::map<std::string, NodeRenderStatsTotals>::const_iterator it2 = totals.nodes.begin(); it2 != totals.nodes.end(); ++it2) {
+                NodeRenderStatsTotals& nodeTotals = results->totals.nodes[it2->first];
+                nodeTotals.timeSpentRendering += it2->second.timeSpentRendering;
+                nodeTotals.nbCacheHits += it2->second.nbCacheHits;
+                nodeTotals.nbCacheMisses += it2->second.nbCacheMisses;
+                nodeTotals.nbCacheHitButDownscaledImages += it2->second.nbCacheHitButDownscaledImages;
+            }
+        }
+
+        app->resetProject();
+    }
+};
+
+TEST_F(RenderBenchmark,
+       ReferenceProjects)
+{
+    const char* projectsDir = std::getenv(kBenchmarkEnvProjects);
+
+    if (!projectsDir) {
+        std::cout << "Skipping the render benchmark: " kBenchmarkEnvProjects " is not set" << std::endl;
+
+        return;
+    }
+
+    int firstFrame = INT_MIN;
+    int lastFrame = INT_MAX;
+    const char* frames = std::getenv(kBenchmarkEnvFrames);
+    if (frames) {
+        ASSERT_EQ(2, std::sscanf(frames, "%d-%d", &firstFrame, &lastFrame) ) << "Invalid " kBenchmarkEnvFrames ": " << frames;
+    }
+
+    QDir dir( QString::fromUtf8(projectsDir) );
+    QStringList projects = dir.entryList(QStringList( QString::fromUtf8("*.ntp") ), QDir::Files, QDir::Name);
+    ASSERT_FALSE( projects.isEmpty() ) << "No project found in " << projectsDir;
+
+    std::vector<ProjectResults> results;
+    for (QStringList::const_iterator it = projects.begin(); it != projects.end(); ++it) {
+        ProjectResults projectResults;
+        projectResults.name = it->toStdString();
+        renderProject(dir.absoluteFilePath(*it), firstFrame, lastFrame, &projectResults);
+        if ( HasFatalFailure() ) {
+            return;
+        }
+        std::cout << projectResults.name << ": " << projectResults.totals.nbFrames << " frames in "
+                  << Timer::printAsTime(projectResults.renderTime, false).toStdString()
+                  << ", peak memory " << printAsRAM(projectResults.totals.peakRSS).toStdString() << std::endl;
+        results.push_back(projectResults);
+    }
+
+    const char* output = std::getenv(kBenchmarkEnvOutput);
+    std::string outputFile = output ? output : kBenchmarkDefaultOutput;
+    EXPECT_TRUE( writeResults(outputFile, results) ) << "Failed to write " << outputFile;
+    std::cout << "Benchmark results written to " << outputFile << std::endl;
+
+    const char* baselineFile = std::getenv(kBenchmarkEnvBaseline);
+    if (!baselineFile) {
+        return;
+    }
+    JsonValue baseline;
+    ASSERT_TRUE( readBaseline(baselineFile, &baseline) ) << "Failed to read the baseline " << baselineFile;
+
+    std::stringstream report;
+    int nRegressions = compareWithBaseline(results, baseline, report);
+    std::cout << report.str();
+    EXPECT_EQ(0, nRegressions) << "Performance regressions compared to " << baselineFile;
+}
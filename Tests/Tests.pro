@@ -46,10 +46,15 @@ SOURCES += \
     BaseTest.cpp \
     Hash64_Test.cpp \
     Image_Test.cpp \
+    LRUHashTable_Test.cpp \
     Lut_Test.cpp \
     KnobFile_Test.cpp \
     Curve_Test.cpp \
+    DiskCacheBenchmark_Test.cpp \
     Tracker_Test.cpp \
+    NodeGraphSpatialIndex_Test.cpp \
+    Noise_Test.cpp \
+    RenderBenchmark_Test.cpp \
     wmain.cpp
 
 HEADERS += \